@@ -0,0 +1,200 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "BootstrapCalibrator.h"
+#include "GeometryCache.h"
+#include <TStopwatch.h>
+#include <TMath.h>
+#include <TError.h>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+
+
+BootstrapCalibrator::BootstrapCalibrator()
+: Calibrator(),
+  fCentral(),
+  fNReplicates(50),
+  fNThreads(0),
+  fSeed(1),
+  fNGood(0),
+  fNThreadsUsed(0),
+  fReplicateBudget(0),
+  fReplicateCC(),
+  fReplicateTime(0)
+{
+}
+
+
+BootstrapCalibrator::~BootstrapCalibrator()
+{
+}
+
+
+SampleParameters BootstrapCalibrator::Calibrate ( std::vector<Sample> & samples, SampleParameters& initalParams )
+{
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < samples.size(); ++idx)
+    table.AddSample(samples[idx]);
+  return Calibrate(table, initalParams);
+}
+
+
+SampleParameters BootstrapCalibrator::Calibrate ( const ClusterTable& table, SampleParameters& initalParams )
+{
+  // the central fit, its sigma is the sigma of the replicates
+  fCentral.SetBootstrapSeed(0);
+  if( fResidualHistograms )
+    fCentral.SetResidualHistograms(fResidualHistograms);
+  if( fMemoryBudget > 0 )
+    fCentral.SetMemoryBudget(fMemoryBudget, fScratchDirectory.Data());
+  SampleParameters central = fCentral.Calibrate(table, initalParams);
+  fStats.Add(fCentral.GetStats());
+  const Double_t sigma = fCentral.GetFitSigma();
+
+  fNGood = initalParams.GetNGood();
+  fReplicateCC.assign(TMath::Max(fNReplicates, 0) * fNGood, 0.);
+  CoreParameters core;
+  initalParams.GetCore(core);
+  const GeometryCache geometry(core);
+
+  Int_t nThreads = fNThreads > 0 ? fNThreads : std::thread::hardware_concurrency();
+  nThreads = TMath::Max(1, TMath::Min(nThreads, fNReplicates));
+  fNThreadsUsed = nThreads;
+  // the threads share the budget
+  fReplicateBudget = fCentral.GetMemoryBudget() > 0 ? TMath::Max(fCentral.GetMemoryBudget() / nThreads, Long64_t(1)) : 0;
+
+  TStopwatch watch;
+  std::atomic<Int_t> next(0);
+  std::mutex statsMutex;
+  std::vector<std::thread> threads;
+  // the replicates start from the central fit
+  for(Int_t thread = 1; thread < nThreads; ++thread)
+    threads.push_back(std::thread(&BootstrapCalibrator::RunReplicates, this, std::cref(table), std::ref(central),
+				  std::cref(geometry), sigma, std::ref(next), std::ref(statsMutex)));
+  RunReplicates(table, central, geometry, sigma, next, statsMutex);
+  for(UInt_t thread = 0; thread < threads.size(); ++thread)
+    threads[thread].join();
+  fReplicateTime = watch.RealTime();
+
+  return central;
+}
+
+
+void BootstrapCalibrator::PrintReport ( Option_t* option ) const
+{
+  printf("BootstrapCalibrator.PrintReport\n");
+  printf("   replicates: %d, threads: %d, seed: %llu, replicate wall time: %g s\n",
+	 GetNReplicates(), fNThreadsUsed, (unsigned long long) fSeed, fReplicateTime);
+  if( fReplicateBudget > 0 )
+    printf("   memory budget per replicate: %lld bytes\n", (long long) fReplicateBudget);
+  if( GetNReplicates() ) {
+    // median relative spread of the channels fitted
+    std::vector<Double_t> relative;
+    for(UInt_t cell = 0; cell < fNGood; ++cell) {
+      const Double_t spread = GetSpread(cell);
+      if( spread > 0 )
+	relative.push_back(spread / TMath::Abs(GetMean(cell)));
+    }
+    if( ! relative.empty() ) {
+      std::nth_element(relative.begin(), relative.begin() + relative.size()/2, relative.end());
+      printf("   channels with spread: %d, median relative spread: %g\n", (Int_t) relative.size(), relative[relative.size()/2]);
+    }
+  }
+  printf("   central fit, samples: %d, unknowns: %d, sigma: %g, cost: %g, iterations: %d\n",
+	 (Int_t) fCentral.GetStats().GetCounter(CalibStats::kSamples), fCentral.GetNParams(),
+	 fCentral.GetFitSigma(), fCentral.GetCost(), fCentral.GetNIterations());
+  // timers and counters of the central fit and the replicates
+  Calibrator::PrintReport(option);
+}
+
+
+Double_t BootstrapCalibrator::GetMean ( UInt_t cell ) const
+{
+  const Int_t nReplicates = GetNReplicates();
+  if( ! nReplicates )
+    return 0;
+  Double_t sum = 0;
+  for(Int_t replicate = 0; replicate < nReplicates; ++replicate)
+    sum += GetReplicateCC(replicate, cell);
+  return sum / nReplicates;
+}
+
+
+Double_t BootstrapCalibrator::GetSpread ( UInt_t cell ) const
+{
+  const Int_t nReplicates = GetNReplicates();
+  if( nReplicates < 2 )
+    return 0;
+  const Double_t mean = GetMean(cell);
+  Double_t sum = 0;
+  for(Int_t replicate = 0; replicate < nReplicates; ++replicate) {
+    const Double_t d = GetReplicateCC(replicate, cell) - mean;
+    sum += d*d;
+  }
+  return TMath::Sqrt(sum / (nReplicates - 1));
+}
+
+
+Double_t BootstrapCalibrator::GetQuantile ( UInt_t cell, Double_t q ) const
+{
+  const Int_t nReplicates = GetNReplicates();
+  if( ! nReplicates )
+    return 0;
+  std::vector<Double_t> cc(nReplicates);
+  for(Int_t replicate = 0; replicate < nReplicates; ++replicate)
+    cc[replicate] = GetReplicateCC(replicate, cell);
+  std::sort(cc.begin(), cc.end());
+  const Double_t position = TMath::Max(0., TMath::Min(1., q)) * (nReplicates - 1);
+  const Int_t below = Int_t(position);
+  if( below + 1 >= nReplicates )
+    return cc[nReplicates - 1];
+  return cc[below] + (position - below) * (cc[below + 1] - cc[below]);
+}
+
+
+ULong64_t BootstrapCalibrator::GetReplicateSeed ( Int_t replicate ) const
+{
+  // distinct and non zero
+  return fSeed * 0x100000001B3ULL + replicate + 1;
+}
+
+
+void BootstrapCalibrator::RunReplicates ( const ClusterTable& table, SampleParameters& params, const GeometryCache& geometry,
+					  Double_t sigma, std::atomic<Int_t>& next, std::mutex& statsMutex )
+{
+  NLLSCalibrator fitter;
+  fitter.CopySettings(fCentral);
+  fitter.SetMemoryBudget(fReplicateBudget, fCentral.GetScratchDirectory());
+  fitter.SetSigma(sigma);
+  fitter.SetGeometry(&geometry);
+
+  for(Int_t replicate = next++; replicate < fNReplicates; replicate = next++) {
+    fitter.SetBootstrapSeed(GetReplicateSeed(replicate));
+    const SampleParameters result = fitter.Calibrate(table, params);
+    const Float_t* cc = result.GetCCArray().GetArray();
+    std::copy(cc, cc + fNGood, fReplicateCC.begin() + replicate*fNGood);
+  }
+
+  std::lock_guard<std::mutex> lock(statsMutex);
+  fStats.Add(fitter.GetStats());
+}
@@ -0,0 +1,102 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef BOOTSTRAPCALIBRATOR_H
+#define BOOTSTRAPCALIBRATOR_H
+
+#include "Calibrator.h"
+#include "NLLSCalibrator.h"
+#include "ClusterTable.h"
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+class GeometryCache;
+
+
+// Bootstrap uncertainties of the cc's. The robust loss makes the covariance
+// of the final normal matrix unreliable, so the samples are instead refitted
+// with N resamples and the cc's of each good channel summarised by the
+// mean, spread and quantiles of the refits.
+//
+// The resamples are Poisson weights of the samples generated on the fly
+// (NLLSCalibrator::PoissonWeight), not copies; the replicate fits run
+// concurrently on SetNThreads threads, each with its own NLLSCalibrator,
+// and share the (read only) ClusterTable, parameters and GeometryCache.
+// The fits have the settings of GetFitter, and the sigma of the central fit;
+// residual histograms are filled by the central fit. A memory budget is
+// that of the central fit, and is divided among the threads of the
+// replicates, each of which holds one fit at a time.
+class BootstrapCalibrator : public Calibrator
+{
+public:
+  BootstrapCalibrator();
+  virtual ~BootstrapCalibrator();
+
+  // the central fit, and the uncertainties of the replicates
+  virtual SampleParameters Calibrate(std::vector<Sample> & samples, SampleParameters& initalParams);
+  SampleParameters Calibrate(const ClusterTable& table, SampleParameters& initalParams);
+  virtual void PrintReport(Option_t* option = "") const;
+
+  // *** Settings ***
+  // the central fit, whose settings the replicates copy
+  NLLSCalibrator& GetFitter() { return fCentral; }
+  void SetNReplicates(Int_t n) { fNReplicates = n; }
+  // 0: a thread per hardware thread
+  void SetNThreads(Int_t n) { fNThreads = n; }
+  void SetSeed(ULong64_t seed) { fSeed = seed; }
+
+  // *** Result of last Calibrate, per good channel ***
+  Int_t GetNReplicates() const { return fNGood ? fReplicateCC.size() / fNGood : 0; }
+  Int_t GetNThreadsUsed() const { return fNThreadsUsed; }
+  // [bytes] the memory budget of each replicate fit, 0 for no limit
+  Long64_t GetReplicateBudget() const { return fReplicateBudget; }
+  Double_t GetReplicateCC(Int_t replicate, UInt_t cell) const { return fReplicateCC[replicate*fNGood + cell]; }
+  Double_t GetMean(UInt_t cell) const;
+  // standard deviation of the replicates
+  Double_t GetSpread(UInt_t cell) const;
+  // q in [0, 1], linear between order statistics
+  Double_t GetQuantile(UInt_t cell, Double_t q) const;
+  // the seed of the resample of replicate
+  ULong64_t GetReplicateSeed(Int_t replicate) const;
+
+private:
+  BootstrapCalibrator(const BootstrapCalibrator&); // Not Implemented
+  BootstrapCalibrator& operator= (const BootstrapCalibrator&); // Not Implemented
+
+  // fits replicates, taken from next, until none are left
+  void RunReplicates(const ClusterTable& table, SampleParameters& params, const GeometryCache& geometry,
+		     Double_t sigma, std::atomic<Int_t>& next, std::mutex& statsMutex);
+
+  NLLSCalibrator fCentral;
+  Int_t fNReplicates;
+  Int_t fNThreads;
+  ULong64_t fSeed;
+
+  UInt_t fNGood;
+  Int_t fNThreadsUsed;
+  Long64_t fReplicateBudget; // [bytes] the budget of the central fit over the threads
+  std::vector<Double_t> fReplicateCC; // [nReplicates*nGood]
+  Double_t fReplicateTime; // [s] wall time of the replicates
+};
+
+#endif // BOOTSTRAPCALIBRATOR_H
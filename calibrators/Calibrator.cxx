@@ -21,13 +21,60 @@
 */
 
 #include "Calibrator.h"
+#include "GeometryCache.h"
+#include "AutoDiff.h"
+#include "MassKernel.h"
+#include "NonLinearity.h"
+
+
+namespace {
+  // evaluates the mass, and optionally the dense gradient, of a sample
+  // with the kernel of the nonlinearity policy given by DispatchNonLinearity.
+  // With automatic, the gradient is by automatic differentiation, and
+  // includes the global parameters if global is given.
+  class SampleMass
+  {
+  public:
+    SampleMass(const Sample& s, const SampleParameters& p, const CoreGlobals& globals, const GeometryCache& geometry,
+	       std::vector<Double_t>* gradient, Bool_t automatic = kFALSE, Double_t* global = NULL)
+    : fSample(s), fParams(p), fGlobals(globals), fGeometry(geometry), fGradient(gradient), fAutomatic(automatic), fGlobal(global), fMass(0) {}
+
+    template<class NonLinearity> void operator() (const NonLinearity& nonLinearity);
+    Double_t GetMass() const { return fMass; }
+
+  private:
+    SampleMass(const SampleMass&); // Not Implemented
+    SampleMass& operator= (const SampleMass&); // Not Implemented
+
+    const Sample& fSample;
+    const SampleParameters& fParams;
+    const CoreGlobals& fGlobals;
+    const GeometryCache& fGeometry;
+    std::vector<Double_t>* fGradient;
+    Bool_t fAutomatic;
+    Double_t* fGlobal;
+    Double_t fMass;
+  };
+}
 
 Calibrator::Calibrator()
+: TObject(),
+  fStats("CalibratorStats", "Calibrator stage timers and counters"),
+  fTelemetry(NULL),
+  fResidualHistograms(NULL),
+  fMemoryBudget(0),
+  fScratchDirectory("/tmp")
 {
 //TODO
 }
 
-Calibrator::Calibrator ( const TObject& object ) : TObject ( object )
+Calibrator::Calibrator ( const TObject& object )
+: TObject ( object ),
+  fStats("CalibratorStats", "Calibrator stage timers and counters"),
+  fTelemetry(NULL),
+  fResidualHistograms(NULL),
+  fMemoryBudget(0),
+  fScratchDirectory("/tmp")
 {
 //TODO
 }
@@ -43,15 +90,121 @@ const Calibrator& Calibrator::operator= ( const TObject& object )
   return *this;
 }
 
-Double_t Calibrator::M ( Sample s, SampleParameters p )
+Double_t Calibrator::M ( const Sample& s, const SampleParameters& p )
+{
+  // builds the geometry cache for a single evaluation, use the
+  // GeometryCache overload when evaluating many samples.
+  CoreParameters core;
+  p.GetCore(core);
+  const GeometryCache geometry(core);
+  return M(s, p, geometry);
+}
+
+
+Double_t Calibrator::M ( const Sample& s, const SampleParameters& p, const GeometryCache& geometry )
 {
-  //TODO
-  return 0;
+  const CoreGlobals globals = p.GetCoreGlobals();
+  SampleMass sampleMass(s, p, globals, geometry, NULL);
+  DispatchNonLinearity(globals, sampleMass);
+  return sampleMass.GetMass();
 }
 
 
+std::vector<Double_t> Calibrator::M_p ( const Sample& s, const SampleParameters& p )
+{
+  CoreParameters core;
+  p.GetCore(core);
+  const GeometryCache geometry(core);
+  return M_p(s, p, geometry);
+}
+
 
+std::vector<Double_t> Calibrator::M_p ( const Sample& s, const SampleParameters& p, const GeometryCache& geometry )
+{
+  // dM/dcc_i, for all good channels i.
+  std::vector<Double_t> gradient(p.GetNGood(), 0.);
+  const CoreGlobals globals = p.GetCoreGlobals();
+  SampleMass sampleMass(s, p, globals, geometry, &gradient);
+  DispatchNonLinearity(globals, sampleMass);
+  return gradient;
+}
 
 
+std::vector<Double_t> Calibrator::M_pAD ( const Sample& s, const SampleParameters& p, const GeometryCache& geometry, Double_t* dMdGlobal )
+{
+  std::vector<Double_t> gradient(p.GetNGood(), 0.);
+  const CoreGlobals globals = p.GetCoreGlobals();
+  SampleMass sampleMass(s, p, globals, geometry, &gradient, kTRUE, dMdGlobal);
+  DispatchNonLinearity(globals, sampleMass);
+  return gradient;
+}
 
 
+void Calibrator::PrintReport ( Option_t* option ) const
+{
+  printf("Calibrator.PrintReport, %s\n", ClassName());
+  fStats.Print(option);
+}
+
+
+
+void Calibrator::GetCells ( const TArrayF& amplitudes, std::vector<Int_t>& index, std::vector<Float_t>& amp )
+{
+  index.clear();
+  amp.clear();
+  const Float_t* array = amplitudes.GetArray();
+  for(Int_t idx = 0; idx < amplitudes.GetSize(); ++idx) {
+    if( array[idx] <= 0 )
+      continue;
+    index.push_back(idx);
+    amp.push_back(array[idx]);
+  }
+}
+
+
+template<class NonLinearity>
+void SampleMass::operator() ( const NonLinearity& nonLinearity )
+{
+  // a sample with an empty cluster has no mass, 0, nor gradient, as
+  // ClusterTable::AddSample skips it
+  std::vector<Int_t> index1, index2;
+  std::vector<Float_t> amp1, amp2;
+  Calibrator::GetCells(fSample.Amplitudes1(), index1, amp1);
+  Calibrator::GetCells(fSample.Amplitudes2(), index2, amp2);
+  fMass = 0;
+  if( index1.empty() || index2.empty() )
+    return;
+
+  const TArrayF& ccArray = fParams.GetCCArray();
+  const std::vector<Double_t> cc(ccArray.GetArray(), ccArray.GetArray() + ccArray.GetSize());
+  const MassKernel<Double_t, NonLinearity> kernel(fGeometry, fGlobals, nonLinearity, &cc[0]);
+  const Bool_t derivatives = fGradient != NULL && ! fAutomatic;
+
+  ClusterState<Double_t> c1, c2;
+  kernel.EvalCluster(&index1[0], &amp1[0], index1.size(), c1, derivatives);
+  kernel.EvalCluster(&index2[0], &amp2[0], index2.size(), c2, derivatives);
+
+  const Double_t vertex[3] = {fSample.GetVertex().X(), fSample.GetVertex().Y(), fSample.GetVertex().Z()};
+  if( fAutomatic ) {
+    std::vector<Double_t> grad1(index1.size()), grad2(index2.size());
+    fMass = MassGradientAD(fGeometry, fGlobals, nonLinearity, &cc[0],
+			   &index1[0], &amp1[0], index1.size(), &index2[0], &amp2[0], index2.size(),
+			   vertex, &grad1[0], &grad2[0], fGlobal);
+    for(UInt_t idx = 0; idx < index1.size(); ++idx)
+      (*fGradient)[index1[idx]] += grad1[idx];
+    for(UInt_t idx = 0; idx < index2.size(); ++idx)
+      (*fGradient)[index2[idx]] += grad2[idx];
+    return;
+  }
+  if( ! derivatives ) {
+    fMass = MassKernel<Double_t, NonLinearity>::Mass(c1, c2, vertex);
+    return;
+  }
+
+  std::vector<Double_t> grad1(index1.size()), grad2(index2.size());
+  fMass = MassKernel<Double_t, NonLinearity>::MassGradient(c1, c2, vertex, &grad1[0], &grad2[0]);
+  for(UInt_t idx = 0; idx < index1.size(); ++idx)
+    (*fGradient)[index1[idx]] += grad1[idx];
+  for(UInt_t idx = 0; idx < index2.size(); ++idx)
+    (*fGradient)[index2[idx]] += grad2[idx];
+}
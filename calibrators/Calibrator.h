@@ -26,8 +26,14 @@
 #include <TObject.h>
 #include <Sample.h>
 #include <SampleParameters.h>
+#include <CalibStats.h>
+#include <TString.h>
 #include <vector>
 
+class GeometryCache;
+class Telemetry;
+class ResidualHistograms;
+
 
 class Calibrator : public TObject
 {
@@ -37,12 +43,52 @@ public:
   virtual ~Calibrator();
   const Calibrator& operator= ( const TObject& object );
 
-  static Double_t M(Sample s, SampleParameters p);
-  static std::vector<Double_t> M_p(Sample s, SampleParameters p);
+  // the mass of a sample, 0 (and no gradient) if either cluster has no cells
+  static Double_t M(const Sample& s, const SampleParameters& p);
+  static Double_t M(const Sample& s, const SampleParameters& p, const GeometryCache& geometry);
+  static std::vector<Double_t> M_p(const Sample& s, const SampleParameters& p);
+  static std::vector<Double_t> M_p(const Sample& s, const SampleParameters& p, const GeometryCache& geometry);
+  // M_p by automatic differentiation, and if dMdGlobal is given, the
+  // derivatives wrt. (LogWeight, Para, Parb).
+  static std::vector<Double_t> M_pAD(const Sample& s, const SampleParameters& p, const GeometryCache& geometry, Double_t* dMdGlobal = NULL);
+
+  // gathers the good channel indices and amplitudes of the non zero
+  // entries of a (dense) sample amplitude array.
+  static void GetCells(const TArrayF& amplitudes, std::vector<Int_t>& index, std::vector<Float_t>& amp);
   
 
   virtual SampleParameters Calibrate(std::vector<Sample> & samples, SampleParameters& initalParams) = 0;
 
+  // calibration report, stage timers and counters
+  CalibStats& GetStats() { return fStats; }
+  const CalibStats& GetStats() const { return fStats; }
+  virtual void PrintReport(Option_t* option = "") const;
+
+  // per iteration records of the fits, not owned, NULL for none
+  void SetTelemetry(Telemetry* telemetry) { fTelemetry = telemetry; }
+  Telemetry* GetTelemetry() const { return fTelemetry; }
+  // per cell and module pulls of the final residuals of a calibration,
+  // reset as each fit starts (ResidualHistograms::Add merges several);
+  // not owned, NULL for none
+  void SetResidualHistograms(ResidualHistograms* histograms) { fResidualHistograms = histograms; }
+  ResidualHistograms* GetResidualHistograms() const { return fResidualHistograms; }
+  // bytes the jacobian or normal matrix of a calibration may take in
+  // memory, 0 for no limit; beyond it the jacobian rows are spilled to
+  // memory mapped scratch files in scratchDirectory (NLLSCalibrator)
+  void SetMemoryBudget(Long64_t bytes, const char* scratchDirectory = "/tmp") { fMemoryBudget = bytes; fScratchDirectory = scratchDirectory; }
+  Long64_t GetMemoryBudget() const { return fMemoryBudget; }
+  const char* GetScratchDirectory() const { return fScratchDirectory.Data(); }
+
+protected:
+  CalibStats fStats; // residual, jacobian, solve and io timers, sample and iteration counters
+  Telemetry* fTelemetry;
+  ResidualHistograms* fResidualHistograms;
+  Long64_t fMemoryBudget; // [bytes] 0 for none
+  TString fScratchDirectory;
+
+private:
+  Calibrator(const Calibrator&); // Not Implemented
+  Calibrator& operator= (const Calibrator&); // Not Implemented
 };
 
 #endif // CALIBRATOR_H
@@ -0,0 +1,183 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "CellOrdering.h"
+#include "SampleParameters.h"
+#include "ClusterTable.h"
+#include "GeometryCache.h"
+#include <TError.h>
+#include <algorithm>
+
+
+CellOrdering::CellOrdering()
+: fBlockSize(64),
+  fNewIndex(),
+  fOldIndex(),
+  fAbsId(),
+  fOldSample()
+{
+}
+
+
+void CellOrdering::Compute ( const SampleParameters& params )
+{
+  // order 6, the 64x56 cells of a module in a 64x64 square
+  const UInt_t order = 6;
+  const UInt_t nGood = params.GetNGood();
+  std::vector< std::pair<ULong64_t, Int_t> > keys(nGood);
+  fAbsId.resize(nGood);
+  for(UInt_t index = 0; index < nGood; ++index) {
+    const Int_t absId = params.GetIDArray()[index];
+    const ULong64_t module = GeometryCache::AbsIdToModule(absId);
+    const UInt_t curve = HilbertIndex(order, GeometryCache::AbsIdToRowX(absId), GeometryCache::AbsIdToColZ(absId));
+    keys[index] = std::make_pair((module << 32) | curve, Int_t(index));
+    fAbsId[index] = absId;
+  }
+  std::sort(keys.begin(), keys.end());
+
+  fNewIndex.resize(nGood);
+  fOldIndex.resize(nGood);
+  for(UInt_t index = 0; index < nGood; ++index) {
+    fOldIndex[index] = keys[index].second;
+    fNewIndex[keys[index].second] = index;
+  }
+}
+
+
+Bool_t CellOrdering::Apply ( const SampleParameters& params, SampleParameters& ordered ) const
+{
+  const UInt_t nGood = params.GetNGood();
+  if( nGood != GetNCells() ) {
+    Error("Apply", "parameters of %d good channels, the ordering of %d", nGood, GetNCells());
+    return kFALSE;
+  }
+  for(UInt_t index = 0; index < nGood; ++index)
+    if( params.GetIDArray()[index] != fAbsId[index] ) {
+      Error("Apply", "good channel %d has absId %d, the ordering %d", index, params.GetIDArray()[index], fAbsId[index]);
+      return kFALSE;
+    }
+
+  ordered = params;
+  for(UInt_t index = 0; index < nGood; ++index) {
+    const Int_t old = fOldIndex[index];
+    ordered.SetID(index, params.GetIDArray()[old]);
+    ordered.SetCC(index, params.GetCCArray()[old]);
+    if( params.GetLocalPos(old) )
+      ordered.SetLocalPos(index, *params.GetLocalPos(old));
+    else
+      ordered.RemoveLocalPos(index);
+  }
+  return kTRUE;
+}
+
+
+void CellOrdering::Apply ( const ClusterTable& table, ClusterTable& ordered )
+{
+  // the samples sorted by the dominant blocks of their clusters, the lower
+  // block first, stable within a pair of blocks
+  const UInt_t nSamples = table.GetNSamples();
+  std::vector< std::pair<ULong64_t, UInt_t> > keys(nSamples);
+  for(UInt_t sample = 0; sample < nSamples; ++sample) {
+    const ULong64_t block1 = DominantBlock(table, table.GetCluster1(sample));
+    const ULong64_t block2 = DominantBlock(table, table.GetCluster2(sample));
+    keys[sample] = std::make_pair((std::min(block1, block2) << 32) | std::max(block1, block2), sample);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // the clusters in the order of their first sample, the cells renumbered
+  ordered.Clear();
+  fOldSample.resize(nSamples);
+  std::vector<Int_t> newCluster(table.GetNClusters(), -1);
+  std::vector<Int_t> index;
+  for(UInt_t sample = 0; sample < nSamples; ++sample) {
+    fOldSample[sample] = keys[sample].second;
+    Int_t clusters[2] = {table.GetCluster1(fOldSample[sample]), table.GetCluster2(fOldSample[sample])};
+    for(Int_t idx = 0; idx < 2; ++idx) {
+      const Int_t cluster = clusters[idx];
+      if( newCluster[cluster] < 0 ) {
+	const Int_t nCells = table.GetNCells(cluster);
+	index.resize(nCells);
+	for(Int_t cell = 0; cell < nCells; ++cell)
+	  index[cell] = fNewIndex[table.GetCellIndex(cluster)[cell]];
+	const Float_t* amp = nCells ? table.GetCellAmp(cluster) : NULL;
+	newCluster[cluster] = ordered.AddCluster(nCells ? &index[0] : NULL, amp, nCells, kFALSE);
+      }
+      clusters[idx] = newCluster[cluster];
+    }
+    ordered.AddPair(clusters[0], clusters[1], table.GetVertex(fOldSample[sample]));
+  }
+}
+
+
+Bool_t CellOrdering::Restore ( const SampleParameters& ordered, SampleParameters& params ) const
+{
+  const UInt_t nGood = ordered.GetNGood();
+  if( nGood != GetNCells() || UInt_t(params.GetNGood()) != nGood ) {
+    Error("Restore", "parameters of %d and %d good channels, the ordering of %d", nGood, params.GetNGood(), GetNCells());
+    return kFALSE;
+  }
+  for(UInt_t index = 0; index < nGood; ++index) {
+    const Int_t old = fOldIndex[index];
+    if( params.GetIDArray()[old] != ordered.GetIDArray()[index] ) {
+      Error("Restore", "ordered channel %d has absId %d, expected %d", index, ordered.GetIDArray()[index], params.GetIDArray()[old]);
+      return kFALSE;
+    }
+    params.SetCC(old, ordered.GetCCArray()[index]);
+  }
+  return kTRUE;
+}
+
+
+UInt_t CellOrdering::HilbertIndex ( UInt_t order, UInt_t x, UInt_t z )
+{
+  // quadrant by quadrant, from the largest, the square rotated such that
+  // the curve in each quadrant starts where the previous ended
+  UInt_t distance = 0;
+  for(UInt_t s = 1U << (order - 1); s > 0; s >>= 1) {
+    const UInt_t rx = (x & s) > 0;
+    const UInt_t rz = (z & s) > 0;
+    distance += s * s * ((3 * rx) ^ rz);
+    if( ! rz ) {
+      if( rx ) {
+	x = s - 1 - (x & (s - 1));
+	z = s - 1 - (z & (s - 1));
+      }
+      std::swap(x, z);
+    }
+  }
+  return distance;
+}
+
+
+Int_t CellOrdering::DominantBlock ( const ClusterTable& table, Int_t cluster ) const
+{
+  // a cluster without cells after the last block
+  if( ! table.GetNCells(cluster) )
+    return GetNCells() / fBlockSize + 1;
+  const Int_t* index = table.GetCellIndex(cluster);
+  const Float_t* amp = table.GetCellAmp(cluster);
+  Int_t dominant = 0;
+  for(Int_t cell = 1; cell < table.GetNCells(cluster); ++cell)
+    if( amp[cell] > amp[dominant] )
+      dominant = cell;
+  return fNewIndex[index[dominant]] / fBlockSize;
+}
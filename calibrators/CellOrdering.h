@@ -0,0 +1,88 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef CELLORDERING_H
+#define CELLORDERING_H
+
+#include <Rtypes.h>
+#include <vector>
+
+class SampleParameters;
+class ClusterTable;
+
+
+// A locality preserving order of the good channels and of the samples, a
+// preprocessing stage of the calibration.
+//
+// The kernels read the cc's and the cell geometry at the cell indices of
+// the clusters. In the order of ExtractorTask::SetParameters (module, row,
+// column) and with the samples in event order, those reads are scattered.
+// Compute renumbers the good channels along a Hilbert curve of (row x,
+// column z) within each module, so that the cells of a cluster are close in
+// memory, and Apply sorts the samples by the blocks of the cells of largest
+// amplitude of their clusters, so that consecutive samples read the same
+// cache lines.
+//
+// The ordered parameters keep the PHOS absIds (GetIDArray), and Restore
+// maps the cc's of a calibration of the ordered samples back to the good
+// channel order of the original parameters.
+class CellOrdering
+{
+public:
+  CellOrdering();
+
+  // cells of a block for the sort of the samples, 64 by default
+  void SetBlockSize(UInt_t cells) { fBlockSize = cells > 0 ? cells : 1; }
+  UInt_t GetBlockSize() const { return fBlockSize; }
+
+  // the order of the good channels of params
+  void Compute(const SampleParameters& params);
+
+  // params renumbered, kFALSE if params has other good channels
+  Bool_t Apply(const SampleParameters& params, SampleParameters& ordered) const;
+  // the clusters of table renumbered, and the samples sorted, into ordered
+  void Apply(const ClusterTable& table, ClusterTable& ordered);
+  // the cc's of ordered (Apply) to the channels of params
+  Bool_t Restore(const SampleParameters& ordered, SampleParameters& params) const;
+
+  // *** The permutations ***
+  UInt_t GetNCells() const { return fNewIndex.size(); }
+  Int_t GetNewIndex(UInt_t oldIndex) const { return fNewIndex[oldIndex]; }
+  Int_t GetOldIndex(UInt_t newIndex) const { return fOldIndex[newIndex]; }
+  // sample of the table of the last Apply at a sample of ordered
+  UInt_t GetOldSample(UInt_t newSample) const { return fOldSample[newSample]; }
+
+  // distance of (x, z) along the Hilbert curve of a 2^order square
+  static UInt_t HilbertIndex(UInt_t order, UInt_t x, UInt_t z);
+
+private:
+  // block of the cell of largest amplitude, past the last for no cells
+  Int_t DominantBlock(const ClusterTable& table, Int_t cluster) const;
+
+  UInt_t fBlockSize;
+  std::vector<Int_t> fNewIndex; // [nGood] ordered index of good channel
+  std::vector<Int_t> fOldIndex; // [nGood] good channel of ordered index
+  std::vector<Int_t> fAbsId; // [nGood] absId of good channel, for Apply
+  std::vector<UInt_t> fOldSample; // [nSamples] of the last Apply
+};
+
+#endif // CELLORDERING_H
@@ -0,0 +1,176 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ClusterTable.h"
+#include "Calibrator.h"
+#include "SampleEvent.h"
+#include "SampleBatch.h"
+#include "CoreSampleSet.h"
+#include <cstring>
+
+
+ClusterTable::ClusterTable()
+: fClusterBegin(1, 0),
+  fCellIndex(),
+  fCellAmp(),
+  fCluster(),
+  fVertex(),
+  fHashes(),
+  fNShared(0),
+  fIndex(),
+  fAmp()
+{
+}
+
+
+void ClusterTable::Clear()
+{
+  fClusterBegin.assign(1, 0);
+  fCellIndex.clear();
+  fCellAmp.clear();
+  fCluster.clear();
+  fVertex.clear();
+  fHashes.clear();
+  fNShared = 0;
+}
+
+
+Bool_t ClusterTable::AddSample ( const Sample& sample )
+{
+  // both clusters are checked before either is added
+  Calibrator::GetCells(sample.Amplitudes1(), fIndex[0], fAmp[0]);
+  Calibrator::GetCells(sample.Amplitudes2(), fIndex[1], fAmp[1]);
+  if( fIndex[0].empty() || fIndex[1].empty() )
+    return kFALSE;
+  const Int_t cluster1 = AddCluster(&fIndex[0][0], &fAmp[0][0], fIndex[0].size());
+  const Int_t cluster2 = AddCluster(&fIndex[1][0], &fAmp[1][0], fIndex[1].size());
+
+  const Double_t vertex[3] = {sample.GetVertex().X(), sample.GetVertex().Y(), sample.GetVertex().Z()};
+  AddPair(cluster1, cluster2, vertex);
+  return kTRUE;
+}
+
+
+void ClusterTable::AddEvent ( const SampleEvent& event )
+{
+  // cluster ids of the event to ids of the table
+  const Int_t first = GetNClusters();
+  for(Int_t cluster = 0; cluster < event.GetNClusters(); ++cluster)
+    AddCluster(event.GetCellIndex(cluster), event.GetCellAmp(cluster), event.GetNCells(cluster), kFALSE);
+
+  const Double_t vertex[3] = {event.GetVertex().X(), event.GetVertex().Y(), event.GetVertex().Z()};
+  Int_t nPairs = 0;
+  for(Int_t pair = 0; pair < event.GetNPairs(); ++pair) {
+    const Int_t cluster1 = event.GetCluster1(pair);
+    const Int_t cluster2 = event.GetCluster2(pair);
+    if( ! event.GetNCells(cluster1) || ! event.GetNCells(cluster2) )
+      continue;
+    AddPair(first + cluster1, first + cluster2, vertex);
+    ++nPairs;
+  }
+  if( 2*nPairs > event.GetNClusters() )
+    fNShared += 2*nPairs - event.GetNClusters();
+}
+
+
+UInt_t ClusterTable::AddBatch ( const SampleBatch& batch )
+{
+  UInt_t nPairs = 0;
+  for(UInt_t sample = 0; sample < batch.GetNSamples(); ++sample) {
+    if( ! batch.GetNCells(sample, 0) || ! batch.GetNCells(sample, 1) )
+      continue;
+    const Int_t cluster1 = AddCluster(batch.GetCellIndex(sample, 0), batch.GetCellAmp(sample, 0), batch.GetNCells(sample, 0));
+    const Int_t cluster2 = AddCluster(batch.GetCellIndex(sample, 1), batch.GetCellAmp(sample, 1), batch.GetNCells(sample, 1));
+    Double_t vertex[3];
+    batch.GetVertex(sample, vertex);
+    AddPair(cluster1, cluster2, vertex);
+    ++nPairs;
+  }
+  return nPairs;
+}
+
+
+Int_t ClusterTable::AddCluster ( const Int_t* index, const Float_t* amp, Int_t nCells, Bool_t deduplicate )
+{
+  ULong64_t hash = 0;
+  if( deduplicate ) {
+    hash = Hash(index, amp, nCells);
+    typedef std::unordered_multimap<ULong64_t, Int_t>::const_iterator Iterator;
+    const std::pair<Iterator, Iterator> range = fHashes.equal_range(hash);
+    for(Iterator it = range.first; it != range.second; ++it) {
+      const Int_t cluster = it->second;
+      if( GetNCells(cluster) == nCells
+	  && ! memcmp(GetCellIndex(cluster), index, nCells*sizeof(Int_t))
+	  && ! memcmp(GetCellAmp(cluster), amp, nCells*sizeof(Float_t)) ) {
+	++fNShared;
+	return cluster;
+      }
+    }
+  }
+
+  const Int_t cluster = GetNClusters();
+  fCellIndex.insert(fCellIndex.end(), index, index + nCells);
+  fCellAmp.insert(fCellAmp.end(), amp, amp + nCells);
+  fClusterBegin.push_back(fCellIndex.size());
+  if( deduplicate )
+    fHashes.insert(std::make_pair(hash, cluster));
+  return cluster;
+}
+
+
+void ClusterTable::AddPair ( Int_t cluster1, Int_t cluster2, const Double_t vertex[3] )
+{
+  fCluster.push_back(cluster1);
+  fCluster.push_back(cluster2);
+  fVertex.insert(fVertex.end(), vertex, vertex + 3);
+}
+
+
+ULong64_t ClusterTable::Hash ( const Int_t* index, const Float_t* amp, Int_t nCells ) const
+{
+  // FNV-1a over the bytes of the cells
+  ULong64_t hash = 14695981039346656037ULL;
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(index);
+  for(UInt_t idx = 0; idx < nCells*sizeof(Int_t); ++idx)
+    hash = (hash ^ bytes[idx]) * 1099511628211ULL;
+  bytes = reinterpret_cast<const unsigned char*>(amp);
+  for(UInt_t idx = 0; idx < nCells*sizeof(Float_t); ++idx)
+    hash = (hash ^ bytes[idx]) * 1099511628211ULL;
+  return hash;
+}
+
+
+void ClusterTable::GetCore ( CoreSampleSet& set ) const
+{
+  set.Clear();
+  std::vector<CoreCell> cells;
+  for(UInt_t cluster = 0; cluster < GetNClusters(); ++cluster) {
+    cells.resize(GetNCells(cluster));
+    for(Int_t cell = 0; cell < GetNCells(cluster); ++cell) {
+      cells[cell].fIndex = GetCellIndex(cluster)[cell];
+      cells[cell].fAmp = GetCellAmp(cluster)[cell];
+    }
+    set.AddCluster(cells.empty() ? NULL : &cells[0], cells.size());
+  }
+  for(UInt_t sample = 0; sample < GetNSamples(); ++sample)
+    set.AddSample(GetCluster1(sample), GetCluster2(sample), GetVertex(sample));
+}
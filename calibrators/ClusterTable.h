@@ -0,0 +1,98 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef CLUSTERTABLE_H
+#define CLUSTERTABLE_H
+
+#include <Rtypes.h>
+#include <vector>
+#include <unordered_map>
+
+class Sample;
+class SampleEvent;
+class SampleBatch;
+class CoreSampleSet;
+
+
+// The samples as a table of unique clusters and pairs of cluster ids, for
+// the calibration inner loop. A cluster which is paired with several others
+// (ExtractCandidates pairs every selected cluster of an event) is stored,
+// and evaluated by the mass model, once.
+//
+// The cells of a cluster are its good channel indices and amplitudes, in
+// flat arrays. Clusters added by AddSample are deduplicated by content;
+// the clusters of a SampleEvent are unique within the event already.
+class ClusterTable
+{
+public:
+  ClusterTable();
+
+  void Clear();
+  // adds the pair of sample; kFALSE, and nothing added, if either cluster
+  // has no cells
+  Bool_t AddSample(const Sample& sample);
+  // adds the clusters and pairs of an event
+  void AddEvent(const SampleEvent& event);
+  // adds the samples of a batch, the number of pairs added
+  UInt_t AddBatch(const SampleBatch& batch);
+  // id of the cluster, the id of an identical cluster if deduplicate and
+  // there is one.
+  Int_t AddCluster(const Int_t* index, const Float_t* amp, Int_t nCells, Bool_t deduplicate = kTRUE);
+  void AddPair(Int_t cluster1, Int_t cluster2, const Double_t vertex[3]);
+
+  // *** Clusters ***
+  UInt_t GetNClusters() const { return fClusterBegin.size() - 1; }
+  Int_t GetNCells(Int_t cluster) const { return fClusterBegin[cluster+1] - fClusterBegin[cluster]; }
+  const Int_t* GetCellIndex(Int_t cluster) const { return &fCellIndex[fClusterBegin[cluster]]; }
+  const Float_t* GetCellAmp(Int_t cluster) const { return &fCellAmp[fClusterBegin[cluster]]; }
+  UInt_t GetNCellEntries() const { return fCellIndex.size(); }
+  const std::vector<Int_t>& GetCellIndexArray() const { return fCellIndex; }
+
+  // *** Pairs, the samples ***
+  UInt_t GetNSamples() const { return fCluster.size() / 2; }
+  Int_t GetCluster1(UInt_t sample) const { return fCluster[2*sample]; }
+  Int_t GetCluster2(UInt_t sample) const { return fCluster[2*sample+1]; }
+  const Double_t* GetVertex(UInt_t sample) const { return &fVertex[3*sample]; }
+
+  // cluster references resolved to an existing cluster
+  UInt_t GetNShared() const { return fNShared; }
+
+  // the clusters and pairs as plain values (libCalibCore)
+  void GetCore(CoreSampleSet& set) const;
+
+private:
+  ULong64_t Hash(const Int_t* index, const Float_t* amp, Int_t nCells) const;
+
+  std::vector<UInt_t> fClusterBegin; // [nClusters+1] first cell of cluster
+  std::vector<Int_t> fCellIndex; // good channel index of cell
+  std::vector<Float_t> fCellAmp; // amplitude of cell
+  std::vector<Int_t> fCluster; // [2*nSamples] cluster ids of sample
+  std::vector<Double_t> fVertex; // [3*nSamples]
+  std::unordered_multimap<ULong64_t, Int_t> fHashes; // content hash to cluster id
+  UInt_t fNShared;
+
+  // work, the cells of the two clusters of a sample
+  std::vector<Int_t> fIndex[2];
+  std::vector<Float_t> fAmp[2];
+};
+
+#endif // CLUSTERTABLE_H
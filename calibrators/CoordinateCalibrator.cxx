@@ -0,0 +1,689 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "CoordinateCalibrator.h"
+#include "GeometryCache.h"
+#include "NLLSCalibrator.h"
+#include "MultilevelCalibrator.h"
+#include "NonLinearity.h"
+#include "Telemetry.h"
+#include "ResidualHistograms.h"
+#include <TMath.h>
+#include <TError.h>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+namespace {
+  const Double_t kMaxStep = 0.5; // largest relative change of a cc in a step
+  const Int_t kMaxHalvings = 4; // of a block step that raises the cost
+}
+
+
+class CoordinateCalibrator::FitFunctor
+{
+public:
+  FitFunctor(CoordinateCalibrator& calibrator, const CoreParameters& params)
+  : fCalibrator(calibrator), fParams(params) {}
+
+  template<class NonLinearity> void operator() (const NonLinearity& nonLinearity)
+  { fCalibrator.Fit(nonLinearity, fParams); }
+
+private:
+  FitFunctor(const FitFunctor&); // Not Implemented
+  FitFunctor& operator= (const FitFunctor&); // Not Implemented
+
+  CoordinateCalibrator& fCalibrator;
+  const CoreParameters& fParams;
+};
+
+
+// all threads of a sweep wait for each other
+class CoordinateCalibrator::Barrier
+{
+public:
+  explicit Barrier(Int_t n) : fN(n), fWaiting(0), fGeneration(0), fMutex(), fCondition() {}
+
+  void Wait()
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    const Long64_t generation = fGeneration;
+    if( ++fWaiting == fN ) {
+      fWaiting = 0;
+      ++fGeneration;
+      fCondition.notify_all();
+    }
+    else
+      fCondition.wait(lock, [&] { return fGeneration != generation; });
+  }
+
+private:
+  Barrier(const Barrier&); // Not Implemented
+  Barrier& operator= (const Barrier&); // Not Implemented
+
+  const Int_t fN;
+  Int_t fWaiting;
+  Long64_t fGeneration;
+  std::mutex fMutex;
+  std::condition_variable fCondition;
+};
+
+
+struct CoordinateCalibrator::Work
+{
+  Work() : fGrad1(), fGrad2(), fGradient(), fMark(), fTouched(), fHessian(), fDiagonal(), fStep(), fCC() {}
+
+  std::vector<Double_t> fGrad1; // dM/dcc of the cells of cluster 1
+  std::vector<Double_t> fGrad2;
+  std::vector<Double_t> fGradient; // [n] dM/dcc of the cells of the block
+  std::vector<Int_t> fMark; // [n] last sample of the cell
+  std::vector<Int_t> fTouched; // cells of the block in the sample
+  std::vector<Double_t> fHessian; // [n*n] lower, row major
+  std::vector<Double_t> fDiagonal; // [n]
+  std::vector<Double_t> fStep; // [n] right hand side, then step
+  std::vector<Double_t> fCC; // [n] before the step
+};
+
+
+CoordinateCalibrator::CoordinateCalibrator()
+: Calibrator(),
+  fNThreads(0),
+  fBlockSize(4),
+  fMaxSweeps(100),
+  fTolerance(1e-6),
+  fTargetMass(NLLSCalibrator::kPi0Mass),
+  fSigma(-1),
+  fHuberK(1.345),
+  fClusters(),
+  fTable(NULL),
+  fBlock(),
+  fLocal(),
+  fBlockCellBegin(1, 0),
+  fBlockCells(),
+  fBlockSampleBegin(1, 0),
+  fBlockSamples(),
+  fBlockClusterBegin(1, 0),
+  fBlockClusters(),
+  fNParams(0),
+  fColour(),
+  fColourBegin(1, 0),
+  fColourBlocks(),
+  fGeometry(NULL),
+  fCC(),
+  fStates(),
+  fResiduals(),
+  fDecrease(0),
+  fFitSigma(-1),
+  fCost(0),
+  fNSweeps(0),
+  fNThreadsUsed(0),
+  fConverged(kFALSE),
+  fStopped(kFALSE)
+{
+}
+
+
+CoordinateCalibrator::~CoordinateCalibrator()
+{
+}
+
+
+SampleParameters CoordinateCalibrator::Calibrate ( std::vector<Sample> & samples, SampleParameters& initalParams )
+{
+  fClusters.Clear();
+  for(UInt_t idx = 0; idx < samples.size(); ++idx)
+    fClusters.AddSample(samples[idx]);
+  return Calibrate(fClusters, initalParams);
+}
+
+
+SampleParameters CoordinateCalibrator::Calibrate ( const ClusterTable& table, SampleParameters& initalParams )
+{
+  CoreParameters core;
+  initalParams.GetCore(core);
+  const UInt_t nGood = core.GetNGood();
+  fTable = &table;
+  fStats.Count(CalibStats::kSamples, table.GetNSamples());
+  std::vector<Int_t> cellTile;
+  MultilevelCalibrator::GetTiles(initalParams, fBlockSize, cellTile);
+  if( fBlockSize <= 1 )
+    for(UInt_t cell = 0; cell < nGood; ++cell)
+      cellTile[cell] = cell;
+  BuildIncidence(table, cellTile);
+  Colour();
+
+  const GeometryCache geometry(core);
+  fGeometry = &geometry;
+  fCC.resize(nGood);
+  for(UInt_t cell = 0; cell < nGood; ++cell)
+    fCC[cell] = core.fChannels[cell].fCC;
+  FitFunctor fit(*this, core);
+  DispatchNonLinearity(core.fGlobals, fit);
+  fGeometry = NULL;
+
+  SampleParameters result(initalParams);
+  for(UInt_t cell = 0; cell < nGood; ++cell)
+    if( fBlock[cell] >= 0 )
+      result.SetCC(cell, fCC[cell]);
+  return result;
+}
+
+
+void CoordinateCalibrator::PrintReport ( Option_t* option ) const
+{
+  printf("CoordinateCalibrator.PrintReport\n");
+  const Int_t nColours = GetNColours();
+  Int_t largest = 0;
+  for(Int_t colour = 0; colour < nColours; ++colour)
+    largest = TMath::Max(largest, GetColourSize(colour));
+  printf("   samples: %d, unknowns: %d, blocks: %d, colours: %d, blocks per colour: mean %g, largest %d, threads: %d\n",
+	 fTable ? fTable->GetNSamples() : 0, fNParams, GetNBlocks(), nColours, nColours ? Double_t(GetNBlocks()) / nColours : 0., largest, fNThreadsUsed);
+  printf("   sigma: %g, cost: %g, sweeps: %d%s\n", fFitSigma, fCost, fNSweeps,
+	 fStopped ? ", stopped by the telemetry callback" : fConverged ? "" : ", not converged");
+  Calibrator::PrintReport(option);
+}
+
+
+Bool_t CoordinateCalibrator::CheckColouring() const
+{
+  std::vector<Int_t> forbidden(GetNColours(), -1);
+  for(Int_t block = 0; block < GetNBlocks(); ++block) {
+    std::fill(forbidden.begin(), forbidden.end(), -1);
+    MarkNeighbourColours(block, forbidden);
+    if( forbidden[fColour[block]] == block )
+      return kFALSE;
+  }
+  return kTRUE;
+}
+
+
+void CoordinateCalibrator::BuildIncidence ( const ClusterTable& table, const std::vector<Int_t>& cellTile )
+{
+  // the unknowns, the cells in a sample, and their blocks, the tiles
+  // numbered in order of appearance
+  const UInt_t nGood = cellTile.size();
+  const UInt_t nSamples = table.GetNSamples();
+  std::vector<Bool_t> used(table.GetNClusters(), kFALSE);
+  fBlock.assign(nGood, -1);
+  for(UInt_t sample = 0; sample < nSamples; ++sample) {
+    const Int_t clusters[2] = {table.GetCluster1(sample), table.GetCluster2(sample)};
+    for(Int_t idx = 0; idx < 2; ++idx) {
+      used[clusters[idx]] = kTRUE;
+      const Int_t* index = table.GetCellIndex(clusters[idx]);
+      for(Int_t cell = 0; cell < table.GetNCells(clusters[idx]); ++cell)
+	fBlock[index[cell]] = 0;
+    }
+  }
+  std::vector<Int_t> tileBlock(nGood ? *std::max_element(cellTile.begin(), cellTile.end()) + 1 : 0, -1);
+  Int_t nBlocks = 0;
+  fNParams = 0;
+  fBlockCellBegin.assign(1, 0);
+  for(UInt_t cell = 0; cell < nGood; ++cell) {
+    if( fBlock[cell] < 0 )
+      continue;
+    if( tileBlock[cellTile[cell]] < 0 ) {
+      tileBlock[cellTile[cell]] = nBlocks++;
+      fBlockCellBegin.push_back(0);
+    }
+    fBlock[cell] = tileBlock[cellTile[cell]];
+    ++fBlockCellBegin[fBlock[cell] + 1];
+    ++fNParams;
+  }
+  for(Int_t block = 0; block < nBlocks; ++block)
+    fBlockCellBegin[block+1] += fBlockCellBegin[block];
+  fBlockCells.resize(fNParams);
+  fLocal.assign(nGood, -1);
+  std::vector<UInt_t> nextCell(fBlockCellBegin.begin(), fBlockCellBegin.end() - 1);
+  for(UInt_t cell = 0; cell < nGood; ++cell)
+    if( fBlock[cell] >= 0 ) {
+      fLocal[cell] = nextCell[fBlock[cell]] - fBlockCellBegin[fBlock[cell]];
+      fBlockCells[nextCell[fBlock[cell]]++] = cell;
+    }
+
+  // the samples and the clusters of each block, blocks counted once per
+  // sample and cluster
+  std::vector<Int_t> lastSample(nBlocks, -1);
+  std::vector<Int_t> lastCluster(nBlocks, -1);
+  fBlockSampleBegin.assign(nBlocks + 1, 0);
+  fBlockClusterBegin.assign(nBlocks + 1, 0);
+  for(Int_t pass = 0; pass < 2; ++pass) {
+    std::vector<UInt_t> nextSample(fBlockSampleBegin.begin(), fBlockSampleBegin.end() - 1);
+    std::fill(lastSample.begin(), lastSample.end(), -1);
+    for(UInt_t sample = 0; sample < nSamples; ++sample) {
+      const Int_t clusters[2] = {table.GetCluster1(sample), table.GetCluster2(sample)};
+      for(Int_t idx = 0; idx < 2; ++idx) {
+	const Int_t* index = table.GetCellIndex(clusters[idx]);
+	for(Int_t cell = 0; cell < table.GetNCells(clusters[idx]); ++cell) {
+	  const Int_t block = fBlock[index[cell]];
+	  if( lastSample[block] == Int_t(sample) )
+	    continue;
+	  lastSample[block] = sample;
+	  if( pass )
+	    fBlockSamples[nextSample[block]++] = sample;
+	  else
+	    ++fBlockSampleBegin[block + 1];
+	}
+      }
+    }
+    std::vector<UInt_t> nextCluster(fBlockClusterBegin.begin(), fBlockClusterBegin.end() - 1);
+    std::fill(lastCluster.begin(), lastCluster.end(), -1);
+    for(UInt_t cluster = 0; cluster < table.GetNClusters(); ++cluster) {
+      const Int_t* index = table.GetCellIndex(cluster);
+      for(Int_t cell = 0; used[cluster] && cell < table.GetNCells(cluster); ++cell) {
+	const Int_t block = fBlock[index[cell]];
+	if( lastCluster[block] == Int_t(cluster) )
+	  continue;
+	lastCluster[block] = cluster;
+	if( pass )
+	  fBlockClusters[nextCluster[block]++] = cluster;
+	else
+	  ++fBlockClusterBegin[block + 1];
+      }
+    }
+    if( pass )
+      break;
+    for(Int_t block = 0; block < nBlocks; ++block) {
+      fBlockSampleBegin[block+1] += fBlockSampleBegin[block];
+      fBlockClusterBegin[block+1] += fBlockClusterBegin[block];
+    }
+    fBlockSamples.resize(fBlockSampleBegin[nBlocks]);
+    fBlockClusters.resize(fBlockClusterBegin[nBlocks]);
+  }
+}
+
+
+void CoordinateCalibrator::MarkNeighbourColours ( Int_t block, std::vector<Int_t>& forbidden ) const
+{
+  const ClusterTable& table = *fTable;
+  for(UInt_t pos = fBlockSampleBegin[block]; pos < fBlockSampleBegin[block+1]; ++pos) {
+    const UInt_t sample = fBlockSamples[pos];
+    const Int_t clusters[2] = {table.GetCluster1(sample), table.GetCluster2(sample)};
+    for(Int_t idx = 0; idx < 2; ++idx) {
+      const Int_t* index = table.GetCellIndex(clusters[idx]);
+      for(Int_t cell = 0; cell < table.GetNCells(clusters[idx]); ++cell) {
+	const Int_t other = fBlock[index[cell]];
+	if( other != block && fColour[other] >= 0 )
+	  forbidden[fColour[other]] = block;
+      }
+    }
+  }
+}
+
+
+void CoordinateCalibrator::Colour()
+{
+  // greedy, the blocks in most samples first, each the lowest colour none
+  // of its neighbours has
+  const Int_t nBlocks = GetNBlocks();
+  std::vector< std::pair<UInt_t, Int_t> > order;
+  for(Int_t block = 0; block < nBlocks; ++block)
+    order.push_back(std::make_pair(fBlockSampleBegin[block+1] - fBlockSampleBegin[block], block));
+  std::sort(order.rbegin(), order.rend());
+
+  fColour.assign(nBlocks, -1);
+  std::vector<Int_t> forbidden;
+  std::vector<Int_t> size;
+  for(UInt_t idx = 0; idx < order.size(); ++idx) {
+    const Int_t block = order[idx].second;
+    forbidden.resize(size.size() + 1, -1);
+    MarkNeighbourColours(block, forbidden);
+    Int_t colour = 0;
+    while( forbidden[colour] == block )
+      ++colour;
+    if( colour == Int_t(size.size()) )
+      size.push_back(0);
+    fColour[block] = colour;
+    ++size[colour];
+  }
+
+  // balance, blocks of colours above the mean size to the smallest colour
+  // below it that is allowed
+  const Int_t nColours = size.size();
+  const Int_t target = nColours ? (nBlocks + nColours - 1) / nColours : 0;
+  for(UInt_t idx = 0; idx < order.size(); ++idx) {
+    const Int_t block = order[idx].second;
+    if( size[fColour[block]] <= target )
+      continue;
+    std::fill(forbidden.begin(), forbidden.end(), -1);
+    MarkNeighbourColours(block, forbidden);
+    Int_t best = -1;
+    for(Int_t colour = 0; colour < nColours; ++colour)
+      if( forbidden[colour] != block && size[colour] < target && (best < 0 || size[colour] < size[best]) )
+	best = colour;
+    if( best < 0 )
+      continue;
+    --size[fColour[block]];
+    fColour[block] = best;
+    ++size[best];
+  }
+
+  fColourBegin.assign(nColours + 1, 0);
+  for(Int_t block = 0; block < nBlocks; ++block)
+    ++fColourBegin[fColour[block] + 1];
+  for(Int_t colour = 0; colour < nColours; ++colour)
+    fColourBegin[colour+1] += fColourBegin[colour];
+  fColourBlocks.resize(nBlocks);
+  std::vector<UInt_t> next(fColourBegin.begin(), fColourBegin.end() - 1);
+  for(Int_t block = 0; block < nBlocks; ++block)
+    fColourBlocks[next[fColour[block]]++] = block;
+}
+
+
+template<class NonLinearity>
+void CoordinateCalibrator::Fit ( const NonLinearity& nonLinearity, const CoreParameters& params )
+{
+  fNSweeps = 0;
+  fConverged = kFALSE;
+  fStopped = kFALSE;
+  if( fResidualHistograms )
+    fResidualHistograms->Reset(params);
+  const ClusterTable& table = *fTable;
+  const MassKernel<Double_t, NonLinearity> kernel(*fGeometry, params.fGlobals, nonLinearity, &fCC[0]);
+
+  // the clusters of the samples and the residuals, at the initial cc's
+  fStats.Start(CalibStats::kResidual);
+  fStates.assign(table.GetNClusters(), ClusterState<Double_t>());
+  fResiduals.assign(table.GetNSamples(), 0.);
+  for(Int_t block = 0; block < GetNBlocks(); ++block)
+    EvalBlock(kernel, block);
+  fStats.Stop(CalibStats::kResidual);
+
+  // robust scale, of the settings or 1.4826 * median(|r|)
+  fFitSigma = fSigma;
+  if( fFitSigma <= 0 ) {
+    std::vector<Double_t> absResiduals(fResiduals.size());
+    for(UInt_t sample = 0; sample < fResiduals.size(); ++sample)
+      absResiduals[sample] = std::fabs(fResiduals[sample]);
+    fFitSigma = 1;
+    if( ! absResiduals.empty() ) {
+      const UInt_t median = absResiduals.size() / 2;
+      std::nth_element(absResiduals.begin(), absResiduals.begin() + median, absResiduals.end());
+      if( absResiduals[median] > 0 )
+	fFitSigma = 1.4826 * absResiduals[median];
+    }
+  }
+
+  // the sweeps, on nThreads threads
+  if( fTelemetry )
+    fTelemetry->BeginFit();
+  Int_t nThreads = fNThreads > 0 ? fNThreads : std::thread::hardware_concurrency();
+  nThreads = TMath::Max(1, nThreads);
+  fNThreadsUsed = nThreads;
+  Int_t nDownWeighted;
+  Double_t squares;
+  fCost = EvalCost(nDownWeighted, squares);
+  fDecrease = 0;
+  if( fNParams ) {
+    fStats.Start(CalibStats::kSolve);
+    Barrier barrier(nThreads);
+    std::vector<Double_t> changes(nThreads, 0.);
+    std::vector<std::thread> threads;
+    for(Int_t thread = 1; thread < nThreads; ++thread)
+      threads.push_back(std::thread(&CoordinateCalibrator::RunSweeps< MassKernel<Double_t, NonLinearity> >, this,
+				    thread, nThreads, std::cref(kernel), std::ref(barrier), std::ref(changes)));
+    RunSweeps(0, nThreads, kernel, barrier, changes);
+    for(UInt_t thread = 0; thread < threads.size(); ++thread)
+      threads[thread].join();
+    fStats.Stop(CalibStats::kSolve);
+    if( ! fConverged && ! fStopped )
+      Warning("Fit", "not converged in %d sweeps, the last lowered the cost by %g (relative), the tolerance is %g",
+	      fNSweeps, fDecrease, fTolerance);
+  }
+  else
+    fConverged = kTRUE;
+
+  // the final residuals, into the histograms
+  fCost = EvalCost(nDownWeighted, squares);
+  if( fResidualHistograms ) {
+    for(UInt_t sample = 0; sample < table.GetNSamples(); ++sample) {
+      const Int_t cluster1 = table.GetCluster1(sample);
+      const Int_t cluster2 = table.GetCluster2(sample);
+      fResidualHistograms->Fill(table.GetCellIndex(cluster1), table.GetNCells(cluster1),
+				table.GetCellIndex(cluster2), table.GetNCells(cluster2), fResiduals[sample] / fFitSigma, 1);
+    }
+  }
+}
+
+
+template<class Kernel>
+void CoordinateCalibrator::RunSweeps ( Int_t thread, Int_t nThreads, const Kernel& kernel, Barrier& barrier, std::vector<Double_t>& changes )
+{
+  // the blocks of each colour split between the threads; thread 0 takes
+  // the decisions between sweeps
+  Work work;
+  for(Int_t sweep = 0; sweep < fMaxSweeps; ++sweep) {
+    Double_t change = 0;
+    for(Int_t colour = 0; colour < GetNColours(); ++colour) {
+      const UInt_t size = fColourBegin[colour+1] - fColourBegin[colour];
+      const UInt_t begin = fColourBegin[colour] + ULong64_t(size) * thread / nThreads;
+      const UInt_t end = fColourBegin[colour] + ULong64_t(size) * (thread + 1) / nThreads;
+      for(UInt_t pos = begin; pos < end; ++pos)
+	change = TMath::Max(change, UpdateBlock(kernel, fColourBlocks[pos], work));
+      barrier.Wait();
+    }
+    changes[thread] = change;
+    barrier.Wait();
+
+    if( ! thread ) {
+      ++fNSweeps;
+      fStats.Count(CalibStats::kIterations, 1);
+      TelemetryRecord record;
+      const Double_t previousCost = fCost;
+      fCost = EvalCost(record.fNDownWeighted, record.fCost);
+      fDecrease = previousCost > 0 ? (previousCost - fCost) / previousCost : 0;
+      fConverged = fDecrease <= fTolerance;
+      if( fTelemetry ) {
+	record.fIteration = sweep;
+	record.fNTrials = 1;
+	record.fRobustCost = fCost;
+	record.fStepNorm = *std::max_element(changes.begin(), changes.end());
+	record.fSolveTime = fStats.GetRealTime(CalibStats::kSolve);
+	fStopped = ! fTelemetry->Record(record);
+      }
+    }
+    barrier.Wait();
+    if( fConverged || fStopped )
+      break;
+  }
+}
+
+
+template<class Kernel>
+Double_t CoordinateCalibrator::EvalBlock ( const Kernel& kernel, Int_t block )
+{
+  const ClusterTable& table = *fTable;
+  for(UInt_t pos = fBlockClusterBegin[block]; pos < fBlockClusterBegin[block+1]; ++pos) {
+    const UInt_t cluster = fBlockClusters[pos];
+    kernel.EvalCluster(table.GetCellIndex(cluster), table.GetCellAmp(cluster), table.GetNCells(cluster), fStates[cluster], kTRUE);
+  }
+  Double_t cost = 0;
+  for(UInt_t pos = fBlockSampleBegin[block]; pos < fBlockSampleBegin[block+1]; ++pos) {
+    const UInt_t sample = fBlockSamples[pos];
+    fResiduals[sample] = Kernel::Mass(fStates[table.GetCluster1(sample)], fStates[table.GetCluster2(sample)], table.GetVertex(sample))
+      - fTargetMass;
+    cost += Rho(fResiduals[sample]);
+  }
+  return cost;
+}
+
+
+template<class Kernel>
+Double_t CoordinateCalibrator::UpdateBlock ( const Kernel& kernel, Int_t block, Work& work )
+{
+  // the IRLS normal equations of the cost in the cc's of the block, from
+  // the cached residuals and cluster states of its samples
+  const ClusterTable& table = *fTable;
+  const UInt_t cellBegin = fBlockCellBegin[block];
+  const Int_t n = fBlockCellBegin[block+1] - cellBegin;
+  std::vector<Double_t>& h = work.fHessian;
+  std::vector<Double_t>& step = work.fStep;
+  work.fGradient.assign(n, 0.);
+  work.fMark.assign(n, -1);
+  h.assign(n*n, 0.);
+  step.assign(n, 0.);
+  Double_t cost = 0;
+  for(UInt_t pos = fBlockSampleBegin[block]; pos < fBlockSampleBegin[block+1]; ++pos) {
+    const UInt_t sample = fBlockSamples[pos];
+    const Int_t clusters[2] = {table.GetCluster1(sample), table.GetCluster2(sample)};
+    work.fGrad1.resize(table.GetNCells(clusters[0]));
+    work.fGrad2.resize(table.GetNCells(clusters[1]));
+    Kernel::MassGradient(fStates[clusters[0]], fStates[clusters[1]], table.GetVertex(sample), &work.fGrad1[0], &work.fGrad2[0]);
+    work.fTouched.clear();
+    for(Int_t idx = 0; idx < 2; ++idx) {
+      const Int_t* index = table.GetCellIndex(clusters[idx]);
+      const std::vector<Double_t>& grad = idx ? work.fGrad2 : work.fGrad1;
+      for(Int_t cell = 0; cell < table.GetNCells(clusters[idx]); ++cell) {
+	if( fBlock[index[cell]] != block )
+	  continue;
+	const Int_t local = fLocal[index[cell]];
+	if( work.fMark[local] != Int_t(sample) ) {
+	  work.fMark[local] = sample;
+	  work.fTouched.push_back(local);
+	}
+	work.fGradient[local] += grad[cell];
+      }
+    }
+    const Double_t r = fResiduals[sample];
+    const Double_t w = Weight(r);
+    for(UInt_t i = 0; i < work.fTouched.size(); ++i) {
+      const Int_t row = work.fTouched[i];
+      const Double_t wg = w * work.fGradient[row];
+      step[row] -= wg * r;
+      for(UInt_t j = 0; j < work.fTouched.size(); ++j)
+	if( work.fTouched[j] <= row )
+	  h[row*n + work.fTouched[j]] += wg * work.fGradient[work.fTouched[j]];
+    }
+    for(UInt_t i = 0; i < work.fTouched.size(); ++i)
+      work.fGradient[work.fTouched[i]] = 0;
+    cost += Rho(r);
+  }
+
+  // cells without curvature keep their cc, a relative 1e-6 damping of the
+  // rest; dense cholesky in place, the diagonal only if not positive
+  work.fDiagonal.resize(n);
+  for(Int_t i = 0; i < n; ++i) {
+    if( h[i*n + i] <= 0 ) {
+      std::fill(h.begin() + i*n, h.begin() + i*n + i, 0.);
+      for(Int_t k = i + 1; k < n; ++k)
+	h[k*n + i] = 0;
+      h[i*n + i] = 1;
+      step[i] = 0;
+    }
+    else
+      h[i*n + i] *= 1 + 1e-6;
+    work.fDiagonal[i] = h[i*n + i];
+  }
+  Bool_t positive = kTRUE;
+  for(Int_t j = 0; j < n && positive; ++j) {
+    Double_t d = h[j*n + j];
+    for(Int_t k = 0; k < j; ++k)
+      d -= h[j*n + k]*h[j*n + k];
+    if( d <= 0 ) {
+      positive = kFALSE;
+      break;
+    }
+    const Double_t ljj = std::sqrt(d);
+    h[j*n + j] = ljj;
+    for(Int_t i = j + 1; i < n; ++i) {
+      Double_t sum = h[i*n + j];
+      for(Int_t k = 0; k < j; ++k)
+	sum -= h[i*n + k]*h[j*n + k];
+      h[i*n + j] = sum / ljj;
+    }
+  }
+  if( positive ) {
+    for(Int_t i = 0; i < n; ++i) {
+      for(Int_t k = 0; k < i; ++k)
+	step[i] -= h[i*n + k]*step[k];
+      step[i] /= h[i*n + i];
+    }
+    for(Int_t i = n - 1; i >= 0; --i) {
+      step[i] /= h[i*n + i];
+      for(Int_t k = 0; k < i; ++k)
+	step[k] -= h[i*n + k]*step[i];
+    }
+  }
+  else
+    for(Int_t i = 0; i < n; ++i)
+      step[i] /= work.fDiagonal[i];
+
+  // the step, limited and halved until it lowers the cost of the block
+  work.fCC.resize(n);
+  for(Int_t i = 0; i < n; ++i) {
+    const Int_t cell = fBlockCells[cellBegin + i];
+    work.fCC[i] = fCC[cell];
+    const Double_t limit = kMaxStep * std::fabs(fCC[cell]);
+    step[i] = TMath::Max(-limit, TMath::Min(limit, step[i]));
+  }
+  for(Int_t halving = 0; halving <= kMaxHalvings; ++halving) {
+    Double_t change = 0;
+    for(Int_t i = 0; i < n; ++i) {
+      const Int_t cell = fBlockCells[cellBegin + i];
+      fCC[cell] = work.fCC[i] + step[i];
+      change = TMath::Max(change, work.fCC[i] != 0 ? std::fabs(step[i] / work.fCC[i]) : std::fabs(step[i]));
+    }
+    if( EvalBlock(kernel, block) <= cost )
+      return change;
+    for(Int_t i = 0; i < n; ++i)
+      step[i] *= 0.5;
+  }
+
+  // no decrease, the cc's, clusters and residuals as they were
+  for(Int_t i = 0; i < n; ++i)
+    fCC[fBlockCells[cellBegin + i]] = work.fCC[i];
+  EvalBlock(kernel, block);
+  return 0;
+}
+
+
+Double_t CoordinateCalibrator::EvalCost ( Int_t& nDownWeighted, Double_t& squares ) const
+{
+  Double_t cost = 0;
+  nDownWeighted = 0;
+  squares = 0;
+  for(UInt_t sample = 0; sample < fResiduals.size(); ++sample) {
+    const Double_t r = fResiduals[sample];
+    cost += Rho(r);
+    squares += 0.5*r*r;
+    nDownWeighted += std::fabs(r) > fHuberK * fFitSigma;
+  }
+  return cost;
+}
+
+
+Double_t CoordinateCalibrator::Rho ( Double_t r ) const
+{
+  const Double_t c = fHuberK * fFitSigma;
+  const Double_t absR = std::fabs(r);
+  return absR <= c ? 0.5*r*r : c*absR - 0.5*c*c;
+}
+
+
+Double_t CoordinateCalibrator::Weight ( Double_t r ) const
+{
+  const Double_t c = fHuberK * fFitSigma;
+  const Double_t absR = std::fabs(r);
+  return absR <= c ? 1 : c / absR;
+}
@@ -0,0 +1,169 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef COORDINATECALIBRATOR_H
+#define COORDINATECALIBRATOR_H
+
+#include "Calibrator.h"
+#include "ClusterTable.h"
+#include "MassKernel.h"
+#include <vector>
+
+class GeometryCache;
+struct CoreParameters;
+
+
+// Robust calibration of the cc's by parallel block coordinate descent,
+// without a global matrix.
+//
+// The cells are grouped in blocks, square tiles of SetBlockSize cells of a
+// module. Each block in turn takes the robust (IRLS) Newton step of the cost
+// in the cc's of its cells, a small dense solve, accepted only if it lowers
+// the cost of the samples of the block (else halved), with the residuals of
+// the samples and the cluster states cached and updated in place. Two blocks
+// conflict if they are in a sample together; the blocks of one colour of
+// the conflict graph share no sample, nor cluster, so the blocks of a colour
+// are updated by several threads at once without locks (Gauss-Seidel
+// between colours, Jacobi within). The graph is not stored, neighbours are
+// found through the samples of a block. The colouring is greedy, blocks in
+// most samples first, then balanced by moving blocks of large colours to
+// small colours which none of their neighbours have.
+//
+// The sweeps stop when one lowers the robust cost by less than the
+// tolerance, relative, as NLLSCalibrator does; a Warning if MaxSweeps is
+// reached first.
+//
+// Memory is the incidence of blocks to samples and clusters, the residuals
+// and the cluster states, linear in the samples. Samples pairing distant
+// cells make the conflict graph dense: a block conflicts with the blocks
+// within the largest pair distance, and the parallelism is in the blocks
+// per colour (GetNColours, GetColourSize), a handful per module when the
+// pairs span tens of cells.
+class CoordinateCalibrator : public Calibrator
+{
+public:
+  CoordinateCalibrator();
+  virtual ~CoordinateCalibrator();
+
+  virtual SampleParameters Calibrate(std::vector<Sample> & samples, SampleParameters& initalParams);
+  SampleParameters Calibrate(const ClusterTable& table, SampleParameters& initalParams);
+  virtual void PrintReport(Option_t* option = "") const;
+
+  // *** Settings ***
+  // 0: a thread per hardware thread
+  void SetNThreads(Int_t n) { fNThreads = n; }
+  // blocks of size x size cells, 1: a block per cell
+  void SetBlockSize(Int_t size) { fBlockSize = size; }
+  void SetMaxSweeps(Int_t n) { fMaxSweeps = n; }
+  void SetTolerance(Double_t tolerance) { fTolerance = tolerance; } // on the relative decrease of the robust cost in a sweep
+  void SetTargetMass(Double_t mass) { fTargetMass = mass; }
+  void SetSigma(Double_t sigma) { fSigma = sigma; } // <= 0: estimated from initial residuals, each fit
+  void SetHuberK(Double_t k) { fHuberK = k; }
+
+  Double_t GetSigma() const { return fSigma; } // the setting, see GetFitSigma
+
+  // *** Result of last Calibrate ***
+  Double_t GetCost() const { return fCost; }
+  Double_t GetFitSigma() const { return fFitSigma; } // set or estimated
+  Int_t GetNSweeps() const { return fNSweeps; }
+  Bool_t IsConverged() const { return fConverged; }
+  Int_t GetNThreadsUsed() const { return fNThreadsUsed; }
+  UInt_t GetNParams() const { return fNParams; }
+  Int_t GetNBlocks() const { return fBlockCellBegin.size() - 1; }
+  Int_t GetNColours() const { return fColourBegin.size() - 1; }
+  // blocks of colour
+  Int_t GetColourSize(Int_t colour) const { return fColourBegin[colour+1] - fColourBegin[colour]; }
+  // colour of the block of good channel cell, -1 if not an unknown
+  Int_t GetColour(UInt_t cell) const { return fBlock[cell] >= 0 ? fColour[fBlock[cell]] : -1; }
+  // the blocks of one colour share no sample, true by construction
+  Bool_t CheckColouring() const;
+
+private:
+  CoordinateCalibrator(const CoordinateCalibrator&); // Not Implemented
+  CoordinateCalibrator& operator= (const CoordinateCalibrator&); // Not Implemented
+
+  class FitFunctor; // calls Fit with the nonlinearity policy of the parameters
+  class Barrier;
+  struct Work; // the buffers of a thread
+
+  void BuildIncidence(const ClusterTable& table, const std::vector<Int_t>& cellTile);
+  void Colour();
+  // stamps the colours of the neighbours of block in forbidden
+  void MarkNeighbourColours(Int_t block, std::vector<Int_t>& forbidden) const;
+  template<class NonLinearity>
+  void Fit(const NonLinearity& nonLinearity, const CoreParameters& params);
+  template<class Kernel>
+  void RunSweeps(Int_t thread, Int_t nThreads, const Kernel& kernel, Barrier& barrier, std::vector<Double_t>& changes);
+  // the step of block, returns the largest |dcc|/|cc|
+  template<class Kernel>
+  Double_t UpdateBlock(const Kernel& kernel, Int_t block, Work& work);
+  // the clusters and residuals of the samples of block, at the cc's; their robust cost
+  template<class Kernel>
+  Double_t EvalBlock(const Kernel& kernel, Int_t block);
+  Double_t EvalCost(Int_t& nDownWeighted, Double_t& squares) const;
+  Double_t Rho(Double_t r) const;
+  Double_t Weight(Double_t r) const;
+
+  // *** Settings ***
+  Int_t fNThreads;
+  Int_t fBlockSize;
+  Int_t fMaxSweeps;
+  Double_t fTolerance;
+  Double_t fTargetMass;
+  Double_t fSigma;
+  Double_t fHuberK;
+
+  // *** Samples, and the incidence of the blocks ***
+  ClusterTable fClusters; // samples of Calibrate(std::vector<Sample>&)
+  const ClusterTable* fTable;
+  std::vector<Int_t> fBlock; // [nGood] block of cell, -1 if not an unknown
+  std::vector<Int_t> fLocal; // [nGood] index of cell in its block
+  std::vector<UInt_t> fBlockCellBegin; // [nBlocks+1]
+  std::vector<Int_t> fBlockCells; // cells of block
+  std::vector<UInt_t> fBlockSampleBegin; // [nBlocks+1]
+  std::vector<UInt_t> fBlockSamples; // samples of block
+  std::vector<UInt_t> fBlockClusterBegin; // [nBlocks+1]
+  std::vector<UInt_t> fBlockClusters; // clusters of block, in a sample
+  UInt_t fNParams;
+
+  // *** Colouring ***
+  std::vector<Int_t> fColour; // [nBlocks]
+  std::vector<UInt_t> fColourBegin; // [nColours+1]
+  std::vector<Int_t> fColourBlocks; // blocks by colour
+
+  // *** Work ***
+  const GeometryCache* fGeometry;
+  std::vector<Double_t> fCC; // [nGood]
+  std::vector< ClusterState<Double_t> > fStates; // [nClusters]
+  std::vector<Double_t> fResiduals; // [nSamples] M - m0
+  Double_t fDecrease; // relative, of the last sweep
+
+  // *** Result ***
+  Double_t fFitSigma;
+  Double_t fCost;
+  Int_t fNSweeps;
+  Int_t fNThreadsUsed;
+  Bool_t fConverged;
+  Bool_t fStopped;
+};
+
+#endif // COORDINATECALIBRATOR_H
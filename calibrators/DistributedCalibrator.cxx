@@ -0,0 +1,220 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "DistributedCalibrator.h"
+#include <TError.h>
+#include <algorithm>
+#include <cmath>
+
+
+DistributedCalibrator::DistributedCalibrator ( Transport& transport )
+: NLLSCalibrator(),
+  fTransport(transport),
+  fPositions(),
+  fFailed(kFALSE)
+{
+}
+
+
+DistributedCalibrator::~DistributedCalibrator()
+{
+}
+
+
+void DistributedCalibrator::PrintReport ( Option_t* option ) const
+{
+  printf("DistributedCalibrator.PrintReport\n");
+  printf("   rank %d of %d, transport failed: %s\n", fTransport.GetRank(), fTransport.GetNRanks(), fFailed ? "yes" : "no");
+  NLLSCalibrator::PrintReport(option);
+}
+
+
+void DistributedCalibrator::ReduceUnknowns ( std::vector<Int_t>& cellParam )
+{
+  fStats.Start(CalibStats::kCommunication);
+  if( ! fTransport.AllReduceMax(&cellParam[0], cellParam.size()) )
+    fFailed = kTRUE;
+  fStats.Stop(CalibStats::kCommunication);
+}
+
+
+void DistributedCalibrator::ReducePattern()
+{
+  // the coordinator's pattern is the union of all, with the positions of
+  // the values of each worker's pattern in it
+  fStats.Start(CalibStats::kCommunication);
+  fPositions.clear();
+  if( ! fTransport.IsCoordinator() ) {
+    if( ! fTransport.SendVector(0, fNormal.GetRowBegin()) || ! fTransport.SendVector(0, fNormal.GetCols()) )
+      fFailed = kTRUE;
+    fStats.Stop(CalibStats::kCommunication);
+    return;
+  }
+
+  const Int_t nRanks = fTransport.GetNRanks();
+  std::vector< std::vector<UInt_t> > rowBegins(nRanks);
+  std::vector< std::vector<Int_t> > cols(nRanks);
+  for(Int_t rank = 1; rank < nRanks; ++rank) {
+    if( ! fTransport.ReceiveVector(rank, rowBegins[rank]) || ! fTransport.ReceiveVector(rank, cols[rank]) ) {
+      fFailed = kTRUE;
+      rowBegins[rank].assign(fNParams + 1, 0);
+      cols[rank].clear();
+    }
+    fNormal.MergePattern(rowBegins[rank], cols[rank]);
+  }
+
+  fPositions.resize(nRanks);
+  for(Int_t rank = 1; rank < nRanks; ++rank) {
+    fPositions[rank].resize(cols[rank].size());
+    for(UInt_t row = 0; row < fNParams; ++row)
+      for(UInt_t pos = rowBegins[rank][row]; pos < rowBegins[rank][row+1]; ++pos)
+	fPositions[rank][pos] = fNormal.Find(row, cols[rank][pos]);
+  }
+  fStats.Stop(CalibStats::kCommunication);
+}
+
+
+Double_t DistributedCalibrator::ReducePass ( Double_t cost, Bool_t jacobian )
+{
+  fStats.Start(CalibStats::kCommunication);
+  if( jacobian && fUsedSolver == kCGLS ) {
+    // the rows stay on their rank, the gradient to all
+    if( fNParams && ! fTransport.AllReduceSum(&fGradient[0], fNParams) )
+      fFailed = kTRUE;
+  }
+  else if( jacobian ) {
+    if( ! fTransport.IsCoordinator() ) {
+      if( ! fTransport.SendVector(0, fNormal.GetValues()) || ! fTransport.SendVector(0, fGradient) )
+	fFailed = kTRUE;
+    }
+    else {
+      std::vector<Double_t>& values = fNormal.GetValues();
+      std::vector<Double_t> partial;
+      for(Int_t rank = 1; rank < fTransport.GetNRanks(); ++rank) {
+	if( fTransport.ReceiveVector(rank, partial) && partial.size() == fPositions[rank].size() )
+	  for(UInt_t idx = 0; idx < partial.size(); ++idx)
+	    values[fPositions[rank][idx]] += partial[idx];
+	else
+	  fFailed = kTRUE;
+	if( fTransport.ReceiveVector(rank, partial) && partial.size() == fNParams )
+	  for(UInt_t param = 0; param < fNParams; ++param)
+	    fGradient[param] += partial[param];
+	else
+	  fFailed = kTRUE;
+      }
+    }
+  }
+  if( ! fTransport.AllReduceSum(&cost, 1) )
+    fFailed = kTRUE;
+  fStats.Stop(CalibStats::kCommunication);
+  return cost;
+}
+
+
+void DistributedCalibrator::ReduceSums ( Double_t* data, UInt_t n )
+{
+  fStats.Start(CalibStats::kCommunication);
+  if( ! fTransport.AllReduceSum(data, n) )
+    fFailed = kTRUE;
+  fStats.Stop(CalibStats::kCommunication);
+}
+
+
+Bool_t DistributedCalibrator::ReduceOverBudget ( ULong64_t& bytes, Bool_t estimate )
+{
+  // the coordinator's normal matrix is at most the sum of the ranks', and
+  // at most dense; any rank beyond the budget turns all to kCGLS
+  fStats.Start(CalibStats::kCommunication);
+  if( estimate ) {
+    Double_t total = bytes;
+    if( ! fTransport.AllReduceSum(&total, 1) )
+      fFailed = kTRUE;
+    ULong64_t dense = ULong64_t(fNParams) * fNParams;
+    if( fUsedSolver == kLDLT )
+      dense += (dense - fNParams) / 2;
+    bytes = std::min(ULong64_t(total), dense * (sizeof(Int_t) + sizeof(Double_t)));
+  }
+  Int_t over = NLLSCalibrator::ReduceOverBudget(bytes, estimate);
+  if( ! fTransport.AllReduceMax(&over, 1) )
+    fFailed = kTRUE;
+  fStats.Stop(CalibStats::kCommunication);
+  return over;
+}
+
+
+Int_t DistributedCalibrator::Solve ( Double_t lambda, std::vector<Double_t>& step )
+{
+  // kCGLS on all ranks, in step; the same sums give all the same step
+  if( fUsedSolver == kCGLS )
+    return NLLSCalibrator::Solve(lambda, step);
+
+  // else the coordinator solves, and broadcasts the step
+  Int_t nIterations = 0;
+  if( fTransport.IsCoordinator() )
+    nIterations = NLLSCalibrator::Solve(lambda, step);
+  step.resize(fNParams);
+
+  fStats.Start(CalibStats::kCommunication);
+  if( ! fTransport.Broadcast(&nIterations, sizeof(nIterations))
+      || (fNParams && ! fTransport.Broadcast(&step[0], fNParams*sizeof(Double_t))) )
+    fFailed = kTRUE;
+  fStats.Stop(CalibStats::kCommunication);
+  return nIterations;
+}
+
+
+Double_t DistributedCalibrator::EstimateSigma()
+{
+  // 1.4826 * median(|r|) of the residuals of all ranks, on the coordinator
+  fStats.Start(CalibStats::kCommunication);
+  Double_t sigma = 1;
+  if( ! fTransport.IsCoordinator() ) {
+    if( ! fTransport.SendVector(0, fResiduals) )
+      fFailed = kTRUE;
+  }
+  else {
+    std::vector<Double_t> absResiduals(fResiduals);
+    std::vector<Double_t> partial;
+    for(Int_t rank = 1; rank < fTransport.GetNRanks(); ++rank) {
+      if( fTransport.ReceiveVector(rank, partial) )
+	absResiduals.insert(absResiduals.end(), partial.begin(), partial.end());
+      else
+	fFailed = kTRUE;
+    }
+    for(UInt_t idx = 0; idx < absResiduals.size(); ++idx)
+      absResiduals[idx] = std::fabs(absResiduals[idx]);
+    const UInt_t n = absResiduals.size();
+    if( n ) {
+      std::nth_element(absResiduals.begin(), absResiduals.begin() + n/2, absResiduals.end());
+      sigma = 1.4826 * absResiduals[n/2];
+    }
+    if( sigma <= 0 )
+      sigma = 1;
+  }
+  if( ! fTransport.Broadcast(&sigma, sizeof(sigma)) )
+    fFailed = kTRUE;
+  fStats.Stop(CalibStats::kCommunication);
+
+  if( fFailed )
+    Error("EstimateSigma", "transport failed, the calibration is not of all ranks");
+  return sigma;
+}
@@ -0,0 +1,76 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef DISTRIBUTEDCALIBRATOR_H
+#define DISTRIBUTEDCALIBRATOR_H
+
+#include "NLLSCalibrator.h"
+#include "Transport.h"
+
+
+// NLLSCalibrator over several processes, each calibrating its own part of
+// the samples; all ranks call Calibrate, with the same initial parameters.
+//
+// The unknowns are the cells of the samples of any rank. Each pass every
+// rank evaluates its samples; the costs are summed on all ranks, and with
+// the jacobian, the partial normal matrices J^T W J and gradients J^T W r
+// are summed on the coordinator (rank 0), which solves for the step and
+// broadcasts it, so that all ranks hold the same cc's and take the same
+// decisions. Every rank returns the calibrated parameters.
+//
+// With kCG and kLDLT the normal equations are only assembled, analysed and
+// solved on the coordinator. With kCGLS every rank keeps the jacobian rows
+// of its samples and all ranks run the same CGLS iterations, the products
+// J^T x summed over the ranks (ReduceSums), the gradient summed to all.
+// The fallback to kCGLS beyond the memory budget is taken by all ranks as
+// soon as one rank is beyond it.
+class DistributedCalibrator : public NLLSCalibrator
+{
+public:
+  explicit DistributedCalibrator(Transport& transport);
+  virtual ~DistributedCalibrator();
+
+  virtual void PrintReport(Option_t* option = "") const;
+
+  Transport& GetTransport() { return fTransport; }
+
+protected:
+  virtual void ReduceUnknowns(std::vector<Int_t>& cellParam);
+  virtual void ReducePattern();
+  virtual Double_t ReducePass(Double_t cost, Bool_t jacobian);
+  virtual void ReduceSums(Double_t* data, UInt_t n);
+  virtual Bool_t IsSolvingRank() const { return fTransport.IsCoordinator(); }
+  virtual Bool_t ReduceOverBudget(ULong64_t& bytes, Bool_t estimate);
+  virtual Int_t Solve(Double_t lambda, std::vector<Double_t>& step);
+  virtual Double_t EstimateSigma();
+
+  Transport& fTransport;
+  // coordinator: [rank][i] position in fNormal of the i'th value of the rank's normal matrix
+  std::vector< std::vector<UInt_t> > fPositions;
+  Bool_t fFailed; // a transport operation failed
+
+private:
+  DistributedCalibrator(const DistributedCalibrator&); // Not Implemented
+  DistributedCalibrator& operator= (const DistributedCalibrator&); // Not Implemented
+};
+
+#endif // DISTRIBUTEDCALIBRATOR_H
@@ -0,0 +1,144 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "MultilevelCalibrator.h"
+#include "GeometryCache.h"
+#include <TStopwatch.h>
+#include <cstdio>
+
+
+MultilevelCalibrator::MultilevelCalibrator()
+: Calibrator(),
+  fFine(),
+  fTileSizes(),
+  fCoarseMaxIterations(10),
+  fLevelNParams(),
+  fLevelNIterations(),
+  fLevelCost(),
+  fLevelTime()
+{
+  const Int_t tileSizes[3] = {0, 8, 2};
+  fTileSizes.assign(tileSizes, tileSizes + 3);
+}
+
+
+MultilevelCalibrator::~MultilevelCalibrator()
+{
+}
+
+
+SampleParameters MultilevelCalibrator::Calibrate ( std::vector<Sample> & samples, SampleParameters& initalParams )
+{
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < samples.size(); ++idx)
+    table.AddSample(samples[idx]);
+  return Calibrate(table, initalParams);
+}
+
+
+SampleParameters MultilevelCalibrator::Calibrate ( const ClusterTable& table, SampleParameters& initalParams )
+{
+  fLevelNParams.clear();
+  fLevelNIterations.clear();
+  fLevelCost.clear();
+  fLevelTime.clear();
+  if( fMemoryBudget > 0 )
+    fFine.SetMemoryBudget(fMemoryBudget, fScratchDirectory.Data());
+  // the sigma of the settings, each level estimates its own if <= 0
+  const Double_t sigma = fFine.GetSigma();
+
+  CoreParameters core;
+  initalParams.GetCore(core);
+  const GeometryCache geometry(core);
+  SampleParameters params(initalParams);
+  std::vector<Int_t> cellTile;
+  TStopwatch watch;
+  for(UInt_t level = 0; level < fTileSizes.size(); ++level) {
+    watch.Start();
+    NLLSCalibrator fitter;
+    fitter.CopySettings(fFine);
+    fitter.SetSigma(sigma);
+    fitter.SetMaxIterations(fCoarseMaxIterations);
+    fitter.SetGeometry(&geometry);
+    fitter.SetTelemetry(fTelemetry);
+    GetTiles(params, fTileSizes[level], cellTile);
+    fitter.SetAggregates(cellTile);
+    params = fitter.Calibrate(table, params);
+    fStats.Add(fitter.GetStats());
+    fLevelNParams.push_back(fitter.GetNParams());
+    fLevelNIterations.push_back(fitter.GetNIterations());
+    fLevelCost.push_back(fitter.GetCost());
+    fLevelTime.push_back(watch.RealTime());
+    if( fitter.IsStopped() )
+      return params;
+  }
+
+  // the fit per cell
+  watch.Start();
+  fFine.SetSigma(sigma);
+  fFine.SetGeometry(&geometry);
+  fFine.SetTelemetry(fTelemetry);
+  if( fResidualHistograms )
+    fFine.SetResidualHistograms(fResidualHistograms);
+  fFine.SetAggregates(std::vector<Int_t>());
+  SampleParameters result = fFine.Calibrate(table, params);
+  fFine.SetGeometry(NULL);
+  fStats.Add(fFine.GetStats());
+  fLevelNParams.push_back(fFine.GetNParams());
+  fLevelNIterations.push_back(fFine.GetNIterations());
+  fLevelCost.push_back(fFine.GetCost());
+  fLevelTime.push_back(watch.RealTime());
+  return result;
+}
+
+
+void MultilevelCalibrator::PrintReport ( Option_t* option ) const
+{
+  printf("MultilevelCalibrator.PrintReport\n");
+  for(Int_t level = 0; level < GetNLevels(); ++level) {
+    const Bool_t fine = level == GetNLevels() - 1 && level == Int_t(fTileSizes.size());
+    char name[64];
+    if( fine )
+      snprintf(name, sizeof(name), "cells");
+    else if( fTileSizes[level] > 0 )
+      snprintf(name, sizeof(name), "%dx%d tiles", fTileSizes[level], fTileSizes[level]);
+    else
+      snprintf(name, sizeof(name), "modules");
+    printf("   level %d, %s: unknowns: %d, iterations: %d, cost: %g, wall time: %g s\n",
+	   level, name, fLevelNParams[level], fLevelNIterations[level], fLevelCost[level], fLevelTime[level]);
+  }
+  Calibrator::PrintReport(option);
+}
+
+
+void MultilevelCalibrator::GetTiles ( const SampleParameters& params, Int_t tileSize, std::vector<Int_t>& cellTile )
+{
+  const Int_t nTileX = tileSize > 0 ? (GeometryCache::kNRowX + tileSize - 1) / tileSize : 1;
+  const Int_t nTileZ = tileSize > 0 ? (GeometryCache::kNColZ + tileSize - 1) / tileSize : 1;
+  cellTile.resize(params.GetNGood());
+  for(Int_t cell = 0; cell < params.GetNGood(); ++cell) {
+    const Int_t absId = params.GetIDArray()[cell];
+    cellTile[cell] = GeometryCache::AbsIdToModule(absId) * nTileX * nTileZ;
+    if( tileSize > 0 )
+      cellTile[cell] += (GeometryCache::AbsIdToRowX(absId) / tileSize) * nTileZ + GeometryCache::AbsIdToColZ(absId) / tileSize;
+  }
+}
@@ -0,0 +1,90 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MULTILEVELCALIBRATOR_H
+#define MULTILEVELCALIBRATOR_H
+
+#include "Calibrator.h"
+#include "NLLSCalibrator.h"
+#include "ClusterTable.h"
+#include <vector>
+
+
+// Coarse to fine calibration. From nominal cc's most of the error is in
+// large scale offsets (of modules, of groups of cells), which a full fit
+// removes at the cost of a solve in all cc's per iteration. The coarse
+// levels fit a scale per module, then per 8x8 and per 2x2 tile of cells
+// (SetCoarseLevels) as the aggregates of NLLSCalibrator, each from the cc's
+// of the previous level; the scale of a tile is its cc's times a common
+// factor, so the solution of a level is the start of the next as it is.
+// The fit per cell (GetFitter) then starts near the solution, and takes
+// fewer iterations.
+//
+// A coarse level has a pass over all samples per iteration as the fine
+// fit has, but a solve in as many unknowns as tiles; the passes of the
+// coarse levels can outweigh the fine iterations saved, so the whole is
+// not necessarily faster than the fit per cell alone. The levels have the
+// settings of GetFitter, and at most SetCoarseMaxIterations iterations;
+// the residual histograms are filled by the fine fit.
+class MultilevelCalibrator : public Calibrator
+{
+public:
+  MultilevelCalibrator();
+  virtual ~MultilevelCalibrator();
+
+  virtual SampleParameters Calibrate(std::vector<Sample> & samples, SampleParameters& initalParams);
+  SampleParameters Calibrate(const ClusterTable& table, SampleParameters& initalParams);
+  virtual void PrintReport(Option_t* option = "") const;
+
+  // *** Settings ***
+  // the fit per cell, whose settings the coarse levels copy
+  NLLSCalibrator& GetFitter() { return fFine; }
+  // tile sizes in cells of the coarse levels, coarsest first, 0 a module;
+  // {0, 8, 2} by default
+  void SetCoarseLevels(const std::vector<Int_t>& tileSizes) { fTileSizes = tileSizes; }
+  void SetCoarseMaxIterations(Int_t n) { fCoarseMaxIterations = n; }
+
+  // aggregate of each good channel of params in tiles of tileSize cells
+  static void GetTiles(const SampleParameters& params, Int_t tileSize, std::vector<Int_t>& cellTile);
+
+  // *** Result of last Calibrate, per level, the fine fit last ***
+  Int_t GetNLevels() const { return fLevelNParams.size(); }
+  UInt_t GetLevelNParams(Int_t level) const { return fLevelNParams[level]; }
+  Int_t GetLevelNIterations(Int_t level) const { return fLevelNIterations[level]; }
+  Double_t GetLevelCost(Int_t level) const { return fLevelCost[level]; }
+  Double_t GetLevelTime(Int_t level) const { return fLevelTime[level]; } // [s] wall
+
+private:
+  MultilevelCalibrator(const MultilevelCalibrator&); // Not Implemented
+  MultilevelCalibrator& operator= (const MultilevelCalibrator&); // Not Implemented
+
+  NLLSCalibrator fFine;
+  std::vector<Int_t> fTileSizes;
+  Int_t fCoarseMaxIterations;
+
+  std::vector<UInt_t> fLevelNParams;
+  std::vector<Int_t> fLevelNIterations;
+  std::vector<Double_t> fLevelCost;
+  std::vector<Double_t> fLevelTime;
+};
+
+#endif // MULTILEVELCALIBRATOR_H
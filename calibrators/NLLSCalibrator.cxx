@@ -0,0 +1,961 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "NLLSCalibrator.h"
+#include "GeometryCache.h"
+#include "Telemetry.h"
+#include "ResidualHistograms.h"
+#include "AutoDiff.h"
+#include "MassKernel.h"
+#include "NonLinearity.h"
+#include <TMath.h>
+#include <algorithm>
+#include <cmath>
+
+
+const Double_t NLLSCalibrator::kPi0Mass = 0.1349766;
+const Double_t NLLSCalibrator::kFloatTolerance = 1e-5;
+const Double_t NLLSCalibrator::kSigmaTolerance = 0.01;
+const Double_t NLLSCalibrator::kMaxRelativeStep = 0.5;
+
+
+class NLLSCalibrator::FitFunctor
+{
+public:
+  FitFunctor(NLLSCalibrator& calibrator, const CoreParameters& params, std::vector<Double_t>& cc)
+  : fCalibrator(calibrator), fParams(params), fCC(cc) {}
+
+  template<class NonLinearity> void operator() (const NonLinearity& nonLinearity)
+  { fCalibrator.Fit(nonLinearity, fParams, fCC); }
+
+private:
+  FitFunctor(const FitFunctor&); // Not Implemented
+  FitFunctor& operator= (const FitFunctor&); // Not Implemented
+
+  NLLSCalibrator& fCalibrator;
+  const CoreParameters& fParams;
+  std::vector<Double_t>& fCC;
+};
+
+
+NLLSCalibrator::NLLSCalibrator()
+: Calibrator(),
+  fPrecision(kDouble),
+  fDerivatives(kAnalytic),
+  fSolver(kCG),
+  fWarmStart(kFALSE),
+  fPreconditionerType(Preconditioner::kJacobi),
+  fTileSize(0),
+  fTargetMass(kPi0Mass),
+  fSigma(-1),
+  fHuberK(1.345),
+  fMaxIterations(20),
+  fTolerance(1e-6),
+  fLambda0(1e-3),
+  fNRefinements(3),
+  fMaxCGIterations(1000),
+  fCGTolerance(1e-10),
+  fBootstrapSeed(0),
+  fCouplings(),
+  fCouplingSigma(0),
+  fAggregates(),
+  fKeepCompiled(kFALSE),
+  fClusters(),
+  fTable(NULL),
+  fNSamples(0),
+  fUsedSolver(kCG),
+  fNParams(0),
+  fCellParam(),
+  fParamCell(),
+  fGeometry(NULL),
+  fOwnsGeometry(kFALSE),
+  fNormal(),
+  fPreconditioner(NULL),
+  fLDLT(),
+  fRows(&fStats),
+  fGradient(),
+  fResiduals(),
+  fPassSquares(0),
+  fPassNDownWeighted(0),
+  fFillHistograms(kFALSE),
+  fFitSigma(-1),
+  fCost(0),
+  fNIterations(0),
+  fNCGIterations(0),
+  fStopped(kFALSE)
+{
+}
+
+
+NLLSCalibrator::~NLLSCalibrator()
+{
+  if( fOwnsGeometry )
+    delete fGeometry;
+  delete fPreconditioner;
+}
+
+
+SampleParameters NLLSCalibrator::Calibrate ( std::vector<Sample> & samples, SampleParameters& initalParams )
+{
+  // other samples in the same table, compiled again
+  fTable = NULL;
+  fClusters.Clear();
+  for(UInt_t idx = 0; idx < samples.size(); ++idx)
+    fClusters.AddSample(samples[idx]);
+  return Calibrate(fClusters, initalParams);
+}
+
+
+SampleParameters NLLSCalibrator::Calibrate ( const ClusterTable& table, SampleParameters& initalParams )
+{
+  CoreParameters core;
+  initalParams.GetCore(core);
+  CalibrateCore(table, core);
+
+  SampleParameters result(initalParams);
+  for(UInt_t cell = 0; cell < fCellParam.size(); ++cell)
+    if( fCellParam[cell] >= 0 )
+      result.SetCC(cell, core.fChannels[cell].fCC);
+  return result;
+}
+
+
+void NLLSCalibrator::CalibrateCore ( const ClusterTable& table, CoreParameters& params )
+{
+  if( ! fGeometry || fOwnsGeometry ) {
+    delete fGeometry;
+    fGeometry = new GeometryCache(params);
+    fOwnsGeometry = kTRUE;
+  }
+  if( ! fKeepCompiled || fTable != &table || fCellParam.size() != UInt_t(params.GetNGood()) )
+    CompileSamples(table, params);
+  else
+    fStats.Count(CalibStats::kSamples, fNSamples);
+  CreatePreconditioner(params);
+
+  // the nonlinearity version is resolved once, Fit is instantiated per policy
+  const UInt_t nGood = params.GetNGood();
+  std::vector<Double_t> cc(nGood);
+  for(UInt_t cell = 0; cell < nGood; ++cell)
+    cc[cell] = params.fChannels[cell].fCC;
+  FitFunctor fit(*this, params, cc);
+  DispatchNonLinearity(params.fGlobals, fit);
+
+  for(UInt_t cell = 0; cell < nGood; ++cell)
+    if( fCellParam[cell] >= 0 )
+      params.fChannels[cell].fCC = cc[cell];
+}
+
+
+void NLLSCalibrator::SetGeometry ( const GeometryCache* geometry )
+{
+  if( fOwnsGeometry )
+    delete fGeometry;
+  fGeometry = geometry;
+  fOwnsGeometry = kFALSE;
+}
+
+
+void NLLSCalibrator::CopySettings ( const NLLSCalibrator& other )
+{
+  fPrecision = other.fPrecision;
+  fDerivatives = other.fDerivatives;
+  fSolver = other.fSolver;
+  fWarmStart = other.fWarmStart;
+  fPreconditionerType = other.fPreconditionerType;
+  fTileSize = other.fTileSize;
+  fTargetMass = other.fTargetMass;
+  fSigma = other.fSigma;
+  fHuberK = other.fHuberK;
+  fMaxIterations = other.fMaxIterations;
+  fTolerance = other.fTolerance;
+  fLambda0 = other.fLambda0;
+  fNRefinements = other.fNRefinements;
+  fMaxCGIterations = other.fMaxCGIterations;
+  fCGTolerance = other.fCGTolerance;
+  fMemoryBudget = other.fMemoryBudget;
+  fScratchDirectory = other.fScratchDirectory;
+  fStats.SetEnabled(other.fStats.IsEnabled());
+}
+
+
+UInt_t NLLSCalibrator::PoissonWeight ( ULong64_t seed, UInt_t sample )
+{
+  // splitmix64 of (seed, sample) to a uniform, by the inverse of the
+  // Poisson(1) distribution
+  ULong64_t z = seed + (sample + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  const Double_t u = (z >> 11) * (1. / 9007199254740992.);
+
+  Double_t p = 0.36787944117144233; // e^-1, P(0)
+  Double_t cdf = p;
+  UInt_t k = 0;
+  while( u >= cdf && k < 20 ) {
+    ++k;
+    p /= k;
+    cdf += p;
+  }
+  return k;
+}
+
+
+void NLLSCalibrator::PrintReport ( Option_t* option ) const
+{
+  printf("NLLSCalibrator.PrintReport\n");
+  const char* solvers[3] = {"cg", "cgls", "ldlt"};
+  printf("   precision: %s, derivatives: %s, solver: %s (set: %s), samples: %d, unknowns: %d\n",
+	 fPrecision == kDouble ? "double" : "mixed", fDerivatives == kAnalytic ? "analytic" : "automatic",
+	 solvers[fUsedSolver], solvers[fSolver], fNSamples, fNParams);
+  if( fTable )
+    printf("   clusters: %d, shared cluster references: %d\n", fTable->GetNClusters(), fTable->GetNShared());
+  if( fUsedSolver == kCG )
+    printf("   normal matrix non zero: %d, preconditioner: %s\n", fNormal.GetNNonZero(),
+	   fPreconditioner ? fPreconditioner->GetName() : "none");
+  else if( fUsedSolver == kLDLT )
+    printf("   normal matrix non zero: %d, factor non zero: %d, analysis cached: %s\n", fNormal.GetNNonZero(),
+	   fLDLT.GetNNonZero(), fLDLT.IsCached() ? "yes" : "no");
+  else
+    printf("   jacobian non zero: %llu\n", (unsigned long long) fRows.GetNNonZero());
+  if( fMemoryBudget > 0 )
+    printf("   memory budget: %.1f MB, rows in memory at most: %.1f MB, spilled: %.1f MB in %d chunks, %.1f MB over all passes, io time: %g s\n",
+	   fMemoryBudget / 1048576., fRows.GetPeakBytes() / 1048576., fRows.GetSpilledBytes() / 1048576., fRows.GetNChunks(),
+	   fRows.GetTotalSpilledBytes() / 1048576., fStats.GetRealTime(CalibStats::kIO));
+  if( ! fAggregates.empty() )
+    printf("   unknowns are scales of aggregates of cells\n");
+  printf("   sigma: %g, cost: %g, iterations: %d, cg iterations: %d%s\n",
+	 fFitSigma, fCost, fNIterations, fNCGIterations, fStopped ? ", stopped by the telemetry callback" : "");
+  if( fBootstrapSeed )
+    printf("   bootstrap resample, seed: %llu\n", (unsigned long long) fBootstrapSeed);
+  Calibrator::PrintReport(option);
+}
+
+
+void NLLSCalibrator::CompileSamples ( const ClusterTable& table, const CoreParameters& params )
+{
+  // finds the unknowns and the pattern of the normal matrix of the samples of table.
+  fTable = &table;
+  fNSamples = table.GetNSamples();
+  fStats.Count(CalibStats::kSamples, fNSamples);
+
+  // unknowns, the cells of the clusters of the samples
+  const UInt_t nGood = params.GetNGood();
+  std::vector<Bool_t> used(table.GetNClusters(), kFALSE);
+  for(UInt_t sample = 0; sample < fNSamples; ++sample) {
+    used[table.GetCluster1(sample)] = kTRUE;
+    used[table.GetCluster2(sample)] = kTRUE;
+  }
+  fCellParam.assign(nGood, -1);
+  for(UInt_t cluster = 0; cluster < table.GetNClusters(); ++cluster)
+    for(Int_t cell = 0; used[cluster] && cell < table.GetNCells(cluster); ++cell)
+      fCellParam[table.GetCellIndex(cluster)[cell]] = 0;
+  ReduceUnknowns(fCellParam);
+  if( ! fAggregates.empty() && fAggregates.size() != nGood ) {
+    Error("CompileSamples", "aggregates of %d good channels, the parameters have %d, fitting each channel",
+	  (Int_t) fAggregates.size(), nGood);
+    fAggregates.clear();
+  }
+  // an unknown per channel, or per aggregate
+  std::vector<Int_t> aggregateParam;
+  fParamCell.clear();
+  for(UInt_t cell = 0; cell < nGood; ++cell) {
+    if( fCellParam[cell] < 0 )
+      continue;
+    if( ! fAggregates.empty() ) {
+      const UInt_t aggregate = fAggregates[cell];
+      if( aggregate >= aggregateParam.size() )
+	aggregateParam.resize(aggregate + 1, -1);
+      if( aggregateParam[aggregate] >= 0 ) {
+	fCellParam[cell] = aggregateParam[aggregate];
+	continue;
+      }
+      aggregateParam[aggregate] = fParamCell.size();
+    }
+    fCellParam[cell] = fParamCell.size();
+    fParamCell.push_back(cell);
+  }
+  fNParams = fParamCell.size();
+
+  // normal matrix pattern, each sample couples all its cells
+  std::vector< std::vector<Int_t> > cliques(fNSamples);
+  for(UInt_t sample = 0; sample < fNSamples; ++sample) {
+    std::vector<Int_t>& clique = cliques[sample];
+    const Int_t clusters[2] = {table.GetCluster1(sample), table.GetCluster2(sample)};
+    for(Int_t idx = 0; idx < 2; ++idx)
+      for(Int_t cell = 0; cell < table.GetNCells(clusters[idx]); ++cell)
+	clique.push_back(fCellParam[table.GetCellIndex(clusters[idx])[cell]]);
+    std::sort(clique.begin(), clique.end());
+    clique.erase(std::unique(clique.begin(), clique.end()), clique.end());
+  }
+  // and each coupling its unknowns
+  for(UInt_t pair = 0; fCouplingSigma > 0 && pair + 1 < fCouplings.size(); pair += 2) {
+    std::vector<Int_t> clique;
+    for(Int_t end = 0; end < 2; ++end)
+      if( fCellParam[fCouplings[pair+end]] >= 0 )
+	clique.push_back(fCellParam[fCouplings[pair+end]]);
+    cliques.push_back(clique);
+  }
+
+  // beyond the memory budget, matrix free; the normal matrix is counted
+  // before it is allocated, and with kLDLT its factor at least as large as
+  // its strictly lower triangle
+  fUsedSolver = fSolver;
+  if( fUsedSolver != kCGLS ) {
+    const ULong64_t nNonZero = SparseMatrix::CountPattern(fNParams, cliques);
+    ULong64_t normalBytes = nNonZero * (sizeof(Int_t) + sizeof(Double_t));
+    if( fUsedSolver == kLDLT )
+      normalBytes += (nNonZero - fNParams) / 2 * (sizeof(Int_t) + sizeof(Double_t));
+    if( ReduceOverBudget(normalBytes, kTRUE) ) {
+      Warning("CompileSamples", "the normal matrix takes %.1f MB, beyond the memory budget of %.1f MB, solving matrix free (cgls)",
+	      normalBytes / 1048576., fMemoryBudget / 1048576.);
+      fUsedSolver = kCGLS;
+    }
+  }
+  if( fUsedSolver != kCGLS ) {
+    fNormal.SetPattern(fNParams, cliques);
+    ReducePattern();
+  }
+  else
+    fNormal.SetPattern(0, std::vector< std::vector<Int_t> >());
+  if( fUsedSolver == kLDLT ) {
+    ULong64_t factorBytes = ULong64_t(fNormal.GetNNonZero()) * (sizeof(Int_t) + sizeof(Double_t));
+    if( IsSolvingRank() ) {
+      fStats.Start(CalibStats::kSolve);
+      fLDLT.Analyse(fNormal);
+      fStats.Stop(CalibStats::kSolve);
+      factorBytes += ULong64_t(fLDLT.GetNNonZero()) * (sizeof(Int_t) + sizeof(Double_t));
+    }
+    // the fill in is known after the analysis, which stays cached
+    if( ReduceOverBudget(factorBytes, kFALSE) ) {
+      Warning("CompileSamples", "the normal matrix and its factor take %.1f MB, beyond the memory budget of %.1f MB, solving matrix free (cgls)",
+	      factorBytes / 1048576., fMemoryBudget / 1048576.);
+      fUsedSolver = kCGLS;
+      fNormal.SetPattern(0, std::vector< std::vector<Int_t> >());
+      fLDLT = SparseLDLT();
+    }
+  }
+  fRows.SetBudget(fMemoryBudget, fScratchDirectory.Data());
+  fGradient.assign(fNParams, 0.);
+  fResiduals.assign(fNSamples, 0.);
+}
+
+
+void NLLSCalibrator::CreatePreconditioner ( const CoreParameters& params )
+{
+  // block of unknown, by module, or by tile of fTileSize x fTileSize cells
+  // within module, of the group of the cell
+  delete fPreconditioner;
+  fPreconditioner = NULL;
+  if( fUsedSolver == kCGLS ) {
+    if( fPreconditionerType != Preconditioner::kJacobi )
+      Warning("CreatePreconditioner", "solver cgls is jacobi preconditioned only");
+    return;
+  }
+
+  const Int_t nTileX = fTileSize > 0 ? (GeometryCache::kNRowX + fTileSize - 1) / fTileSize : 1;
+  const Int_t nTileZ = fTileSize > 0 ? (GeometryCache::kNColZ + fTileSize - 1) / fTileSize : 1;
+  std::vector<Int_t> block(fNParams);
+  for(UInt_t param = 0; param < fNParams; ++param) {
+    const Int_t absId = params.fChannels[fParamCell[param]].fAbsId;
+    const Int_t module = GetCellGroup(fParamCell[param]) * CoreParameters::kNMod + GeometryCache::AbsIdToModule(absId);
+    block[param] = module * nTileX * nTileZ;
+    if( fTileSize > 0 )
+      block[param] += (GeometryCache::AbsIdToRowX(absId) / fTileSize) * nTileZ + GeometryCache::AbsIdToColZ(absId) / fTileSize;
+  }
+  fPreconditioner = Preconditioner::Create(fPreconditionerType, block);
+}
+
+
+template<class T, class NonLinearity>
+Double_t NLLSCalibrator::EvalPass ( const NonLinearity& nonLinearity, const CoreParameters& params, const std::vector<Double_t>& cc,
+				    Bool_t jacobian )
+{
+  // Evaluates the masses (in precision T) and the robust cost at cc. Stores
+  // the residuals in fResiduals. With jacobian, assembles fNormal and
+  // fGradient (in double).
+  if( jacobian )
+    fStats.Start(CalibStats::kJacobian);
+  else
+    fStats.Start(CalibStats::kResidual);
+
+  const std::vector<T> ccT(cc.begin(), cc.end());
+  const MassKernel<T, NonLinearity> kernel(*fGeometry, params.fGlobals, nonLinearity, &ccT[0]);
+  const Bool_t assemble = jacobian && fUsedSolver != kCGLS;
+  const Bool_t keepRows = jacobian && fUsedSolver == kCGLS;
+  if( assemble )
+    fNormal.Zero();
+  if( keepRows )
+    fRows.Clear();
+  if( jacobian )
+    fGradient.assign(fNParams, 0.);
+
+  // the clusters, once each
+  const ClusterTable& table = *fTable;
+  const Bool_t analytic = jacobian && fDerivatives == kAnalytic;
+  std::vector< ClusterState<T> > states;
+  if( ! jacobian || analytic ) {
+    states.resize(table.GetNClusters());
+    for(UInt_t cluster = 0; cluster < table.GetNClusters(); ++cluster)
+      kernel.EvalCluster(table.GetCellIndex(cluster), table.GetCellAmp(cluster), table.GetNCells(cluster), states[cluster], analytic);
+  }
+
+  std::vector<T> grad1, grad2;
+  std::vector< std::pair<Int_t, Double_t> > row;
+  std::vector<Int_t> cols;
+  std::vector<Double_t> g;
+  std::vector<Double_t> rowValues;
+  Double_t cost = 0;
+  fPassSquares = 0;
+  fPassNDownWeighted = 0;
+  const Double_t huberScale = fHuberK * fFitSigma;
+  for(UInt_t sample = 0; sample < fNSamples; ++sample) {
+    // bootstrap weight, samples not in the resample are not evaluated
+    const UInt_t count = fBootstrapSeed ? PoissonWeight(fBootstrapSeed, sample) : 1;
+    if( ! count ) {
+      fResiduals[sample] = 0;
+      if( keepRows )
+	fRows.AddRow(NULL, NULL, 0, 0.);
+      continue;
+    }
+
+    const Int_t cluster1 = table.GetCluster1(sample);
+    const Int_t cluster2 = table.GetCluster2(sample);
+    const Int_t nCells1 = table.GetNCells(cluster1);
+    const Int_t nCells2 = table.GetNCells(cluster2);
+    const Int_t* index1 = table.GetCellIndex(cluster1);
+    const Int_t* index2 = table.GetCellIndex(cluster2);
+    const Double_t* sampleVertex = table.GetVertex(sample);
+    const T vertex[3] = {T(sampleVertex[0]), T(sampleVertex[1]), T(sampleVertex[2])};
+
+    T mass;
+    if( jacobian && ! analytic ) {
+      grad1.resize(nCells1);
+      grad2.resize(nCells2);
+      mass = MassGradientAD(*fGeometry, params.fGlobals, nonLinearity, &ccT[0],
+			    index1, table.GetCellAmp(cluster1), nCells1,
+			    index2, table.GetCellAmp(cluster2), nCells2,
+			    vertex, &grad1[0], &grad2[0]);
+    }
+    else if( jacobian ) {
+      grad1.resize(nCells1);
+      grad2.resize(nCells2);
+      mass = MassKernel<T, NonLinearity>::MassGradient(states[cluster1], states[cluster2], vertex, &grad1[0], &grad2[0]);
+    }
+    else
+      mass = MassKernel<T, NonLinearity>::Mass(states[cluster1], states[cluster2], vertex);
+
+    const Double_t r = Double_t(mass) - fTargetMass;
+    fResiduals[sample] = r;
+    cost += count * Rho(r);
+    fPassSquares += count * 0.5*r*r;
+    fPassNDownWeighted += std::fabs(r) > huberScale;
+    if( fFillHistograms )
+      fResidualHistograms->Fill(index1, nCells1, index2, nCells2, r / fFitSigma, count);
+    if( ! jacobian )
+      continue;
+
+    // jacobian row, cells shared by the clusters, or of an aggregate, are
+    // merged
+    row.clear();
+    const Bool_t aggregated = ! fAggregates.empty();
+    for(Int_t cell = 0; cell < nCells1; ++cell)
+      row.push_back(std::make_pair(fCellParam[index1[cell]], Double_t(grad1[cell]) * (aggregated ? cc[index1[cell]] : 1.)));
+    for(Int_t cell = 0; cell < nCells2; ++cell)
+      row.push_back(std::make_pair(fCellParam[index2[cell]], Double_t(grad2[cell]) * (aggregated ? cc[index2[cell]] : 1.)));
+    std::sort(row.begin(), row.end());
+    cols.clear();
+    g.clear();
+    for(UInt_t idx = 0; idx < row.size(); ++idx) {
+      if( ! cols.empty() && cols.back() == row[idx].first )
+	g.back() += row[idx].second;
+      else {
+	cols.push_back(row[idx].first);
+	g.push_back(row[idx].second);
+      }
+    }
+
+    const Double_t w = count * Weight(r);
+    if( assemble )
+      fNormal.AddOuter(&cols[0], &g[0], cols.size(), w);
+    if( keepRows ) {
+      const Double_t sqrtW = std::sqrt(w);
+      rowValues.resize(cols.size());
+      for(UInt_t idx = 0; idx < cols.size(); ++idx)
+	rowValues[idx] = sqrtW * g[idx];
+      fRows.AddRow(&cols[0], &rowValues[0], cols.size(), - sqrtW * r);
+    }
+    for(UInt_t idx = 0; idx < cols.size(); ++idx)
+      fGradient[cols[idx]] += w * g[idx] * r;
+  }
+
+  // couplings, 0.5 w (cc_a - cc_b)^2, a jacobian row each of (1, -1), of
+  // (cc_a, -cc_b) in aggregates
+  const Double_t w = fCouplingSigma > 0 ? fFitSigma*fFitSigma / (fCouplingSigma*fCouplingSigma) : 0;
+  for(UInt_t pair = 0; w > 0 && pair + 1 < fCouplings.size(); pair += 2) {
+    const Double_t d = cc[fCouplings[pair]] - cc[fCouplings[pair+1]];
+    cost += 0.5*w*d*d;
+    if( ! jacobian )
+      continue;
+    cols.clear();
+    g.clear();
+    for(Int_t end = 0; end < 2; ++end) {
+      const Int_t param = fCellParam[fCouplings[pair+end]];
+      if( param < 0 )
+	continue;
+      const Double_t dcc = fAggregates.empty() ? 1. : cc[fCouplings[pair+end]];
+      fGradient[param] += w * (end ? -dcc : dcc) * d;
+      if( ! cols.empty() && cols[0] == param ) {
+	g[0] -= dcc;
+	continue;
+      }
+      cols.push_back(param);
+      g.push_back(end ? -dcc : dcc);
+    }
+    if( cols.size() == 2 && cols[0] > cols[1] ) {
+      std::swap(cols[0], cols[1]);
+      std::swap(g[0], g[1]);
+    }
+    if( assemble && ! cols.empty() )
+      fNormal.AddOuter(&cols[0], &g[0], cols.size(), w);
+    if( keepRows ) {
+      rowValues.resize(cols.size());
+      for(UInt_t idx = 0; idx < cols.size(); ++idx)
+	rowValues[idx] = std::sqrt(w) * g[idx];
+      fRows.AddRow(cols.empty() ? NULL : &cols[0], cols.empty() ? NULL : &rowValues[0], cols.size(), - std::sqrt(w) * d);
+    }
+  }
+  if( keepRows )
+    fRows.Finish();
+
+  if( jacobian )
+    fStats.Stop(CalibStats::kJacobian);
+  else
+    fStats.Stop(CalibStats::kResidual);
+  return ReducePass(cost, jacobian);
+}
+
+
+template<class NonLinearity>
+void NLLSCalibrator::Fit ( const NonLinearity& nonLinearity, const CoreParameters& params, std::vector<Double_t>& cc )
+{
+  fNIterations = 0;
+  fNCGIterations = 0;
+  fStopped = kFALSE;
+  if( fTelemetry )
+    fTelemetry->BeginFit();
+  if( fResidualHistograms )
+    fResidualHistograms->Reset(params);
+  Double_t times[3] = {0, 0, 0};
+
+  // robust scale, of the settings or first estimated from the initial residuals
+  fFitSigma = fSigma;
+  if( fFitSigma <= 0 ) {
+    fFitSigma = 1;
+    EvalPass<Double_t>(nonLinearity, params, cc, kFALSE);
+    fFitSigma = EstimateSigma();
+  }
+
+  // Levenberg-Marquardt; kMixed first in float to float precision, then
+  // refined in double from there, to the same stop as kDouble
+  const Bool_t useFloat = fPrecision == kMixed;
+  Double_t lambda = fLambda0;
+  std::vector<Double_t> step;
+  std::vector<Double_t> trial;
+  for(Int_t phase = useFloat ? 0 : 1; phase < 2 && ! fStopped; ++phase) {
+    const Bool_t inFloat = phase == 0;
+    const Double_t tolerance = inFloat ? TMath::Max(fTolerance, kFloatTolerance) : fTolerance;
+    const Int_t maxIterations = inFloat || ! useFloat ? fMaxIterations : fNRefinements;
+    Double_t cost = inFloat
+      ? EvalPass<Float_t>(nonLinearity, params, cc, kTRUE)
+      : EvalPass<Double_t>(nonLinearity, params, cc, kTRUE);
+    for(Int_t iteration = 0; iteration < maxIterations; ++iteration) {
+      fStats.Count(CalibStats::kIterations, 1);
+      ++fNIterations;
+
+      TelemetryRecord record;
+      if( fTelemetry ) {
+	GetStageTimes(times);
+	record.fIteration = iteration;
+	record.fPhase = useFloat && ! inFloat;
+	for(UInt_t param = 0; param < fGradient.size(); ++param)
+	  record.fGradientNorm += fGradient[param]*fGradient[param];
+	record.fGradientNorm = std::sqrt(record.fGradientNorm);
+      }
+
+      Bool_t accepted = kFALSE;
+      const Double_t previousCost = cost;
+      Double_t stepNorm = 0;
+      Double_t ccNorm = 0;
+      while( ! accepted && lambda < 1e10 ) {
+	const Int_t nInner = Solve(lambda, step);
+	fNCGIterations += nInner;
+	record.fNInnerIterations += nInner;
+	++record.fNTrials;
+	record.fLambda = lambda;
+	trial = cc;
+	ApplyStep(step, trial, stepNorm, ccNorm);
+	const Double_t trialCost = inFloat
+	  ? EvalPass<Float_t>(nonLinearity, params, trial, kFALSE)
+	  : EvalPass<Double_t>(nonLinearity, params, trial, kFALSE);
+	if( trialCost < cost ) {
+	  accepted = kTRUE;
+	  cc.swap(trial);
+	  cost = trialCost;
+	  lambda = TMath::Max(lambda / 10, 1e-12);
+	}
+	else
+	  lambda *= 10;
+      }
+      record.fStepNorm = std::sqrt(stepNorm);
+      record.fCost = fPassSquares;
+      record.fRobustCost = cost;
+      record.fNDownWeighted = fPassNDownWeighted;
+      if( fTelemetry && ! RecordIteration(record, times) ) {
+	fStopped = kTRUE;
+	break;
+      }
+      if( ! accepted )
+	break;
+
+      // an estimated scale follows the residuals of the accepted cc's, as
+      // in IRLS; an offset of the initial cc's inflates the first estimate,
+      // and the fit does not stop while the scale moves
+      Bool_t scaleMoved = kFALSE;
+      if( fSigma <= 0 ) {
+	const Double_t sigma = EstimateSigma();
+	scaleMoved = std::fabs(sigma - fFitSigma) > kSigmaTolerance * fFitSigma;
+	fFitSigma = sigma;
+      }
+      if( ! scaleMoved && (stepNorm <= tolerance*tolerance * ccNorm || previousCost - cost <= tolerance * previousCost) )
+	break;
+      cost = inFloat
+	? EvalPass<Float_t>(nonLinearity, params, cc, kTRUE)
+	: EvalPass<Double_t>(nonLinearity, params, cc, kTRUE);
+    }
+  }
+
+  // the final residuals, into the histograms
+  if( fResidualHistograms )
+    fFillHistograms = kTRUE;
+  fCost = EvalPass<Double_t>(nonLinearity, params, cc, kFALSE);
+  fFillHistograms = kFALSE;
+}
+
+
+void NLLSCalibrator::ApplyStep ( const std::vector<Double_t>& step, std::vector<Double_t>& cc, Double_t& stepNorm, Double_t& ccNorm ) const
+{
+  // each component clipped to change its cc by at most kMaxRelativeStep of
+  // it, so that no cc changes sign
+  stepNorm = 0;
+  ccNorm = 0;
+  if( fAggregates.empty() ) {
+    for(UInt_t param = 0; param < fNParams; ++param) {
+      Double_t& c = cc[fParamCell[param]];
+      const Double_t d = TMath::Max(- kMaxRelativeStep * std::fabs(c), TMath::Min(kMaxRelativeStep * std::fabs(c), step[param]));
+      ccNorm += c*c;
+      c += d;
+      stepNorm += d*d;
+    }
+    return;
+  }
+  for(UInt_t cell = 0; cell < cc.size(); ++cell)
+    if( fCellParam[cell] >= 0 )
+      cc[cell] *= 1 + TMath::Max(- kMaxRelativeStep, TMath::Min(kMaxRelativeStep, step[fCellParam[cell]]));
+  for(UInt_t param = 0; param < fNParams; ++param) {
+    const Double_t d = TMath::Max(- kMaxRelativeStep, TMath::Min(kMaxRelativeStep, step[param]));
+    stepNorm += d*d;
+  }
+  ccNorm = fNParams;
+}
+
+
+Int_t NLLSCalibrator::Solve ( Double_t lambda, std::vector<Double_t>& step )
+{
+  // without warm start, or the first time, the solve starts from zero
+  if( ! fWarmStart || step.size() != fNParams )
+    step.assign(fNParams, 0.);
+  switch( fUsedSolver ) {
+  case kCGLS:
+    return SolveCGLS(lambda, step);
+  case kLDLT:
+    return SolveDirect(lambda, step);
+  default:
+    return SolveNormal(lambda, step);
+  }
+}
+
+
+Int_t NLLSCalibrator::SolveDirect ( Double_t lambda, std::vector<Double_t>& step )
+{
+  // Solves (A + lambda D) step = -g as SolveNormal, by the LDL^T
+  // factorisation on the analysis of CompileSamples; by SolveNormal if a
+  // pivot is not positive. Returns 1, the factorisation.
+  fStats.Start(CalibStats::kSolve);
+
+  std::vector<Double_t> damping;
+  GetDamping(damping);
+  std::vector<Double_t> shift(fNParams);
+  for(UInt_t idx = 0; idx < fNParams; ++idx)
+    shift[idx] = lambda * damping[idx];
+  if( ! fLDLT.Factorise(fNormal, shift) ) {
+    fStats.Stop(CalibStats::kSolve);
+    Warning("SolveDirect", "the damped normal matrix is not positive definite, solved by cg");
+    return SolveNormal(lambda, step);
+  }
+  std::vector<Double_t> rhs(fNParams);
+  for(UInt_t idx = 0; idx < fNParams; ++idx)
+    rhs[idx] = - fGradient[idx];
+  step.resize(fNParams);
+  if( fNParams )
+    fLDLT.Solve(&rhs[0], &step[0]);
+
+  fStats.Stop(CalibStats::kSolve);
+  return 1;
+}
+
+
+Int_t NLLSCalibrator::SolveNormal ( Double_t lambda, std::vector<Double_t>& step )
+{
+  // Solves (A + lambda D) step = -g, A = fNormal, g = fGradient and D the
+  // diagonal of A (floored), by preconditioned conjugate gradient, starting
+  // from step. Returns the number of iterations.
+  fStats.Start(CalibStats::kSolve);
+
+  const UInt_t n = fNParams;
+  std::vector<Double_t> damping;
+  GetDamping(damping);
+  std::vector<Double_t> shift(n);
+  for(UInt_t idx = 0; idx < n; ++idx)
+    shift[idx] = lambda * damping[idx];
+  fPreconditioner->Compute(fNormal, shift);
+
+  std::vector<Double_t> r(n), z(n), p(n), q(n);
+  MultiplyDamped(lambda, damping, &step[0], &q[0]);
+  Double_t rz = 0;
+  Double_t bNorm = 0;
+  for(UInt_t idx = 0; idx < n; ++idx) {
+    r[idx] = - fGradient[idx] - q[idx];
+    bNorm += fGradient[idx]*fGradient[idx];
+  }
+  fPreconditioner->Apply(&r[0], &z[0]);
+  for(UInt_t idx = 0; idx < n; ++idx) {
+    p[idx] = z[idx];
+    rz += r[idx]*z[idx];
+  }
+
+  Int_t iteration = 0;
+  for(; iteration < fMaxCGIterations && bNorm > 0; ++iteration) {
+    MultiplyDamped(lambda, damping, &p[0], &q[0]);
+    Double_t pq = 0;
+    for(UInt_t idx = 0; idx < n; ++idx)
+      pq += p[idx]*q[idx];
+    if( pq <= 0 )
+      break;
+    const Double_t alpha = rz / pq;
+    Double_t rNorm = 0;
+    for(UInt_t idx = 0; idx < n; ++idx) {
+      step[idx] += alpha * p[idx];
+      r[idx] -= alpha * q[idx];
+      rNorm += r[idx]*r[idx];
+    }
+    if( rNorm <= fCGTolerance*fCGTolerance * bNorm ) {
+      ++iteration;
+      break;
+    }
+    fPreconditioner->Apply(&r[0], &z[0]);
+    Double_t rzNew = 0;
+    for(UInt_t idx = 0; idx < n; ++idx)
+      rzNew += r[idx]*z[idx];
+    const Double_t beta = rzNew / rz;
+    rz = rzNew;
+    for(UInt_t idx = 0; idx < n; ++idx)
+      p[idx] = z[idx] + beta * p[idx];
+  }
+
+  fStats.Stop(CalibStats::kSolve);
+  return iteration;
+}
+
+
+Int_t NLLSCalibrator::SolveCGLS ( Double_t lambda, std::vector<Double_t>& step )
+{
+  // Minimises |J step - b|^2 + lambda step^T D step, J the weighted jacobian
+  // rows, b = fRowRHS and D the floored diagonal of J^T J, by Jacobi
+  // preconditioned CGLS starting from step. The same solution as
+  // SolveNormal, without the normal matrix. Returns the number of iterations.
+  fStats.Start(CalibStats::kSolve);
+
+  const UInt_t n = fNParams;
+  std::vector<Double_t> damping;
+  GetDamping(damping);
+
+  // row space residual rs = b - J step, and s = J^T rs - lambda D step
+  const UInt_t nRows = fRows.GetNRows();
+  const std::vector<Double_t>& rhs = fRows.GetRHS();
+  std::vector<Double_t> rs(nRows), q(nRows);
+  std::vector<Double_t> s(n), z(n), p(n);
+  fRows.Multiply(&step[0], &rs[0]);
+  for(UInt_t row = 0; row < nRows; ++row)
+    rs[row] = rhs[row] - rs[row];
+  fRows.MultiplyTransposed(&rs[0], &s[0], n);
+  ReduceSums(&s[0], n);
+  Double_t gamma = 0;
+  Double_t bNorm = 0;
+  for(UInt_t idx = 0; idx < n; ++idx) {
+    s[idx] -= lambda * damping[idx] * step[idx];
+    z[idx] = s[idx] / ((1 + lambda) * damping[idx]);
+    p[idx] = z[idx];
+    gamma += s[idx]*z[idx];
+    bNorm += fGradient[idx]*fGradient[idx];
+  }
+
+  Int_t iteration = 0;
+  for(; iteration < fMaxCGIterations && bNorm > 0; ++iteration) {
+    fRows.Multiply(&p[0], &q[0]);
+    Double_t delta = 0;
+    for(UInt_t row = 0; row < nRows; ++row)
+      delta += q[row]*q[row];
+    ReduceSums(&delta, 1);
+    for(UInt_t idx = 0; idx < n; ++idx)
+      delta += lambda * damping[idx] * p[idx]*p[idx];
+    if( delta <= 0 )
+      break;
+    const Double_t alpha = gamma / delta;
+    for(UInt_t idx = 0; idx < n; ++idx)
+      step[idx] += alpha * p[idx];
+    for(UInt_t row = 0; row < nRows; ++row)
+      rs[row] -= alpha * q[row];
+    fRows.MultiplyTransposed(&rs[0], &s[0], n);
+    ReduceSums(&s[0], n);
+    Double_t sNorm = 0;
+    for(UInt_t idx = 0; idx < n; ++idx) {
+      s[idx] -= lambda * damping[idx] * step[idx];
+      sNorm += s[idx]*s[idx];
+    }
+    if( sNorm <= fCGTolerance*fCGTolerance * bNorm ) {
+      ++iteration;
+      break;
+    }
+    Double_t gammaNew = 0;
+    for(UInt_t idx = 0; idx < n; ++idx) {
+      z[idx] = s[idx] / ((1 + lambda) * damping[idx]);
+      gammaNew += s[idx]*z[idx];
+    }
+    const Double_t beta = gammaNew / gamma;
+    gamma = gammaNew;
+    for(UInt_t idx = 0; idx < n; ++idx)
+      p[idx] = z[idx] + beta * p[idx];
+  }
+
+  fStats.Stop(CalibStats::kSolve);
+  return iteration;
+}
+
+
+void NLLSCalibrator::GetDamping ( std::vector<Double_t>& damping )
+{
+  // the diagonal of J^T W J, floored relative to its largest element
+  damping.assign(fNParams, 0.);
+  if( fUsedSolver != kCGLS )
+    for(UInt_t param = 0; param < fNParams; ++param)
+      damping[param] = fNormal.GetDiagonal(param);
+  else {
+    fRows.AddSquares(damping);
+    if( fNParams )
+      ReduceSums(&damping[0], fNParams);
+  }
+
+  Double_t maxDiagonal = 0;
+  for(UInt_t param = 0; param < fNParams; ++param)
+    maxDiagonal = TMath::Max(maxDiagonal, damping[param]);
+  for(UInt_t param = 0; param < fNParams; ++param)
+    damping[param] = TMath::Max(damping[param], 1e-12*maxDiagonal + 1e-300);
+}
+
+
+void NLLSCalibrator::MultiplyDamped ( Double_t lambda, const std::vector<Double_t>& damping, const Double_t* x, Double_t* y ) const
+{
+  fNormal.Multiply(x, y);
+  for(UInt_t idx = 0; idx < fNParams; ++idx)
+    y[idx] += lambda * damping[idx] * x[idx];
+}
+
+
+Double_t NLLSCalibrator::EstimateSigma()
+{
+  const Double_t sigma = GetPeakWidth();
+  return sigma > 0 ? sigma : 1;
+}
+
+
+Double_t NLLSCalibrator::GetPeakWidth() const
+{
+  // 1.4826 * median(|r|), the normal equivalent of the median absolute
+  // residual, of the resample, each sample its bootstrap weight times
+  std::vector<Double_t> absResiduals;
+  absResiduals.reserve(fResiduals.size());
+  for(UInt_t sample = 0; sample < fResiduals.size(); ++sample) {
+    const UInt_t count = fBootstrapSeed ? PoissonWeight(fBootstrapSeed, sample) : 1;
+    absResiduals.insert(absResiduals.end(), count, std::fabs(fResiduals[sample]));
+  }
+  if( absResiduals.empty() )
+    return 0;
+  const UInt_t median = absResiduals.size() / 2;
+  std::nth_element(absResiduals.begin(), absResiduals.begin() + median, absResiduals.end());
+  return 1.4826 * absResiduals[median];
+}
+
+
+void NLLSCalibrator::GetStageTimes ( Double_t times[3] ) const
+{
+  times[0] = fStats.GetRealTime(CalibStats::kResidual);
+  times[1] = fStats.GetRealTime(CalibStats::kJacobian);
+  times[2] = fStats.GetRealTime(CalibStats::kSolve);
+}
+
+
+Bool_t NLLSCalibrator::RecordIteration ( TelemetryRecord& record, const Double_t times[3] )
+{
+  Double_t now[3];
+  GetStageTimes(now);
+  record.fResidualTime = now[0] - times[0];
+  record.fJacobianTime = now[1] - times[1];
+  record.fSolveTime = now[2] - times[2];
+  return fTelemetry->Record(record);
+}
+
+
+Double_t NLLSCalibrator::Rho ( Double_t r ) const
+{
+  const Double_t c = fHuberK * fFitSigma;
+  const Double_t absR = std::fabs(r);
+  return absR <= c ? 0.5*r*r : c*absR - 0.5*c*c;
+}
+
+
+Double_t NLLSCalibrator::Weight ( Double_t r ) const
+{
+  const Double_t c = fHuberK * fFitSigma;
+  const Double_t absR = std::fabs(r);
+  return absR <= c ? 1 : c / absR;
+}
@@ -0,0 +1,247 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef NLLSCALIBRATOR_H
+#define NLLSCALIBRATOR_H
+
+#include "Calibrator.h"
+#include "SparseMatrix.h"
+#include "Preconditioner.h"
+#include "SparseLDLT.h"
+#include "ClusterTable.h"
+#include "RowStore.h"
+#include <vector>
+
+class GeometryCache;
+struct TelemetryRecord;
+
+
+// Outlier robust nonlinear least squares calibration of the cc's.
+//
+// Minimises sum_s rho(M_s(cc) - m0) over the samples of a ClusterTable,
+// rho the Huber loss of scale sigma, by Levenberg-Marquardt steps on the
+// IRLS weighted normal equations; the settings below choose how the steps
+// are solved and what the unknowns are.
+class NLLSCalibrator : public Calibrator
+{
+public:
+  enum Precision { kDouble, kMixed };
+  enum Derivatives { kAnalytic, kAutomatic };
+  enum Solver { kCG, kCGLS, kLDLT };
+
+  NLLSCalibrator();
+  virtual ~NLLSCalibrator();
+
+  virtual SampleParameters Calibrate(std::vector<Sample> & samples, SampleParameters& initalParams);
+  SampleParameters Calibrate(const ClusterTable& table, SampleParameters& initalParams);
+  virtual void PrintReport(Option_t* option = "") const;
+
+  // *** Settings ***
+  // kMixed: residuals and jacobian rows in float, the normal equations in
+  // double; once converged to kFloatTolerance, at most SetNRefinements
+  // iterations in double, with a double gradient (with the float one the
+  // refinement stalls about 1e-5 short)
+  void SetPrecision(Precision precision) { fPrecision = precision; }
+  // kAutomatic: forward mode (AutoDiff.h), exact but slower; the check of
+  // kAnalytic, the hand derived gradient of MassKernel
+  void SetDerivatives(Derivatives derivatives) { fDerivatives = derivatives; }
+  // kCG: sparse normal matrix, preconditioned conjugate gradient. kCGLS:
+  // matrix free, CGLS streamed over the jacobian rows, memory per sample.
+  // kLDLT: sparse LDL^T (SparseLDLT.h), the analysis cached per pattern.
+  // Beyond the memory budget (Calibrator::SetMemoryBudget) the normal
+  // matrix is not assembled, kCGLS is used, and its rows beyond the budget
+  // are spilled to a scratch file (RowStore.h)
+  void SetSolver(Solver solver) { fSolver = solver; }
+  // each solve starts from the previous step, rather than from zero
+  void SetWarmStart(Bool_t warmStart) { fWarmStart = warmStart; }
+  // kCG, and kLDLT if a factorisation fails; Jacobi by default. tileSize
+  // is the size in cells of the square block jacobi tiles, 0 a module
+  void SetPreconditioner(Preconditioner::Type type, Int_t tileSize = 0) { fPreconditionerType = type; fTileSize = tileSize; }
+  void SetTargetMass(Double_t mass) { fTargetMass = mass; }
+  void SetSigma(Double_t sigma) { fSigma = sigma; } // <= 0: estimated from the residuals, each iteration
+  void SetHuberK(Double_t k) { fHuberK = k; }
+  void SetMaxIterations(Int_t n) { fMaxIterations = n; }
+  void SetTolerance(Double_t tolerance) { fTolerance = tolerance; }
+  void SetLambda(Double_t lambda) { fLambda0 = lambda; }
+  void SetNRefinements(Int_t n) { fNRefinements = n; } // kMixed, iterations in double
+  void SetMaxCGIterations(Int_t n) { fMaxCGIterations = n; }
+  void SetCGTolerance(Double_t tolerance) { fCGTolerance = tolerance; }
+  // each sample weighted by PoissonWeight(seed, sample), the fit of a
+  // bootstrap resample without a copy of the samples (BootstrapCalibrator).
+  // 0: no resampling
+  void SetBootstrapSeed(ULong64_t seed) { fBootstrapSeed = seed; }
+  // geometry of the parameters, shared between calibrators, not owned
+  void SetGeometry(const GeometryCache* geometry);
+  // the unknowns and the normal matrix pattern (and its analysis) kept from
+  // one Calibrate of a table to the next of the same table and good
+  // channels, which must not change in between (SweepCalibrator)
+  void SetKeepCompiled(Bool_t keep) { fKeepCompiled = keep; }
+  // the settings of other, and its memory budget, not the bootstrap seed,
+  // the geometry nor SetKeepCompiled
+  void CopySettings(const NLLSCalibrator& other);
+  // pairs of good channel indices, [2*nCouplings], each adding
+  // 0.5 (sigma (cc_a - cc_b) / sigmaCC)^2 to the cost (PeriodCalibrator);
+  // a channel which is not an unknown enters with its fixed cc.
+  // sigmaCC <= 0: no couplings
+  void SetCouplings(const std::vector<Int_t>& pairs, Double_t sigmaCC) { fCouplings = pairs; fCouplingSigma = sigmaCC; }
+  // aggregate (>= 0) of each good channel, [nGood]; an unknown per
+  // aggregate, the relative step d of cc_c -> cc_c (1 + d) of its cells
+  // (MultilevelCalibrator). Empty for an unknown per channel
+  void SetAggregates(const std::vector<Int_t>& cellAggregate) { fAggregates = cellAggregate; }
+
+  Precision GetPrecision() const { return fPrecision; }
+  Derivatives GetDerivatives() const { return fDerivatives; }
+  Solver GetSolver() const { return fSolver; }
+  // the solver of the last fit, kCGLS where the setting is beyond the memory budget
+  Solver GetUsedSolver() const { return fUsedSolver; }
+  Preconditioner::Type GetPreconditionerType() const { return fPreconditionerType; }
+  Double_t GetSigma() const { return fSigma; } // the setting, see GetFitSigma
+  ULong64_t GetBootstrapSeed() const { return fBootstrapSeed; }
+
+  // weight of sample in the resample of seed
+  static UInt_t PoissonWeight(ULong64_t seed, UInt_t sample);
+
+  // *** Result of last Calibrate ***
+  Double_t GetFitSigma() const { return fFitSigma; } // the sigma of the fit, set or estimated
+  Double_t GetCost() const { return fCost; }
+  Int_t GetNIterations() const { return fNIterations; }
+  Int_t GetNCGIterations() const { return fNCGIterations; }
+  UInt_t GetNParams() const { return fNParams; }
+  // 1.4826 median |M - m0| of the final residuals of the resample, the width of the peak
+  Double_t GetPeakWidth() const;
+  // the telemetry callback stopped the fit
+  Bool_t IsStopped() const { return fStopped; }
+  // the jacobian rows of kCGLS, and what of them was spilled
+  const RowStore& GetRows() const { return fRows; }
+
+  const static Double_t kPi0Mass; // [GeV]
+  const static Double_t kFloatTolerance; // relative step at which float iterations stop, kMixed
+  const static Double_t kSigmaTolerance; // relative change of an estimated sigma below which the fit may stop
+  const static Double_t kMaxRelativeStep; // largest change of a cc in a step, relative to the cc
+
+protected:
+  class FitFunctor; // calls Fit with the nonlinearity policy of the parameters
+
+  // fits the cc's of params to the samples of table, params holds the result
+  void CalibrateCore(const ClusterTable& table, CoreParameters& params);
+  void CompileSamples(const ClusterTable& table, const CoreParameters& params);
+  void CreatePreconditioner(const CoreParameters& params);
+  // group of good channel cell, the blocks of the block jacobi
+  // preconditioner do not span groups
+  virtual Int_t GetCellGroup(Int_t cell) const { return 0; }
+
+  // hooks for calibration over several processes (DistributedCalibrator),
+  // called with the local results; by default the local results are all.
+  virtual void ReduceUnknowns(std::vector<Int_t>& cellParam) {} // >= 0 where a cell is an unknown
+  virtual void ReducePattern() {} // after fNormal.SetPattern, kCG and kLDLT
+  virtual Double_t ReducePass(Double_t cost, Bool_t jacobian) { return cost; } // after each EvalPass
+  virtual void ReduceSums(Double_t* data, UInt_t n) {} // elementwise, the products of the kCGLS solve
+  virtual Bool_t IsSolvingRank() const { return kTRUE; } // holds the normal equations of all samples, kCG and kLDLT
+  // bytes beyond the memory budget, the same on all ranks; estimate: the bytes of
+  // the samples of this rank, else the bytes this rank holds
+  virtual Bool_t ReduceOverBudget(ULong64_t& bytes, Bool_t estimate) { return fMemoryBudget > 0 && bytes > ULong64_t(fMemoryBudget); }
+  template<class T, class NonLinearity>
+  Double_t EvalPass(const NonLinearity& nonLinearity, const CoreParameters& params, const std::vector<Double_t>& cc,
+		    Bool_t jacobian);
+  // cc plus step, in cc, and the squared norms of the step and of the
+  // unknowns (relative steps and 1 of aggregates)
+  void ApplyStep(const std::vector<Double_t>& step, std::vector<Double_t>& cc, Double_t& stepNorm, Double_t& ccNorm) const;
+  template<class NonLinearity>
+  void Fit(const NonLinearity& nonLinearity, const CoreParameters& params, std::vector<Double_t>& cc);
+  // solves the damped normal equations for step, with the solver of the settings
+  virtual Int_t Solve(Double_t lambda, std::vector<Double_t>& step);
+  Int_t SolveNormal(Double_t lambda, std::vector<Double_t>& step);
+  Int_t SolveCGLS(Double_t lambda, std::vector<Double_t>& step);
+  Int_t SolveDirect(Double_t lambda, std::vector<Double_t>& step);
+  void MultiplyDamped(Double_t lambda, const std::vector<Double_t>& damping, const Double_t* x, Double_t* y) const;
+  void GetDamping(std::vector<Double_t>& damping); // floored diagonal of J^T W J
+  virtual Double_t EstimateSigma();
+
+  // the residual, jacobian and solve wall times so far
+  void GetStageTimes(Double_t times[3]) const;
+  // records an iteration to fTelemetry, with the stage times since times;
+  // kFALSE if the fit is to stop
+  Bool_t RecordIteration(TelemetryRecord& record, const Double_t times[3]);
+
+  // Huber loss and IRLS weight of residual
+  Double_t Rho(Double_t r) const;
+  Double_t Weight(Double_t r) const;
+
+  // *** Settings ***
+  Precision fPrecision;
+  Derivatives fDerivatives;
+  Solver fSolver;
+  Bool_t fWarmStart;
+  Preconditioner::Type fPreconditionerType;
+  Int_t fTileSize;
+  Double_t fTargetMass;
+  Double_t fSigma;
+  Double_t fHuberK;
+  Int_t fMaxIterations;
+  Double_t fTolerance; // on |dcc|/|cc|
+  Double_t fLambda0;
+  Int_t fNRefinements;
+  Int_t fMaxCGIterations;
+  Double_t fCGTolerance;
+  ULong64_t fBootstrapSeed;
+  std::vector<Int_t> fCouplings; // pairs of good channels
+  Double_t fCouplingSigma;
+  std::vector<Int_t> fAggregates; // [nGood] aggregate of good channel, empty for none
+  Bool_t fKeepCompiled;
+
+  // *** Compiled samples ***
+  ClusterTable fClusters; // samples of Calibrate(std::vector<Sample>&)
+  const ClusterTable* fTable; // samples fitted
+  UInt_t fNSamples;
+  Solver fUsedSolver; // fSolver, or kCGLS beyond the memory budget
+
+  // *** Unknowns, the cc's of the good channels in any sample ***
+  UInt_t fNParams;
+  std::vector<Int_t> fCellParam; // [nGood] unknown of good channel, -1 if none
+  std::vector<Int_t> fParamCell; // [fNParams] good channel of unknown, the first of an aggregate
+
+  // *** Work ***
+  const GeometryCache* fGeometry;
+  Bool_t fOwnsGeometry;
+  SparseMatrix fNormal; // J^T W J, kCG and kLDLT
+  Preconditioner* fPreconditioner; // kCG
+  SparseLDLT fLDLT; // kLDLT
+  RowStore fRows; // weighted jacobian rows sqrt(w) dM/dcc, right hand sides -sqrt(w) r, kCGLS; the samples', then the couplings'
+  std::vector<Double_t> fGradient; // J^T W r
+  std::vector<Double_t> fResiduals; // [fNSamples] M - m0
+  Double_t fPassSquares; // sum 0.5 r^2 of the last pass
+  Int_t fPassNDownWeighted; // samples beyond the huber scale in the last pass
+  Bool_t fFillHistograms; // the pass fills fResidualHistograms
+
+  // *** Result ***
+  Double_t fFitSigma;
+  Double_t fCost;
+  Int_t fNIterations;
+  Int_t fNCGIterations;
+  Bool_t fStopped;
+
+private:
+  NLLSCalibrator(const NLLSCalibrator&); // Not Implemented
+  NLLSCalibrator& operator= (const NLLSCalibrator&); // Not Implemented
+};
+
+#endif // NLLSCALIBRATOR_H
@@ -0,0 +1,241 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "PeakCalibrator.h"
+#include "NLLSCalibrator.h"
+#include "GeometryCache.h"
+#include "MassKernel.h"
+#include "NonLinearity.h"
+#include <TMath.h>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+
+class PeakCalibrator::FillFunctor
+{
+public:
+  FillFunctor(PeakCalibrator& calibrator, const CoreParameters& params)
+  : fCalibrator(calibrator), fParams(params) {}
+
+  template<class NonLinearity> void operator() (const NonLinearity& nonLinearity)
+  { fCalibrator.Fill(nonLinearity, fParams); }
+
+private:
+  FillFunctor(const FillFunctor&); // Not Implemented
+  FillFunctor& operator= (const FillFunctor&); // Not Implemented
+
+  PeakCalibrator& fCalibrator;
+  const CoreParameters& fParams;
+};
+
+
+PeakCalibrator::PeakCalibrator()
+: Calibrator(),
+  fNBins(100),
+  fMin(0.5),
+  fMax(1.5),
+  fWindow(3),
+  fMinEntries(20),
+  fMaxCorrection(2),
+  fTargetMass(NLLSCalibrator::kPi0Mass),
+  fNThreads(0),
+  fClusters(),
+  fTable(NULL),
+  fGeometry(NULL),
+  fThreadHistograms(),
+  fThreadEntries(),
+  fThreadFractions(),
+  fHistograms(),
+  fEntries(),
+  fFractions(),
+  fPeaks(),
+  fNCorrected(0),
+  fNThreadsUsed(0)
+{
+}
+
+
+PeakCalibrator::~PeakCalibrator()
+{
+}
+
+
+SampleParameters PeakCalibrator::Calibrate ( std::vector<Sample> & samples, SampleParameters& initalParams )
+{
+  fClusters.Clear();
+  for(UInt_t idx = 0; idx < samples.size(); ++idx)
+    fClusters.AddSample(samples[idx]);
+  return Calibrate(fClusters, initalParams);
+}
+
+
+SampleParameters PeakCalibrator::Calibrate ( const ClusterTable& table, SampleParameters& initalParams )
+{
+  CoreParameters core;
+  initalParams.GetCore(core);
+  const GeometryCache geometry(core);
+  fTable = &table;
+  fGeometry = &geometry;
+  fStats.Count(CalibStats::kSamples, table.GetNSamples());
+  fStats.Start(CalibStats::kResidual);
+  FillFunctor fill(*this, core);
+  DispatchNonLinearity(core.fGlobals, fill);
+  fStats.Stop(CalibStats::kResidual);
+  fGeometry = NULL;
+
+  // the peaks, and the corrections of the cells of enough entries
+  SampleParameters result(initalParams);
+  const UInt_t nGood = core.GetNGood();
+  fPeaks.assign(nGood, 0.);
+  fNCorrected = 0;
+  for(UInt_t cell = 0; cell < nGood; ++cell) {
+    if( fEntries[cell] < UInt_t(TMath::Max(fMinEntries, 1)) )
+      continue;
+    fPeaks[cell] = FindPeak(cell);
+    const Double_t fraction = GetFraction(cell);
+    if( fPeaks[cell] <= 0 || fraction <= 0 )
+      continue;
+    Double_t correction = std::pow(fPeaks[cell], -2 / fraction);
+    correction = TMath::Max(1 / fMaxCorrection, TMath::Min(fMaxCorrection, correction));
+    result.SetCC(cell, initalParams.GetCCArray()[cell] * correction);
+    ++fNCorrected;
+  }
+  return result;
+}
+
+
+void PeakCalibrator::PrintReport ( Option_t* option ) const
+{
+  printf("PeakCalibrator.PrintReport\n");
+  Double_t meanFraction = 0;
+  for(UInt_t cell = 0; cell < fEntries.size(); ++cell)
+    if( fPeaks[cell] > 0 )
+      meanFraction += GetFraction(cell);
+  printf("   samples: %d, cells: %d, corrected: %d, mean leading energy fraction: %g, bins: %d in [%g, %g), threads: %d\n",
+	 fTable ? fTable->GetNSamples() : 0, (Int_t) fEntries.size(), fNCorrected,
+	 fNCorrected ? meanFraction / fNCorrected : 0., fNBins, fMin, fMax, fNThreadsUsed);
+  Calibrator::PrintReport(option);
+}
+
+
+template<class NonLinearity>
+void PeakCalibrator::Fill ( const NonLinearity& nonLinearity, const CoreParameters& params )
+{
+  const UInt_t nGood = params.GetNGood();
+  std::vector<Double_t> cc(nGood);
+  for(UInt_t cell = 0; cell < nGood; ++cell)
+    cc[cell] = params.fChannels[cell].fCC;
+
+  Int_t nThreads = fNThreads > 0 ? fNThreads : std::thread::hardware_concurrency();
+  nThreads = TMath::Max(1, TMath::Min(nThreads, Int_t(fTable->GetNSamples())));
+  fNThreadsUsed = nThreads;
+  fThreadHistograms.assign(nThreads, std::vector<UInt_t>(nGood * fNBins, 0));
+  fThreadEntries.assign(nThreads, std::vector<UInt_t>(nGood, 0));
+  fThreadFractions.assign(nThreads, std::vector<Double_t>(nGood, 0.));
+
+  std::vector<std::thread> threads;
+  for(Int_t thread = 1; thread < nThreads; ++thread)
+    threads.push_back(std::thread(&PeakCalibrator::FillSamples<NonLinearity>, this, std::cref(nonLinearity), std::cref(params),
+				  std::cref(cc), thread, nThreads));
+  FillSamples(nonLinearity, params, cc, 0, nThreads);
+  for(UInt_t thread = 0; thread < threads.size(); ++thread)
+    threads[thread].join();
+
+  // the sum of the threads
+  fHistograms.swap(fThreadHistograms[0]);
+  fEntries.swap(fThreadEntries[0]);
+  fFractions.swap(fThreadFractions[0]);
+  for(Int_t thread = 1; thread < nThreads; ++thread) {
+    for(UInt_t bin = 0; bin < fHistograms.size(); ++bin)
+      fHistograms[bin] += fThreadHistograms[thread][bin];
+    for(UInt_t cell = 0; cell < nGood; ++cell) {
+      fEntries[cell] += fThreadEntries[thread][cell];
+      fFractions[cell] += fThreadFractions[thread][cell];
+    }
+  }
+  fThreadHistograms.clear();
+  fThreadEntries.clear();
+  fThreadFractions.clear();
+}
+
+
+template<class NonLinearity>
+void PeakCalibrator::FillSamples ( const NonLinearity& nonLinearity, const CoreParameters& params, const std::vector<Double_t>& cc,
+				   Int_t thread, Int_t nThreads )
+{
+  const ClusterTable& table = *fTable;
+  const MassKernel<Double_t, NonLinearity> kernel(*fGeometry, params.fGlobals, nonLinearity, &cc[0]);
+  std::vector<UInt_t>& histograms = fThreadHistograms[thread];
+  std::vector<UInt_t>& entries = fThreadEntries[thread];
+  std::vector<Double_t>& fractions = fThreadFractions[thread];
+  const UInt_t nSamples = table.GetNSamples();
+  const UInt_t begin = ULong64_t(nSamples) * thread / nThreads;
+  const UInt_t end = ULong64_t(nSamples) * (thread + 1) / nThreads;
+  ClusterState<Double_t> states[2];
+  for(UInt_t sample = begin; sample < end; ++sample) {
+    const Int_t clusters[2] = {table.GetCluster1(sample), table.GetCluster2(sample)};
+    for(Int_t idx = 0; idx < 2; ++idx)
+      kernel.EvalCluster(table.GetCellIndex(clusters[idx]), table.GetCellAmp(clusters[idx]), table.GetNCells(clusters[idx]),
+			 states[idx], kFALSE);
+    const Double_t ratio = MassKernel<Double_t, NonLinearity>::Mass(states[0], states[1], table.GetVertex(sample)) / fTargetMass;
+    const Int_t bin = Int_t(std::floor((ratio - fMin) / (fMax - fMin) * fNBins));
+    if( bin < 0 || bin >= fNBins )
+      continue;
+
+    // the leading cell of each cluster, by raw energy
+    for(Int_t idx = 0; idx < 2; ++idx) {
+      const Int_t* index = table.GetCellIndex(clusters[idx]);
+      const Float_t* amp = table.GetCellAmp(clusters[idx]);
+      Int_t leading = 0;
+      Double_t energy = 0;
+      for(Int_t cell = 0; cell < table.GetNCells(clusters[idx]); ++cell) {
+	energy += cc[index[cell]] * amp[cell];
+	if( cc[index[cell]] * amp[cell] > cc[index[leading]] * amp[leading] )
+	  leading = cell;
+      }
+      const Int_t cell = index[leading];
+      ++histograms[cell*fNBins + bin];
+      ++entries[cell];
+      if( energy > 0 )
+	fractions[cell] += cc[cell] * amp[leading] / energy;
+    }
+  }
+}
+
+
+Double_t PeakCalibrator::FindPeak ( UInt_t cell ) const
+{
+  // mean of the bins around the largest
+  const UInt_t* histogram = GetHistogram(cell);
+  Int_t largest = 0;
+  for(Int_t bin = 1; bin < fNBins; ++bin)
+    if( histogram[bin] > histogram[largest] )
+      largest = bin;
+  Double_t sum = 0;
+  Double_t weighted = 0;
+  for(Int_t bin = TMath::Max(0, largest - fWindow); bin <= TMath::Min(fNBins - 1, largest + fWindow); ++bin) {
+    sum += histogram[bin];
+    weighted += histogram[bin] * (fMin + (bin + 0.5) * (fMax - fMin) / fNBins);
+  }
+  return sum > 0 ? weighted / sum : 0;
+}
@@ -0,0 +1,117 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PEAKCALIBRATOR_H
+#define PEAKCALIBRATOR_H
+
+#include "Calibrator.h"
+#include "ClusterTable.h"
+#include <vector>
+
+class GeometryCache;
+struct CoreParameters;
+
+
+// A fast first estimate of the cc's, the initial parameters of the
+// nonlinear fit (NLLSCalibrator), from a single pass over the samples.
+//
+// Each sample is attributed to the leading cell (of largest energy) of each
+// of its clusters, and its mass, at the initial cc's, over the target mass
+// is filled into a histogram of that cell. Samples are split between
+// SetNThreads threads, each filling histograms of its own, which are summed
+// at the end. The peak of a cell is the mean of the bins within SetWindow
+// bins of its largest bin. To first order, a cell of mean energy fraction f
+// of its clusters moves the mass by cc^(f/2), so the cc of a cell of at
+// least SetMinEntries entries is corrected by (m0/peak)^(2/f), within a
+// factor SetMaxCorrection; other cells keep their cc.
+class PeakCalibrator : public Calibrator
+{
+public:
+  PeakCalibrator();
+  virtual ~PeakCalibrator();
+
+  virtual SampleParameters Calibrate(std::vector<Sample> & samples, SampleParameters& initalParams);
+  SampleParameters Calibrate(const ClusterTable& table, SampleParameters& initalParams);
+  virtual void PrintReport(Option_t* option = "") const;
+
+  // *** Settings ***
+  // bins of mass / target mass in [min, max)
+  void SetBinning(Int_t nBins, Double_t min, Double_t max) { fNBins = nBins; fMin = min; fMax = max; }
+  void SetWindow(Int_t bins) { fWindow = bins; } // half width
+  void SetMinEntries(Int_t n) { fMinEntries = n; }
+  void SetMaxCorrection(Double_t factor) { fMaxCorrection = factor; }
+  void SetTargetMass(Double_t mass) { fTargetMass = mass; }
+  // 0: a thread per hardware thread
+  void SetNThreads(Int_t n) { fNThreads = n; }
+
+  // *** Result of last Calibrate, per good channel ***
+  Int_t GetNBins() const { return fNBins; }
+  const UInt_t* GetHistogram(UInt_t cell) const { return &fHistograms[cell*fNBins]; }
+  UInt_t GetEntries(UInt_t cell) const { return fEntries[cell]; }
+  // mass / target mass, 0 if too few entries
+  Double_t GetPeak(UInt_t cell) const { return fPeaks[cell]; }
+  // mean energy fraction of the cell in the clusters it leads
+  Double_t GetFraction(UInt_t cell) const { return fEntries[cell] ? fFractions[cell] / fEntries[cell] : 0; }
+  Int_t GetNCorrected() const { return fNCorrected; }
+  Int_t GetNThreadsUsed() const { return fNThreadsUsed; }
+
+private:
+  PeakCalibrator(const PeakCalibrator&); // Not Implemented
+  PeakCalibrator& operator= (const PeakCalibrator&); // Not Implemented
+
+  class FillFunctor; // calls Fill with the nonlinearity policy of the parameters
+
+  template<class NonLinearity> void Fill(const NonLinearity& nonLinearity, const CoreParameters& params);
+  // fills the histograms of thread with the samples of its share
+  template<class NonLinearity>
+  void FillSamples(const NonLinearity& nonLinearity, const CoreParameters& params, const std::vector<Double_t>& cc, Int_t thread, Int_t nThreads);
+  Double_t FindPeak(UInt_t cell) const;
+
+  // *** Settings ***
+  Int_t fNBins;
+  Double_t fMin;
+  Double_t fMax;
+  Int_t fWindow;
+  Int_t fMinEntries;
+  Double_t fMaxCorrection;
+  Double_t fTargetMass;
+  Int_t fNThreads;
+
+  ClusterTable fClusters; // samples of Calibrate(std::vector<Sample>&)
+  const ClusterTable* fTable;
+  const GeometryCache* fGeometry;
+
+  // *** Work, per thread ***
+  std::vector< std::vector<UInt_t> > fThreadHistograms; // [nGood*fNBins]
+  std::vector< std::vector<UInt_t> > fThreadEntries; // [nGood]
+  std::vector< std::vector<Double_t> > fThreadFractions; // [nGood]
+
+  // *** Result ***
+  std::vector<UInt_t> fHistograms; // [nGood*fNBins]
+  std::vector<UInt_t> fEntries; // [nGood]
+  std::vector<Double_t> fFractions; // [nGood] sum of the energy fractions
+  std::vector<Double_t> fPeaks; // [nGood]
+  Int_t fNCorrected;
+  Int_t fNThreadsUsed;
+};
+
+#endif // PEAKCALIBRATOR_H
@@ -0,0 +1,176 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "PeriodCalibrator.h"
+#include "CoreParameters.h"
+#include <TError.h>
+
+
+PeriodCalibrator::PeriodCalibrator()
+: NLLSCalibrator(),
+  fCoupling(kSmooth),
+  fSigmaCC(0.01),
+  fNPeriods(0),
+  fNGood(0),
+  fPeriodTable(),
+  fReference()
+{
+}
+
+
+PeriodCalibrator::~PeriodCalibrator()
+{
+}
+
+
+SampleParameters PeriodCalibrator::Calibrate ( std::vector<Sample> & samples, SampleParameters& initalParams )
+{
+  fClusters.Clear();
+  for(UInt_t idx = 0; idx < samples.size(); ++idx)
+    fClusters.AddSample(samples[idx]);
+  return Calibrate(fClusters, initalParams);
+}
+
+
+SampleParameters PeriodCalibrator::Calibrate ( const ClusterTable& table, SampleParameters& initalParams )
+{
+  const std::vector<const ClusterTable*> tables(1, &table);
+  const std::vector<SampleParameters> initialParams(1, initalParams);
+  return Calibrate(tables, initialParams)[0];
+}
+
+
+std::vector<SampleParameters> PeriodCalibrator::Calibrate ( const std::vector<const ClusterTable*>& tables,
+							    const std::vector<SampleParameters>& initialParams )
+{
+  std::vector<SampleParameters> result(initialParams);
+  fNPeriods = 0;
+  if( tables.empty() || tables.size() != initialParams.size() ) {
+    Error("Calibrate", "%d periods of samples, %d of parameters", (Int_t) tables.size(), (Int_t) initialParams.size());
+    return result;
+  }
+  fNGood = initialParams[0].GetNGood();
+  for(UInt_t period = 1; period < initialParams.size(); ++period) {
+    if( initialParams[period].GetNGood() != fNGood ) {
+      Error("Calibrate", "period %d has %d good channels, period 0 has %d", period, initialParams[period].GetNGood(), fNGood);
+      return result;
+    }
+  }
+  fNPeriods = tables.size();
+
+  // the stacked channels, the periods' and the reference's, initially the
+  // mean of the periods
+  const Int_t nGroups = fNPeriods + (fCoupling == kReference);
+  CoreParameters stacked;
+  initialParams[0].GetCore(stacked);
+  stacked.fChannels.resize(nGroups * fNGood);
+  CoreParameters period;
+  for(Int_t group = 0; group < nGroups; ++group) {
+    if( group < fNPeriods )
+      initialParams[group].GetCore(period);
+    for(Int_t cell = 0; cell < fNGood; ++cell) {
+      CoreChannel& channel = stacked.fChannels[group*fNGood + cell];
+      channel = period.fChannels[cell];
+      if( group < fNPeriods )
+	continue;
+      channel.fCC = 0;
+      for(Int_t p = 0; p < fNPeriods; ++p)
+	channel.fCC += stacked.fChannels[p*fNGood + cell].fCC / fNPeriods;
+    }
+  }
+
+  // the samples of period p on its channels, the clusters of a table are
+  // unique already
+  fPeriodTable.Clear();
+  std::vector<Int_t> index;
+  std::vector<Int_t> clusterId;
+  for(Int_t p = 0; p < fNPeriods; ++p) {
+    const ClusterTable& table = *tables[p];
+    clusterId.resize(table.GetNClusters());
+    for(UInt_t cluster = 0; cluster < table.GetNClusters(); ++cluster) {
+      const Int_t nCells = table.GetNCells(cluster);
+      index.assign(table.GetCellIndex(cluster), table.GetCellIndex(cluster) + nCells);
+      for(Int_t cell = 0; cell < nCells; ++cell)
+	index[cell] += p*fNGood;
+      clusterId[cluster] = fPeriodTable.AddCluster(nCells ? &index[0] : NULL, table.GetCellAmp(cluster), nCells, kFALSE);
+    }
+    for(UInt_t sample = 0; sample < table.GetNSamples(); ++sample)
+      fPeriodTable.AddPair(clusterId[table.GetCluster1(sample)], clusterId[table.GetCluster2(sample)], table.GetVertex(sample));
+  }
+
+  // couplings, of successive periods or of each period to the reference
+  std::vector<Int_t> pairs;
+  for(Int_t p = 0; p < fNPeriods; ++p) {
+    for(Int_t cell = 0; cell < fNGood; ++cell) {
+      if( fCoupling == kSmooth && p + 1 < fNPeriods ) {
+	pairs.push_back(p*fNGood + cell);
+	pairs.push_back((p+1)*fNGood + cell);
+      }
+      else if( fCoupling == kReference ) {
+	pairs.push_back(p*fNGood + cell);
+	pairs.push_back(fNPeriods*fNGood + cell);
+      }
+    }
+  }
+  SetCouplings(pairs, fCoupling == kIndependent ? 0 : fSigmaCC);
+
+  // a geometry of the stacked channels
+  SetGeometry(NULL);
+  CalibrateCore(fPeriodTable, stacked);
+
+  fReference = initialParams[0];
+  for(UInt_t param = 0; param < fNParams; ++param) {
+    const Int_t cell = fParamCell[param];
+    const Int_t group = cell / fNGood;
+    if( group < fNPeriods )
+      result[group].SetCC(cell % fNGood, stacked.fChannels[cell].fCC);
+    else
+      fReference.SetCC(cell % fNGood, stacked.fChannels[cell].fCC);
+  }
+  return result;
+}
+
+
+void PeriodCalibrator::PrintReport ( Option_t* option ) const
+{
+  const char* couplings[3] = {"independent", "smooth", "reference"};
+  printf("PeriodCalibrator.PrintReport\n");
+  printf("   periods: %d, good channels per period: %d, coupling: %s, sigma cc: %g, couplings: %d\n",
+	 fNPeriods, fNGood, couplings[fCoupling], fSigmaCC, (Int_t) fCouplings.size() / 2);
+  NLLSCalibrator::PrintReport(option);
+}
+
+
+void PeriodCalibrator::ReduceUnknowns ( std::vector<Int_t>& cellParam )
+{
+  // with a coupling, a channel of any period is an unknown of all
+  if( fCoupling == kIndependent || fNGood <= 0 )
+    return;
+  const Int_t nGroups = cellParam.size() / fNGood;
+  for(Int_t cell = 0; cell < fNGood; ++cell) {
+    Bool_t used = kFALSE;
+    for(Int_t group = 0; group < nGroups; ++group)
+      used = used || cellParam[group*fNGood + cell] >= 0;
+    for(Int_t group = 0; used && group < nGroups; ++group)
+      cellParam[group*fNGood + cell] = 0;
+  }
+}
@@ -0,0 +1,94 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PERIODCALIBRATOR_H
+#define PERIODCALIBRATOR_H
+
+#include "NLLSCalibrator.h"
+#include <vector>
+
+
+// Joint calibration of the cc's of several run periods, the gains drifting
+// between them. The samples of each period are fitted with cc's of their
+// own, coupled between the periods: kSmooth ties the cc's of a channel in
+// successive periods, kReference ties the cc's of each period to a shared
+// reference cc per channel (fitted too); kIndependent fits the periods
+// without coupling, as separate calibrations would.
+//
+// The good channels of the periods are stacked into one NLLSCalibrator
+// problem, channel cell of period p as good channel p*nGood + cell (the
+// reference after the last period), with NLLSCalibrator couplings of
+// strength sigmaCC, the expected cc difference. The normal matrix is then
+// block tridiagonal (kSmooth) or an arrow (kReference) in the periods, the
+// blocks of the samples of a period with only diagonal couplings between
+// them, so its size, the cost of a pass and of a CG iteration grow linearly
+// with the number of periods; the block jacobi preconditioner blocks are
+// modules (or tiles) of a period.
+//
+// With a coupling, a channel in the samples of any period is an unknown in
+// all periods, its cc in a period without samples of it follows from the
+// coupling. The periods have the same good channels; the globals are those
+// of the first period.
+class PeriodCalibrator : public NLLSCalibrator
+{
+public:
+  enum Coupling { kIndependent, kSmooth, kReference };
+
+  PeriodCalibrator();
+  virtual ~PeriodCalibrator();
+
+  // a single period
+  virtual SampleParameters Calibrate(std::vector<Sample> & samples, SampleParameters& initalParams);
+  SampleParameters Calibrate(const ClusterTable& table, SampleParameters& initalParams);
+  // the parameters of each period, of the samples of tables[p] starting
+  // from initialParams[p]
+  std::vector<SampleParameters> Calibrate(const std::vector<const ClusterTable*>& tables,
+					  const std::vector<SampleParameters>& initialParams);
+  virtual void PrintReport(Option_t* option = "") const;
+
+  // *** Settings ***
+  void SetCoupling(Coupling coupling, Double_t sigmaCC = 0.01) { fCoupling = coupling; fSigmaCC = sigmaCC; }
+  Coupling GetCoupling() const { return fCoupling; }
+
+  // *** Result of last Calibrate ***
+  Int_t GetNPeriods() const { return fNPeriods; }
+  // the reference cc's, kReference
+  const SampleParameters& GetReference() const { return fReference; }
+
+protected:
+  virtual void ReduceUnknowns(std::vector<Int_t>& cellParam);
+  virtual Int_t GetCellGroup(Int_t cell) const { return fNGood > 0 ? cell / fNGood : 0; }
+
+  Coupling fCoupling;
+  Double_t fSigmaCC;
+
+  Int_t fNPeriods;
+  Int_t fNGood; // of a period
+  ClusterTable fPeriodTable; // the samples of all periods, on the stacked channels
+  SampleParameters fReference;
+
+private:
+  PeriodCalibrator(const PeriodCalibrator&); // Not Implemented
+  PeriodCalibrator& operator= (const PeriodCalibrator&); // Not Implemented
+};
+
+#endif // PERIODCALIBRATOR_H
@@ -0,0 +1,209 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ResidualHistograms.h"
+#include "GeometryCache.h"
+#include "CoreParameters.h"
+#include <TH1F.h>
+#include <TH2F.h>
+#include <TCanvas.h>
+#include <TError.h>
+#include <TMath.h>
+#include <cmath>
+#include <cstdio>
+
+
+ResidualHistograms::ResidualHistograms ( Int_t nBins, Double_t maxPull )
+: fNBins(nBins),
+  fMaxPull(maxPull),
+  fAbsId(),
+  fCellBins(),
+  fCellSums(),
+  fModuleBins(),
+  fModuleSums()
+{
+}
+
+
+void ResidualHistograms::Reset ( const CoreParameters& params )
+{
+  const Int_t nGood = params.GetNGood();
+  fAbsId.resize(nGood);
+  for(Int_t cell = 0; cell < nGood; ++cell)
+    fAbsId[cell] = params.fChannels[cell].fAbsId;
+  fCellBins.assign(nGood * (fNBins+2), 0.);
+  fCellSums.assign(4 * nGood, 0.);
+  fModuleBins.assign(GeometryCache::kNMod * (fNBins+2), 0.);
+  fModuleSums.assign(4 * GeometryCache::kNMod, 0.);
+}
+
+
+void ResidualHistograms::Fill ( const Int_t* index1, Int_t nCells1, const Int_t* index2, Int_t nCells2, Double_t pull, Double_t weight )
+{
+  const Int_t bin = GetBin(pull);
+  const Bool_t inRange = bin > 0 && bin <= fNBins;
+  const Double_t sums[4] = {weight, inRange ? weight : 0., inRange ? weight * pull : 0., inRange ? weight * pull*pull : 0.};
+  UInt_t modules = 0; // bit per module filled
+
+  for(Int_t idx = 0; idx < nCells1 + nCells2; ++idx) {
+    const Int_t cell = idx < nCells1 ? index1[idx] : index2[idx - nCells1];
+    // cells of both clusters, once
+    Bool_t seen = kFALSE;
+    for(Int_t other = 0; idx >= nCells1 && other < nCells1 && ! seen; ++other)
+      seen = index1[other] == cell;
+    if( seen )
+      continue;
+
+    fCellBins[cell * (fNBins+2) + bin] += weight;
+    for(Int_t sum = 0; sum < 4; ++sum)
+      fCellSums[4*cell + sum] += sums[sum];
+
+    const Int_t module = GeometryCache::AbsIdToModule(fAbsId[cell]);
+    if( modules & (1u << module) )
+      continue;
+    modules |= 1u << module;
+    fModuleBins[module * (fNBins+2) + bin] += weight;
+    for(Int_t sum = 0; sum < 4; ++sum)
+      fModuleSums[4*module + sum] += sums[sum];
+  }
+}
+
+
+Bool_t ResidualHistograms::Add ( const ResidualHistograms& other )
+{
+  if( other.fNBins != fNBins || other.fMaxPull != fMaxPull || other.fAbsId != fAbsId ) {
+    Error("Add", "histograms of other channels or bins");
+    return kFALSE;
+  }
+  for(UInt_t idx = 0; idx < fCellBins.size(); ++idx)
+    fCellBins[idx] += other.fCellBins[idx];
+  for(UInt_t idx = 0; idx < fCellSums.size(); ++idx)
+    fCellSums[idx] += other.fCellSums[idx];
+  for(UInt_t idx = 0; idx < fModuleBins.size(); ++idx)
+    fModuleBins[idx] += other.fModuleBins[idx];
+  for(UInt_t idx = 0; idx < fModuleSums.size(); ++idx)
+    fModuleSums[idx] += other.fModuleSums[idx];
+  return kTRUE;
+}
+
+
+void ResidualHistograms::FindOutliers ( std::vector<Int_t>& cells, Double_t maxMeanPull, Double_t maxRMS, Double_t minEntries ) const
+{
+  cells.clear();
+  for(Int_t cell = 0; cell < GetNCells(); ++cell) {
+    if( GetCellStatistic(cell, kEntries) <= minEntries )
+      continue;
+    if( std::fabs(GetCellStatistic(cell, kMean)) > maxMeanPull || GetCellStatistic(cell, kRMS) > maxRMS )
+      cells.push_back(cell);
+  }
+}
+
+
+TH2F* ResidualHistograms::CreateCellPulls ( const char* name ) const
+{
+  const Int_t nGood = GetNCells();
+  TH2F* hist = new TH2F(name, "Mass pull of the samples of each cell;good channel index;(M - m_{0})/#sigma",
+			nGood, 0, nGood, fNBins, -fMaxPull, fMaxPull);
+  Double_t entries = 0;
+  for(Int_t cell = 0; cell < nGood; ++cell) {
+    for(Int_t bin = 0; bin < fNBins+2; ++bin)
+      hist->SetBinContent(cell+1, bin, fCellBins[cell * (fNBins+2) + bin]);
+    entries += fCellSums[4*cell];
+  }
+  hist->SetEntries(entries);
+  return hist;
+}
+
+
+TH1F* ResidualHistograms::CreateModulePulls ( Int_t module ) const
+{
+  char name[256];
+  char title[256];
+  sprintf(name, "pulls_%d", module);
+  sprintf(title, "Mass pull of the samples of mod:%d;(M - m_{0})/#sigma", module);
+  TH1F* hist = new TH1F(name, title, fNBins, -fMaxPull, fMaxPull);
+  for(Int_t bin = 0; bin < fNBins+2; ++bin)
+    hist->SetBinContent(bin, fModuleBins[module * (fNBins+2) + bin]);
+  hist->SetEntries(fModuleSums[4*module]);
+  return hist;
+}
+
+
+TH2F* ResidualHistograms::CreateModuleMap ( Int_t module, Statistic statistic ) const
+{
+  const char* names[3] = {"entries", "mean", "rms"};
+  char name[256];
+  char title[256];
+  sprintf(name, "pullmap_%s_%d", names[statistic], module);
+  sprintf(title, "Mass pull %s per cell, mod:%d", names[statistic], module);
+  TH2F* hist = new TH2F(name, title, GeometryCache::kNRowX, 0, GeometryCache::kNRowX, GeometryCache::kNColZ, 0, GeometryCache::kNColZ);
+  for(Int_t cell = 0; cell < GetNCells(); ++cell) {
+    const Int_t absId = fAbsId[cell];
+    if( GeometryCache::AbsIdToModule(absId) != module || fCellSums[4*cell] <= 0 )
+      continue;
+    hist->SetBinContent(GeometryCache::AbsIdToRowX(absId)+1, GeometryCache::AbsIdToColZ(absId)+1,
+			GetCellStatistic(cell, statistic));
+  }
+  return hist;
+}
+
+
+TCanvas* ResidualHistograms::DrawPullMap ( Statistic statistic ) const
+{
+  TCanvas* canv = new TCanvas;
+  int nmod = 0;
+  for(UInt_t mod = 0; mod < GeometryCache::kNMod; ++mod)
+    if( fModuleSums.size() && fModuleSums[4*mod] > 0 )
+      ++nmod;
+  canv->Divide(nmod, 1);
+  nmod = 0;
+  for(UInt_t mod = 0; mod < GeometryCache::kNMod; ++mod)
+    if( fModuleSums.size() && fModuleSums[4*mod] > 0 ) {
+      canv->cd(++nmod);
+      CreateModuleMap(mod, statistic)->Draw("colz");
+    }
+
+  return canv;
+}
+
+
+Int_t ResidualHistograms::GetBin ( Double_t pull ) const
+{
+  if( pull < -fMaxPull )
+    return 0;
+  if( pull >= fMaxPull )
+    return fNBins+1;
+  return 1 + TMath::Min(Int_t((pull + fMaxPull) / (2*fMaxPull) * fNBins), fNBins-1);
+}
+
+
+Double_t ResidualHistograms::GetStatistic ( const Double_t* sums, Statistic statistic )
+{
+  if( statistic == kEntries )
+    return sums[0];
+  if( sums[1] <= 0 )
+    return 0;
+  const Double_t mean = sums[2] / sums[1];
+  if( statistic == kMean )
+    return mean;
+  return std::sqrt(TMath::Max(sums[3] / sums[1] - mean*mean, 0.));
+}
@@ -0,0 +1,93 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef RESIDUALHISTOGRAMS_H
+#define RESIDUALHISTOGRAMS_H
+
+#include <Rtypes.h>
+#include <vector>
+
+struct CoreParameters;
+class TH1F;
+class TH2F;
+class TCanvas;
+
+
+// Per cell and per module distributions of the mass pulls, (M - m0)/sigma,
+// of the samples touching each cell (module), for bad channel QA after a
+// calibration (Calibrator::SetResidualHistograms). Filled by the
+// calibrator in its final residual evaluation, so without an extra pass
+// over the samples; a sample counts once in each of its cells and modules.
+// The calibrator resets them as each fit starts.
+//
+// The pulls are accumulated in fixed bin arrays, bin 0 the underflow and
+// nBins+1 the overflow as in ROOT, with the weighted sums for the mean and
+// rms, and exported as ROOT histograms on demand. The mean and rms are of
+// the pulls within +-maxPull; the tails are the outliers the robust fit
+// discounts, and would swamp the spread of a noisy channel. Accumulators
+// filled apart (e.g. by the ranks of a DistributedCalibrator) merge by Add.
+class ResidualHistograms
+{
+public:
+  enum Statistic { kEntries, kMean, kRMS };
+
+  ResidualHistograms(Int_t nBins = 100, Double_t maxPull = 5.);
+
+  // clears and sizes for the good channels of params
+  void Reset(const CoreParameters& params);
+  // the pull of a sample of the cells of its two clusters, good channel
+  // indices; cells in both clusters count once
+  void Fill(const Int_t* index1, Int_t nCells1, const Int_t* index2, Int_t nCells2, Double_t pull, Double_t weight = 1.);
+  // adds the entries of other, filled for the same channels and bins
+  Bool_t Add(const ResidualHistograms& other);
+
+  Int_t GetNBins() const { return fNBins; }
+  Double_t GetMaxPull() const { return fMaxPull; }
+  Int_t GetNCells() const { return fAbsId.size(); }
+  Double_t GetCellStatistic(Int_t cell, Statistic statistic) const { return GetStatistic(&fCellSums[4*cell], statistic); }
+  Double_t GetModuleStatistic(Int_t module, Statistic statistic) const { return GetStatistic(&fModuleSums[4*module], statistic); }
+  // cells with more than minEntries entries and a mean pull or rms beyond the limits
+  void FindOutliers(std::vector<Int_t>& cells, Double_t maxMeanPull, Double_t maxRMS, Double_t minEntries = 10.) const;
+
+  // *** ROOT histograms, owned by the caller ***
+  // pull vs. good channel index
+  TH2F* CreateCellPulls(const char* name = "cellPulls") const;
+  TH1F* CreateModulePulls(Int_t module) const;
+  // a statistic of the pulls of the cells of module, in x and z
+  TH2F* CreateModuleMap(Int_t module, Statistic statistic = kMean) const;
+  // the module maps of the modules with entries, as DrawBadChannelMap
+  TCanvas* DrawPullMap(Statistic statistic = kMean) const;
+
+private:
+  Int_t GetBin(Double_t pull) const;
+  static Double_t GetStatistic(const Double_t* sums, Statistic statistic);
+
+  Int_t fNBins;
+  Double_t fMaxPull;
+  std::vector<Int_t> fAbsId; // [nGood]
+  std::vector<Float_t> fCellBins; // [nGood*(fNBins+2)]
+  std::vector<Double_t> fCellSums; // [4*nGood] sum w, and within range sum w, sum w pull, sum w pull^2
+  std::vector<Float_t> fModuleBins; // [kNMod*(fNBins+2)]
+  std::vector<Double_t> fModuleSums; // [4*kNMod]
+};
+
+#endif // RESIDUALHISTOGRAMS_H
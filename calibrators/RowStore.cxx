@@ -0,0 +1,285 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "RowStore.h"
+#include <CalibStats.h>
+#include <TError.h>
+#include <TMath.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+namespace {
+  // bytes of the columns of a chunk, padded to the values
+  ULong64_t Padded(ULong64_t bytes) { return (bytes + 7) / 8 * 8; }
+
+  Bool_t WriteAll(Int_t file, const void* data, ULong64_t bytes, ULong64_t offset)
+  {
+    const char* pos = static_cast<const char*>(data);
+    while( bytes > 0 ) {
+      const ssize_t written = pwrite(file, pos, bytes, offset);
+      if( written <= 0 )
+	return kFALSE;
+      pos += written;
+      bytes -= written;
+      offset += written;
+    }
+    return kTRUE;
+  }
+
+  void MultiplyBlock(const UInt_t* rowBegin, const Int_t* cols, const Double_t* values, UInt_t nRows,
+		     const Double_t* x, Double_t* y)
+  {
+    for(UInt_t row = 0; row < nRows; ++row) {
+      Double_t sum = 0;
+      for(UInt_t pos = rowBegin[row]; pos < rowBegin[row+1]; ++pos)
+	sum += values[pos] * x[cols[pos]];
+      y[row] = sum;
+    }
+  }
+
+  void MultiplyTransposedBlock(const UInt_t* rowBegin, const Int_t* cols, const Double_t* values, UInt_t nRows,
+			       const Double_t* y, Double_t* x)
+  {
+    for(UInt_t row = 0; row < nRows; ++row)
+      for(UInt_t pos = rowBegin[row]; pos < rowBegin[row+1]; ++pos)
+	x[cols[pos]] += values[pos] * y[row];
+  }
+}
+
+
+RowStore::RowStore ( CalibStats* stats )
+: fStats(stats),
+  fBudget(0),
+  fDirectory("/tmp"),
+  fRHS(),
+  fNNonZero(0),
+  fRowBegin(1, 0),
+  fCols(),
+  fValues(),
+  fFile(-1),
+  fFileSize(0),
+  fChunks(),
+  fMap(NULL),
+  fMapSize(0),
+  fReadBack(),
+  fTotalSpilled(0),
+  fPeakBytes(0)
+{
+}
+
+
+RowStore::~RowStore()
+{
+  Unmap();
+  if( fFile >= 0 )
+    close(fFile);
+}
+
+
+void RowStore::SetBudget ( Long64_t bytes, const char* directory )
+{
+  fBudget = bytes;
+  fDirectory = directory ? directory : "/tmp";
+}
+
+
+void RowStore::Clear()
+{
+  fRHS.clear();
+  fNNonZero = 0;
+  fRowBegin.assign(1, 0);
+  fCols.clear();
+  fValues.clear();
+  Unmap();
+  if( fFile >= 0 && fFileSize > 0 && ftruncate(fFile, 0) != 0 )
+    Warning("Clear", "cannot truncate the scratch file");
+  fFileSize = 0;
+  fChunks.clear();
+}
+
+
+void RowStore::AddRow ( const Int_t* cols, const Double_t* values, Int_t n, Double_t rhs )
+{
+  fRHS.push_back(rhs);
+  fCols.insert(fCols.end(), cols, cols + n);
+  fValues.insert(fValues.end(), values, values + n);
+  fRowBegin.push_back(fCols.size());
+  fNNonZero += n;
+
+  const ULong64_t bytes = GetBufferBytes();
+  fPeakBytes = TMath::Max(fPeakBytes, bytes);
+  if( fBudget > 0 && bytes >= ULong64_t(fBudget) )
+    Spill();
+}
+
+
+void RowStore::Finish()
+{
+  // maps the chunks, or reads them back if the file cannot be mapped
+  if( ! fFileSize )
+    return;
+  if( fStats )
+    fStats->Start(CalibStats::kIO);
+  void* map = mmap(NULL, fFileSize, PROT_READ, MAP_SHARED, fFile, 0);
+  if( map != MAP_FAILED ) {
+    fMap = static_cast<char*>(map);
+    fMapSize = fFileSize;
+    madvise(map, fFileSize, MADV_SEQUENTIAL);
+  }
+  else {
+    Warning("Finish", "cannot map the scratch file, the rows are read back into memory");
+    fReadBack.resize(fFileSize);
+    ULong64_t offset = 0;
+    while( offset < fFileSize ) {
+      const ssize_t read = pread(fFile, &fReadBack[offset], fFileSize - offset, offset);
+      if( read <= 0 ) {
+	Error("Finish", "cannot read the scratch file");
+	break;
+      }
+      offset += read;
+    }
+    fMap = &fReadBack[0];
+  }
+  if( fStats )
+    fStats->Stop(CalibStats::kIO);
+}
+
+
+void RowStore::Multiply ( const Double_t* x, Double_t* y ) const
+{
+  const UInt_t* rowBegin;
+  const Int_t* cols;
+  const Double_t* values;
+  for(UInt_t idx = 0; idx < fChunks.size(); ++idx) {
+    GetChunk(fChunks[idx], rowBegin, cols, values);
+    MultiplyBlock(rowBegin, cols, values, fChunks[idx].fNRows, x, y);
+    y += fChunks[idx].fNRows;
+  }
+  MultiplyBlock(&fRowBegin[0], fCols.data(), fValues.data(), fRowBegin.size() - 1, x, y);
+}
+
+
+void RowStore::MultiplyTransposed ( const Double_t* y, Double_t* x, UInt_t n ) const
+{
+  std::fill(x, x + n, 0.);
+  const UInt_t* rowBegin;
+  const Int_t* cols;
+  const Double_t* values;
+  for(UInt_t idx = 0; idx < fChunks.size(); ++idx) {
+    GetChunk(fChunks[idx], rowBegin, cols, values);
+    MultiplyTransposedBlock(rowBegin, cols, values, fChunks[idx].fNRows, y, x);
+    y += fChunks[idx].fNRows;
+  }
+  MultiplyTransposedBlock(&fRowBegin[0], fCols.data(), fValues.data(), fRowBegin.size() - 1, y, x);
+}
+
+
+void RowStore::AddSquares ( std::vector<Double_t>& squares ) const
+{
+  const UInt_t* rowBegin;
+  const Int_t* cols;
+  const Double_t* values;
+  for(UInt_t idx = 0; idx < fChunks.size(); ++idx) {
+    GetChunk(fChunks[idx], rowBegin, cols, values);
+    for(UInt_t pos = 0; pos < fChunks[idx].fNNonZero; ++pos)
+      squares[cols[pos]] += values[pos]*values[pos];
+  }
+  for(UInt_t pos = 0; pos < fCols.size(); ++pos)
+    squares[fCols[pos]] += fValues[pos]*fValues[pos];
+}
+
+
+ULong64_t RowStore::GetBufferBytes() const
+{
+  return fRowBegin.size()*sizeof(UInt_t) + fCols.size()*sizeof(Int_t) + fValues.size()*sizeof(Double_t);
+}
+
+
+void RowStore::Spill()
+{
+  // the buffered rows as a chunk at the end of the scratch file; if it
+  // cannot be written, the rows stay in memory, without budget
+  if( fFile < 0 ) {
+    TString path = fDirectory + "/calib_rows_XXXXXX";
+    std::vector<char> name(path.Data(), path.Data() + path.Length() + 1);
+    fFile = mkstemp(&name[0]);
+    if( fFile < 0 ) {
+      Error("Spill", "cannot create a scratch file in %s, the rows stay in memory", fDirectory.Data());
+      fBudget = 0;
+      return;
+    }
+    unlink(&name[0]);
+  }
+  if( fStats )
+    fStats->Start(CalibStats::kIO);
+
+  Chunk chunk;
+  chunk.fOffset = fFileSize;
+  chunk.fNRows = fRowBegin.size() - 1;
+  chunk.fNNonZero = fCols.size();
+  const ULong64_t rowBytes = fRowBegin.size()*sizeof(UInt_t);
+  const ULong64_t colBytes = Padded(rowBytes + fCols.size()*sizeof(Int_t)) - rowBytes;
+  const ULong64_t valueBytes = fValues.size()*sizeof(Double_t);
+  fCols.resize(fCols.size() + (colBytes - fCols.size()*sizeof(Int_t)) / sizeof(Int_t), 0); // padding
+  const Bool_t written = WriteAll(fFile, &fRowBegin[0], rowBytes, chunk.fOffset)
+    && WriteAll(fFile, fCols.data(), colBytes, chunk.fOffset + rowBytes)
+    && WriteAll(fFile, fValues.data(), valueBytes, chunk.fOffset + rowBytes + colBytes);
+  fCols.resize(chunk.fNNonZero);
+
+  if( written ) {
+    fChunks.push_back(chunk);
+    fFileSize += rowBytes + colBytes + valueBytes;
+    fTotalSpilled += rowBytes + colBytes + valueBytes;
+    fRowBegin.assign(1, 0);
+    fCols.clear();
+    fValues.clear();
+  }
+  else {
+    Error("Spill", "cannot write the scratch file, the rows stay in memory");
+    fBudget = 0;
+  }
+  if( fStats )
+    fStats->Stop(CalibStats::kIO);
+}
+
+
+void RowStore::Unmap()
+{
+  if( fMap && fReadBack.empty() )
+    munmap(fMap, fMapSize);
+  std::vector<char>().swap(fReadBack);
+  fMap = NULL;
+  fMapSize = 0;
+}
+
+
+void RowStore::GetChunk ( const Chunk& chunk, const UInt_t*& rowBegin, const Int_t*& cols, const Double_t*& values ) const
+{
+  const char* base = fMap + chunk.fOffset;
+  const ULong64_t rowBytes = (chunk.fNRows + 1)*sizeof(UInt_t);
+  rowBegin = reinterpret_cast<const UInt_t*>(base);
+  cols = reinterpret_cast<const Int_t*>(base + rowBytes);
+  values = reinterpret_cast<const Double_t*>(base + Padded(rowBytes + chunk.fNNonZero*sizeof(Int_t)));
+}
@@ -0,0 +1,121 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef ROWSTORE_H
+#define ROWSTORE_H
+
+#include <Rtypes.h>
+#include <TString.h>
+#include <vector>
+
+class CalibStats;
+
+
+// The weighted jacobian rows of the matrix free solver (NLLSCalibrator
+// kCGLS), sparse, with their right hand sides, and their products with
+// vectors streamed over them.
+//
+// With a memory budget, rows are buffered up to the budget in memory and
+// the full buffer is spilled, as a chunk, to a scratch file; at Finish the
+// file is memory mapped and the products stream over the chunks in order,
+// then over the rows still buffered. The scratch file is unlinked when
+// created, so it does not outlive the process. The right hand sides, a
+// double per row, stay in memory.
+class RowStore
+{
+public:
+  // stats, the io timer of the spill, not owned
+  explicit RowStore(CalibStats* stats = NULL);
+  ~RowStore();
+
+  // bytes of rows kept in memory, 0 for no limit; the directory of the
+  // scratch file
+  void SetBudget(Long64_t bytes, const char* directory = "/tmp");
+
+  // begins a new set of rows
+  void Clear();
+  void AddRow(const Int_t* cols, const Double_t* values, Int_t n, Double_t rhs);
+  // after the last row
+  void Finish();
+
+  UInt_t GetNRows() const { return fRHS.size(); }
+  ULong64_t GetNNonZero() const { return fNNonZero; }
+  const std::vector<Double_t>& GetRHS() const { return fRHS; }
+
+  // y = J x
+  void Multiply(const Double_t* x, Double_t* y) const;
+  // x = J^T y, x of n columns
+  void MultiplyTransposed(const Double_t* y, Double_t* x, UInt_t n) const;
+  // adds the column sums of squares to squares
+  void AddSquares(std::vector<Double_t>& squares) const;
+
+  // *** Spill ***
+  // bytes of the rows of the last set in the scratch file, and chunks
+  ULong64_t GetSpilledBytes() const { return fFileSize; }
+  Int_t GetNChunks() const { return fChunks.size(); }
+  // bytes written over all sets
+  ULong64_t GetTotalSpilledBytes() const { return fTotalSpilled; }
+  // bytes of the rows in memory, at most
+  ULong64_t GetPeakBytes() const { return fPeakBytes; }
+
+private:
+  RowStore(const RowStore&); // Not Implemented
+  RowStore& operator= (const RowStore&); // Not Implemented
+
+  // a chunk in the scratch file, at fOffset: row begins [fNRows+1],
+  // columns [fNNonZero], padding to 8 bytes, values [fNNonZero]
+  struct Chunk
+  {
+    ULong64_t fOffset;
+    UInt_t fNRows;
+    UInt_t fNNonZero;
+  };
+
+  ULong64_t GetBufferBytes() const;
+  void Spill();
+  void Unmap();
+  // the arrays of chunk in the mapped file
+  void GetChunk(const Chunk& chunk, const UInt_t*& rowBegin, const Int_t*& cols, const Double_t*& values) const;
+
+  CalibStats* fStats;
+  Long64_t fBudget;
+  TString fDirectory;
+
+  std::vector<Double_t> fRHS; // [nRows]
+  ULong64_t fNNonZero;
+
+  // rows buffered in memory, after those of the chunks
+  std::vector<UInt_t> fRowBegin;
+  std::vector<Int_t> fCols;
+  std::vector<Double_t> fValues;
+
+  Int_t fFile; // descriptor of the scratch file, -1 if none
+  ULong64_t fFileSize;
+  std::vector<Chunk> fChunks;
+  char* fMap; // the mapped scratch file, NULL if not mapped
+  ULong64_t fMapSize;
+  std::vector<char> fReadBack; // the scratch file, if it cannot be mapped
+  ULong64_t fTotalSpilled;
+  ULong64_t fPeakBytes;
+};
+
+#endif // ROWSTORE_H
@@ -0,0 +1,275 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SweepCalibrator.h"
+#include "GeometryCache.h"
+#include "ResidualHistograms.h"
+#include "Telemetry.h"
+#include <TStopwatch.h>
+#include <TMath.h>
+#include <TError.h>
+#include <thread>
+#include <cstdio>
+
+
+struct SweepCalibrator::Worker
+{
+  Worker() : fFitter(), fTelemetry(), fVariants(), fFilled(), fNarrowest(), fBest(-1) {}
+
+  NLLSCalibrator fFitter;
+  Telemetry fTelemetry; // records of its fits, kept, fit k that of variant fVariants[k]
+  std::vector<Int_t> fVariants;
+  ResidualHistograms fFilled; // of the last fit
+  ResidualHistograms fNarrowest; // of the fit of fBest
+  Int_t fBest; // its variant of the narrowest peak, -1 if none
+};
+
+
+namespace {
+  // the parameters the GeometryCache is made of are the same
+  Bool_t SameGeometry(const CoreParameters& a, const CoreParameters& b)
+  {
+    if( a.fGlobals.fCS != b.fGlobals.fCS || a.GetNGood() != b.GetNGood() )
+      return kFALSE;
+    for(Int_t mod = 0; mod < CoreParameters::kNMod; ++mod)
+      for(Int_t idx = 0; idx < 12; ++idx)
+	if( a.fT[mod][idx] != b.fT[mod][idx] )
+	  return kFALSE;
+    for(Int_t cell = 0; cell < a.GetNGood(); ++cell)
+      if( a.fChannels[cell].fLocalX != b.fChannels[cell].fLocalX || a.fChannels[cell].fLocalZ != b.fChannels[cell].fLocalZ )
+	return kFALSE;
+    return kTRUE;
+  }
+}
+
+
+SweepCalibrator::SweepCalibrator()
+: Calibrator(),
+  fFitter(),
+  fNThreads(0),
+  fVariants(),
+  fNames(),
+  fResults(),
+  fCosts(),
+  fPeakWidths(),
+  fNIterations(),
+  fFitSigma(-1),
+  fBest(-1),
+  fNThreadsUsed(0),
+  fSweepTime(0)
+{
+}
+
+
+SweepCalibrator::~SweepCalibrator()
+{
+}
+
+
+void SweepCalibrator::AddVariant ( const SampleParameters& params, const char* name )
+{
+  if( ! fVariants.empty() ) {
+    const SampleParameters& first = fVariants.front();
+    Bool_t same = params.GetNGood() == first.GetNGood();
+    for(Int_t cell = 0; same && cell < params.GetNGood(); ++cell)
+      same = params.GetIDArray()[cell] == first.GetIDArray()[cell];
+    if( ! same ) {
+      Error("AddVariant", "variant %s has other good channels than the first, not added", name);
+      return;
+    }
+  }
+  fVariants.push_back(params);
+  fNames.push_back(name);
+}
+
+
+void SweepCalibrator::AddGrid ( const SampleParameters& base, const std::vector<Float_t>& logWeights,
+				const std::vector<Float_t>& paraValues, const std::vector<Float_t>& parbValues )
+{
+  char name[256];
+  for(UInt_t w = 0; w < logWeights.size(); ++w)
+    for(UInt_t a = 0; a < paraValues.size(); ++a)
+      for(UInt_t b = 0; b < parbValues.size(); ++b) {
+	SampleParameters variant(base);
+	variant.SetLogWeight(logWeights[w]);
+	variant.SetParA(paraValues[a]);
+	variant.SetParB(parbValues[b]);
+	snprintf(name, sizeof(name), "w0 %g, para %g, parb %g", logWeights[w], paraValues[a], parbValues[b]);
+	AddVariant(variant, name);
+      }
+}
+
+
+void SweepCalibrator::ClearVariants()
+{
+  fVariants.clear();
+  fNames.clear();
+}
+
+
+SampleParameters SweepCalibrator::Calibrate ( std::vector<Sample> & samples, SampleParameters& initalParams )
+{
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < samples.size(); ++idx)
+    table.AddSample(samples[idx]);
+  return Calibrate(table, initalParams);
+}
+
+
+SampleParameters SweepCalibrator::Calibrate ( const ClusterTable& table, SampleParameters& initalParams )
+{
+  const Bool_t none = fVariants.empty();
+  if( none )
+    AddVariant(initalParams, "initial");
+  const Int_t nVariants = fVariants.size();
+  fResults.assign(nVariants, SampleParameters());
+  fCosts.assign(nVariants, 0.);
+  fPeakWidths.assign(nVariants, 0.);
+  fNIterations.assign(nVariants, 0);
+
+  Int_t nThreads = fNThreads > 0 ? fNThreads : std::thread::hardware_concurrency();
+  nThreads = TMath::Max(1, TMath::Min(nThreads, nVariants));
+  fNThreadsUsed = nThreads;
+
+  // one geometry for all fits, if the variants have that of the first
+  CoreParameters first;
+  fVariants.front().GetCore(first);
+  const GeometryCache geometry(first);
+  Bool_t sameGeometry = kTRUE;
+  for(Int_t variant = 1; sameGeometry && variant < nVariants; ++variant) {
+    CoreParameters core;
+    fVariants[variant].GetCore(core);
+    sameGeometry = SameGeometry(first, core);
+  }
+
+  // the threads share the budget
+  const Long64_t budget = fMemoryBudget > 0 ? fMemoryBudget : fFitter.GetMemoryBudget();
+  const char* scratchDirectory = fMemoryBudget > 0 ? fScratchDirectory.Data() : fFitter.GetScratchDirectory();
+  std::vector<Worker> workers(nThreads);
+  for(Int_t thread = 0; thread < nThreads; ++thread) {
+    NLLSCalibrator& fitter = workers[thread].fFitter;
+    fitter.CopySettings(fFitter);
+    fitter.SetKeepCompiled(kTRUE);
+    fitter.SetGeometry(sameGeometry ? &geometry : NULL);
+    fitter.SetMemoryBudget(budget > 0 ? TMath::Max(budget / nThreads, Long64_t(1)) : 0, scratchDirectory);
+    if( fTelemetry ) {
+      workers[thread].fTelemetry.SetKeepRecords();
+      fitter.SetTelemetry(&workers[thread].fTelemetry);
+    }
+    if( fResidualHistograms ) {
+      workers[thread].fFilled = ResidualHistograms(fResidualHistograms->GetNBins(), fResidualHistograms->GetMaxPull());
+      fitter.SetResidualHistograms(&workers[thread].fFilled);
+    }
+  }
+
+  TStopwatch watch;
+  std::atomic<Int_t> next(0);
+  // with no sigma set, the one estimated by a fit of the first variant;
+  // the variants are then all fitted at it, the first again, since the fit
+  // estimating it moved its sigma between steps
+  fFitSigma = fFitter.GetSigma();
+  if( fFitSigma <= 0 ) {
+    NLLSCalibrator estimator;
+    estimator.CopySettings(fFitter);
+    estimator.SetGeometry(sameGeometry ? &geometry : NULL);
+    SampleParameters params(fVariants.front());
+    estimator.Calibrate(table, params);
+    fFitSigma = estimator.GetFitSigma();
+  }
+  for(Int_t thread = 0; thread < nThreads; ++thread)
+    workers[thread].fFitter.SetSigma(fFitSigma);
+  std::vector<std::thread> threads;
+  for(Int_t thread = 1; thread < nThreads; ++thread)
+    threads.push_back(std::thread(&SweepCalibrator::RunVariants, this, std::cref(table), std::ref(workers[thread]), std::ref(next)));
+  RunVariants(table, workers[0], next);
+  for(UInt_t thread = 0; thread < threads.size(); ++thread)
+    threads[thread].join();
+  fSweepTime = watch.RealTime();
+
+  fBest = -1;
+  for(Int_t variant = 0; variant < nVariants; ++variant)
+    if( fBest < 0 || fPeakWidths[variant] < fPeakWidths[fBest] )
+      fBest = variant;
+
+  for(Int_t thread = 0; thread < nThreads; ++thread) {
+    const Worker& worker = workers[thread];
+    fStats.Add(worker.fFitter.GetStats());
+    if( fResidualHistograms && worker.fBest == fBest )
+      *fResidualHistograms = worker.fNarrowest;
+  }
+  // the records of the fits, in the order of the variants
+  for(Int_t variant = 0; fTelemetry && variant < nVariants; ++variant)
+    for(Int_t thread = 0; thread < nThreads; ++thread) {
+      const Worker& worker = workers[thread];
+      for(UInt_t fit = 0; fit < worker.fVariants.size(); ++fit) {
+	if( worker.fVariants[fit] != variant )
+	  continue;
+	fTelemetry->BeginFit();
+	const std::vector<TelemetryRecord>& records = worker.fTelemetry.GetRecords();
+	for(UInt_t record = 0; record < records.size(); ++record)
+	  if( records[record].fFit == Int_t(fit) )
+	    fTelemetry->Record(records[record]);
+      }
+    }
+
+  const SampleParameters result = fResults[fBest];
+  if( none )
+    ClearVariants();
+  return result;
+}
+
+
+void SweepCalibrator::PrintReport ( Option_t* option ) const
+{
+  printf("SweepCalibrator.PrintReport\n");
+  printf("   variants: %d, threads: %d, sigma: %g, wall time: %g s\n", (Int_t) fResults.size(), fNThreadsUsed, fFitSigma, fSweepTime);
+  for(UInt_t variant = 0; variant < fResults.size(); ++variant)
+    printf("   %c %-32s cost: %-12g peak width: %-12g iterations: %d\n", Int_t(variant) == fBest ? '*' : ' ',
+	   variant < fNames.size() ? fNames[variant].Data() : "", fCosts[variant], fPeakWidths[variant], fNIterations[variant]);
+  Calibrator::PrintReport(option);
+}
+
+
+void SweepCalibrator::RunVariants ( const ClusterTable& table, Worker& worker, std::atomic<Int_t>& next )
+{
+  const Int_t nVariants = fVariants.size();
+  for(Int_t variant = next++; variant < nVariants; variant = next++)
+    FitVariant(table, worker, variant);
+}
+
+
+void SweepCalibrator::FitVariant ( const ClusterTable& table, Worker& worker, Int_t variant )
+{
+  NLLSCalibrator& fitter = worker.fFitter;
+  fResults[variant] = fitter.Calibrate(table, fVariants[variant]);
+  fCosts[variant] = fitter.GetCost();
+  fPeakWidths[variant] = fitter.GetPeakWidth();
+  fNIterations[variant] = fitter.GetNIterations();
+  worker.fVariants.push_back(variant);
+  // the variants of a worker come in increasing order, so the first of
+  // equal widths is kept, as in Calibrate
+  if( worker.fBest < 0 || fPeakWidths[variant] < fPeakWidths[worker.fBest] ) {
+    worker.fBest = variant;
+    if( fResidualHistograms )
+      worker.fNarrowest = worker.fFilled;
+  }
+}
@@ -0,0 +1,117 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SWEEPCALIBRATOR_H
+#define SWEEPCALIBRATOR_H
+
+#include "Calibrator.h"
+#include "NLLSCalibrator.h"
+#include "ClusterTable.h"
+#include <vector>
+#include <atomic>
+
+
+// Calibration of a grid of reconstruction settings, to choose among them:
+// variants of the parameters differing in the log weight, the depth
+// correction (para, parb), the nonlinearity parameters or the cc's, each
+// calibrated from the same samples.
+//
+// The samples are decoded once, into one ClusterTable which the fits of
+// all variants read; each variant is an independent fit, making its own
+// passes over the table, not a lockstep pass per batch for all variants.
+// The fits run concurrently on SetNThreads threads, each with an
+// NLLSCalibrator of the settings of GetFitter which compiles the table
+// once for all its variants (NLLSCalibrator::SetKeepCompiled), and with
+// one GeometryCache if the variants share the geometry. The fits have one
+// fixed sigma, that of GetFitter or else the one estimated by a prior fit
+// of the first variant, so that their costs compare and each result is
+// that of a lone fit of the variant at that sigma. Per variant the final
+// cost and the width of the mass peak (NLLSCalibrator::GetPeakWidth) are
+// kept, and Calibrate returns the calibration of the variant of the
+// narrowest peak.
+//
+// A memory budget is divided among the threads. The residual histograms
+// are those of the variant of the narrowest peak; the telemetry receives
+// the fits in the order of the variants once all have finished, so its
+// callback cannot stop them.
+class SweepCalibrator : public Calibrator
+{
+public:
+  SweepCalibrator();
+  virtual ~SweepCalibrator();
+
+  // the variants, or initalParams if there are none
+  virtual SampleParameters Calibrate(std::vector<Sample> & samples, SampleParameters& initalParams);
+  SampleParameters Calibrate(const ClusterTable& table, SampleParameters& initalParams);
+  virtual void PrintReport(Option_t* option = "") const;
+
+  // *** Settings ***
+  NLLSCalibrator& GetFitter() { return fFitter; }
+  // 0: a thread per hardware thread
+  void SetNThreads(Int_t n) { fNThreads = n; }
+  // the variants have the good channels of the first
+  void AddVariant(const SampleParameters& params, const char* name = "");
+  // a variant of base per (log weight, para, parb) of the grid
+  void AddGrid(const SampleParameters& base, const std::vector<Float_t>& logWeights,
+	       const std::vector<Float_t>& paraValues, const std::vector<Float_t>& parbValues);
+  void ClearVariants();
+  Int_t GetNVariants() const { return fVariants.size(); }
+  const SampleParameters& GetVariant(Int_t variant) const { return fVariants[variant]; }
+  const char* GetVariantName(Int_t variant) const { return fNames[variant].Data(); }
+
+  // *** Result of last Calibrate, per variant ***
+  const SampleParameters& GetResult(Int_t variant) const { return fResults[variant]; }
+  Double_t GetCost(Int_t variant) const { return fCosts[variant]; }
+  Double_t GetPeakWidth(Int_t variant) const { return fPeakWidths[variant]; }
+  Int_t GetNIterations(Int_t variant) const { return fNIterations[variant]; }
+  // the sigma of all fits
+  Double_t GetFitSigma() const { return fFitSigma; }
+  // of the narrowest peak, -1 if none
+  Int_t GetBest() const { return fBest; }
+  Int_t GetNThreadsUsed() const { return fNThreadsUsed; }
+
+private:
+  SweepCalibrator(const SweepCalibrator&); // Not Implemented
+  SweepCalibrator& operator= (const SweepCalibrator&); // Not Implemented
+
+  // a thread of the sweep, its fitter and what its fits leave
+  struct Worker;
+  // fits variants, taken from next, until none are left
+  void RunVariants(const ClusterTable& table, Worker& worker, std::atomic<Int_t>& next);
+  void FitVariant(const ClusterTable& table, Worker& worker, Int_t variant);
+
+  NLLSCalibrator fFitter;
+  Int_t fNThreads;
+  std::vector<SampleParameters> fVariants;
+  std::vector<TString> fNames;
+
+  std::vector<SampleParameters> fResults;
+  std::vector<Double_t> fCosts;
+  std::vector<Double_t> fPeakWidths;
+  std::vector<Int_t> fNIterations;
+  Double_t fFitSigma;
+  Int_t fBest;
+  Int_t fNThreadsUsed;
+  Double_t fSweepTime; // [s] wall time of the fits
+};
+
+#endif // SWEEPCALIBRATOR_H
@@ -0,0 +1,176 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Telemetry.h"
+#include <TError.h>
+#include <cstring>
+
+
+const UInt_t Telemetry::kVersion;
+const Int_t TelemetryRecord::kNInts;
+const Int_t TelemetryRecord::kNDoubles;
+
+namespace {
+  const char kMagic[4] = {'C', 'T', 'E', 'L'};
+  const char* kColumns = "fit,iteration,phase,trials,inner_iterations,down_weighted,"
+    "cost,robust_cost,gradient_norm,step_norm,lambda,residual_time,jacobian_time,solve_time";
+}
+
+
+TelemetryRecord::TelemetryRecord()
+: fFit(0),
+  fIteration(0),
+  fPhase(0),
+  fNTrials(0),
+  fNInnerIterations(0),
+  fNDownWeighted(0),
+  fCost(0),
+  fRobustCost(0),
+  fGradientNorm(0),
+  fStepNorm(0),
+  fLambda(0),
+  fResidualTime(0),
+  fJacobianTime(0),
+  fSolveTime(0)
+{
+}
+
+
+Telemetry::Telemetry()
+: fFile(NULL),
+  fFormat(kCSV),
+  fCallback(),
+  fKeepRecords(kFALSE),
+  fFit(-1),
+  fRecords()
+{
+}
+
+
+Telemetry::~Telemetry()
+{
+  Close();
+}
+
+
+Bool_t Telemetry::Open ( const char* filename, Format format )
+{
+  Close();
+  fFile = std::fopen(filename, format == kCSV ? "w" : "wb");
+  if( ! fFile ) {
+    Error("Open", "could not open %s", filename);
+    return kFALSE;
+  }
+  fFormat = format;
+  if( format == kCSV )
+    std::fprintf(fFile, "%s\n", kColumns);
+  else {
+    const UInt_t header[3] = {kVersion, TelemetryRecord::kNInts, TelemetryRecord::kNDoubles};
+    std::fwrite(kMagic, 1, 4, fFile);
+    std::fwrite(header, sizeof(UInt_t), 3, fFile);
+  }
+  return kTRUE;
+}
+
+
+void Telemetry::Close()
+{
+  if( fFile )
+    std::fclose(fFile);
+  fFile = NULL;
+}
+
+
+void Telemetry::BeginFit()
+{
+  ++fFit;
+}
+
+
+Bool_t Telemetry::Record ( const TelemetryRecord& in )
+{
+  TelemetryRecord record(in);
+  record.fFit = fFit < 0 ? 0 : fFit;
+  if( fKeepRecords )
+    fRecords.push_back(record);
+
+  if( fFile && fFormat == kCSV )
+    std::fprintf(fFile, "%d,%d,%d,%d,%d,%d,%.17g,%.17g,%.6g,%.6g,%.3g,%.6g,%.6g,%.6g\n",
+		 record.fFit, record.fIteration, record.fPhase, record.fNTrials, record.fNInnerIterations, record.fNDownWeighted,
+		 record.fCost, record.fRobustCost, record.fGradientNorm, record.fStepNorm, record.fLambda,
+		 record.fResidualTime, record.fJacobianTime, record.fSolveTime);
+  if( fFile && fFormat == kBinary ) {
+    const Int_t ints[TelemetryRecord::kNInts] = {record.fFit, record.fIteration, record.fPhase,
+						 record.fNTrials, record.fNInnerIterations, record.fNDownWeighted};
+    const Double_t doubles[TelemetryRecord::kNDoubles] = {record.fCost, record.fRobustCost, record.fGradientNorm,
+							  record.fStepNorm, record.fLambda,
+							  record.fResidualTime, record.fJacobianTime, record.fSolveTime};
+    std::fwrite(ints, sizeof(Int_t), TelemetryRecord::kNInts, fFile);
+    std::fwrite(doubles, sizeof(Double_t), TelemetryRecord::kNDoubles, fFile);
+  }
+
+  return fCallback ? fCallback(record) : kTRUE;
+}
+
+
+Bool_t Telemetry::ReadBinary ( const char* filename, std::vector<TelemetryRecord>& records )
+{
+  records.clear();
+  std::FILE* file = std::fopen(filename, "rb");
+  if( ! file ) {
+    Error("ReadBinary", "could not open %s", filename);
+    return kFALSE;
+  }
+  char magic[4];
+  UInt_t header[3];
+  if( std::fread(magic, 1, 4, file) != 4 || std::memcmp(magic, kMagic, 4)
+      || std::fread(header, sizeof(UInt_t), 3, file) != 3 || header[0] != kVersion
+      || header[1] != UInt_t(TelemetryRecord::kNInts) || header[2] != UInt_t(TelemetryRecord::kNDoubles) ) {
+    Error("ReadBinary", "%s is not a telemetry stream of version %d", filename, kVersion);
+    std::fclose(file);
+    return kFALSE;
+  }
+
+  Int_t ints[TelemetryRecord::kNInts];
+  Double_t doubles[TelemetryRecord::kNDoubles];
+  while( std::fread(ints, sizeof(Int_t), TelemetryRecord::kNInts, file) == UInt_t(TelemetryRecord::kNInts)
+	 && std::fread(doubles, sizeof(Double_t), TelemetryRecord::kNDoubles, file) == UInt_t(TelemetryRecord::kNDoubles) ) {
+    TelemetryRecord record;
+    record.fFit = ints[0];
+    record.fIteration = ints[1];
+    record.fPhase = ints[2];
+    record.fNTrials = ints[3];
+    record.fNInnerIterations = ints[4];
+    record.fNDownWeighted = ints[5];
+    record.fCost = doubles[0];
+    record.fRobustCost = doubles[1];
+    record.fGradientNorm = doubles[2];
+    record.fStepNorm = doubles[3];
+    record.fLambda = doubles[4];
+    record.fResidualTime = doubles[5];
+    record.fJacobianTime = doubles[6];
+    record.fSolveTime = doubles[7];
+    records.push_back(record);
+  }
+  std::fclose(file);
+  return kTRUE;
+}
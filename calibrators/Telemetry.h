@@ -0,0 +1,104 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Rtypes.h>
+#include <vector>
+#include <functional>
+#include <cstdio>
+
+
+// One iteration of a fit, as recorded by the calibrators
+struct TelemetryRecord
+{
+  TelemetryRecord();
+
+  Int_t fFit; // index of the fit, by Telemetry::BeginFit
+  Int_t fIteration;
+  Int_t fPhase; // 0 Levenberg-Marquardt, 1 mixed precision refinement
+  Int_t fNTrials; // steps tried, rejected ones included
+  Int_t fNInnerIterations; // of the linear solver
+  Int_t fNDownWeighted; // samples beyond the robust scale
+  Double_t fCost; // sum 0.5 r^2, after the iteration
+  Double_t fRobustCost; // sum rho(r), after the iteration
+  Double_t fGradientNorm; // |J^T W r|, at the start of the iteration
+  Double_t fStepNorm; // |dcc|
+  Double_t fLambda; // damping of the step taken
+  Double_t fResidualTime; // [s] wall time of the iteration per stage,
+  Double_t fJacobianTime; //     from the calibrator CalibStats
+  Double_t fSolveTime;
+
+  const static Int_t kNInts = 6;
+  const static Int_t kNDoubles = 8;
+};
+
+
+// Per iteration convergence telemetry of the calibrators (Calibrator::
+// SetTelemetry), to follow a fit while it runs and to tune the solver
+// settings from production traces. The records are streamed to a CSV or a
+// binary file (a header, "CTEL", version and field counts, then the
+// records as their int and double fields), and optionally kept in memory.
+// A record per iteration, so the overhead is negligible.
+//
+// The callback is called with every record; returning kFALSE stops the fit
+// after the iteration, e.g. on a diverging cost or on a time budget.
+class Telemetry
+{
+public:
+  enum Format { kCSV, kBinary };
+  typedef std::function<Bool_t (const TelemetryRecord&)> Callback;
+  const static UInt_t kVersion = 1;
+
+  Telemetry();
+  virtual ~Telemetry();
+
+  Bool_t Open(const char* filename, Format format = kCSV);
+  void Close();
+  void SetCallback(const Callback& callback) { fCallback = callback; }
+  void SetKeepRecords(Bool_t keep = kTRUE) { fKeepRecords = keep; }
+
+  // called by the calibrators at the start of a fit, and per iteration;
+  // Record returns kFALSE if the fit is to stop
+  void BeginFit();
+  virtual Bool_t Record(const TelemetryRecord& record);
+
+  Int_t GetNFits() const { return fFit + 1; }
+  const std::vector<TelemetryRecord>& GetRecords() const { return fRecords; }
+
+  // the records of a binary stream
+  static Bool_t ReadBinary(const char* filename, std::vector<TelemetryRecord>& records);
+
+private:
+  Telemetry(const Telemetry&); // Not Implemented
+  Telemetry& operator= (const Telemetry&); // Not Implemented
+
+  std::FILE* fFile;
+  Format fFormat;
+  Callback fCallback;
+  Bool_t fKeepRecords;
+  Int_t fFit;
+  std::vector<TelemetryRecord> fRecords;
+};
+
+#endif // TELEMETRY_H
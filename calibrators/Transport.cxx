@@ -0,0 +1,311 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Transport.h"
+#include <TError.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <time.h>
+
+
+namespace {
+  Double_t Now()
+  {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+  }
+
+  // socket of address, bound (listen) or connected, -1 on failure
+  Int_t OpenSocket(const std::string& address, Bool_t listen)
+  {
+    if( address.compare(0, 5, "unix:") == 0 ) {
+      const std::string path = address.substr(5);
+      sockaddr_un addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      if( path.size() >= sizeof(addr.sun_path) ) {
+	Error("SocketTransport", "unix socket path too long: %s", path.c_str());
+	return -1;
+      }
+      strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+      const Int_t fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if( fd < 0 )
+	return -1;
+      if( listen )
+	unlink(path.c_str());
+      const Int_t status = listen
+	? bind(fd, (sockaddr*) &addr, sizeof(addr))
+	: connect(fd, (sockaddr*) &addr, sizeof(addr));
+      if( status < 0 || (listen && ::listen(fd, SOMAXCONN) < 0) ) {
+	close(fd);
+	return -1;
+      }
+      return fd;
+    }
+
+    if( address.compare(0, 4, "tcp:") == 0 ) {
+      const std::string hostPort = address.substr(4);
+      const size_t colon = hostPort.rfind(':');
+      if( colon == std::string::npos ) {
+	Error("SocketTransport", "tcp address not host:port: %s", hostPort.c_str());
+	return -1;
+      }
+      const std::string host = hostPort.substr(0, colon);
+      const std::string port = hostPort.substr(colon + 1);
+      addrinfo hints;
+      memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      hints.ai_flags = listen ? AI_PASSIVE : 0;
+      addrinfo* result = NULL;
+      const char* node = listen && (host.empty() || host == "*") ? NULL : host.c_str();
+      if( getaddrinfo(node, port.c_str(), &hints, &result) != 0 )
+	return -1;
+      Int_t fd = -1;
+      for(addrinfo* info = result; info && fd < 0; info = info->ai_next) {
+	fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+	if( fd < 0 )
+	  continue;
+	const int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	if( listen )
+	  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	const Int_t status = listen
+	  ? bind(fd, info->ai_addr, info->ai_addrlen)
+	  : connect(fd, info->ai_addr, info->ai_addrlen);
+	if( status < 0 || (listen && ::listen(fd, SOMAXCONN) < 0) ) {
+	  close(fd);
+	  fd = -1;
+	}
+      }
+      freeaddrinfo(result);
+      return fd;
+    }
+
+    Error("SocketTransport", "address neither unix:<path> nor tcp:<host>:<port>: %s", address.c_str());
+    return -1;
+  }
+}
+
+
+Bool_t Transport::Broadcast ( void* data, ULong64_t size )
+{
+  if( IsCoordinator() ) {
+    for(Int_t rank = 1; rank < GetNRanks(); ++rank)
+      if( ! Send(rank, data, size) )
+	return kFALSE;
+    return kTRUE;
+  }
+  return Receive(0, data, size);
+}
+
+
+Bool_t Transport::ReduceSum ( Double_t* data, ULong64_t n )
+{
+  if( ! IsCoordinator() )
+    return Send(0, data, n*sizeof(Double_t));
+
+  std::vector<Double_t> buffer(n);
+  for(Int_t rank = 1; rank < GetNRanks(); ++rank) {
+    if( ! Receive(rank, &buffer[0], n*sizeof(Double_t)) )
+      return kFALSE;
+    for(ULong64_t idx = 0; idx < n; ++idx)
+      data[idx] += buffer[idx];
+  }
+  return kTRUE;
+}
+
+
+Bool_t Transport::AllReduceSum ( Double_t* data, ULong64_t n )
+{
+  return ReduceSum(data, n) && Broadcast(data, n*sizeof(Double_t));
+}
+
+
+Bool_t Transport::AllReduceMax ( Int_t* data, ULong64_t n )
+{
+  if( ! IsCoordinator() )
+    return Send(0, data, n*sizeof(Int_t)) && Receive(0, data, n*sizeof(Int_t));
+
+  std::vector<Int_t> buffer(n);
+  for(Int_t rank = 1; rank < GetNRanks(); ++rank) {
+    if( ! Receive(rank, &buffer[0], n*sizeof(Int_t)) )
+      return kFALSE;
+    for(ULong64_t idx = 0; idx < n; ++idx)
+      data[idx] = std::max(data[idx], buffer[idx]);
+  }
+  return Broadcast(data, n*sizeof(Int_t));
+}
+
+
+SocketTransport::SocketTransport ( const char* address, Int_t rank, Int_t nRanks, Double_t timeout )
+: Transport(),
+  fRank(rank),
+  fNRanks(nRanks),
+  fConnected(kFALSE),
+  fSockets(),
+  fUnixPath()
+{
+  if( rank < 0 || rank >= nRanks ) {
+    Error("SocketTransport", "rank %d not in [0, %d)", rank, nRanks);
+    return;
+  }
+  fConnected = rank == 0 ? Listen(address, timeout) : Connect(address, timeout);
+}
+
+
+SocketTransport::~SocketTransport()
+{
+  for(UInt_t idx = 0; idx < fSockets.size(); ++idx)
+    if( fSockets[idx] >= 0 )
+      close(fSockets[idx]);
+  if( ! fUnixPath.empty() )
+    unlink(&fUnixPath[0]);
+}
+
+
+Bool_t SocketTransport::Listen ( const char* address, Double_t timeout )
+{
+  // accepts the workers, which identify by sending their rank
+  fSockets.assign(fNRanks, -1);
+  if( fNRanks == 1 )
+    return kTRUE;
+  const Int_t server = OpenSocket(address, kTRUE);
+  if( server < 0 ) {
+    Error("Listen", "can not listen on %s: %s", address, strerror(errno));
+    return kFALSE;
+  }
+  if( strncmp(address, "unix:", 5) == 0 )
+    fUnixPath.assign(address + 5, address + strlen(address) + 1);
+
+  const Double_t end = Now() + timeout;
+  Int_t nConnected = 0;
+  while( nConnected < fNRanks - 1 ) {
+    pollfd pfd = {server, POLLIN, 0};
+    const Int_t wait = Int_t(1000*(end - Now()));
+    if( wait <= 0 || poll(&pfd, 1, wait) <= 0 )
+      break;
+    const Int_t fd = accept(server, NULL, NULL);
+    if( fd < 0 )
+      continue;
+    Int_t rank = -1;
+    fSockets[0] = fd; // for Receive
+    if( ! Receive(0, &rank, sizeof(rank)) || rank <= 0 || rank >= fNRanks || fSockets[rank] >= 0 ) {
+      Error("Listen", "connection with invalid rank %d", rank);
+      close(fd);
+      fSockets[0] = -1;
+      continue;
+    }
+    fSockets[0] = -1;
+    fSockets[rank] = fd;
+    ++nConnected;
+  }
+  close(server);
+
+  if( nConnected < fNRanks - 1 ) {
+    Error("Listen", "%d of %d workers connected within %g s", nConnected, fNRanks - 1, timeout);
+    return kFALSE;
+  }
+  return kTRUE;
+}
+
+
+Bool_t SocketTransport::Connect ( const char* address, Double_t timeout )
+{
+  // retries until the coordinator listens
+  fSockets.assign(1, -1);
+  const Double_t end = Now() + timeout;
+  while( fSockets[0] < 0 && Now() < end ) {
+    fSockets[0] = OpenSocket(address, kFALSE);
+    if( fSockets[0] < 0 )
+      usleep(10000);
+  }
+  if( fSockets[0] < 0 ) {
+    Error("Connect", "can not connect to %s within %g s", address, timeout);
+    return kFALSE;
+  }
+  return Send(0, &fRank, sizeof(fRank));
+}
+
+
+Int_t SocketTransport::GetSocket ( Int_t rank ) const
+{
+  if( fRank == 0 )
+    return rank > 0 && rank < fNRanks ? fSockets[rank] : (rank == 0 ? fSockets[0] : -1);
+  return rank == 0 ? fSockets[0] : -1;
+}
+
+
+Bool_t SocketTransport::Send ( Int_t rank, const void* data, ULong64_t size )
+{
+  const Int_t fd = GetSocket(rank);
+  if( fd < 0 ) {
+    Error("Send", "no connection from rank %d to rank %d", fRank, rank);
+    return kFALSE;
+  }
+  const char* bytes = static_cast<const char*>(data);
+  while( size > 0 ) {
+    const ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+    if( sent < 0 && errno == EINTR )
+      continue;
+    if( sent <= 0 ) {
+      Error("Send", "to rank %d: %s", rank, strerror(errno));
+      return kFALSE;
+    }
+    bytes += sent;
+    size -= sent;
+  }
+  return kTRUE;
+}
+
+
+Bool_t SocketTransport::Receive ( Int_t rank, void* data, ULong64_t size )
+{
+  const Int_t fd = GetSocket(rank);
+  if( fd < 0 ) {
+    Error("Receive", "no connection from rank %d to rank %d", fRank, rank);
+    return kFALSE;
+  }
+  char* bytes = static_cast<char*>(data);
+  while( size > 0 ) {
+    const ssize_t received = recv(fd, bytes, size, 0);
+    if( received < 0 && errno == EINTR )
+      continue;
+    if( received <= 0 ) {
+      Error("Receive", "from rank %d: %s", rank, received ? strerror(errno) : "connection closed");
+      return kFALSE;
+    }
+    bytes += received;
+    size -= received;
+  }
+  return kTRUE;
+}
@@ -0,0 +1,117 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <Rtypes.h>
+#include <vector>
+
+
+// Message transport between the processes of a distributed calibration
+// (DistributedCalibrator). Rank 0 is the coordinator, ranks 1 to
+// GetNRanks()-1 the workers; workers only exchange messages with the
+// coordinator. Implementations give the point to point Send and Receive of
+// raw bytes, the collectives are built on them here.
+class Transport
+{
+public:
+  Transport() {}
+  virtual ~Transport() {}
+
+  virtual Int_t GetRank() const = 0;
+  virtual Int_t GetNRanks() const = 0;
+  Bool_t IsCoordinator() const { return GetRank() == 0; }
+
+  // blocking, of exactly size bytes
+  virtual Bool_t Send(Int_t rank, const void* data, ULong64_t size) = 0;
+  virtual Bool_t Receive(Int_t rank, void* data, ULong64_t size) = 0;
+
+  // *** Collectives, all ranks must call ***
+  // data of the coordinator to all
+  Bool_t Broadcast(void* data, ULong64_t size);
+  // elementwise sum to the coordinator, in rank order
+  Bool_t ReduceSum(Double_t* data, ULong64_t n);
+  // elementwise sum, to all
+  Bool_t AllReduceSum(Double_t* data, ULong64_t n);
+  // elementwise maximum, to all
+  Bool_t AllReduceMax(Int_t* data, ULong64_t n);
+
+  // vector of any size, point to point
+  template<class T> Bool_t SendVector(Int_t rank, const std::vector<T>& data);
+  template<class T> Bool_t ReceiveVector(Int_t rank, std::vector<T>& data);
+
+private:
+  Transport(const Transport&); // Not Implemented
+  Transport& operator= (const Transport&); // Not Implemented
+};
+
+
+template<class T>
+Bool_t Transport::SendVector ( Int_t rank, const std::vector<T>& data )
+{
+  const ULong64_t size = data.size();
+  return Send(rank, &size, sizeof(size)) && (! size || Send(rank, &data[0], size*sizeof(T)));
+}
+
+
+template<class T>
+Bool_t Transport::ReceiveVector ( Int_t rank, std::vector<T>& data )
+{
+  ULong64_t size = 0;
+  if( ! Receive(rank, &size, sizeof(size)) )
+    return kFALSE;
+  data.resize(size);
+  return ! size || Receive(rank, &data[0], size*sizeof(T));
+}
+
+
+// Transport over stream sockets, in the unix domain between processes on
+// one machine ("unix:/path/to/socket") or over tcp between machines
+// ("tcp:host:port"). The coordinator listens on the address and waits for
+// the nRanks-1 workers, which retry connecting until the timeout.
+class SocketTransport : public Transport
+{
+public:
+  SocketTransport(const char* address, Int_t rank, Int_t nRanks, Double_t timeout = 60);
+  virtual ~SocketTransport();
+
+  virtual Int_t GetRank() const { return fRank; }
+  virtual Int_t GetNRanks() const { return fNRanks; }
+  Bool_t IsConnected() const { return fConnected; }
+
+  virtual Bool_t Send(Int_t rank, const void* data, ULong64_t size);
+  virtual Bool_t Receive(Int_t rank, void* data, ULong64_t size);
+
+private:
+  Bool_t Listen(const char* address, Double_t timeout);
+  Bool_t Connect(const char* address, Double_t timeout);
+  Int_t GetSocket(Int_t rank) const;
+
+  Int_t fRank;
+  Int_t fNRanks;
+  Bool_t fConnected;
+  std::vector<Int_t> fSockets; // coordinator: [rank] socket of worker, worker: [0] socket of coordinator
+  std::vector<char> fUnixPath; // unix socket path to remove, coordinator
+};
+
+#endif // TRANSPORT_H
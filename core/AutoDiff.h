@@ -0,0 +1,198 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef AUTODIFF_H
+#define AUTODIFF_H
+
+#include "CoreTypes.h"
+#include "CoreError.h"
+#include <cmath>
+#include "MassKernel.h"
+
+
+// Forward mode automatic differentiation. Dual<T, N> carries a value and
+// its derivatives in N directions; the mass kernel instantiated with it
+// (MassKernel<Dual<T, N>, NonLinearity>) gives exact derivatives of M
+// without hand derived expressions. Used to cross check, or replace, the
+// analytic gradient of MassKernel::MassGradient.
+template<class T, Int_t N>
+class Dual
+{
+public:
+  Dual(T value = 0) : fValue(value) { for(Int_t i = 0; i < N; ++i) fD[i] = 0; }
+
+  // independent variable of direction
+  static Dual Variable(T value, Int_t direction) { Dual x(value); x.fD[direction] = 1; return x; }
+
+  T Value() const { return fValue; }
+  T D(Int_t direction) const { return fD[direction]; }
+
+  Dual& operator+= (const Dual& b) { fValue += b.fValue; for(Int_t i = 0; i < N; ++i) fD[i] += b.fD[i]; return *this; }
+  Dual& operator-= (const Dual& b) { fValue -= b.fValue; for(Int_t i = 0; i < N; ++i) fD[i] -= b.fD[i]; return *this; }
+  Dual& operator*= (const Dual& b) { return *this = *this * b; }
+  Dual& operator/= (const Dual& b) { return *this = *this / b; }
+  Dual& operator+= (T b) { fValue += b; return *this; }
+  Dual& operator-= (T b) { fValue -= b; return *this; }
+  Dual& operator*= (T b) { fValue *= b; for(Int_t i = 0; i < N; ++i) fD[i] *= b; return *this; }
+  Dual& operator/= (T b) { return *this *= T(1)/b; }
+
+  friend Dual operator- (const Dual& a) { Dual c(-a.fValue); for(Int_t i = 0; i < N; ++i) c.fD[i] = -a.fD[i]; return c; }
+
+  friend Dual operator+ (const Dual& a, const Dual& b) { Dual c(a); return c += b; }
+  friend Dual operator+ (const Dual& a, T b) { Dual c(a); return c += b; }
+  friend Dual operator+ (T a, const Dual& b) { Dual c(b); return c += a; }
+  friend Dual operator- (const Dual& a, const Dual& b) { Dual c(a); return c -= b; }
+  friend Dual operator- (const Dual& a, T b) { Dual c(a); return c -= b; }
+  friend Dual operator- (T a, const Dual& b) { Dual c(-b); return c += a; }
+  friend Dual operator* (const Dual& a, T b) { Dual c(a); return c *= b; }
+  friend Dual operator* (T a, const Dual& b) { Dual c(b); return c *= a; }
+  friend Dual operator* (const Dual& a, const Dual& b)
+  {
+    Dual c(a.fValue * b.fValue);
+    for(Int_t i = 0; i < N; ++i)
+      c.fD[i] = a.fD[i]*b.fValue + a.fValue*b.fD[i];
+    return c;
+  }
+  friend Dual operator/ (const Dual& a, T b) { Dual c(a); return c *= T(1)/b; }
+  friend Dual operator/ (T a, const Dual& b)
+  {
+    const T inv = T(1) / b.fValue;
+    Dual c(a * inv);
+    for(Int_t i = 0; i < N; ++i)
+      c.fD[i] = - a * b.fD[i] * inv * inv;
+    return c;
+  }
+  friend Dual operator/ (const Dual& a, const Dual& b)
+  {
+    const T inv = T(1) / b.fValue;
+    Dual c(a.fValue * inv);
+    for(Int_t i = 0; i < N; ++i)
+      c.fD[i] = (a.fD[i] - c.fValue*b.fD[i]) * inv;
+    return c;
+  }
+
+  friend bool operator< (const Dual& a, const Dual& b) { return a.fValue < b.fValue; }
+  friend bool operator< (const Dual& a, T b) { return a.fValue < b; }
+  friend bool operator< (T a, const Dual& b) { return a < b.fValue; }
+  friend bool operator<= (const Dual& a, const Dual& b) { return a.fValue <= b.fValue; }
+  friend bool operator<= (const Dual& a, T b) { return a.fValue <= b; }
+  friend bool operator<= (T a, const Dual& b) { return a <= b.fValue; }
+  friend bool operator> (const Dual& a, const Dual& b) { return a.fValue > b.fValue; }
+  friend bool operator> (const Dual& a, T b) { return a.fValue > b; }
+  friend bool operator> (T a, const Dual& b) { return a > b.fValue; }
+  friend bool operator>= (const Dual& a, const Dual& b) { return a.fValue >= b.fValue; }
+  friend bool operator>= (const Dual& a, T b) { return a.fValue >= b; }
+  friend bool operator>= (T a, const Dual& b) { return a >= b.fValue; }
+
+  // chain rule, f(a) with f'(a) = df
+  friend Dual Chain(const Dual& a, T f, T df)
+  {
+    Dual c(f);
+    for(Int_t i = 0; i < N; ++i)
+      c.fD[i] = df * a.fD[i];
+    return c;
+  }
+  friend Dual log(const Dual& a) { return Chain(a, std::log(a.fValue), T(1)/a.fValue); }
+  friend Dual exp(const Dual& a) { const T e = std::exp(a.fValue); return Chain(a, e, e); }
+  friend Dual sqrt(const Dual& a) { const T s = std::sqrt(a.fValue); return Chain(a, s, T(0.5)/s); }
+  friend Dual fabs(const Dual& a) { return a.fValue < 0 ? -a : a; }
+
+private:
+  T fValue;
+  T fD[N];
+};
+
+
+// Mass and its derivatives by automatic differentiation: grad1[i] = dM/dcc
+// of cell i of cluster 1 (likewise grad2), and, if not NULL,
+// gradGlobal = (dM/dLogWeight, dM/dParA, dM/dParB).
+template<class T, class NonLinearity>
+T MassGradientAD(const GeometryCache& geometry, const CoreGlobals& globals, const NonLinearity& nonLinearity, const T* cc,
+		 const Int_t* index1, const Float_t* amp1, Int_t nCells1,
+		 const Int_t* index2, const Float_t* amp2, Int_t nCells2,
+		 const T vertex[3], T* grad1, T* grad2, T* gradGlobal = NULL);
+
+
+
+template<class D, class T, class NonLinearity>
+T MassGradientDual ( const GeometryCache& geometry, const CoreGlobals& globals, const NonLinearity& nonLinearity, const T* cc,
+		     const Int_t* index1, const Float_t* amp1, Int_t nCells1,
+		     const Int_t* index2, const Float_t* amp2, Int_t nCells2,
+		     const T vertex[3], T* grad1, T* grad2, T* gradGlobal )
+{
+  // directions: cells of cluster 1, cells of cluster 2, log weight, para, parb
+  std::vector<D> cellCC1(nCells1), cellCC2(nCells2);
+  for(Int_t idx = 0; idx < nCells1; ++idx)
+    cellCC1[idx] = D::Variable(cc[index1[idx]], idx);
+  for(Int_t idx = 0; idx < nCells2; ++idx)
+    cellCC2[idx] = D::Variable(cc[index2[idx]], nCells1 + idx);
+  const Int_t global = nCells1 + nCells2;
+  const D logWeight = D::Variable(globals.fLogWeight, global);
+  const D parA = D::Variable(globals.fParA, global + 1);
+  const D parB = D::Variable(globals.fParB, global + 2);
+
+  const MassKernel<D, NonLinearity> kernel(geometry, globals, nonLinearity, NULL, logWeight, parA, parB);
+  ClusterState<D> c1, c2;
+  kernel.EvalCluster(index1, amp1, &cellCC1[0], nCells1, c1);
+  kernel.EvalCluster(index2, amp2, &cellCC2[0], nCells2, c2);
+  const D vertexD[3] = {vertex[0], vertex[1], vertex[2]};
+  const D mass = MassKernel<D, NonLinearity>::Mass(c1, c2, vertexD);
+
+  for(Int_t idx = 0; idx < nCells1; ++idx)
+    grad1[idx] = mass.D(idx);
+  for(Int_t idx = 0; idx < nCells2; ++idx)
+    grad2[idx] = mass.D(nCells1 + idx);
+  if( gradGlobal )
+    for(Int_t idx = 0; idx < 3; ++idx)
+      gradGlobal[idx] = mass.D(global + idx);
+  return mass.Value();
+}
+
+
+template<class T, class NonLinearity>
+T MassGradientAD ( const GeometryCache& geometry, const CoreGlobals& globals, const NonLinearity& nonLinearity, const T* cc,
+		   const Int_t* index1, const Float_t* amp1, Int_t nCells1,
+		   const Int_t* index2, const Float_t* amp2, Int_t nCells2,
+		   const T vertex[3], T* grad1, T* grad2, T* gradGlobal )
+{
+  // the number of directions is rounded up to one of a few fixed sizes
+  const Int_t nDirections = nCells1 + nCells2 + 3;
+  if( nDirections <= 16 )
+    return MassGradientDual< Dual<T, 16> >(geometry, globals, nonLinearity, cc, index1, amp1, nCells1, index2, amp2, nCells2, vertex, grad1, grad2, gradGlobal);
+  if( nDirections <= 32 )
+    return MassGradientDual< Dual<T, 32> >(geometry, globals, nonLinearity, cc, index1, amp1, nCells1, index2, amp2, nCells2, vertex, grad1, grad2, gradGlobal);
+  if( nDirections <= 64 )
+    return MassGradientDual< Dual<T, 64> >(geometry, globals, nonLinearity, cc, index1, amp1, nCells1, index2, amp2, nCells2, vertex, grad1, grad2, gradGlobal);
+  if( nDirections <= 128 )
+    return MassGradientDual< Dual<T, 128> >(geometry, globals, nonLinearity, cc, index1, amp1, nCells1, index2, amp2, nCells2, vertex, grad1, grad2, gradGlobal);
+
+  CoreError("MassGradientAD", "%d cells in sample, at most 125 supported", nCells1 + nCells2);
+  for(Int_t idx = 0; idx < nCells1; ++idx)
+    grad1[idx] = 0;
+  for(Int_t idx = 0; idx < nCells2; ++idx)
+    grad2[idx] = 0;
+  if( gradGlobal )
+    gradGlobal[0] = gradGlobal[1] = gradGlobal[2] = 0;
+  return 0;
+}
+
+#endif // AUTODIFF_H
@@ -0,0 +1,53 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "CoreError.h"
+#include <cstdarg>
+#include <cstdio>
+
+
+namespace {
+  void Message(const char* level, const char* location, const char* format, va_list args)
+  {
+    std::fprintf(stderr, "%s in <%s>: ", level, location);
+    std::vfprintf(stderr, format, args);
+    std::fprintf(stderr, "\n");
+  }
+}
+
+
+void CoreError ( const char* location, const char* format, ... )
+{
+  va_list args;
+  va_start(args, format);
+  Message("Error", location, format, args);
+  va_end(args);
+}
+
+
+void CoreWarning ( const char* location, const char* format, ... )
+{
+  va_list args;
+  va_start(args, format);
+  Message("Warning", location, format, args);
+  va_end(args);
+}
@@ -0,0 +1,45 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "CoreParameters.h"
+#include <type_traits>
+
+
+// the plain values are copied as bytes, e.g. into transport buffers
+static_assert(std::is_trivial<CoreCell>::value && std::is_trivial<CoreSample>::value
+	      && std::is_trivial<CoreGlobals>::value && std::is_trivial<CoreChannel>::value,
+	      "core value types must be trivial");
+
+
+const Int_t CoreGlobals::kMaxNonLinearParams;
+const Int_t CoreParameters::kNMod;
+
+
+CoreParameters::CoreParameters()
+: fGlobals(),
+  fChannels()
+{
+  // no nonlinearity correction, and identity transformations
+  for(Int_t mod = 0; mod < kNMod; ++mod)
+    for(Int_t idx = 0; idx < 12; ++idx)
+      fT[mod][idx] = (idx % 5 == 0) ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef COREPARAMETERS_H
+#define COREPARAMETERS_H
+
+#include "CoreTypes.h"
+#include <vector>
+
+
+// The global parameters of the mass model, a plain copy of those of
+// SampleParameters (SampleParameters::GetCoreGlobals), with the
+// nonlinearity correction resolved to its NonLinearity::Version.
+struct CoreGlobals
+{
+  const static Int_t kMaxNonLinearParams = 8;
+
+  Float_t fLogWeight; // AliPHOSClusterizerv1::fW0
+  Float_t fParA; // depth correction
+  Float_t fParB;
+  Float_t fCS; // crystal shift, center to front surface
+  Double_t fIncident[3]; // incident vector
+  Int_t fNonLinearity; // NonLinearity::Version
+  Int_t fNNonLinearParams;
+  Float_t fNonLinearParams[kMaxNonLinearParams];
+};
+
+
+// A good channel, its PHOS absId, cc and cell center in the module frame.
+struct CoreChannel
+{
+  Int_t fAbsId;
+  Float_t fCC;
+  Float_t fLocalX;
+  Float_t fLocalZ;
+};
+
+
+// The parameters of the calibration as plain values, converted to and from
+// SampleParameters by SampleParameters::GetCore and SetCore. The module
+// transformations are row major 3x4 [R|t], global = R*local + t.
+struct CoreParameters
+{
+  const static Int_t kNMod = 5;
+
+  CoreParameters();
+
+  Int_t GetNGood() const { return fChannels.size(); }
+
+  CoreGlobals fGlobals;
+  Float_t fT[kNMod][12];
+  std::vector<CoreChannel> fChannels; // [nGood]
+};
+
+#endif // COREPARAMETERS_H
@@ -0,0 +1,119 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "CoreSampleSet.h"
+#include "CoreParameters.h"
+#include "GeometryCache.h"
+#include "MassKernel.h"
+#include "NonLinearity.h"
+
+
+namespace {
+  // the masses of a set with the kernel of the nonlinearity policy
+  class MassPass
+  {
+  public:
+    MassPass(const CoreSampleSet& set, const CoreParameters& params, std::vector<Double_t>& masses)
+    : fSet(set), fParams(params), fMasses(masses) {}
+
+    template<class NonLinearity> void operator() (const NonLinearity& nonLinearity);
+
+  private:
+    MassPass(const MassPass&); // Not Implemented
+    MassPass& operator= (const MassPass&); // Not Implemented
+
+    const CoreSampleSet& fSet;
+    const CoreParameters& fParams;
+    std::vector<Double_t>& fMasses;
+  };
+
+
+  template<class NonLinearity>
+  void MassPass::operator() ( const NonLinearity& nonLinearity )
+  {
+    const GeometryCache geometry(fParams);
+    std::vector<Double_t> cc(fParams.GetNGood());
+    for(Int_t idx = 0; idx < fParams.GetNGood(); ++idx)
+      cc[idx] = fParams.fChannels[idx].fCC;
+    const MassKernel<Double_t, NonLinearity> kernel(geometry, fParams.fGlobals, nonLinearity, cc.empty() ? NULL : &cc[0]);
+
+    // the clusters, once each
+    std::vector< ClusterState<Double_t> > states(fSet.GetNClusters());
+    std::vector<Int_t> index;
+    std::vector<Float_t> amp;
+    for(UInt_t cluster = 0; cluster < fSet.GetNClusters(); ++cluster) {
+      const Int_t nCells = fSet.GetNCells(cluster);
+      const CoreCell* cells = fSet.GetCells(cluster);
+      index.resize(nCells);
+      amp.resize(nCells);
+      for(Int_t cell = 0; cell < nCells; ++cell) {
+	index[cell] = cells[cell].fIndex;
+	amp[cell] = cells[cell].fAmp;
+      }
+      kernel.EvalCluster(nCells ? &index[0] : NULL, nCells ? &amp[0] : NULL, nCells, states[cluster]);
+    }
+
+    fMasses.resize(fSet.GetNSamples());
+    for(UInt_t sample = 0; sample < fSet.GetNSamples(); ++sample) {
+      const CoreSample& pair = fSet.GetSample(sample);
+      fMasses[sample] = MassKernel<Double_t, NonLinearity>::Mass(states[pair.fCluster[0]], states[pair.fCluster[1]], pair.fVertex);
+    }
+  }
+}
+
+
+CoreSampleSet::CoreSampleSet()
+: fClusterBegin(1, 0),
+  fCells(),
+  fSamples()
+{
+}
+
+
+void CoreSampleSet::Clear()
+{
+  fClusterBegin.assign(1, 0);
+  fCells.clear();
+  fSamples.clear();
+}
+
+
+Int_t CoreSampleSet::AddCluster ( const CoreCell* cells, Int_t nCells )
+{
+  fCells.insert(fCells.end(), cells, cells + nCells);
+  fClusterBegin.push_back(fCells.size());
+  return fClusterBegin.size() - 2;
+}
+
+
+void CoreSampleSet::AddSample ( Int_t cluster1, Int_t cluster2, const Double_t vertex[3] )
+{
+  const CoreSample sample = {{cluster1, cluster2}, {vertex[0], vertex[1], vertex[2]}};
+  fSamples.push_back(sample);
+}
+
+
+void CoreSampleSet::EvalMasses ( const CoreParameters& params, std::vector<Double_t>& masses ) const
+{
+  MassPass pass(*this, params, masses);
+  DispatchNonLinearity(params.fGlobals, pass);
+}
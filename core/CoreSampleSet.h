@@ -0,0 +1,61 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef CORESAMPLESET_H
+#define CORESAMPLESET_H
+
+#include "CoreTypes.h"
+#include <vector>
+
+struct CoreParameters;
+
+
+// Samples as plain values: clusters as ranges of a flat cell array, and
+// samples as pairs of cluster ids. The layout of ClusterTable, without its
+// deduplication; converted from it by ClusterTable::GetCore, and from a
+// Sample by Sample::GetCore.
+class CoreSampleSet
+{
+public:
+  CoreSampleSet();
+
+  void Clear();
+  // id of the new cluster
+  Int_t AddCluster(const CoreCell* cells, Int_t nCells);
+  void AddSample(Int_t cluster1, Int_t cluster2, const Double_t vertex[3]);
+
+  UInt_t GetNClusters() const { return fClusterBegin.size() - 1; }
+  Int_t GetNCells(Int_t cluster) const { return fClusterBegin[cluster+1] - fClusterBegin[cluster]; }
+  const CoreCell* GetCells(Int_t cluster) const { return &fCells[fClusterBegin[cluster]]; }
+  UInt_t GetNSamples() const { return fSamples.size(); }
+  const CoreSample& GetSample(UInt_t sample) const { return fSamples[sample]; }
+
+  // the masses of the samples, evaluated with the cc's of params
+  void EvalMasses(const CoreParameters& params, std::vector<Double_t>& masses) const;
+
+private:
+  std::vector<UInt_t> fClusterBegin; // [nClusters+1]
+  std::vector<CoreCell> fCells;
+  std::vector<CoreSample> fSamples;
+};
+
+#endif // CORESAMPLESET_H
@@ -0,0 +1,58 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef CORETYPES_H
+#define CORETYPES_H
+
+// The basic types of the calibration core (libCalibCore), which is built
+// without ROOT. They are declared as ROOT's RtypesCore declares them, so
+// that core and ROOT headers can be included together; the core itself
+// uses true and false rather than kTRUE and kFALSE.
+#ifndef ROOT_RtypesCore
+typedef int Int_t;
+typedef unsigned int UInt_t;
+typedef float Float_t;
+typedef double Double_t;
+typedef bool Bool_t;
+typedef long long Long64_t;
+typedef unsigned long long ULong64_t;
+#endif
+
+#include <cstddef>
+
+
+// A cell of a cluster, its good channel index and amplitude.
+struct CoreCell
+{
+  Int_t fIndex;
+  Float_t fAmp;
+};
+
+
+// A sample, a pair of clusters (ids into a CoreSampleSet) and the vertex.
+struct CoreSample
+{
+  Int_t fCluster[2];
+  Double_t fVertex[3];
+};
+
+#endif // CORETYPES_H
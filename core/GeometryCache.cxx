@@ -0,0 +1,43 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "GeometryCache.h"
+
+
+GeometryCache::GeometryCache ( const CoreParameters& params )
+: fNCells(params.GetNGood()),
+  fModule(params.GetNGood()),
+  fLocalX(params.GetNGood()),
+  fLocalZ(params.GetNGood()),
+  fLocalY(-params.fGlobals.fCS)
+{
+  for(UInt_t idx = 0; idx < fNCells; ++idx) {
+    const CoreChannel& channel = params.fChannels[idx];
+    fModule[idx] = AbsIdToModule(channel.fAbsId);
+    fLocalX[idx] = channel.fLocalX;
+    fLocalZ[idx] = channel.fLocalZ;
+  }
+
+  for(UInt_t mod = 0; mod < kNMod; ++mod)
+    for(int idx = 0; idx < 12; ++idx)
+      fT[mod][idx] = params.fT[mod][idx];
+}
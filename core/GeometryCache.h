@@ -0,0 +1,85 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef GEOMETRYCACHE_H
+#define GEOMETRYCACHE_H
+
+#include "CoreTypes.h"
+#include "CoreParameters.h"
+#include <vector>
+
+
+// Immutable per-cell geometry derived from the parameters, for the mass
+// model inner loop. Cells are stored SoA, indexed as the good channels of
+// the parameters. The module transformations (TGeoHMatrix of
+// SampleParameters::GetT) are stored as plain row major 3x4 [R|t] arrays,
+// so that g = R*l + t needs no virtual call.
+class GeometryCache
+{
+public:
+  // constants, PHOS EMC
+  const static UInt_t kNMod = CoreParameters::kNMod;
+  const static UInt_t kNRowX = 64;
+  const static UInt_t kNColZ = 56;
+
+  explicit GeometryCache(const CoreParameters& params);
+
+  UInt_t GetNCells() const { return fNCells; }
+  Int_t GetModule(UInt_t index) const { return fModule[index]; }
+  Float_t GetLocalX(UInt_t index) const { return fLocalX[index]; }
+  Float_t GetLocalZ(UInt_t index) const { return fLocalZ[index]; }
+  Float_t GetLocalY() const { return fLocalY; }
+  const Float_t* GetT(UInt_t module) const { return fT[module]; }
+
+  const Int_t* GetModuleArray() const { return &fModule[0]; }
+  const Float_t* GetLocalXArray() const { return &fLocalX[0]; }
+  const Float_t* GetLocalZArray() const { return &fLocalZ[0]; }
+
+  // local (x, y, z) in module to global
+  template<class T> void LocalToGlobal(UInt_t module, const T local[3], T global[3]) const;
+
+  // PHOS absId (1 based) to module (0 based)
+  static Int_t AbsIdToModule(Int_t absId) { return (absId - 1) / (kNRowX*kNColZ); }
+  // PHOS absId to row x and column z in module (0 based)
+  static Int_t AbsIdToRowX(Int_t absId) { return ((absId - 1) % (kNRowX*kNColZ)) / kNColZ; }
+  static Int_t AbsIdToColZ(Int_t absId) { return (absId - 1) % kNColZ; }
+
+private:
+  UInt_t fNCells;
+  std::vector<Int_t> fModule; // [fNCells] module of cell, 0 based
+  std::vector<Float_t> fLocalX; // [fNCells] local x of cell center
+  std::vector<Float_t> fLocalZ; // [fNCells] local z of cell center
+  Float_t fLocalY; // local y of crystal front surface, -CoreGlobals::fCS
+  Float_t fT[kNMod][12]; // [kNMod] row major 3x4 [R|t], global = R*local + t
+};
+
+
+template<class T>
+inline void GeometryCache::LocalToGlobal ( UInt_t module, const T local[3], T global[3] ) const
+{
+  const Float_t* t = fT[module];
+  global[0] = t[0]*local[0] + t[1]*local[1] + t[2]*local[2]  + t[3];
+  global[1] = t[4]*local[0] + t[5]*local[1] + t[6]*local[2]  + t[7];
+  global[2] = t[8]*local[0] + t[9]*local[1] + t[10]*local[2] + t[11];
+}
+
+#endif // GEOMETRYCACHE_H
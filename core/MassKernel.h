@@ -0,0 +1,312 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MASSKERNEL_H
+#define MASSKERNEL_H
+
+#include "CoreTypes.h"
+#include "CoreParameters.h"
+#include "GeometryCache.h"
+#include <cmath>
+#include <vector>
+
+
+// Energy and global position of one cluster, with the derivatives wrt the
+// cc of each of its cells (if requested).
+template<class T>
+struct ClusterState
+{
+  ClusterState() : fNCells(0), fEnergy(0), fGlobal(), fDEnergy(), fDGlobal() {}
+
+  Int_t fNCells;
+  T fEnergy; // nonlinearity corrected
+  T fGlobal[3];
+  std::vector<T> fDEnergy; // [fNCells] dEnergy/dcc_i
+  std::vector<T> fDGlobal; // [3*fNCells] dGlobal/dcc_i
+};
+
+
+// The forward model of the calibration, the pi0 mass of two clusters as
+// reconstructed from the cell amplitudes and the parameters, see
+// AliPHOSEmcRecPoint::EvalAll and AliPHOSClusterizerv1. Cell energy is
+// e_i = cc_i * a_i. The kernel is instantiated per scalar type T (Float_t
+// or Double_t, the precision of all arithmetic) and per nonlinearity policy
+// (NonLinearity.h). The cc's are given separately from the global
+// parameters, as
+// the array being fitted. Clusters are given as sparse lists of good channel
+// indices and amplitudes.
+template<class T, class NonLinearity>
+class MassKernel
+{
+public:
+  MassKernel(const GeometryCache& geometry, const CoreGlobals& globals, const NonLinearity& nonLinearity, const T* cc);
+  // with the global parameters given, e.g. as dual numbers (AutoDiff.h)
+  MassKernel(const GeometryCache& geometry, const CoreGlobals& globals, const NonLinearity& nonLinearity, const T* cc,
+	     const T& logWeight, const T& parA, const T& parB);
+
+  // cc's of the kernel, cc[index[i]]
+  void EvalCluster(const Int_t* index, const Float_t* amp, Int_t nCells, ClusterState<T>& state, Bool_t derivatives = false) const;
+  // cc's per cell of the cluster, cellCC[i]
+  void EvalCluster(const Int_t* index, const Float_t* amp, const T* cellCC, Int_t nCells, ClusterState<T>& state, Bool_t derivatives = false) const;
+
+  static T Mass(const ClusterState<T>& c1, const ClusterState<T>& c2, const T vertex[3]);
+  // grad1[i] = dM/dcc of cell i in cluster 1, likewise grad2.
+  static T MassGradient(const ClusterState<T>& c1, const ClusterState<T>& c2, const T vertex[3], T* grad1, T* grad2);
+
+private:
+  // cc access, by good channel index or by cell of cluster
+  struct GlobalCC {
+    const T* fCC; const Int_t* fIndex;
+    const T& operator[] (Int_t idx) const { return fCC[fIndex[idx]]; }
+  };
+  struct LocalCC {
+    const T* fCC;
+    const T& operator[] (Int_t idx) const { return fCC[idx]; }
+  };
+  template<class CCArray>
+  void EvalClusterImpl(const Int_t* index, const Float_t* amp, const CCArray& cc, Int_t nCells, ClusterState<T>& state, Bool_t derivatives) const;
+
+  const GeometryCache& fGeometry;
+  const T* fCC;
+  const T fLogWeight;
+  const T fParA;
+  const T fParB;
+  T fDepthX; // incident vector x/|y|, 0 if no depth correction
+  T fDepthZ; // incident vector z/|y|
+  const NonLinearity fNonLinearity;
+};
+
+
+
+template<class T, class NonLinearity>
+MassKernel<T, NonLinearity>::MassKernel ( const GeometryCache& geometry, const CoreGlobals& globals, const NonLinearity& nonLinearity, const T* cc )
+: fGeometry(geometry),
+  fCC(cc),
+  fLogWeight(globals.fLogWeight),
+  fParA(globals.fParA),
+  fParB(globals.fParB),
+  fDepthX(0),
+  fDepthZ(0),
+  fNonLinearity(nonLinearity)
+{
+  const Double_t* inc = globals.fIncident;
+  if( inc[1] != 0 ) {
+    fDepthX = inc[0] / std::fabs(inc[1]);
+    fDepthZ = inc[2] / std::fabs(inc[1]);
+  }
+}
+
+
+template<class T, class NonLinearity>
+MassKernel<T, NonLinearity>::MassKernel ( const GeometryCache& geometry, const CoreGlobals& globals, const NonLinearity& nonLinearity, const T* cc,
+					  const T& logWeight, const T& parA, const T& parB )
+: fGeometry(geometry),
+  fCC(cc),
+  fLogWeight(logWeight),
+  fParA(parA),
+  fParB(parB),
+  fDepthX(0),
+  fDepthZ(0),
+  fNonLinearity(nonLinearity)
+{
+  const Double_t* inc = globals.fIncident;
+  if( inc[1] != 0 ) {
+    fDepthX = inc[0] / std::fabs(inc[1]);
+    fDepthZ = inc[2] / std::fabs(inc[1]);
+  }
+}
+
+
+template<class T, class NonLinearity>
+inline void MassKernel<T, NonLinearity>::EvalCluster ( const Int_t* index, const Float_t* amp, Int_t nCells, ClusterState<T>& state, Bool_t derivatives ) const
+{
+  const GlobalCC cc = {fCC, index};
+  EvalClusterImpl(index, amp, cc, nCells, state, derivatives);
+}
+
+
+template<class T, class NonLinearity>
+inline void MassKernel<T, NonLinearity>::EvalCluster ( const Int_t* index, const Float_t* amp, const T* cellCC, Int_t nCells, ClusterState<T>& state, Bool_t derivatives ) const
+{
+  const LocalCC cc = {cellCC};
+  EvalClusterImpl(index, amp, cc, nCells, state, derivatives);
+}
+
+
+template<class T, class NonLinearity>
+template<class CCArray>
+void MassKernel<T, NonLinearity>::EvalClusterImpl ( const Int_t* index, const Float_t* amp, const CCArray& cc, Int_t nCells, ClusterState<T>& state, Bool_t derivatives ) const
+{
+  using std::log;
+  state.fNCells = nCells;
+  state.fEnergy = 0;
+  state.fGlobal[0] = state.fGlobal[1] = state.fGlobal[2] = 0;
+  if( derivatives ) {
+    state.fDEnergy.assign(nCells, T(0));
+    state.fDGlobal.assign(3*nCells, T(0));
+  }
+  if( nCells <= 0 )
+    return;
+
+  // energy
+  T energy = 0;
+  for(Int_t idx = 0; idx < nCells; ++idx)
+    energy += cc[idx] * amp[idx];
+  if( energy <= 0 )
+    return;
+
+  // log weighted center of gravity, w_i = max(0, W0 + ln(e_i/E))
+  const Float_t* localX = fGeometry.GetLocalXArray();
+  const Float_t* localZ = fGeometry.GetLocalZArray();
+  const T logEnergy = log(energy);
+  T wtot = 0;
+  T x = 0;
+  T z = 0;
+  T sumX = 0; // sum of x_i (and z_i) over cells with w_i > 0
+  T sumZ = 0;
+  Int_t nActive = 0;
+  for(Int_t idx = 0; idx < nCells; ++idx) {
+    const T e = cc[idx] * amp[idx];
+    if( e <= 0 )
+      continue;
+    const T w = fLogWeight + log(e) - logEnergy;
+    if( w <= 0 )
+      continue;
+    wtot += w;
+    x += w * localX[index[idx]];
+    z += w * localZ[index[idx]];
+    sumX += localX[index[idx]];
+    sumZ += localZ[index[idx]];
+    ++nActive;
+  }
+  if( wtot <= 0 )
+    return;
+  x /= wtot;
+  z /= wtot;
+
+  // depth correction
+  const T depth = fParA * logEnergy + fParB;
+  const T xCog = x;
+  const T zCog = z;
+  x -= depth * fDepthX;
+  z -= depth * fDepthZ;
+
+  const Int_t module = fGeometry.GetModule(index[0]);
+  const T local[3] = {x, fGeometry.GetLocalY(), z};
+  fGeometry.LocalToGlobal(module, local, state.fGlobal);
+  state.fEnergy = fNonLinearity.Correct(energy);
+
+  if( ! derivatives )
+    return;
+
+  // dw_i/dcc_j = delta_ij/cc_i - a_j/E, for w_i > 0
+  const T dCorrected = fNonLinearity.Derivative(energy);
+  const Float_t* t = fGeometry.GetT(module);
+  const T restX = sumX - nActive*xCog;
+  const T restZ = sumZ - nActive*zCog;
+  for(Int_t idx = 0; idx < nCells; ++idx) {
+    const T e = cc[idx] * amp[idx];
+    const T dLogEnergy = amp[idx] / energy; // dln(E)/dcc_j
+    T dx = -dLogEnergy * restX;
+    T dz = -dLogEnergy * restZ;
+    if( e > 0 && fLogWeight + log(e) - logEnergy > 0 ) {
+      dx += (localX[index[idx]] - xCog) / cc[idx];
+      dz += (localZ[index[idx]] - zCog) / cc[idx];
+    }
+    dx = dx/wtot - fParA * dLogEnergy * fDepthX;
+    dz = dz/wtot - fParA * dLogEnergy * fDepthZ;
+
+    state.fDEnergy[idx] = dCorrected * amp[idx];
+    state.fDGlobal[3*idx + 0] = t[0]*dx + t[2]*dz;
+    state.fDGlobal[3*idx + 1] = t[4]*dx + t[6]*dz;
+    state.fDGlobal[3*idx + 2] = t[8]*dx + t[10]*dz;
+  }
+}
+
+
+template<class T, class NonLinearity>
+T MassKernel<T, NonLinearity>::Mass ( const ClusterState<T>& c1, const ClusterState<T>& c2, const T vertex[3] )
+{
+  // M^2 = 2 E1 E2 (1 - cos(theta))
+  using std::sqrt;
+  const T d1[3] = {c1.fGlobal[0] - vertex[0], c1.fGlobal[1] - vertex[1], c1.fGlobal[2] - vertex[2]};
+  const T d2[3] = {c2.fGlobal[0] - vertex[0], c2.fGlobal[1] - vertex[1], c2.fGlobal[2] - vertex[2]};
+  const T norm1 = sqrt(d1[0]*d1[0] + d1[1]*d1[1] + d1[2]*d1[2]);
+  const T norm2 = sqrt(d2[0]*d2[0] + d2[1]*d2[1] + d2[2]*d2[2]);
+  if( norm1 <= 0 || norm2 <= 0 )
+    return 0;
+
+  const T cosTheta = (d1[0]*d2[0] + d1[1]*d2[1] + d1[2]*d2[2]) / (norm1*norm2);
+  const T m2 = 2 * c1.fEnergy * c2.fEnergy * (1 - cosTheta);
+  return m2 > 0 ? sqrt(m2) : 0;
+}
+
+
+template<class T, class NonLinearity>
+T MassKernel<T, NonLinearity>::MassGradient ( const ClusterState<T>& c1, const ClusterState<T>& c2, const T vertex[3], T* grad1, T* grad2 )
+{
+  using std::sqrt;
+  for(Int_t idx = 0; idx < c1.fNCells; ++idx)
+    grad1[idx] = 0;
+  for(Int_t idx = 0; idx < c2.fNCells; ++idx)
+    grad2[idx] = 0;
+
+  T u1[3] = {c1.fGlobal[0] - vertex[0], c1.fGlobal[1] - vertex[1], c1.fGlobal[2] - vertex[2]};
+  T u2[3] = {c2.fGlobal[0] - vertex[0], c2.fGlobal[1] - vertex[1], c2.fGlobal[2] - vertex[2]};
+  const T norm1 = sqrt(u1[0]*u1[0] + u1[1]*u1[1] + u1[2]*u1[2]);
+  const T norm2 = sqrt(u2[0]*u2[0] + u2[1]*u2[1] + u2[2]*u2[2]);
+  if( norm1 <= 0 || norm2 <= 0 )
+    return 0;
+  for(int i = 0; i < 3; ++i) {
+    u1[i] /= norm1;
+    u2[i] /= norm2;
+  }
+
+  const T cosTheta = u1[0]*u2[0] + u1[1]*u2[1] + u1[2]*u2[2];
+  const T m2 = 2 * c1.fEnergy * c2.fEnergy * (1 - cosTheta);
+  if( m2 <= 0 )
+    return 0;
+  const T mass = sqrt(m2);
+
+  // dM/dE1, dM/dE2, dM/dcos and dcos/dg1, dcos/dg2
+  const T dE1 = c2.fEnergy * (1 - cosTheta) / mass;
+  const T dE2 = c1.fEnergy * (1 - cosTheta) / mass;
+  const T dCos = - c1.fEnergy * c2.fEnergy / mass;
+  T dg1[3];
+  T dg2[3];
+  for(int i = 0; i < 3; ++i) {
+    dg1[i] = dCos * (u2[i] - cosTheta*u1[i]) / norm1;
+    dg2[i] = dCos * (u1[i] - cosTheta*u2[i]) / norm2;
+  }
+
+  for(Int_t idx = 0; idx < c1.fNCells; ++idx) {
+    const T* dg = &c1.fDGlobal[3*idx];
+    grad1[idx] = dE1*c1.fDEnergy[idx] + dg1[0]*dg[0] + dg1[1]*dg[1] + dg1[2]*dg[2];
+  }
+  for(Int_t idx = 0; idx < c2.fNCells; ++idx) {
+    const T* dg = &c2.fDGlobal[3*idx];
+    grad2[idx] = dE2*c2.fDEnergy[idx] + dg2[0]*dg[0] + dg2[1]*dg[1] + dg2[2]*dg[2];
+  }
+  return mass;
+}
+
+#endif // MASSKERNEL_H
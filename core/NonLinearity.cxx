@@ -0,0 +1,44 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "NonLinearity.h"
+#include "CoreError.h"
+#include <cstring>
+
+
+NonLinearity::Version NonLinearity::GetVersion ( const char* name, Int_t nParams )
+{
+  if( ! name || ! std::strcmp(name, "") )
+    return kNone;
+
+  if( ! std::strcmp(name, "Henrik2010") ) {
+    if( nParams < Henrik2010NonLinearity::kNParams ) {
+      CoreWarning("NonLinearity::GetVersion", "Henrik2010 requires %d parameters, correction disabled",
+		  Henrik2010NonLinearity::kNParams);
+      return kNone;
+    }
+    return kHenrik2010;
+  }
+
+  CoreWarning("NonLinearity::GetVersion", "unknown nonlinearity correction version %s, correction disabled", name);
+  return kNone;
+}
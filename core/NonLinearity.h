@@ -0,0 +1,130 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef NONLINEARITY_H
+#define NONLINEARITY_H
+
+#include "CoreTypes.h"
+#include "CoreParameters.h"
+#include <cmath>
+
+
+// Nonlinearity correction policies, one per
+// SampleParameters::GetNonLinearCorrectionVersion(). The version string is
+// resolved once (NonLinearity::GetVersion, by SampleParameters::
+// GetCoreGlobals) and the mass kernels are instantiated
+// per policy, so that Correct and Derivative inline into the cluster loop.
+// Correct(E) is the corrected energy, Derivative(E) = dCorrect/dE.
+
+class NoNonLinearity
+{
+public:
+  const static Int_t kNParams = 0;
+
+  NoNonLinearity(const Float_t* /*params*/, Int_t /*nParams*/) {}
+
+  template<class T> T Correct(const T& energy) const { return energy; }
+  template<class T> T Derivative(const T& /*energy*/) const { return T(1); }
+};
+
+
+// AliPHOSClusterizerv1, "Henrik2010":
+// E' = E (p0 + p1 exp(-E p2)) (1 + p3 exp(-E p4)) (1 + p6/(E^2 + p5))
+class Henrik2010NonLinearity
+{
+public:
+  const static Int_t kNParams = 7;
+
+  Henrik2010NonLinearity(const Float_t* params, Int_t nParams);
+
+  template<class T> T Correct(const T& energy) const;
+  template<class T> T Derivative(const T& energy) const;
+
+private:
+  Float_t fPar[kNParams];
+};
+
+
+namespace NonLinearity {
+  enum Version { kNone, kHenrik2010 };
+
+  // resolves a version string with nParams parameters, falls back to kNone
+  // (with a warning) for unknown versions or too few parameters.
+  Version GetVersion(const char* name, Int_t nParams);
+}
+
+
+// Calls functor(policy) with the policy of globals. Functor must have a
+// template operator() taking the policy by const reference.
+template<class Functor>
+void DispatchNonLinearity(const CoreGlobals& globals, Functor& functor);
+
+
+
+inline Henrik2010NonLinearity::Henrik2010NonLinearity ( const Float_t* params, Int_t nParams )
+{
+  for(Int_t idx = 0; idx < kNParams; ++idx)
+    fPar[idx] = idx < nParams ? params[idx] : 0;
+}
+
+
+template<class T>
+inline T Henrik2010NonLinearity::Correct ( const T& energy ) const
+{
+  using std::exp;
+  const T a = fPar[0] + fPar[1]*exp(-energy*fPar[2]);
+  const T b = 1. + fPar[3]*exp(-energy*fPar[4]);
+  const T c = 1. + fPar[6]/(energy*energy + fPar[5]);
+  return energy * a * b * c;
+}
+
+
+template<class T>
+inline T Henrik2010NonLinearity::Derivative ( const T& energy ) const
+{
+  using std::exp;
+  const T expA = exp(-energy*fPar[2]);
+  const T expB = exp(-energy*fPar[4]);
+  const T denC = energy*energy + fPar[5];
+  const T a = fPar[0] + fPar[1]*expA;
+  const T b = 1. + fPar[3]*expB;
+  const T c = 1. + fPar[6]/denC;
+  const T da = -fPar[1]*fPar[2]*expA;
+  const T db = -fPar[3]*fPar[4]*expB;
+  const T dc = -2.*fPar[6]*energy/(denC*denC);
+  return a*b*c + energy*(da*b*c + a*db*c + a*b*dc);
+}
+
+
+template<class Functor>
+inline void DispatchNonLinearity ( const CoreGlobals& globals, Functor& functor )
+{
+  switch( globals.fNonLinearity ) {
+  case NonLinearity::kHenrik2010:
+    functor(Henrik2010NonLinearity(globals.fNonLinearParams, globals.fNNonLinearParams));
+    break;
+  default:
+    functor(NoNonLinearity(globals.fNonLinearParams, globals.fNNonLinearParams));
+  }
+}
+
+#endif // NONLINEARITY_H
@@ -0,0 +1,277 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Preconditioner.h"
+#include "SparseMatrix.h"
+#include "CoreError.h"
+#include <algorithm>
+#include <cmath>
+
+
+Preconditioner* Preconditioner::Create ( Type type, const std::vector<Int_t>& block )
+{
+  switch( type ) {
+  case kJacobi:
+    return new JacobiPreconditioner();
+  case kBlockJacobi:
+    return new BlockJacobiPreconditioner(block);
+  case kIncompleteCholesky:
+    return new IncompleteCholeskyPreconditioner();
+  }
+  CoreError("Preconditioner::Create", "unknown type %d", type);
+  return NULL;
+}
+
+
+void JacobiPreconditioner::Compute ( const SparseMatrix& a, const std::vector<Double_t>& shift )
+{
+  fInverse.resize(a.GetN());
+  for(UInt_t idx = 0; idx < a.GetN(); ++idx) {
+    const Double_t diagonal = a.GetDiagonal(idx) + shift[idx];
+    fInverse[idx] = diagonal > 0 ? 1. / diagonal : 1.;
+  }
+}
+
+
+void JacobiPreconditioner::Apply ( const Double_t* r, Double_t* z ) const
+{
+  for(UInt_t idx = 0; idx < fInverse.size(); ++idx)
+    z[idx] = fInverse[idx] * r[idx];
+}
+
+
+BlockJacobiPreconditioner::BlockJacobiPreconditioner ( const std::vector<Int_t>& block )
+: fBlockBegin(),
+  fUnknowns(),
+  fLocal(block.size()),
+  fFactorBegin(),
+  fFactor(),
+  fWork()
+{
+  // unknowns grouped by block, in order within a block
+  std::vector< std::pair<Int_t, Int_t> > order(block.size());
+  for(UInt_t idx = 0; idx < block.size(); ++idx)
+    order[idx] = std::make_pair(block[idx], Int_t(idx));
+  std::sort(order.begin(), order.end());
+
+  fUnknowns.resize(block.size());
+  fBlockBegin.push_back(0);
+  for(UInt_t pos = 0; pos < order.size(); ++pos) {
+    if( pos > 0 && order[pos].first != order[pos-1].first )
+      fBlockBegin.push_back(pos);
+    fUnknowns[pos] = order[pos].second;
+    fLocal[order[pos].second] = pos - fBlockBegin.back();
+  }
+  fBlockBegin.push_back(order.size());
+  if( order.empty() )
+    fBlockBegin.assign(1, 0);
+
+  ULong64_t size = 0;
+  for(UInt_t b = 0; b + 1 < fBlockBegin.size(); ++b) {
+    fFactorBegin.push_back(size);
+    const ULong64_t n = fBlockBegin[b+1] - fBlockBegin[b];
+    size += n*n;
+  }
+  fFactor.resize(size);
+}
+
+
+void BlockJacobiPreconditioner::Compute ( const SparseMatrix& a, const std::vector<Double_t>& shift )
+{
+  const std::vector<UInt_t>& rowBegin = a.GetRowBegin();
+  const std::vector<Int_t>& cols = a.GetCols();
+  const std::vector<Double_t>& values = a.GetValues();
+
+  for(UInt_t b = 0; b < GetNBlocks(); ++b) {
+    const UInt_t begin = fBlockBegin[b];
+    const Int_t n = fBlockBegin[b+1] - begin;
+    Double_t* factor = &fFactor[fFactorBegin[b]];
+    std::fill(factor, factor + ULong64_t(n)*n, 0.);
+
+    // the diagonal block of A, lower triangle
+    for(Int_t i = 0; i < n; ++i) {
+      const Int_t row = fUnknowns[begin + i];
+      for(UInt_t pos = rowBegin[row]; pos < rowBegin[row+1]; ++pos) {
+	const Int_t col = cols[pos];
+	const Int_t j = fLocal[col];
+	if( j <= i && j < n && fUnknowns[begin + j] == col )
+	  factor[i*n + j] = values[pos];
+      }
+      factor[i*n + i] += shift[row];
+    }
+
+    // dense cholesky, A = L L^T in place
+    Bool_t positive = true;
+    for(Int_t j = 0; j < n && positive; ++j) {
+      Double_t d = factor[j*n + j];
+      for(Int_t k = 0; k < j; ++k)
+	d -= factor[j*n + k]*factor[j*n + k];
+      if( d <= 0 ) {
+	positive = false;
+	break;
+      }
+      const Double_t ljj = std::sqrt(d);
+      factor[j*n + j] = ljj;
+      for(Int_t i = j + 1; i < n; ++i) {
+	Double_t sum = factor[i*n + j];
+	for(Int_t k = 0; k < j; ++k)
+	  sum -= factor[i*n + k]*factor[j*n + k];
+	factor[i*n + j] = sum / ljj;
+      }
+    }
+
+    // not positive definite, the diagonal of the block instead
+    if( ! positive ) {
+      CoreWarning("BlockJacobiPreconditioner::Compute", "block %d not positive definite, using its diagonal", b);
+      for(Int_t i = 0; i < n; ++i) {
+	const Int_t row = fUnknowns[begin + i];
+	const Double_t diagonal = a.GetDiagonal(row) + shift[row];
+	std::fill(factor + ULong64_t(i)*n, factor + ULong64_t(i+1)*n, 0.);
+	factor[i*n + i] = diagonal > 0 ? std::sqrt(diagonal) : 1.;
+      }
+    }
+  }
+}
+
+
+void BlockJacobiPreconditioner::Apply ( const Double_t* r, Double_t* z ) const
+{
+  for(UInt_t b = 0; b < GetNBlocks(); ++b) {
+    const UInt_t begin = fBlockBegin[b];
+    const Int_t n = fBlockBegin[b+1] - begin;
+    const Double_t* factor = &fFactor[fFactorBegin[b]];
+    fWork.resize(n);
+    Double_t* y = &fWork[0];
+
+    // L y = r, L^T z = y
+    for(Int_t i = 0; i < n; ++i) {
+      Double_t sum = r[fUnknowns[begin + i]];
+      for(Int_t k = 0; k < i; ++k)
+	sum -= factor[i*n + k]*y[k];
+      y[i] = sum / factor[i*n + i];
+    }
+    for(Int_t i = n - 1; i >= 0; --i) {
+      y[i] /= factor[i*n + i];
+      for(Int_t k = 0; k < i; ++k)
+	y[k] -= factor[i*n + k]*y[i];
+    }
+    for(Int_t i = 0; i < n; ++i)
+      z[fUnknowns[begin + i]] = y[i];
+  }
+}
+
+
+void IncompleteCholeskyPreconditioner::Compute ( const SparseMatrix& a, const std::vector<Double_t>& shift )
+{
+  // increases the relative diagonal shift until IC(0) does not break down
+  fShift = 0;
+  if( Factorise(a, shift, fShift) )
+    return;
+  for(fShift = 1e-3; fShift <= 1; fShift *= 10)
+    if( Factorise(a, shift, fShift) )
+      return;
+
+  CoreWarning("IncompleteCholeskyPreconditioner::Compute", "factorisation not positive, using the diagonal");
+  const UInt_t n = a.GetN();
+  fRowBegin.resize(n + 1);
+  fCols.resize(n);
+  fValues.resize(n);
+  for(UInt_t row = 0; row < n; ++row) {
+    fRowBegin[row] = row;
+    fCols[row] = row;
+    const Double_t diagonal = a.GetDiagonal(row) + shift[row];
+    fValues[row] = diagonal > 0 ? std::sqrt(diagonal) : 1.;
+  }
+  fRowBegin[n] = n;
+}
+
+
+Bool_t IncompleteCholeskyPreconditioner::Factorise ( const SparseMatrix& a, const std::vector<Double_t>& shift, Double_t relativeShift )
+{
+  const UInt_t n = a.GetN();
+  const std::vector<UInt_t>& rowBegin = a.GetRowBegin();
+  const std::vector<Int_t>& cols = a.GetCols();
+  const std::vector<Double_t>& values = a.GetValues();
+
+  // pattern, the lower triangle of A; columns are sorted so the diagonal is last
+  fRowBegin.assign(1, 0);
+  fCols.clear();
+  fValues.clear();
+  for(UInt_t row = 0; row < n; ++row) {
+    for(UInt_t pos = rowBegin[row]; pos < rowBegin[row+1] && cols[pos] <= Int_t(row); ++pos) {
+      fCols.push_back(cols[pos]);
+      fValues.push_back(values[pos]);
+    }
+    fRowBegin.push_back(fCols.size());
+  }
+
+  for(UInt_t row = 0; row < n; ++row) {
+    const UInt_t begin = fRowBegin[row];
+    const UInt_t diagonal = fRowBegin[row+1] - 1;
+    for(UInt_t pos = begin; pos < diagonal; ++pos) {
+      // L_ik = (A_ik - sum_{j<k} L_ij L_kj) / L_kk, on the common pattern
+      const Int_t k = fCols[pos];
+      Double_t sum = fValues[pos];
+      UInt_t p = begin;
+      UInt_t q = fRowBegin[k];
+      const UInt_t qEnd = fRowBegin[k+1] - 1;
+      while( p < pos && q < qEnd ) {
+	if( fCols[p] < fCols[q] )
+	  ++p;
+	else if( fCols[p] > fCols[q] )
+	  ++q;
+	else
+	  sum -= fValues[p++]*fValues[q++];
+      }
+      fValues[pos] = sum / fValues[qEnd];
+    }
+    Double_t d = fValues[diagonal]*(1 + relativeShift) + shift[row];
+    for(UInt_t pos = begin; pos < diagonal; ++pos)
+      d -= fValues[pos]*fValues[pos];
+    if( d <= 0 )
+      return false;
+    fValues[diagonal] = std::sqrt(d);
+  }
+  return true;
+}
+
+
+void IncompleteCholeskyPreconditioner::Apply ( const Double_t* r, Double_t* z ) const
+{
+  const UInt_t n = fRowBegin.size() - 1;
+
+  // L y = r
+  for(UInt_t row = 0; row < n; ++row) {
+    const UInt_t diagonal = fRowBegin[row+1] - 1;
+    Double_t sum = r[row];
+    for(UInt_t pos = fRowBegin[row]; pos < diagonal; ++pos)
+      sum -= fValues[pos]*z[fCols[pos]];
+    z[row] = sum / fValues[diagonal];
+  }
+  // L^T z = y, by columns of L^T
+  for(Int_t row = n - 1; row >= 0; --row) {
+    const UInt_t diagonal = fRowBegin[row+1] - 1;
+    z[row] /= fValues[diagonal];
+    for(UInt_t pos = fRowBegin[row]; pos < diagonal; ++pos)
+      z[fCols[pos]] -= fValues[pos]*z[row];
+  }
+}
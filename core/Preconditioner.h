@@ -0,0 +1,117 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PRECONDITIONER_H
+#define PRECONDITIONER_H
+
+#include "CoreTypes.h"
+#include <vector>
+
+class SparseMatrix;
+
+
+// Preconditioners for conjugate gradient on the damped normal equations,
+// (A + diag(shift)) x = b with A the assembled SparseMatrix. Compute is
+// called once per solve, Apply once per iteration (z = M^-1 r).
+//
+// kJacobi, the diagonal.
+// kBlockJacobi, the diagonal blocks of A given by a block number per
+// unknown, each factorised dense (Cholesky). With the blocks as PHOS
+// modules, or as small tiles of cells in a module, which couples the
+// neighbouring cells that share clusters. The factor takes n^2 doubles per
+// block of n unknowns, a full module (3584 cells) some 100 MB.
+// kIncompleteCholesky, IC(0) of A on its own pattern, with a diagonal
+// shift increased until the factorisation is positive.
+class Preconditioner
+{
+public:
+  enum Type { kJacobi, kBlockJacobi, kIncompleteCholesky };
+
+  virtual ~Preconditioner() {}
+
+  virtual void Compute(const SparseMatrix& a, const std::vector<Double_t>& shift) = 0;
+  virtual void Apply(const Double_t* r, Double_t* z) const = 0;
+  virtual const char* GetName() const = 0;
+
+  // new preconditioner of type, block[i] the block of unknown i (kBlockJacobi)
+  static Preconditioner* Create(Type type, const std::vector<Int_t>& block);
+};
+
+
+class JacobiPreconditioner : public Preconditioner
+{
+public:
+  JacobiPreconditioner() : fInverse() {}
+
+  virtual void Compute(const SparseMatrix& a, const std::vector<Double_t>& shift);
+  virtual void Apply(const Double_t* r, Double_t* z) const;
+  virtual const char* GetName() const { return "jacobi"; }
+
+private:
+  std::vector<Double_t> fInverse; // 1/(A_ii + shift_i)
+};
+
+
+class BlockJacobiPreconditioner : public Preconditioner
+{
+public:
+  explicit BlockJacobiPreconditioner(const std::vector<Int_t>& block);
+
+  virtual void Compute(const SparseMatrix& a, const std::vector<Double_t>& shift);
+  virtual void Apply(const Double_t* r, Double_t* z) const;
+  virtual const char* GetName() const { return "block jacobi"; }
+
+  UInt_t GetNBlocks() const { return fBlockBegin.size() - 1; }
+
+private:
+  std::vector<UInt_t> fBlockBegin; // [nBlocks+1] first unknown of block in fUnknowns
+  std::vector<Int_t> fUnknowns; // unknowns ordered by block
+  std::vector<Int_t> fLocal; // [n] position of unknown in its block
+  std::vector<ULong64_t> fFactorBegin; // [nBlocks] first element of block factor
+  std::vector<Double_t> fFactor; // lower cholesky factors, row major, dense
+  mutable std::vector<Double_t> fWork;
+};
+
+
+class IncompleteCholeskyPreconditioner : public Preconditioner
+{
+public:
+  IncompleteCholeskyPreconditioner() : fRowBegin(), fCols(), fValues(), fShift(0) {}
+
+  virtual void Compute(const SparseMatrix& a, const std::vector<Double_t>& shift);
+  virtual void Apply(const Double_t* r, Double_t* z) const;
+  virtual const char* GetName() const { return "incomplete cholesky"; }
+
+  // relative diagonal shift needed by the last Compute
+  Double_t GetShift() const { return fShift; }
+
+private:
+  Bool_t Factorise(const SparseMatrix& a, const std::vector<Double_t>& shift, Double_t relativeShift);
+
+  // lower triangle of L, diagonal last in each row
+  std::vector<UInt_t> fRowBegin;
+  std::vector<Int_t> fCols;
+  std::vector<Double_t> fValues;
+  Double_t fShift;
+};
+
+#endif // PRECONDITIONER_H
@@ -0,0 +1,416 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SparseLDLT.h"
+#include "SparseMatrix.h"
+#include "CoreError.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+  const UInt_t kMagic = 0x544c444c; // "LDLT"
+  const UInt_t kFileVersion = 1;
+  const UInt_t kCacheSize = 16; // analyses kept in memory
+
+  // the analyses of the process
+  struct Cache
+  {
+    Cache() : fMutex(), fEntries(), fDirectory() {}
+
+    std::mutex fMutex;
+    std::map< ULong64_t, std::shared_ptr<const SparseLDLT::Symbolic> > fEntries;
+    std::string fDirectory;
+  };
+
+  Cache& GetCache()
+  {
+    static Cache cache;
+    return cache;
+  }
+
+  template<class T> void WriteVector(std::FILE* file, const std::vector<T>& v)
+  {
+    const ULong64_t size = v.size();
+    std::fwrite(&size, sizeof(size), 1, file);
+    if( size )
+      std::fwrite(&v[0], sizeof(T), size, file);
+  }
+
+  template<class T> bool ReadVector(std::FILE* file, std::vector<T>& v, ULong64_t maxSize)
+  {
+    ULong64_t size = 0;
+    if( std::fread(&size, sizeof(size), 1, file) != 1 || size > maxSize )
+      return false;
+    v.resize(size);
+    return ! size || std::fread(&v[0], sizeof(T), size, file) == size;
+  }
+}
+
+
+SparseLDLT::Symbolic::Symbolic()
+: fHash(0),
+  fN(0),
+  fNNonZeroA(0),
+  fPerm(),
+  fInversePerm(),
+  fColBegin(),
+  fRows(),
+  fRowBegin(),
+  fRowCol(),
+  fRowPos(),
+  fGatherBegin(),
+  fGatherValue(),
+  fGatherRow()
+{
+}
+
+
+SparseLDLT::SparseLDLT()
+: fSymbolic(),
+  fCached(false),
+  fL(),
+  fD(),
+  fWork()
+{
+}
+
+
+void SparseLDLT::Analyse ( const SparseMatrix& a )
+{
+  const ULong64_t hash = Hash(a);
+  fCached = true;
+  if( fSymbolic && fSymbolic->fHash == hash && fSymbolic->fN == a.GetN() && fSymbolic->fNNonZeroA == a.GetNNonZero() )
+    return;
+
+  Cache& cache = GetCache();
+  std::string filename;
+  {
+    std::lock_guard<std::mutex> lock(cache.fMutex);
+    const std::map< ULong64_t, std::shared_ptr<const Symbolic> >::const_iterator entry = cache.fEntries.find(hash);
+    if( entry != cache.fEntries.end() && entry->second->fN == a.GetN() && entry->second->fNNonZeroA == a.GetNNonZero() ) {
+      fSymbolic = entry->second;
+      return;
+    }
+    if( ! cache.fDirectory.empty() ) {
+      char name[64];
+      std::snprintf(name, sizeof(name), "/ldlt_%016llx.bin", (unsigned long long) hash);
+      filename = cache.fDirectory + name;
+    }
+  }
+
+  std::shared_ptr<const Symbolic> symbolic;
+  if( ! filename.empty() )
+    symbolic = Read(filename.c_str(), a, hash);
+  if( ! symbolic ) {
+    fCached = false;
+    symbolic = Compute(a, hash);
+    if( ! filename.empty() )
+      Write(filename.c_str(), *symbolic);
+  }
+
+  std::lock_guard<std::mutex> lock(cache.fMutex);
+  if( cache.fEntries.size() >= kCacheSize )
+    cache.fEntries.erase(cache.fEntries.begin()); // an arbitrary one
+  cache.fEntries[hash] = symbolic;
+  fSymbolic = symbolic;
+}
+
+
+bool SparseLDLT::Factorise ( const SparseMatrix& a, const std::vector<Double_t>& shift )
+{
+  if( ! fSymbolic || fSymbolic->fN != a.GetN() ) {
+    CoreError("SparseLDLT::Factorise", "the pattern is not analysed");
+    return false;
+  }
+  const Symbolic& s = *fSymbolic;
+  const std::vector<Double_t>& values = a.GetValues();
+  fL.resize(s.fRows.size());
+  fD.resize(s.fN);
+  fWork.assign(s.fN, 0.);
+  std::vector<Double_t>& x = fWork;
+
+  // column j of L from A(j:n, j) less the columns k of row j
+  for(UInt_t j = 0; j < s.fN; ++j) {
+    for(UInt_t pos = s.fGatherBegin[j]; pos < s.fGatherBegin[j+1]; ++pos)
+      x[s.fGatherRow[pos]] += values[s.fGatherValue[pos]];
+    x[j] += shift[s.fPerm[j]];
+    for(UInt_t entry = s.fRowBegin[j]; entry < s.fRowBegin[j+1]; ++entry) {
+      const Int_t k = s.fRowCol[entry];
+      const UInt_t p = s.fRowPos[entry];
+      const Double_t f = fL[p] * fD[k];
+      x[j] -= fL[p] * f;
+      for(UInt_t q = p + 1; q < s.fColBegin[k+1]; ++q)
+	x[s.fRows[q]] -= fL[q] * f;
+    }
+
+    const Double_t d = x[j];
+    x[j] = 0;
+    if( ! (d > 0) ) {
+      for(UInt_t q = s.fColBegin[j]; q < s.fColBegin[j+1]; ++q)
+	x[s.fRows[q]] = 0;
+      return false;
+    }
+    fD[j] = d;
+    for(UInt_t q = s.fColBegin[j]; q < s.fColBegin[j+1]; ++q) {
+      fL[q] = x[s.fRows[q]] / d;
+      x[s.fRows[q]] = 0;
+    }
+  }
+  return true;
+}
+
+
+void SparseLDLT::Solve ( const Double_t* b, Double_t* x ) const
+{
+  const Symbolic& s = *fSymbolic;
+  std::vector<Double_t>& y = fWork;
+  y.resize(s.fN);
+  for(UInt_t j = 0; j < s.fN; ++j)
+    y[j] = b[s.fPerm[j]];
+  for(UInt_t j = 0; j < s.fN; ++j)
+    for(UInt_t q = s.fColBegin[j]; q < s.fColBegin[j+1]; ++q)
+      y[s.fRows[q]] -= fL[q] * y[j];
+  for(UInt_t j = 0; j < s.fN; ++j)
+    y[j] /= fD[j];
+  for(UInt_t j = s.fN; j-- > 0; )
+    for(UInt_t q = s.fColBegin[j]; q < s.fColBegin[j+1]; ++q)
+      y[j] -= fL[q] * y[s.fRows[q]];
+  for(UInt_t j = 0; j < s.fN; ++j)
+    x[s.fPerm[j]] = y[j];
+  std::fill(y.begin(), y.end(), 0.);
+}
+
+
+ULong64_t SparseLDLT::Hash ( const SparseMatrix& a )
+{
+  // splitmix64 steps over the size, the row begins and the columns
+  ULong64_t hash = 0x9E3779B97F4A7C15ULL ^ a.GetN();
+  const std::vector<UInt_t>& rowBegin = a.GetRowBegin();
+  const std::vector<Int_t>& cols = a.GetCols();
+  for(UInt_t idx = 0; idx < rowBegin.size() + cols.size(); ++idx) {
+    hash += (idx < rowBegin.size() ? rowBegin[idx] : UInt_t(cols[idx - rowBegin.size()])) + 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+    hash ^= hash >> 31;
+  }
+  return hash;
+}
+
+
+void SparseLDLT::SetCacheDirectory ( const char* directory )
+{
+  Cache& cache = GetCache();
+  std::lock_guard<std::mutex> lock(cache.fMutex);
+  cache.fDirectory = directory ? directory : "";
+}
+
+
+void SparseLDLT::ClearCache()
+{
+  Cache& cache = GetCache();
+  std::lock_guard<std::mutex> lock(cache.fMutex);
+  cache.fEntries.clear();
+}
+
+
+std::shared_ptr<const SparseLDLT::Symbolic> SparseLDLT::Compute ( const SparseMatrix& a, ULong64_t hash )
+{
+  // Minimum degree on the elimination graph. The neighbours of an unknown
+  // when it is eliminated are the pattern of its column of L, they become
+  // a clique.
+  std::shared_ptr<Symbolic> symbolic(new Symbolic);
+  Symbolic& s = *symbolic;
+  const UInt_t n = a.GetN();
+  s.fHash = hash;
+  s.fN = n;
+  s.fNNonZeroA = a.GetNNonZero();
+
+  const std::vector<UInt_t>& rowBegin = a.GetRowBegin();
+  const std::vector<Int_t>& cols = a.GetCols();
+  std::vector< std::vector<Int_t> > adjacent(n);
+  std::set< std::pair<UInt_t, Int_t> > queue; // (degree, unknown)
+  for(UInt_t row = 0; row < n; ++row) {
+    for(UInt_t pos = rowBegin[row]; pos < rowBegin[row+1]; ++pos)
+      if( cols[pos] != Int_t(row) )
+	adjacent[row].push_back(cols[pos]);
+    queue.insert(std::make_pair(UInt_t(adjacent[row].size()), Int_t(row)));
+  }
+
+  std::vector< std::vector<Int_t> > pattern(n);
+  std::vector<Int_t> merged;
+  s.fPerm.reserve(n);
+  while( ! queue.empty() ) {
+    const Int_t v = queue.begin()->second;
+    queue.erase(queue.begin());
+    s.fPerm.push_back(v);
+    const std::vector<Int_t>& neighbours = adjacent[v];
+    for(UInt_t idx = 0; idx < neighbours.size(); ++idx) {
+      const Int_t u = neighbours[idx];
+      queue.erase(std::make_pair(UInt_t(adjacent[u].size()), u));
+      merged.clear();
+      std::set_union(adjacent[u].begin(), adjacent[u].end(), neighbours.begin(), neighbours.end(), std::back_inserter(merged));
+      merged.erase(std::remove(merged.begin(), merged.end(), u), merged.end());
+      merged.erase(std::remove(merged.begin(), merged.end(), v), merged.end());
+      adjacent[u].swap(merged);
+      queue.insert(std::make_pair(UInt_t(adjacent[u].size()), u));
+    }
+    pattern[v].swap(adjacent[v]);
+  }
+
+  // the columns of L in pivot order
+  s.fInversePerm.resize(n);
+  for(UInt_t j = 0; j < n; ++j)
+    s.fInversePerm[s.fPerm[j]] = j;
+  s.fColBegin.assign(1, 0);
+  for(UInt_t j = 0; j < n; ++j) {
+    std::vector<Int_t>& rows = pattern[s.fPerm[j]];
+    for(UInt_t idx = 0; idx < rows.size(); ++idx)
+      rows[idx] = s.fInversePerm[rows[idx]];
+    std::sort(rows.begin(), rows.end());
+    s.fRows.insert(s.fRows.end(), rows.begin(), rows.end());
+    s.fColBegin.push_back(s.fRows.size());
+    std::vector<Int_t>().swap(rows); // free
+  }
+  Complete(s, a);
+  return symbolic;
+}
+
+
+void SparseLDLT::Complete ( Symbolic& s, const SparseMatrix& a )
+{
+  // the inverse permutation, the row pattern and the gather of A, from the
+  // permutation and the column pattern
+  const UInt_t n = s.fN;
+  s.fInversePerm.resize(n);
+  for(UInt_t j = 0; j < n; ++j)
+    s.fInversePerm[s.fPerm[j]] = j;
+
+  s.fRowBegin.assign(n + 1, 0);
+  for(UInt_t p = 0; p < s.fRows.size(); ++p)
+    ++s.fRowBegin[s.fRows[p] + 1];
+  for(UInt_t row = 0; row < n; ++row)
+    s.fRowBegin[row+1] += s.fRowBegin[row];
+  s.fRowCol.resize(s.fRows.size());
+  s.fRowPos.resize(s.fRows.size());
+  std::vector<UInt_t> next(s.fRowBegin.begin(), s.fRowBegin.end() - 1);
+  for(UInt_t k = 0; k < n; ++k) {
+    for(UInt_t p = s.fColBegin[k]; p < s.fColBegin[k+1]; ++p) {
+      const UInt_t entry = next[s.fRows[p]]++;
+      s.fRowCol[entry] = k;
+      s.fRowPos[entry] = p;
+    }
+  }
+
+  const std::vector<UInt_t>& rowBegin = a.GetRowBegin();
+  const std::vector<Int_t>& cols = a.GetCols();
+  s.fGatherBegin.assign(1, 0);
+  s.fGatherValue.clear();
+  s.fGatherRow.clear();
+  for(UInt_t j = 0; j < n; ++j) {
+    const Int_t row = s.fPerm[j];
+    for(UInt_t pos = rowBegin[row]; pos < rowBegin[row+1]; ++pos) {
+      const Int_t i = s.fInversePerm[cols[pos]];
+      if( i < Int_t(j) )
+	continue;
+      s.fGatherValue.push_back(pos);
+      s.fGatherRow.push_back(i);
+    }
+    s.fGatherBegin.push_back(s.fGatherValue.size());
+  }
+}
+
+
+std::shared_ptr<const SparseLDLT::Symbolic> SparseLDLT::Read ( const char* filename, const SparseMatrix& a, ULong64_t hash )
+{
+  std::FILE* file = std::fopen(filename, "rb");
+  if( ! file )
+    return std::shared_ptr<const Symbolic>();
+
+  std::shared_ptr<Symbolic> symbolic(new Symbolic);
+  Symbolic& s = *symbolic;
+  UInt_t header[2] = {0, 0};
+  bool ok = std::fread(header, sizeof(UInt_t), 2, file) == 2 && header[0] == kMagic && header[1] == kFileVersion
+    && std::fread(&s.fHash, sizeof(s.fHash), 1, file) == 1 && std::fread(&s.fN, sizeof(s.fN), 1, file) == 1
+    && std::fread(&s.fNNonZeroA, sizeof(s.fNNonZeroA), 1, file) == 1
+    && s.fHash == hash && s.fN == a.GetN() && s.fNNonZeroA == a.GetNNonZero()
+    && ReadVector(file, s.fPerm, s.fN) && ReadVector(file, s.fColBegin, s.fN + 1)
+    && ReadVector(file, s.fRows, ULong64_t(s.fN) * s.fN);
+  std::fclose(file);
+
+  // a consistent analysis of n unknowns
+  ok = ok && s.fPerm.size() == s.fN && s.fColBegin.size() == s.fN + 1 && s.fColBegin[0] == 0 && s.fColBegin[s.fN] == s.fRows.size();
+  std::vector<bool> seen(s.fN, false);
+  for(UInt_t j = 0; ok && j < s.fN; ++j) {
+    ok = s.fPerm[j] >= 0 && UInt_t(s.fPerm[j]) < s.fN && ! seen[s.fPerm[j]] && s.fColBegin[j] <= s.fColBegin[j+1];
+    for(UInt_t q = s.fColBegin[j]; ok && q < s.fColBegin[j+1]; ++q)
+      ok = s.fRows[q] > Int_t(j) && UInt_t(s.fRows[q]) < s.fN;
+    if( ok )
+      seen[s.fPerm[j]] = true;
+  }
+  if( ! ok ) {
+    CoreWarning("SparseLDLT::Read", "%s is not an analysis of the pattern, ignored", filename);
+    return std::shared_ptr<const Symbolic>();
+  }
+  Complete(s, a);
+  return symbolic;
+}
+
+
+void SparseLDLT::Write ( const char* filename, const Symbolic& s )
+{
+  // to a temporary file of a unique name in the cache directory, renamed
+  // into place, for concurrent writers
+  std::string temporary = std::string(filename) + ".XXXXXX";
+  const int descriptor = mkstemp(&temporary[0]);
+  std::FILE* file = descriptor < 0 ? NULL : fdopen(descriptor, "wb");
+  if( ! file ) {
+    CoreWarning("SparseLDLT::Write", "cannot create %s", temporary.c_str());
+    if( descriptor >= 0 ) {
+      close(descriptor);
+      std::remove(temporary.c_str());
+    }
+    return;
+  }
+  fchmod(descriptor, 0644); // readable as the cache of other users
+  const UInt_t header[2] = {kMagic, kFileVersion};
+  std::fwrite(header, sizeof(UInt_t), 2, file);
+  std::fwrite(&s.fHash, sizeof(s.fHash), 1, file);
+  std::fwrite(&s.fN, sizeof(s.fN), 1, file);
+  std::fwrite(&s.fNNonZeroA, sizeof(s.fNNonZeroA), 1, file);
+  WriteVector(file, s.fPerm);
+  WriteVector(file, s.fColBegin);
+  WriteVector(file, s.fRows);
+  const bool ok = ! std::ferror(file);
+  if( std::fclose(file) != 0 || ! ok || std::rename(temporary.c_str(), filename) != 0 ) {
+    CoreWarning("SparseLDLT::Write", "cannot write %s", filename);
+    std::remove(temporary.c_str());
+  }
+}
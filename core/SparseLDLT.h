@@ -0,0 +1,104 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SPARSELDLT_H
+#define SPARSELDLT_H
+
+#include "CoreTypes.h"
+#include <vector>
+#include <memory>
+
+class SparseMatrix;
+
+
+// Sparse LDL^T factorisation of the symmetric normal matrix, the direct
+// solver of the damped normal equations (A + diag(shift)) x = b.
+//
+// The analysis, a minimum degree fill reducing ordering and the pattern of
+// the factor, depends on the pattern of A only, which is fixed by the cells
+// that share samples: it is the same for every iteration of a fit, and for
+// fits of the same samples (bootstrap replicates, repeated calibrations).
+// Analyse does it once per pattern and caches it, keyed by a hash of the
+// pattern, in memory, shared by all instances and threads, and with
+// SetCacheDirectory on disk. Factorise is numeric only: a gather of A into
+// the permuted lower triangle and a left looking factorisation on the fixed
+// pattern of L.
+class SparseLDLT
+{
+public:
+  // the analysis of a pattern
+  struct Symbolic
+  {
+    Symbolic();
+
+    ULong64_t fHash;
+    UInt_t fN;
+    UInt_t fNNonZeroA;
+    std::vector<Int_t> fPerm; // [fN] unknown of pivot j
+    std::vector<Int_t> fInversePerm; // [fN] pivot of unknown
+    std::vector<UInt_t> fColBegin; // [fN+1] strictly lower pattern of L, by column
+    std::vector<Int_t> fRows; // sorted within column
+    std::vector<UInt_t> fRowBegin; // [fN+1] the pattern of L by row
+    std::vector<Int_t> fRowCol; // column of the entry
+    std::vector<UInt_t> fRowPos; // position in fRows of the entry
+    std::vector<UInt_t> fGatherBegin; // [fN+1] entries of A in lower column j of P A P^T
+    std::vector<UInt_t> fGatherValue; // position in the values of A
+    std::vector<Int_t> fGatherRow; // pivot row, >= j
+  };
+
+  SparseLDLT();
+
+  // the analysis of the pattern of a, from the cache if there
+  void Analyse(const SparseMatrix& a);
+  // factorises a + diag(shift) on the analysis, false if a pivot is not
+  // positive
+  bool Factorise(const SparseMatrix& a, const std::vector<Double_t>& shift);
+  // x = (a + diag(shift))^-1 b, of the last Factorise
+  void Solve(const Double_t* b, Double_t* x) const;
+
+  UInt_t GetN() const { return fSymbolic ? fSymbolic->fN : 0; }
+  // non zeros of the strictly lower L
+  UInt_t GetNNonZero() const { return fSymbolic ? fSymbolic->fRows.size() : 0; }
+  // the last Analyse was found in the cache (memory or disk)
+  bool IsCached() const { return fCached; }
+
+  // hash of the pattern of a
+  static ULong64_t Hash(const SparseMatrix& a);
+  // directory of the disk cache, NULL or empty for none
+  static void SetCacheDirectory(const char* directory);
+  // clears the memory cache
+  static void ClearCache();
+
+private:
+  static std::shared_ptr<const Symbolic> Compute(const SparseMatrix& a, ULong64_t hash);
+  static std::shared_ptr<const Symbolic> Read(const char* filename, const SparseMatrix& a, ULong64_t hash);
+  static void Write(const char* filename, const Symbolic& symbolic);
+  static void Complete(Symbolic& symbolic, const SparseMatrix& a);
+
+  std::shared_ptr<const Symbolic> fSymbolic;
+  bool fCached;
+  std::vector<Double_t> fL; // values of L on fRows
+  std::vector<Double_t> fD; // [n] pivots
+  mutable std::vector<Double_t> fWork; // [n]
+};
+
+#endif // SPARSELDLT_H
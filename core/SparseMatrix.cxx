@@ -0,0 +1,206 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SparseMatrix.h"
+#include <algorithm>
+#include <iterator>
+#include "CoreError.h"
+
+
+SparseMatrix::SparseMatrix()
+: fN(0),
+  fRowBegin(1, 0),
+  fCols(),
+  fValues(),
+  fDiagonal()
+{
+}
+
+
+void SparseMatrix::SetPattern ( UInt_t n, const std::vector< std::vector<Int_t> >& cliques )
+{
+  // rows of the pattern, the diagonal is always included; the columns of
+  // each row are the distinct unknowns of its cliques, counted, then filled
+  std::vector<UInt_t> rowBegin;
+  std::vector<UInt_t> rowCliques;
+  GetRowCliques(n, cliques, rowBegin, rowCliques);
+  std::vector<Int_t> mark(n, -1);
+
+  fN = n;
+  fRowBegin.assign(n+1, 0);
+  for(Int_t pass = 0; pass < 2; ++pass) {
+    std::fill(mark.begin(), mark.end(), -1);
+    for(UInt_t row = 0; row < n; ++row) {
+      UInt_t nCols = 0;
+      mark[row] = row;
+      if( pass )
+	fCols[fRowBegin[row] + nCols] = row;
+      ++nCols;
+      for(UInt_t pos = rowBegin[row]; pos < rowBegin[row+1]; ++pos) {
+	const std::vector<Int_t>& clique = cliques[rowCliques[pos]];
+	for(UInt_t idx = 0; idx < clique.size(); ++idx) {
+	  if( mark[clique[idx]] == Int_t(row) )
+	    continue;
+	  mark[clique[idx]] = row;
+	  if( pass )
+	    fCols[fRowBegin[row] + nCols] = clique[idx];
+	  ++nCols;
+	}
+      }
+      if( ! pass )
+	fRowBegin[row+1] = fRowBegin[row] + nCols;
+    }
+    if( ! pass )
+      fCols.assign(fRowBegin[n], 0);
+  }
+
+  fDiagonal.assign(n, 0);
+  for(UInt_t row = 0; row < n; ++row) {
+    std::sort(fCols.begin() + fRowBegin[row], fCols.begin() + fRowBegin[row+1]);
+    fDiagonal[row] = std::lower_bound(fCols.begin() + fRowBegin[row], fCols.begin() + fRowBegin[row+1], (Int_t) row) - fCols.begin();
+  }
+  fValues.assign(fCols.size(), 0.);
+}
+
+
+ULong64_t SparseMatrix::CountPattern ( UInt_t n, const std::vector< std::vector<Int_t> >& cliques )
+{
+  std::vector<UInt_t> rowBegin;
+  std::vector<UInt_t> rowCliques;
+  GetRowCliques(n, cliques, rowBegin, rowCliques);
+  std::vector<Int_t> mark(n, -1);
+  ULong64_t nNonZero = 0;
+  for(UInt_t row = 0; row < n; ++row) {
+    mark[row] = row;
+    ++nNonZero;
+    for(UInt_t pos = rowBegin[row]; pos < rowBegin[row+1]; ++pos) {
+      const std::vector<Int_t>& clique = cliques[rowCliques[pos]];
+      for(UInt_t idx = 0; idx < clique.size(); ++idx)
+	if( mark[clique[idx]] != Int_t(row) ) {
+	  mark[clique[idx]] = row;
+	  ++nNonZero;
+	}
+    }
+  }
+  return nNonZero;
+}
+
+
+void SparseMatrix::GetRowCliques ( UInt_t n, const std::vector< std::vector<Int_t> >& cliques,
+				   std::vector<UInt_t>& rowBegin, std::vector<UInt_t>& rowCliques )
+{
+  rowBegin.assign(n+1, 0);
+  for(UInt_t idx = 0; idx < cliques.size(); ++idx)
+    for(UInt_t a = 0; a < cliques[idx].size(); ++a)
+      ++rowBegin[cliques[idx][a] + 1];
+  for(UInt_t row = 0; row < n; ++row)
+    rowBegin[row+1] += rowBegin[row];
+  rowCliques.resize(rowBegin[n]);
+  std::vector<UInt_t> next(rowBegin.begin(), rowBegin.end() - 1);
+  for(UInt_t idx = 0; idx < cliques.size(); ++idx)
+    for(UInt_t a = 0; a < cliques[idx].size(); ++a)
+      rowCliques[next[cliques[idx][a]]++] = idx;
+}
+
+
+void SparseMatrix::MergePattern ( const std::vector<UInt_t>& rowBegin, const std::vector<Int_t>& cols )
+{
+  if( rowBegin.size() != fN + 1 ) {
+    CoreError("SparseMatrix::MergePattern", "pattern of %d rows, not %d", (Int_t) rowBegin.size() - 1, fN);
+    return;
+  }
+
+  std::vector<UInt_t> mergedBegin(fN + 1, 0);
+  std::vector<Int_t> merged;
+  merged.reserve(fCols.size());
+  for(UInt_t row = 0; row < fN; ++row) {
+    mergedBegin[row] = merged.size();
+    std::set_union(fCols.begin() + fRowBegin[row], fCols.begin() + fRowBegin[row+1],
+		   cols.begin() + rowBegin[row], cols.begin() + rowBegin[row+1],
+		   std::back_inserter(merged));
+    fDiagonal[row] = mergedBegin[row]
+      + (std::lower_bound(merged.begin() + mergedBegin[row], merged.end(), (Int_t) row) - (merged.begin() + mergedBegin[row]));
+  }
+  mergedBegin[fN] = merged.size();
+
+  fRowBegin.swap(mergedBegin);
+  fCols.swap(merged);
+  fValues.assign(fCols.size(), 0.);
+}
+
+
+Long64_t SparseMatrix::Find ( Int_t row, Int_t col ) const
+{
+  const Int_t* begin = &fCols[0] + fRowBegin[row];
+  const Int_t* end = &fCols[0] + fRowBegin[row+1];
+  const Int_t* pos = std::lower_bound(begin, end, col);
+  if( pos == end || *pos != col )
+    return -1;
+  return pos - &fCols[0];
+}
+
+
+void SparseMatrix::Zero()
+{
+  std::fill(fValues.begin(), fValues.end(), 0.);
+}
+
+
+void SparseMatrix::Add ( Int_t row, Int_t col, Double_t value )
+{
+  const Long64_t pos = Find(row, col);
+  if( pos < 0 ) {
+    CoreError("SparseMatrix::Add", "(%d, %d) not in pattern", row, col);
+    return;
+  }
+  fValues[pos] += value;
+}
+
+
+void SparseMatrix::AddOuter ( const Int_t* cols, const Double_t* g, Int_t n, Double_t w )
+{
+  // cols is sorted, so the search in each row continues from the last match
+  for(Int_t a = 0; a < n; ++a) {
+    const Double_t wga = w * g[a];
+    const Int_t* pos = &fCols[0] + fRowBegin[cols[a]];
+    const Int_t* end = &fCols[0] + fRowBegin[cols[a]+1];
+    for(Int_t b = 0; b < n; ++b) {
+      pos = std::lower_bound(pos, end, cols[b]);
+      if( pos == end || *pos != cols[b] ) {
+	CoreError("SparseMatrix::AddOuter", "(%d, %d) not in pattern", cols[a], cols[b]);
+	return;
+      }
+      fValues[pos - &fCols[0]] += wga * g[b];
+    }
+  }
+}
+
+
+void SparseMatrix::Multiply ( const Double_t* x, Double_t* y ) const
+{
+  for(UInt_t row = 0; row < fN; ++row) {
+    Double_t sum = 0;
+    for(UInt_t pos = fRowBegin[row]; pos < fRowBegin[row+1]; ++pos)
+      sum += fValues[pos] * x[fCols[pos]];
+    y[row] = sum;
+  }
+}
@@ -0,0 +1,77 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SPARSEMATRIX_H
+#define SPARSEMATRIX_H
+
+#include "CoreTypes.h"
+#include <vector>
+
+
+// Square sparse matrix in compressed row storage, with a fixed pattern.
+// Used for the (symmetric) normal matrix of the calibration, J^T W J, for
+// which both triangles are stored. The pattern is given as cliques, lists
+// of unknowns which are all coupled to each other (the cells of a sample).
+class SparseMatrix
+{
+public:
+  SparseMatrix();
+
+  void SetPattern(UInt_t n, const std::vector< std::vector<Int_t> >& cliques);
+  // the non zeros of the pattern of cliques, without building it
+  static ULong64_t CountPattern(UInt_t n, const std::vector< std::vector<Int_t> >& cliques);
+  // the union of the pattern with that of another n x n matrix given by
+  // its row begins and (sorted) columns, values are zeroed
+  void MergePattern(const std::vector<UInt_t>& rowBegin, const std::vector<Int_t>& cols);
+
+  UInt_t GetN() const { return fN; }
+  UInt_t GetNNonZero() const { return fCols.size(); }
+  const std::vector<UInt_t>& GetRowBegin() const { return fRowBegin; }
+  const std::vector<Int_t>& GetCols() const { return fCols; }
+  const std::vector<Double_t>& GetValues() const { return fValues; }
+  std::vector<Double_t>& GetValues() { return fValues; }
+
+  // position in GetValues() of (row, col), -1 if not in pattern
+  Long64_t Find(Int_t row, Int_t col) const;
+  Double_t GetDiagonal(Int_t row) const { return fValues[fDiagonal[row]]; }
+
+  void Zero();
+  void Add(Int_t row, Int_t col, Double_t value);
+  // adds w * g g^T for the (sorted, unique) unknowns cols of a clique
+  void AddOuter(const Int_t* cols, const Double_t* g, Int_t n, Double_t w);
+
+  // y = A x
+  void Multiply(const Double_t* x, Double_t* y) const;
+
+private:
+  // the cliques of each row, [n+1] begins and the cliques
+  static void GetRowCliques(UInt_t n, const std::vector< std::vector<Int_t> >& cliques,
+			    std::vector<UInt_t>& rowBegin, std::vector<UInt_t>& rowCliques);
+
+  UInt_t fN;
+  std::vector<UInt_t> fRowBegin; // [fN+1]
+  std::vector<Int_t> fCols; // sorted within row
+  std::vector<Double_t> fValues;
+  std::vector<UInt_t> fDiagonal; // [fN] position of diagonal element
+};
+
+#endif // SPARSEMATRIX_H
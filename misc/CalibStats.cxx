@@ -0,0 +1,165 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "CalibStats.h"
+#include <TCollection.h>
+
+ClassImp(CalibStats)
+
+
+CalibStats::CalibStats ( const char* name, const char* title )
+: TNamed(name, title),
+  fEnabled(kTRUE)
+{
+  Reset();
+}
+
+
+CalibStats::CalibStats ( const CalibStats& other )
+: TNamed(other),
+  fEnabled(other.fEnabled)
+{
+  Reset();
+  Add(other);
+}
+
+
+CalibStats& CalibStats::operator= ( const CalibStats& other )
+{
+  if( this == &other )
+    return *this;
+  TNamed::operator=(other);
+  fEnabled = other.fEnabled;
+  Reset();
+  Add(other);
+  return *this;
+}
+
+
+CalibStats::~CalibStats()
+{
+}
+
+
+void CalibStats::Stop ( Stage stage )
+{
+  if( ! fEnabled )
+    return;
+
+  TStopwatch& watch = fWatch[stage];
+  watch.Stop();
+  fRealTime[stage] += watch.RealTime();
+  fCpuTime[stage] += watch.CpuTime();
+  ++fNCalls[stage];
+}
+
+
+void CalibStats::Add ( const CalibStats& other )
+{
+  for(int stage = 0; stage < kNStages; ++stage) {
+    fRealTime[stage] += other.fRealTime[stage];
+    fCpuTime[stage] += other.fCpuTime[stage];
+    fNCalls[stage] += other.fNCalls[stage];
+  }
+  for(int counter = 0; counter < kNCounters; ++counter)
+    fCounters[counter] += other.fCounters[counter];
+}
+
+
+void CalibStats::Reset()
+{
+  for(int stage = 0; stage < kNStages; ++stage) {
+    fRealTime[stage] = 0;
+    fCpuTime[stage] = 0;
+    fNCalls[stage] = 0;
+  }
+  for(int counter = 0; counter < kNCounters; ++counter)
+    fCounters[counter] = 0;
+}
+
+
+Long64_t CalibStats::Merge ( TCollection* list )
+{
+  // called by TFileMerger/AliAnalysisManager when merging outputs,
+  // returns the number of merged objects (including this).
+  if( ! list )
+    return 1;
+
+  Long64_t nMerged = 1;
+  TIter next(list);
+  while( TObject* obj = next() ) {
+    const CalibStats* other = dynamic_cast<CalibStats*>(obj);
+    if( ! other ) {
+      Error("Merge", "object in list is not CalibStats");
+      continue;
+    }
+    Add(*other);
+    ++nMerged;
+  }
+  return nMerged;
+}
+
+
+void CalibStats::Print ( Option_t* /*option*/ ) const
+{
+  printf("CalibStats.Print, %s\n", GetName());
+  printf("   %-18s %10s %12s %12s\n", "stage", "calls", "real [s]", "cpu [s]");
+  for(int stage = 0; stage < kNStages; ++stage) {
+    if( ! fNCalls[stage] )
+      continue;
+    printf("   %-18s %10lld %12.4f %12.4f\n", GetStageName(Stage(stage)),
+	   fNCalls[stage], fRealTime[stage], fCpuTime[stage]);
+  }
+  for(int counter = 0; counter < kNCounters; ++counter)
+    printf("   %-18s %10lld\n", GetCounterName(Counter(counter)), fCounters[counter]);
+}
+
+
+const char* CalibStats::GetStageName ( Stage stage )
+{
+  switch( stage ) {
+  case kClusterSelection: return "ClusterSelection";
+  case kPairing:          return "Pairing";
+  case kConversion:       return "Conversion";
+  case kTreeFill:         return "TreeFill";
+  case kResidual:         return "Residual";
+  case kJacobian:         return "Jacobian";
+  case kSolve:            return "Solve";
+  case kIO:               return "IO";
+  case kCommunication:    return "Communication";
+  default:                return "unknown";
+  }
+}
+
+
+const char* CalibStats::GetCounterName ( Counter counter )
+{
+  switch( counter ) {
+  case kClusters:      return "Clusters";
+  case kPairs:         return "Pairs";
+  case kRejectedPairs: return "RejectedPairs";
+  case kCellsMapped:   return "CellsMapped";
+  case kSamples:       return "Samples";
+  case kIterations:    return "Iterations";
+  default:             return "unknown";
+  }
+}
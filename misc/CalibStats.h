@@ -0,0 +1,111 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef CALIBSTATS_H
+#define CALIBSTATS_H
+
+#include <TNamed.h>
+#include <TStopwatch.h>
+
+class TCollection;
+
+
+// Stage timers (wall and cpu) and counters for the extraction and the
+// calibration hot paths. Published in the task output list (fHistList) and
+// in the calibrator report. Can be switched off at run time (SetEnabled) or
+// compiled out with -DCALIB_NO_STATS (cmake -DCALIB_STATS=OFF), in which
+// case the CALIB_STATS_* macros expand to nothing.
+class CalibStats : public TNamed
+{
+public:
+  enum Stage {
+    // extraction
+    kClusterSelection,
+    kPairing,
+    kConversion,
+    kTreeFill,
+    // calibration
+    kResidual,
+    kJacobian,
+    kSolve,
+    kIO,
+    kCommunication,
+    kNStages
+  };
+
+  enum Counter {
+    kClusters,
+    kPairs,
+    kRejectedPairs,
+    kCellsMapped,
+    kSamples,
+    kIterations,
+    kNCounters
+  };
+
+  CalibStats(const char* name = "CalibStats", const char* title = "Stage timers and counters");
+  CalibStats(const CalibStats& other);
+  CalibStats& operator= (const CalibStats& other);
+  virtual ~CalibStats();
+
+  void Start(Stage stage) { if( fEnabled ) fWatch[stage].Start(kTRUE); }
+  void Stop(Stage stage);
+  void Count(Counter counter, Long64_t n = 1) { if( fEnabled ) fCounters[counter] += n; }
+
+  Double_t GetRealTime(Stage stage) const { return fRealTime[stage]; }
+  Double_t GetCpuTime(Stage stage) const { return fCpuTime[stage]; }
+  Long64_t GetNCalls(Stage stage) const { return fNCalls[stage]; }
+  Long64_t GetCounter(Counter counter) const { return fCounters[counter]; }
+  Bool_t IsEnabled() const { return fEnabled; }
+  void SetEnabled(Bool_t enabled = kTRUE) { fEnabled = enabled; }
+
+  void Add(const CalibStats& other);
+  void Reset();
+  Long64_t Merge(TCollection* list); // for merging of grid outputs
+  void Print(Option_t* option = "") const;
+
+  static const char* GetStageName(Stage stage);
+  static const char* GetCounterName(Counter counter);
+
+private:
+  Bool_t fEnabled;
+  Double_t fRealTime[kNStages]; // [s] accumulated wall time per stage
+  Double_t fCpuTime[kNStages]; // [s] accumulated cpu time per stage
+  Long64_t fNCalls[kNStages]; // number of Start/Stop pairs per stage
+  Long64_t fCounters[kNCounters];
+  TStopwatch fWatch[kNStages]; //! running stage timers
+
+  ClassDef(CalibStats, 2);
+};
+
+
+#ifdef CALIB_NO_STATS
+#define CALIB_STATS_START(stats, stage)
+#define CALIB_STATS_STOP(stats, stage)
+#define CALIB_STATS_COUNT(stats, counter, n)
+#else
+#define CALIB_STATS_START(stats, stage) do { if( stats ) (stats)->Start(CalibStats::stage); } while(0)
+#define CALIB_STATS_STOP(stats, stage) do { if( stats ) (stats)->Stop(CalibStats::stage); } while(0)
+#define CALIB_STATS_COUNT(stats, counter, n) do { if( stats ) (stats)->Count(CalibStats::counter, n); } while(0)
+#endif
+
+#endif // CALIBSTATS_H
@@ -40,6 +40,7 @@ ClassImp(ExtractorTask)
 #include "TList.h"
 #include "SampleCandidate.h"
 #include <TH2I.h>
+#include <map>
 
 
 
@@ -48,9 +49,17 @@ ExtractorTask::ExtractorTask(const char* name)
   fParameters(NULL),
   fSampleTree(NULL),
   fSample(NULL),
+  fClusterTable(kFALSE),
+  fEvent(NULL),
   fHistList(NULL),
   fCandidatePtMass(NULL),
-  fSelectedPtMass(NULL)
+  fSelectedPtMass(NULL),
+  fStatsEnabled(kTRUE),
+  fStats(NULL),
+  fMinClusterEnergy(0.5),
+  fMinClusterCells(5),
+  fMaxNExMax(1),
+  fFilter(NULL)
 {
   DefineOutput(1, SampleParameters::Class());
   DefineOutput(2, TTree::Class());
@@ -62,8 +71,10 @@ ExtractorTask::~ExtractorTask()
 {
   delete fSampleTree;
   delete fSample;
+  delete fEvent;
   delete fParameters;
   delete fHistList;
+  delete fFilter;
 }
 
 
@@ -86,7 +97,12 @@ void ExtractorTask::UserCreateOutputObjects()
   // *** Initiallize Sample Tree """
   //fSample = new Sample(nGoodCells);
   fSampleTree = new TTree("fSampleTree", "Sample Tree");
-  fSampleTree->Branch("samples", "Sample", &fSample);
+  if( fClusterTable ) {
+    fEvent = new SampleEvent();
+    fSampleTree->Branch("events", "SampleEvent", &fEvent);
+  }
+  else
+    fSampleTree->Branch("samples", "Sample", &fSample);
 
   // *** Histograms ***
   fHistList = new TList;
@@ -97,6 +113,10 @@ void ExtractorTask::UserCreateOutputObjects()
   fSelectedPtMass = new TH2I("fSelectedPtMass", "fSelectedPtMass", 100, 0, 10,   100, 0, 0.5);
   fHistList->Add(fSelectedPtMass);
 
+  fStats = new CalibStats("fStats", "ExtractorTask stage timers and counters");
+  fStats->SetEnabled(fStatsEnabled);
+  fHistList->Add(fStats);
+
   PostData(1, fParameters);
   PostData(2, fSampleTree);
   PostData(3, fHistList);
@@ -122,6 +142,8 @@ void ExtractorTask::UserExec ( Option_t* )
     SetParameters(*fParameters, *esdEvent);
     Int_t nGoodCells = fParameters->GetNGood();
     fSample = new Sample(nGoodCells);
+    if( fFilter )
+      fFilter->SetParameters(fParameters);
   }
 
 
@@ -129,18 +151,74 @@ void ExtractorTask::UserExec ( Option_t* )
   AliESDCaloCells* phosCells = esdEvent->GetPHOSCells();
     
   // Get Clusters
+  CALIB_STATS_START(fStats, kClusterSelection);
   TRefArray* phosClusterArray = new TRefArray( esdEvent->GetNumberOfCaloClusters() /4 );
   esdEvent->GetPHOSClusters(phosClusterArray);
-  std::vector<AliESDCaloCluster*> selectedClusters = SelectClusters(*phosClusterArray);
+  std::vector<AliESDCaloCluster*> selectedClusters = SelectClusters(*phosClusterArray, fMinClusterEnergy, fMinClusterCells, fMaxNExMax);
+  CALIB_STATS_STOP(fStats, kClusterSelection);
+  CALIB_STATS_COUNT(fStats, kClusters, phosClusterArray->GetEntriesFast());
+
+  CALIB_STATS_START(fStats, kPairing);
   std::vector<SampleCandidate> candidates = ExtractCandidates(selectedClusters, vertex);
-  std::vector<SampleCandidate> selected = SelectCandidates(candidates);
+  std::vector<SampleCandidate> selected = SelectCandidates(candidates, fFilter);
+  CALIB_STATS_STOP(fStats, kPairing);
+  CALIB_STATS_COUNT(fStats, kPairs, candidates.size());
+  CALIB_STATS_COUNT(fStats, kRejectedPairs, candidates.size() - selected.size());
+
+
+  // Fill Tree, an event of clusters and pairs
+  const Bool_t cellCuts = fFilter && fFilter->HasCellCuts();
+  UInt_t nCellRejected = 0;
+  if( fClusterTable ) {
+    CALIB_STATS_START(fStats, kConversion);
+    fEvent->Reset();
+    Double_t vtxarr[3];
+    vertex->GetXYZ(vtxarr);
+    fEvent->SetVertex(TVector3(vtxarr[0], vtxarr[1], vtxarr[2]));
+    std::map<const AliESDCaloCluster*, Int_t> clusterIds;
+    UInt_t nMapped = 0;
+    for(UInt_t idx = 0; idx < selected.size(); ++idx) {
+      const AliESDCaloCluster* clusters[2] = {selected[idx].GetCluster1(), selected[idx].GetCluster2()};
+      Int_t ids[2];
+      for(Int_t c = 0; c < 2; ++c) {
+	std::map<const AliESDCaloCluster*, Int_t>::const_iterator it = clusterIds.find(clusters[c]);
+	if( it == clusterIds.end() )
+	  it = clusterIds.insert(std::make_pair(clusters[c], ClusterToEvent(*fEvent, *clusters[c], *phosCells, *fParameters, nMapped))).first;
+	ids[c] = it->second;
+      }
+      if( cellCuts && ! fFilter->PassCells(fEvent->GetCellIndex(ids[0]), fEvent->GetNCells(ids[0]),
+					   fEvent->GetCellIndex(ids[1]), fEvent->GetNCells(ids[1])) ) {
+	++nCellRejected;
+	continue;
+      }
+      fEvent->AddPair(ids[0], ids[1], selected[idx].GetMomentum().M());
+    }
+    CALIB_STATS_STOP(fStats, kConversion);
+    CALIB_STATS_COUNT(fStats, kCellsMapped, nMapped);
+
+    if( fEvent->GetNPairs() ) {
+      CALIB_STATS_START(fStats, kTreeFill);
+      fSampleTree->Fill();
+      CALIB_STATS_STOP(fStats, kTreeFill);
+    }
+  }
 
+  // Fill Tree, a sample per pair
+  for(UInt_t idx = 0; idx < selected.size() && ! fClusterTable; ++idx) {
+    CALIB_STATS_START(fStats, kConversion);
+    const UInt_t nMapped = CandidateToSample(*fSample, selected[idx], *phosCells, *vertex, *fParameters);
+    CALIB_STATS_STOP(fStats, kConversion);
+    CALIB_STATS_COUNT(fStats, kCellsMapped, nMapped);
+    if( cellCuts && ! fFilter->Pass(*fSample) ) {
+      ++nCellRejected;
+      continue;
+    }
 
-  // Fill Tree
-  for(UInt_t idx = 0; idx < selected.size(); ++idx) {
-    CandidateToSample(*fSample, selected[idx], *phosCells, *vertex, *fParameters);
+    CALIB_STATS_START(fStats, kTreeFill);
     fSampleTree->Fill(); // fill fSample to sampletree
+    CALIB_STATS_STOP(fStats, kTreeFill);
   }
+  CALIB_STATS_COUNT(fStats, kRejectedPairs, nCellRejected);
 
   PostData(1, fParameters);
   PostData(2, fSampleTree);
@@ -154,12 +232,17 @@ void ExtractorTask::Terminate ( Option_t* )
   fCandidatePtMass->DrawCopy();
   new TCanvas;
   fSelectedPtMass->DrawCopy();
+
+  TList* histList = dynamic_cast<TList*>(GetOutputData(3));
+  const CalibStats* stats = histList ? dynamic_cast<CalibStats*>(histList->FindObject("fStats")) : NULL;
+  if( stats )
+    stats->Print();
   return; //TODO: write ExtractorTask::Terminate
 }
 
 
 
-std::vector< AliESDCaloCluster* > ExtractorTask::SelectClusters ( const TRefArray& clusters )
+std::vector< AliESDCaloCluster* > ExtractorTask::SelectClusters ( const TRefArray& clusters, Float_t minEnergy, Int_t minCells, Int_t maxNExMax )
 {
   std::vector<AliESDCaloCluster*> selected;
   for(int idx = 0; idx < clusters.GetEntriesFast(); ++idx){
@@ -168,11 +251,11 @@ std::vector< AliESDCaloCluster* > ExtractorTask::SelectClusters ( const TRefArra
       Printf(" ERROR: ExtractorTask::SelectClusters, clusters argument in function had entry which did not cast to AliESDCaloCluster");
       continue;
     }
-    if( cluster->E() < 0.5 )
+    if( cluster->E() < minEnergy )
       continue;
-    if( cluster->GetNCells() < 5 )
+    if( cluster->GetNCells() < minCells )
       continue;
-    if( cluster->GetNExMax() > 1 )
+    if( cluster->GetNExMax() > maxNExMax )
       continue;
 
     selected.push_back(cluster);
@@ -195,18 +278,50 @@ std::vector< SampleCandidate > ExtractorTask::ExtractCandidates
 }
 
 
-std::vector< SampleCandidate > ExtractorTask::SelectCandidates ( const std::vector< SampleCandidate >& candidates )
+std::vector< SampleCandidate > ExtractorTask::SelectCandidates ( const std::vector< SampleCandidate >& candidates, const SampleFilter* filter )
 {
+  // the scalar cuts of filter, the cell cuts need the extracted cells
   std::vector< SampleCandidate > selected;
   for(unsigned int idx = 0; idx < candidates.size(); ++idx) {
-    selected.push_back(candidates[idx]);
+    const SampleCandidate& candidate = candidates[idx];
+    if( filter && ! filter->PassScalars(candidate.GetMomentum().M(), candidate.GetCluster1()->E(),
+					candidate.GetCluster2()->E(), candidate.GetVertex()->GetZ()) )
+      continue;
+    selected.push_back(candidate);
   }
   return selected;
 }
 
 
-void ExtractorTask::CandidateToSample ( Sample& toSample, const SampleCandidate& candidate, const AliESDCaloCells& phosCells, const AliESDVertex& vertex, const SampleParameters& params)
+void ExtractorTask::SetClusterCuts ( Float_t minEnergy, Int_t minCells, Int_t maxNExMax )
+{
+  fMinClusterEnergy = minEnergy;
+  fMinClusterCells = minCells;
+  fMaxNExMax = maxNExMax;
+}
+
+
+void ExtractorTask::SetFilter ( const SampleFilter& filter )
+{
+  delete fFilter;
+  fFilter = new SampleFilter(filter);
+  fFilter->SetParameters(fParameters);
+}
+
+
+void ExtractorTask::SetStatsEnabled ( Bool_t enabled )
 {
+  fStatsEnabled = enabled;
+  if( fStats )
+    fStats->SetEnabled(enabled);
+}
+
+
+UInt_t ExtractorTask::CandidateToSample ( Sample& toSample, const SampleCandidate& candidate, const AliESDCaloCells& phosCells, const AliESDVertex& vertex, const SampleParameters& params)
+{
+  // returns the number of cluster cells mapped to good channel indices.
+  UInt_t nMapped = 0;
+
   // Set Vertex
   Double_t vtxarr[3];
   vertex.GetXYZ(vtxarr);
@@ -215,7 +330,7 @@ void ExtractorTask::CandidateToSample ( Sample& toSample, const SampleCandidate&
 
 
   // Set Cluster 1 paramters
-  toSample.SetEnergy1(candidate.GetMomentum().E());
+  toSample.SetEnergy1(candidate.GetCluster1()->E());
   toSample.SetMass(candidate.GetMomentum().M());
 
   const AliESDCaloCluster* cluster1 = candidate.GetCluster1();
@@ -230,13 +345,16 @@ void ExtractorTask::CandidateToSample ( Sample& toSample, const SampleCandidate&
     const UInt_t phosID = cluster1->GetCellAbsId(idx);
     const Double32_t fraction = cluster1->GetCellAmplitudeFraction(idx);
     const Double32_t amplitude =  phosCells.GetAmplitude(phosID) * fraction;
-    const UInt_t index = params.FindIndex(phosID); // index of sample coordinate system.
+    const Int_t index = params.FindIndex(phosID); // index of sample coordinate system.
+    if( index < 0 ) // bad channel
+      continue;
     toSample.Amplitude1()[index] = amplitude;
+    ++nMapped;
   }
 
 
   // Set Cluster 2 paramters
-  toSample.SetEnergy2(candidate.GetMomentum().E());
+  toSample.SetEnergy2(candidate.GetCluster2()->E());
 
   const AliESDCaloCluster* cluster2 = candidate.GetCluster2();
   const Float_t pos2[3] = {0};
@@ -250,9 +368,35 @@ void ExtractorTask::CandidateToSample ( Sample& toSample, const SampleCandidate&
     const UInt_t phosID = cluster2->GetCellAbsId(idx);
     const Double32_t fraction = cluster2->GetCellAmplitudeFraction(idx);
     const Double32_t amplitude =  phosCells.GetAmplitude(phosID) * fraction;
-    const UInt_t index = params.FindIndex(phosID); // index of sample coordinate system.
+    const Int_t index = params.FindIndex(phosID); // index of sample coordinate system.
+    if( index < 0 ) // bad channel
+      continue;
     toSample.Amplitude2()[index] = amplitude;
+    ++nMapped;
   }
+
+  return nMapped;
+}
+
+
+Int_t ExtractorTask::ClusterToEvent ( SampleEvent& event, const AliESDCaloCluster& cluster, const AliESDCaloCells& phosCells, const SampleParameters& params, UInt_t& nMapped )
+{
+  // adds the cluster to the cluster table of event, returns its id.
+  std::vector<Int_t> index;
+  std::vector<Float_t> amp;
+  for(Int_t idx = 0; idx < cluster.GetNCells(); ++idx) {
+    const UInt_t phosID = cluster.GetCellAbsId(idx);
+    const Int_t goodIndex = params.FindIndex(phosID); // index of sample coordinate system.
+    if( goodIndex < 0 ) // bad channel
+      continue;
+    index.push_back(goodIndex);
+    amp.push_back(phosCells.GetAmplitude(phosID) * cluster.GetCellAmplitudeFraction(idx));
+  }
+  nMapped += index.size();
+
+  Float_t pos[3] = {0};
+  cluster.GetPosition(pos);
+  return event.AddCluster(index.empty() ? NULL : &index[0], amp.empty() ? NULL : &amp[0], index.size(), cluster.E(), TVector3(pos));
 }
 
 
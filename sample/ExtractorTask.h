@@ -34,6 +34,9 @@
 #include <AliESDCaloCluster.h>
 #include <TRef.h>
 #include "SampleCandidate.h"
+#include "CalibStats.h"
+#include "SampleEvent.h"
+#include "SampleFilter.h"
 
 class AliESDCaloCells;
 class AliESDVertex;
@@ -54,10 +57,24 @@ public:
     virtual void UserExec(Option_t * );
     virtual void Terminate(Option_t * );    
 
-    static std::vector<AliESDCaloCluster*> SelectClusters(const TRefArray& clusters);
+    void SetStatsEnabled(Bool_t enabled = kTRUE);
+    // one SampleEvent per event (branch "events"), each cluster stored once,
+    // instead of a Sample per pair (branch "samples")
+    void SetClusterTable(Bool_t enabled = kTRUE) { fClusterTable = enabled; }
+    const CalibStats* GetStats() const { return fStats; }
+
+    // clusters of at least minEnergy and minCells, and at most maxNExMax
+    // local maxima (defaults 0.5 GeV, 5, 1)
+    void SetClusterCuts(Float_t minEnergy, Int_t minCells, Int_t maxNExMax);
+    // cuts on the pairs; the scalar cuts are applied to the candidates, the
+    // cell cuts to the extracted clusters. Not streamed.
+    void SetFilter(const SampleFilter& filter);
+
+    static std::vector<AliESDCaloCluster*> SelectClusters(const TRefArray& clusters, Float_t minEnergy = 0.5, Int_t minCells = 5, Int_t maxNExMax = 1);
     static std::vector<SampleCandidate> ExtractCandidates(const std::vector<AliESDCaloCluster*>& selectedClusters, AliESDVertex* vtx );
-    static std::vector<SampleCandidate> SelectCandidates(const std::vector<SampleCandidate>& candidates);
-    static void CandidateToSample(Sample& toSample, const SampleCandidate& candidate, const AliESDCaloCells& phosCells, const AliESDVertex& vtx, const SampleParameters& params);
+    static std::vector<SampleCandidate> SelectCandidates(const std::vector<SampleCandidate>& candidates, const SampleFilter* filter = NULL);
+    static UInt_t CandidateToSample(Sample& toSample, const SampleCandidate& candidate, const AliESDCaloCells& phosCells, const AliESDVertex& vtx, const SampleParameters& params);
+    static Int_t ClusterToEvent(SampleEvent& event, const AliESDCaloCluster& cluster, const AliESDCaloCells& phosCells, const SampleParameters& params, UInt_t& nMapped);
     
     
 private:
@@ -76,12 +93,23 @@ private:
     SampleParameters* fParameters;
     TTree* fSampleTree;
     Sample* fSample;
+    Bool_t fClusterTable;
+    SampleEvent* fEvent;
     TList* fHistList;
 
     TH2I* fCandidatePtMass;
     TH2I* fSelectedPtMass;
+
+    Bool_t fStatsEnabled;
+    CalibStats* fStats; // stage timers and counters, owned by fHistList
+
+    // cuts
+    Float_t fMinClusterEnergy;
+    Int_t fMinClusterCells;
+    Int_t fMaxNExMax;
+    SampleFilter* fFilter; //!
     
-    ClassDef(ExtractorTask, 1);
+    ClassDef(ExtractorTask, 4);
 };
 
 #endif // EXTRACTOR_H
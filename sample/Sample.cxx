@@ -22,6 +22,8 @@
 
 #include "Sample.h"
 #include "TArrayF.h"
+#include "CoreSampleSet.h"
+#include <vector>
 
 ClassImp(Sample)
 
@@ -43,3 +45,42 @@ Sample::~Sample()
 {
 }
 
+
+void Sample::GetCore ( CoreSampleSet& set ) const
+{
+  std::vector<CoreCell> cells;
+  Int_t clusters[2];
+  for(Int_t cluster = 0; cluster < 2; ++cluster) {
+    const TArrayF& amplitudes = cluster ? fAmplitudes2 : fAmplitudes1;
+    cells.clear();
+    for(Int_t idx = 0; idx < amplitudes.GetSize(); ++idx) {
+      if( amplitudes[idx] <= 0 )
+	continue;
+      const CoreCell cell = {idx, amplitudes[idx]};
+      cells.push_back(cell);
+    }
+    clusters[cluster] = set.AddCluster(cells.empty() ? NULL : &cells[0], cells.size());
+  }
+  Double_t vertex[3];
+  fVertex.GetXYZ(vertex);
+  set.AddSample(clusters[0], clusters[1], vertex);
+}
+
+
+void Sample::SetCore ( const CoreSampleSet& set, UInt_t sample )
+{
+  const CoreSample& pair = set.GetSample(sample);
+  fVertex.SetXYZ(pair.fVertex[0], pair.fVertex[1], pair.fVertex[2]);
+  for(Int_t cluster = 0; cluster < 2; ++cluster) {
+    TArrayF& amplitudes = cluster ? fAmplitudes2 : fAmplitudes1;
+    amplitudes.Reset();
+    const CoreCell* cells = set.GetCells(pair.fCluster[cluster]);
+    for(Int_t cell = 0; cell < set.GetNCells(pair.fCluster[cluster]); ++cell) {
+      if( cells[cell].fIndex < 0 || cells[cell].fIndex >= amplitudes.GetSize() ) {
+	Error("SetCore", "cell %d beyond the %d amplitudes of the sample", cells[cell].fIndex, amplitudes.GetSize());
+	continue;
+      }
+      amplitudes[cells[cell].fIndex] = cells[cell].fAmp;
+    }
+  }
+}
@@ -29,6 +29,8 @@
 #include <vector>
 #include <TArrayF.h>
 
+class CoreSampleSet;
+
 
 class Sample : public TObject
 {
@@ -67,6 +69,13 @@ public:
   TArrayF& Amplitude2() {return fAmplitudes2; }
 
 
+  // *** Plain values, of the calibration core (libCalibCore) ***
+  // appends the clusters (the cells of non zero amplitude) and the pair
+  void GetCore(CoreSampleSet& set) const;
+  // the amplitudes and vertex of sample of set, into amplitudes sized beforehand
+  void SetCore(const CoreSampleSet& set, UInt_t sample);
+
+
 private:
   Sample(const Sample& other); // Not implemted, declared for suppression of warnings
   Sample& operator=(const Sample& other); // Not implemted, declared for suppression of warnings
@@ -0,0 +1,264 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SampleBatch.h"
+#include "Sample.h"
+#include "SampleEvent.h"
+
+
+SampleBatch::SampleBatch()
+: fArena(0),
+  fCapacity(0),
+  fCellCapacity(0),
+  fNSamples(0),
+  fNCells(0),
+  fCellBegin(0),
+  fCellIndex(0),
+  fCellAmp(0)
+{
+  for(Int_t dim = 0; dim < 3; ++dim)
+    fVertex[dim] = 0;
+  for(Int_t field = 0; field < kNFields; ++field)
+    fField[field] = 0;
+}
+
+
+SampleBatch::SampleBatch ( UInt_t capacity, UInt_t cellCapacity )
+: fArena(0),
+  fCapacity(capacity),
+  fCellCapacity(cellCapacity),
+  fNSamples(0),
+  fNCells(0),
+  fCellBegin(0),
+  fCellIndex(0),
+  fCellAmp(0)
+{
+  // the 8 byte arrays first, then the 4 byte arrays
+  const ULong64_t bytes = 3*sizeof(Double_t)*ULong64_t(capacity)
+    + kNFields*sizeof(Float_t)*ULong64_t(capacity)
+    + sizeof(UInt_t)*(2*ULong64_t(capacity) + 1)
+    + (sizeof(Int_t) + sizeof(Float_t))*ULong64_t(cellCapacity);
+  fArena = new Double_t[(bytes + sizeof(Double_t) - 1) / sizeof(Double_t)];
+
+  Double_t* doubles = fArena;
+  for(Int_t dim = 0; dim < 3; ++dim, doubles += capacity)
+    fVertex[dim] = doubles;
+  Float_t* floats = reinterpret_cast<Float_t*>(doubles);
+  for(Int_t field = 0; field < kNFields; ++field, floats += capacity)
+    fField[field] = floats;
+  fCellBegin = reinterpret_cast<UInt_t*>(floats);
+  fCellIndex = reinterpret_cast<Int_t*>(fCellBegin + 2*capacity + 1);
+  fCellAmp = reinterpret_cast<Float_t*>(fCellIndex + cellCapacity);
+  fCellBegin[0] = 0;
+}
+
+
+#ifdef SAMPLEBATCH_MOVE
+SampleBatch::SampleBatch ( SampleBatch&& other )
+: fArena(0),
+  fCapacity(0),
+  fCellCapacity(0),
+  fNSamples(0),
+  fNCells(0),
+  fCellBegin(0),
+  fCellIndex(0),
+  fCellAmp(0)
+{
+  Take(other);
+}
+
+
+SampleBatch& SampleBatch::operator= ( SampleBatch&& other )
+{
+  if( this != &other ) {
+    delete [] fArena;
+    Take(other);
+  }
+  return *this;
+}
+#endif
+
+
+SampleBatch::~SampleBatch()
+{
+  delete [] fArena;
+}
+
+
+Int_t SampleBatch::Add ( const Double_t vertex[3], Float_t mass,
+			 Float_t energy1, const Float_t position1[3], const Int_t* index1, const Float_t* amp1, Int_t nCells1,
+			 Float_t energy2, const Float_t position2[3], const Int_t* index2, const Float_t* amp2, Int_t nCells2 )
+{
+  if( IsFull() || fNCells + nCells1 + nCells2 > fCellCapacity )
+    return -1;
+
+  const UInt_t sample = fNSamples;
+  for(Int_t dim = 0; dim < 3; ++dim) {
+    fVertex[dim][sample] = vertex[dim];
+    fField[kPosition1X + dim][sample] = position1[dim];
+    fField[kPosition2X + dim][sample] = position2[dim];
+  }
+  fField[kMass][sample] = mass;
+  fField[kEnergy1][sample] = energy1;
+  fField[kEnergy2][sample] = energy2;
+  AddCluster(0, index1, amp1, nCells1);
+  AddCluster(1, index2, amp2, nCells2);
+  return fNSamples++;
+}
+
+
+Int_t SampleBatch::Add ( const Sample& sample )
+{
+  if( IsFull() )
+    return -1;
+
+  // cells of the dense amplitudes straight into the buffer
+  const UInt_t nCells = fNCells;
+  if( ! AddCluster(0, sample.Amplitudes1()) || ! AddCluster(1, sample.Amplitudes2()) ) {
+    fNCells = nCells;
+    return -1;
+  }
+
+  const UInt_t index = fNSamples;
+  Double_t vertex[3], position1[3], position2[3];
+  sample.GetVertex().GetXYZ(vertex);
+  sample.GetPostion1().GetXYZ(position1);
+  sample.GetPostion2().GetXYZ(position2);
+  for(Int_t dim = 0; dim < 3; ++dim) {
+    fVertex[dim][index] = vertex[dim];
+    fField[kPosition1X + dim][index] = position1[dim];
+    fField[kPosition2X + dim][index] = position2[dim];
+  }
+  fField[kMass][index] = sample.GetMass();
+  fField[kEnergy1][index] = sample.GetEnergy1();
+  fField[kEnergy2][index] = sample.GetEnergy2();
+  return fNSamples++;
+}
+
+
+Int_t SampleBatch::Add ( const SampleEvent& event, Int_t pair )
+{
+  const Int_t cluster1 = event.GetCluster1(pair);
+  const Int_t cluster2 = event.GetCluster2(pair);
+  const Double_t vertex[3] = {event.GetVertex().X(), event.GetVertex().Y(), event.GetVertex().Z()};
+  const TVector3 position1 = event.GetPosition(cluster1);
+  const TVector3 position2 = event.GetPosition(cluster2);
+  const Float_t pos1[3] = {Float_t(position1.X()), Float_t(position1.Y()), Float_t(position1.Z())};
+  const Float_t pos2[3] = {Float_t(position2.X()), Float_t(position2.Y()), Float_t(position2.Z())};
+  return Add(vertex, event.GetMass(pair),
+	     event.GetEnergy(cluster1), pos1, event.GetCellIndex(cluster1), event.GetCellAmp(cluster1), event.GetNCells(cluster1),
+	     event.GetEnergy(cluster2), pos2, event.GetCellIndex(cluster2), event.GetCellAmp(cluster2), event.GetNCells(cluster2));
+}
+
+
+void SampleBatch::GetVertex ( UInt_t sample, Double_t vertex[3] ) const
+{
+  for(Int_t dim = 0; dim < 3; ++dim)
+    vertex[dim] = fVertex[dim][sample];
+}
+
+
+TVector3 SampleBatch::GetPosition ( UInt_t sample, Int_t cluster ) const
+{
+  const Int_t first = cluster ? kPosition2X : kPosition1X;
+  return TVector3(fField[first][sample], fField[first+1][sample], fField[first+2][sample]);
+}
+
+
+void SampleBatch::FillSample ( UInt_t sample, Sample& out ) const
+{
+  Double_t vertex[3];
+  GetVertex(sample, vertex);
+  out.SetVertex(TVector3(vertex));
+  out.SetMass(GetMass(sample));
+
+  out.SetEnergy1(GetEnergy(sample, 0));
+  out.SetPostion1(GetPosition(sample, 0));
+  out.Amplitude1().Reset();
+  for(Int_t idx = 0; idx < GetNCells(sample, 0); ++idx)
+    out.Amplitude1()[GetCellIndex(sample, 0)[idx]] = GetCellAmp(sample, 0)[idx];
+
+  out.SetEnergy2(GetEnergy(sample, 1));
+  out.SetPostion2(GetPosition(sample, 1));
+  out.Amplitude2().Reset();
+  for(Int_t idx = 0; idx < GetNCells(sample, 1); ++idx)
+    out.Amplitude2()[GetCellIndex(sample, 1)[idx]] = GetCellAmp(sample, 1)[idx];
+}
+
+
+void SampleBatch::Take ( SampleBatch& other )
+{
+  fArena = other.fArena;
+  fCapacity = other.fCapacity;
+  fCellCapacity = other.fCellCapacity;
+  fNSamples = other.fNSamples;
+  fNCells = other.fNCells;
+  for(Int_t dim = 0; dim < 3; ++dim)
+    fVertex[dim] = other.fVertex[dim];
+  for(Int_t field = 0; field < kNFields; ++field)
+    fField[field] = other.fField[field];
+  fCellBegin = other.fCellBegin;
+  fCellIndex = other.fCellIndex;
+  fCellAmp = other.fCellAmp;
+
+  // other is left empty, of no capacity
+  other.fArena = 0;
+  other.fCapacity = 0;
+  other.fCellCapacity = 0;
+  other.fNSamples = 0;
+  other.fNCells = 0;
+  other.fCellBegin = 0;
+  other.fCellIndex = 0;
+  other.fCellAmp = 0;
+}
+
+
+Bool_t SampleBatch::AddCluster ( Int_t cluster, const Int_t* index, const Float_t* amp, Int_t nCells )
+{
+  if( fNCells + nCells > fCellCapacity )
+    return kFALSE;
+  for(Int_t idx = 0; idx < nCells; ++idx) {
+    fCellIndex[fNCells + idx] = index[idx];
+    fCellAmp[fNCells + idx] = amp[idx];
+  }
+  fNCells += nCells;
+  fCellBegin[2*fNSamples + cluster + 1] = fNCells;
+  return kTRUE;
+}
+
+
+Bool_t SampleBatch::AddCluster ( Int_t cluster, const TArrayF& amplitudes )
+{
+  // the cells of the dense amplitudes, as Calibrator::GetCells
+  const Float_t* array = amplitudes.GetArray();
+  for(Int_t idx = 0; idx < amplitudes.GetSize(); ++idx) {
+    if( array[idx] <= 0 )
+      continue;
+    if( fNCells == fCellCapacity )
+      return kFALSE;
+    fCellIndex[fNCells] = idx;
+    fCellAmp[fNCells] = array[idx];
+    ++fNCells;
+  }
+  fCellBegin[2*fNSamples + cluster + 1] = fNCells;
+  return kTRUE;
+}
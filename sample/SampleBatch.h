@@ -0,0 +1,118 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SAMPLEBATCH_H
+#define SAMPLEBATCH_H
+
+#include <Rtypes.h>
+#include <TVector3.h>
+
+class Sample;
+class SampleEvent;
+class TArrayF;
+
+// move semantics where the compiler has them (not in CINT, nor in ACLiC
+// without -std=c++0x)
+#if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
+#define SAMPLEBATCH_MOVE
+#endif
+
+
+// A fixed capacity batch of samples in one arena allocation. The scalar
+// fields are stored as arrays of the batch (structure of arrays), and the
+// cells of all clusters, as good channel indices and amplitudes, in one
+// shared buffer. Filling a batch does not allocate, and Reset empties it
+// in constant time, so a reader can recycle its batches.
+//
+// Batches are moved, not copied.
+class SampleBatch
+{
+public:
+  enum Field { kMass, kEnergy1, kEnergy2,
+	       kPosition1X, kPosition1Y, kPosition1Z,
+	       kPosition2X, kPosition2Y, kPosition2Z,
+	       kNFields };
+
+  SampleBatch();
+  SampleBatch(UInt_t capacity, UInt_t cellCapacity);
+#ifdef SAMPLEBATCH_MOVE
+  SampleBatch(SampleBatch&& other);
+  SampleBatch& operator= (SampleBatch&& other);
+#endif
+  ~SampleBatch();
+
+  // empties the batch, keeps the arena
+  void Reset() { fNSamples = 0; fNCells = 0; }
+
+  UInt_t GetCapacity() const { return fCapacity; }
+  UInt_t GetCellCapacity() const { return fCellCapacity; }
+  UInt_t GetNSamples() const { return fNSamples; }
+  UInt_t GetNCellEntries() const { return fNCells; }
+  Bool_t IsFull() const { return fNSamples == fCapacity; }
+
+  // index of the added sample, -1 if it does not fit in the batch
+  Int_t Add(const Double_t vertex[3], Float_t mass,
+	    Float_t energy1, const Float_t position1[3], const Int_t* index1, const Float_t* amp1, Int_t nCells1,
+	    Float_t energy2, const Float_t position2[3], const Int_t* index2, const Float_t* amp2, Int_t nCells2);
+  Int_t Add(const Sample& sample);
+  Int_t Add(const SampleEvent& event, Int_t pair);
+  // removes the last sample added, nothing if the batch is empty
+  void PopBack() { if( fNSamples ) { --fNSamples; fNCells = fCellBegin[2*fNSamples]; } }
+
+  // *** Samples ***
+  // the field of all samples, [capacity]
+  const Float_t* GetField(Field field) const { return fField[field]; }
+  Float_t GetMass(UInt_t sample) const { return fField[kMass][sample]; }
+  void GetVertex(UInt_t sample, Double_t vertex[3]) const;
+  // cluster 0 or 1 of sample
+  Float_t GetEnergy(UInt_t sample, Int_t cluster) const { return fField[kEnergy1 + cluster][sample]; }
+  TVector3 GetPosition(UInt_t sample, Int_t cluster) const;
+  Int_t GetNCells(UInt_t sample, Int_t cluster) const { return fCellBegin[2*sample+cluster+1] - fCellBegin[2*sample+cluster]; }
+  const Int_t* GetCellIndex(UInt_t sample, Int_t cluster) const { return fCellIndex + fCellBegin[2*sample+cluster]; }
+  const Float_t* GetCellAmp(UInt_t sample, Int_t cluster) const { return fCellAmp + fCellBegin[2*sample+cluster]; }
+
+  // the sample as a Sample, of size nGood
+  void FillSample(UInt_t sample, Sample& out) const;
+
+private:
+  SampleBatch(const SampleBatch&); // Not Implemented
+  SampleBatch& operator= (const SampleBatch&); // Not Implemented
+
+  void Take(SampleBatch& other);
+  // cells of cluster 0 or 1 of the next sample, kFALSE if out of room
+  Bool_t AddCluster(Int_t cluster, const Int_t* index, const Float_t* amp, Int_t nCells);
+  Bool_t AddCluster(Int_t cluster, const TArrayF& amplitudes);
+
+  Double_t* fArena; // the one allocation, holds all of the below
+  UInt_t fCapacity;
+  UInt_t fCellCapacity;
+  UInt_t fNSamples;
+  UInt_t fNCells;
+
+  Double_t* fVertex[3]; // [capacity]
+  Float_t* fField[kNFields]; // [capacity]
+  UInt_t* fCellBegin; // [2*capacity+1] first cell of cluster, 2*sample+cluster
+  Int_t* fCellIndex; // [cellCapacity]
+  Float_t* fCellAmp; // [cellCapacity]
+};
+
+#endif // SAMPLEBATCH_H
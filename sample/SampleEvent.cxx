@@ -0,0 +1,109 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SampleEvent.h"
+#include "Sample.h"
+
+ClassImp(SampleEvent)
+
+
+SampleEvent::SampleEvent()
+: TObject(),
+  fVertex(0, 0, 0),
+  fClusterBegin(1, 0),
+  fClusterEnergy(),
+  fClusterPosition(),
+  fCellIndex(),
+  fCellAmp(),
+  fPairCluster1(),
+  fPairCluster2(),
+  fPairMass()
+{
+}
+
+
+SampleEvent::~SampleEvent()
+{
+}
+
+
+void SampleEvent::Reset()
+{
+  fVertex.SetXYZ(0, 0, 0);
+  fClusterBegin.resize(1);
+  fClusterEnergy.clear();
+  fClusterPosition.clear();
+  fCellIndex.clear();
+  fCellAmp.clear();
+  fPairCluster1.clear();
+  fPairCluster2.clear();
+  fPairMass.clear();
+}
+
+
+Int_t SampleEvent::AddCluster ( const Int_t* index, const Float_t* amp, Int_t nCells, Float_t energy, const TVector3& position )
+{
+  fCellIndex.insert(fCellIndex.end(), index, index + nCells);
+  fCellAmp.insert(fCellAmp.end(), amp, amp + nCells);
+  fClusterBegin.push_back(fCellIndex.size());
+  fClusterEnergy.push_back(energy);
+  fClusterPosition.push_back(position.X());
+  fClusterPosition.push_back(position.Y());
+  fClusterPosition.push_back(position.Z());
+  return fClusterEnergy.size() - 1;
+}
+
+
+TVector3 SampleEvent::GetPosition ( Int_t cluster ) const
+{
+  return TVector3(fClusterPosition[3*cluster], fClusterPosition[3*cluster+1], fClusterPosition[3*cluster+2]);
+}
+
+
+Int_t SampleEvent::AddPair ( Int_t cluster1, Int_t cluster2, Float_t mass )
+{
+  fPairCluster1.push_back(cluster1);
+  fPairCluster2.push_back(cluster2);
+  fPairMass.push_back(mass);
+  return fPairMass.size() - 1;
+}
+
+
+void SampleEvent::FillSample ( Int_t pair, Sample& sample ) const
+{
+  const Int_t cluster1 = fPairCluster1[pair];
+  const Int_t cluster2 = fPairCluster2[pair];
+  sample.SetVertex(fVertex);
+  sample.SetMass(fPairMass[pair]);
+
+  sample.SetEnergy1(fClusterEnergy[cluster1]);
+  sample.SetPostion1(GetPosition(cluster1));
+  sample.Amplitude1().Reset();
+  for(Int_t idx = 0; idx < GetNCells(cluster1); ++idx)
+    sample.Amplitude1()[GetCellIndex(cluster1)[idx]] = GetCellAmp(cluster1)[idx];
+
+  sample.SetEnergy2(fClusterEnergy[cluster2]);
+  sample.SetPostion2(GetPosition(cluster2));
+  sample.Amplitude2().Reset();
+  for(Int_t idx = 0; idx < GetNCells(cluster2); ++idx)
+    sample.Amplitude2()[GetCellIndex(cluster2)[idx]] = GetCellAmp(cluster2)[idx];
+}
@@ -0,0 +1,87 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SAMPLEEVENT_H
+#define SAMPLEEVENT_H
+
+#include <TObject.h>
+#include <TVector3.h>
+#include <vector>
+
+class Sample;
+
+
+// The samples of an event as a table of its clusters and pairs of cluster
+// ids. Each cluster is stored once, with its cells as good channel indices
+// and amplitudes, however many pairs it is part of, rather than as the
+// dense amplitude arrays of a Sample per pair.
+class SampleEvent : public TObject
+{
+public:
+  SampleEvent();
+  virtual ~SampleEvent();
+
+  // empties the event, keeps the allocated storage
+  void Reset();
+
+  const TVector3& GetVertex() const { return fVertex; }
+  void SetVertex(const TVector3& vertex) { fVertex = vertex; }
+
+  // *** Clusters ***
+  Int_t AddCluster(const Int_t* index, const Float_t* amp, Int_t nCells, Float_t energy, const TVector3& position);
+  Int_t GetNClusters() const { return fClusterEnergy.size(); }
+  Int_t GetNCells(Int_t cluster) const { return fClusterBegin[cluster+1] - fClusterBegin[cluster]; }
+  const Int_t* GetCellIndex(Int_t cluster) const { return &fCellIndex[fClusterBegin[cluster]]; }
+  const Float_t* GetCellAmp(Int_t cluster) const { return &fCellAmp[fClusterBegin[cluster]]; }
+  Float_t GetEnergy(Int_t cluster) const { return fClusterEnergy[cluster]; }
+  TVector3 GetPosition(Int_t cluster) const;
+
+  // *** Pairs ***
+  Int_t AddPair(Int_t cluster1, Int_t cluster2, Float_t mass);
+  Int_t GetNPairs() const { return fPairMass.size(); }
+  Int_t GetCluster1(Int_t pair) const { return fPairCluster1[pair]; }
+  Int_t GetCluster2(Int_t pair) const { return fPairCluster2[pair]; }
+  Float_t GetMass(Int_t pair) const { return fPairMass[pair]; }
+
+  // the pair as a Sample, of size nGood
+  void FillSample(Int_t pair, Sample& sample) const;
+
+private:
+  SampleEvent(const SampleEvent&); // Not Implemented
+  SampleEvent& operator= (const SampleEvent&); // Not Implemented
+
+  TVector3 fVertex;
+
+  std::vector<Int_t> fClusterBegin; // [nClusters+1] first cell of cluster
+  std::vector<Float_t> fClusterEnergy; // [nClusters]
+  std::vector<Float_t> fClusterPosition; // [3*nClusters] global position
+  std::vector<Int_t> fCellIndex; // good channel index of cell
+  std::vector<Float_t> fCellAmp;
+
+  std::vector<Int_t> fPairCluster1; // [nPairs]
+  std::vector<Int_t> fPairCluster2; // [nPairs]
+  std::vector<Float_t> fPairMass; // [nPairs]
+
+  ClassDef(SampleEvent, 1);
+};
+
+#endif // SAMPLEEVENT_H
@@ -0,0 +1,248 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SampleFilter.h"
+#include "Sample.h"
+#include "SampleEvent.h"
+#include "SampleBatch.h"
+#include "SampleParameters.h"
+#include "GeometryCache.h"
+#include <TError.h>
+#include <TMath.h>
+#include <algorithm>
+#include <limits>
+
+
+namespace {
+  const Double_t kInfinity = std::numeric_limits<Double_t>::infinity();
+}
+
+
+SampleFilter::SampleFilter ( const SampleParameters* params )
+: fParameters(params),
+  fMinMass(0),
+  fMaxMass(0),
+  fMinEnergy(0),
+  fMaxAsymmetry(0),
+  fMinVertexZ(0),
+  fMaxVertexZ(0),
+  fMinCells(0),
+  fModules(),
+  fCellSet(),
+  fExcludeCellSet(kFALSE)
+{
+  Clear();
+}
+
+
+SampleFilter::SampleFilter ( const SampleFilter& other )
+: fParameters(other.fParameters),
+  fMinMass(other.fMinMass),
+  fMaxMass(other.fMaxMass),
+  fMinEnergy(other.fMinEnergy),
+  fMaxAsymmetry(other.fMaxAsymmetry),
+  fMinVertexZ(other.fMinVertexZ),
+  fMaxVertexZ(other.fMaxVertexZ),
+  fMinCells(other.fMinCells),
+  fModules(other.fModules),
+  fCellSet(other.fCellSet),
+  fExcludeCellSet(other.fExcludeCellSet)
+{
+}
+
+
+SampleFilter& SampleFilter::operator= ( const SampleFilter& other )
+{
+  fParameters = other.fParameters;
+  fMinMass = other.fMinMass;
+  fMaxMass = other.fMaxMass;
+  fMinEnergy = other.fMinEnergy;
+  fMaxAsymmetry = other.fMaxAsymmetry;
+  fMinVertexZ = other.fMinVertexZ;
+  fMaxVertexZ = other.fMaxVertexZ;
+  fMinCells = other.fMinCells;
+  fModules = other.fModules;
+  fCellSet = other.fCellSet;
+  fExcludeCellSet = other.fExcludeCellSet;
+  return *this;
+}
+
+
+SampleFilter& SampleFilter::MassWindow ( Double_t min, Double_t max )
+{
+  fMinMass = min;
+  fMaxMass = max;
+  return *this;
+}
+
+
+SampleFilter& SampleFilter::MinEnergy ( Double_t min )
+{
+  fMinEnergy = min;
+  return *this;
+}
+
+
+SampleFilter& SampleFilter::MaxAsymmetry ( Double_t max )
+{
+  fMaxAsymmetry = max;
+  return *this;
+}
+
+
+SampleFilter& SampleFilter::VertexZ ( Double_t min, Double_t max )
+{
+  fMinVertexZ = min;
+  fMaxVertexZ = max;
+  return *this;
+}
+
+
+SampleFilter& SampleFilter::MinCells ( Int_t min )
+{
+  fMinCells = min;
+  return *this;
+}
+
+
+SampleFilter& SampleFilter::Module ( Int_t module )
+{
+  if( std::find(fModules.begin(), fModules.end(), module) == fModules.end() )
+    fModules.push_back(module);
+  return *this;
+}
+
+
+SampleFilter& SampleFilter::CellSet ( const std::vector<Int_t>& indices, Bool_t exclude )
+{
+  Int_t size = fParameters ? fParameters->GetNGood() : 0;
+  for(UInt_t idx = 0; idx < indices.size(); ++idx)
+    size = TMath::Max(size, indices[idx] + 1);
+  fCellSet.assign(size, kFALSE);
+  for(UInt_t idx = 0; idx < indices.size(); ++idx)
+    if( indices[idx] >= 0 )
+      fCellSet[indices[idx]] = kTRUE;
+  fExcludeCellSet = exclude;
+  return *this;
+}
+
+
+void SampleFilter::Clear()
+{
+  fMinMass = -kInfinity;
+  fMaxMass = kInfinity;
+  fMinEnergy = -kInfinity;
+  fMaxAsymmetry = kInfinity;
+  fMinVertexZ = -kInfinity;
+  fMaxVertexZ = kInfinity;
+  fMinCells = 0;
+  fModules.clear();
+  fCellSet.clear();
+  fExcludeCellSet = kFALSE;
+}
+
+
+Bool_t SampleFilter::PassScalars ( Double_t mass, Double_t energy1, Double_t energy2, Double_t vertexZ ) const
+{
+  if( mass < fMinMass || mass > fMaxMass )
+    return kFALSE;
+  if( energy1 < fMinEnergy || energy2 < fMinEnergy )
+    return kFALSE;
+  if( vertexZ < fMinVertexZ || vertexZ > fMaxVertexZ )
+    return kFALSE;
+  if( fMaxAsymmetry < 1 && energy1 + energy2 > 0
+      && TMath::Abs(energy1 - energy2) > fMaxAsymmetry * (energy1 + energy2) )
+    return kFALSE;
+  return kTRUE;
+}
+
+
+Bool_t SampleFilter::PassCells ( const Int_t* index1, Int_t nCells1, const Int_t* index2, Int_t nCells2 ) const
+{
+  // the module cut is of the sample, both clusters in the same module
+  Int_t module = -1;
+  return PassCluster(index1, nCells1, module) && PassCluster(index2, nCells2, module);
+}
+
+
+Bool_t SampleFilter::Pass ( const SampleEvent& event, Int_t pair ) const
+{
+  const Int_t cluster1 = event.GetCluster1(pair), cluster2 = event.GetCluster2(pair);
+  return PassScalars(event.GetMass(pair), event.GetEnergy(cluster1), event.GetEnergy(cluster2), event.GetVertex().Z())
+    && PassCells(event.GetCellIndex(cluster1), event.GetNCells(cluster1), event.GetCellIndex(cluster2), event.GetNCells(cluster2));
+}
+
+
+Bool_t SampleFilter::Pass ( const SampleBatch& batch, UInt_t sample ) const
+{
+  Double_t vertex[3];
+  batch.GetVertex(sample, vertex);
+  return PassScalars(batch.GetMass(sample), batch.GetEnergy(sample, 0), batch.GetEnergy(sample, 1), vertex[2])
+    && PassCells(batch.GetCellIndex(sample, 0), batch.GetNCells(sample, 0), batch.GetCellIndex(sample, 1), batch.GetNCells(sample, 1));
+}
+
+
+Bool_t SampleFilter::Pass ( const Sample& sample ) const
+{
+  if( ! PassScalars(sample.GetMass(), sample.GetEnergy1(), sample.GetEnergy2(), sample.GetVertex().Z()) )
+    return kFALSE;
+  if( ! HasCellCuts() )
+    return kTRUE;
+
+  std::vector<Int_t> index1, index2;
+  const TArrayF* amplitudes[2] = {&sample.Amplitudes1(), &sample.Amplitudes2()};
+  std::vector<Int_t>* indices[2] = {&index1, &index2};
+  for(Int_t cluster = 0; cluster < 2; ++cluster)
+    for(Int_t idx = 0; idx < amplitudes[cluster]->GetSize(); ++idx)
+      if( amplitudes[cluster]->At(idx) > 0 )
+	indices[cluster]->push_back(idx);
+  return PassCells(index1.empty() ? NULL : &index1[0], index1.size(), index2.empty() ? NULL : &index2[0], index2.size());
+}
+
+
+Bool_t SampleFilter::PassCluster ( const Int_t* index, Int_t nCells, Int_t& module ) const
+{
+  if( nCells < fMinCells )
+    return kFALSE;
+
+  for(Int_t idx = 0; idx < nCells; ++idx) {
+    const Int_t cell = index[idx];
+    if( ! fCellSet.empty() ) {
+      const Bool_t inSet = cell >= 0 && cell < Int_t(fCellSet.size()) && fCellSet[cell];
+      if( inSet == fExcludeCellSet )
+	return kFALSE;
+    }
+    if( ! fModules.empty() && fParameters ) {
+      const Int_t cellModule = GeometryCache::AbsIdToModule(fParameters->GetIDArray()[cell]);
+      if( module >= 0 && cellModule != module )
+	return kFALSE;
+      module = cellModule;
+    }
+  }
+  if( ! fModules.empty() && ! fParameters ) {
+    Error("PassCells", "module cuts without parameters, for the channel ids");
+    return kFALSE;
+  }
+  if( ! fModules.empty() && std::find(fModules.begin(), fModules.end(), module) == fModules.end() )
+    return kFALSE;
+  return kTRUE;
+}
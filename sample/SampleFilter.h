@@ -0,0 +1,105 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SAMPLEFILTER_H
+#define SAMPLEFILTER_H
+
+#include <Rtypes.h>
+#include <vector>
+
+class Sample;
+class SampleEvent;
+class SampleBatch;
+class SampleParameters;
+
+
+// A chain of cuts on samples, declared once and applied while the samples
+// are read (SampleReader) or extracted (ExtractorTask), so that different
+// cuts do not need a re-extraction. Cuts are chained,
+//
+//   SampleFilter filter(&params);
+//   filter.MassWindow(0.1, 0.17).MaxAsymmetry(0.8).Module(2).VertexZ(-10, 10);
+//
+// and a sample passes if it passes every cut. The cuts are in two stages:
+// PassScalars needs only the mass, cluster energies and vertex, and is
+// evaluated by the readers before the cells are decoded; PassCells needs
+// the cells of the clusters.
+class SampleFilter
+{
+public:
+  explicit SampleFilter(const SampleParameters* params = NULL);
+  SampleFilter(const SampleFilter& other);
+  SampleFilter& operator= (const SampleFilter& other);
+
+  // the channel ids of the module cuts
+  void SetParameters(const SampleParameters* params) { fParameters = params; }
+
+  // *** Scalar cuts ***
+  SampleFilter& MassWindow(Double_t min, Double_t max);
+  // of each cluster
+  SampleFilter& MinEnergy(Double_t min);
+  // |E1 - E2| / (E1 + E2)
+  SampleFilter& MaxAsymmetry(Double_t max);
+  SampleFilter& VertexZ(Double_t min, Double_t max);
+
+  // *** Cell cuts ***
+  // of each cluster
+  SampleFilter& MinCells(Int_t min);
+  // the sample in one of the modules given (0-4): all cells of both
+  // clusters in the same module, by the channel ids of the parameters; a
+  // pair of clusters in two modules fails, whichever modules are given
+  SampleFilter& Module(Int_t module);
+  // the cells of both clusters within the set of good channel indices, or
+  // none of them if exclude, e.g. for suspect channels
+  SampleFilter& CellSet(const std::vector<Int_t>& indices, Bool_t exclude = kFALSE);
+
+  void Clear();
+  Bool_t HasCellCuts() const { return fMinCells > 0 || ! fModules.empty() || ! fCellSet.empty(); }
+
+  Bool_t PassScalars(Double_t mass, Double_t energy1, Double_t energy2, Double_t vertexZ) const;
+  Bool_t PassCells(const Int_t* index1, Int_t nCells1, const Int_t* index2, Int_t nCells2) const;
+
+  // both stages
+  Bool_t Pass(const SampleEvent& event, Int_t pair) const;
+  Bool_t Pass(const SampleBatch& batch, UInt_t sample) const;
+  Bool_t Pass(const Sample& sample) const;
+
+private:
+  // module: of the cells so far, -1 none; the cells must be in it
+  Bool_t PassCluster(const Int_t* index, Int_t nCells, Int_t& module) const;
+
+  const SampleParameters* fParameters; // for the channel ids, not owned
+
+  Double_t fMinMass;
+  Double_t fMaxMass;
+  Double_t fMinEnergy;
+  Double_t fMaxAsymmetry;
+  Double_t fMinVertexZ;
+  Double_t fMaxVertexZ;
+
+  Int_t fMinCells;
+  std::vector<Int_t> fModules;
+  std::vector<Bool_t> fCellSet; // [nGood] in the set
+  Bool_t fExcludeCellSet;
+};
+
+#endif // SAMPLEFILTER_H
@@ -27,6 +27,7 @@
 #include "AliPHOSGeometry.h"
 #include <TString.h>
 #include <TMath.h>
+#include "NonLinearity.h"
 
 
 
@@ -53,41 +54,64 @@ SampleParameters::SampleParameters(UInt_t nGood)
 }
 
 
-// SampleParameters::SampleParameters(const SampleParameters& other)
-// : fNGood(other.fNGood),
-//   fIDArray(other.fIDArray),
-//   fCCArray(other.fCCArray),
-//   fCS(other.fCS),
-//   fLocalPosArray((TObjArray*) other.fLocalPosArray->Clone()),
-//   fLogWeight(other.fLogWeight), 
-//   fNonLinearParams(other.fNonLinearParams),
-//   fNonLinearCorrectionVersion(other.fNonLinearCorrectionVersion),
-//   fT({NULL}),
-//   fIncidentVector(other.fIncidentVector), // from trunk rev.53223, AliPHOSClusterizerv1::WriteRecPoints
-//   fParA(other.fParA), 
-//   fParB(other.fParB)   
-// {
-//   for(int mod = 0; mod <5; ++mod)
-//     if( other.fT[mod] )
-//       fT[mod] = new TGeoHMatrix( * other.fT[mod]);
-// }
-// 
-// 
-// SampleParameters& SampleParameters::operator= (const SampleParameters& other )
-// {
-//  SetNGood( other.fNGood );
-//  fIDArray = other.fIDArray;
-//  fCCArray = other.fCCArray;
-//  fCS = other.fCS;
-//  for(unsigned int idx = 0; idx < fNGood; fNGood++){
-//    if( fLocalPosArray->operator[](idx) )
-//      fLocalPosArray->RemoveAt(idx);
-//    if( other.fLocalPosArray->operator[](idx) )
-//    fLocalPosArray->Add(new TVector3( * (TVector3*) other.fLocalPosArray->operator[](idx)));
-//  }
-//  
-//  return *this;
-// }
+SampleParameters::SampleParameters(const SampleParameters& other)
+: TObject(other),
+  fNGood(other.fNGood),
+  fIDArray(other.fIDArray),
+  fCCArray(other.fCCArray),
+  fCS(other.fCS),
+  fLocalPosArray(other.fNGood),
+  fLogWeight(other.fLogWeight), 
+  fNonLinearParams(other.fNonLinearParams),
+  fNonLinearCorrectionVersion(other.fNonLinearCorrectionVersion),
+  fT(5),
+  fIncidentVector(other.fIncidentVector),
+  fParA(other.fParA), 
+  fParB(other.fParB)   
+{
+  // deep copy, the arrays own their positions and matrixes
+  fLocalPosArray.SetOwner();
+  fT.SetOwner();
+  for(unsigned int idx = 0; idx < fNGood; ++idx)
+    if( other.GetLocalPos(idx) )
+      SetLocalPos(idx, *other.GetLocalPos(idx));
+  for(unsigned int mod = 0; mod < 5; ++mod)
+    if( other.GetT(mod) )
+      SetT(mod, *other.GetT(mod));
+}
+
+
+SampleParameters& SampleParameters::operator= (const SampleParameters& other )
+{
+  if( this == &other )
+    return *this;
+
+  TObject::operator=(other);
+  SetNGood( other.fNGood );
+  fIDArray = other.fIDArray;
+  fCCArray = other.fCCArray;
+  fCS = other.fCS;
+  for(unsigned int idx = 0; idx < fNGood; ++idx) {
+    if( other.GetLocalPos(idx) )
+      SetLocalPos(idx, *other.GetLocalPos(idx));
+    else
+      delete fLocalPosArray.RemoveAt(idx);
+  }
+  fLogWeight = other.fLogWeight;
+  fNonLinearParams = other.fNonLinearParams;
+  fNonLinearCorrectionVersion = other.fNonLinearCorrectionVersion;
+  for(unsigned int mod = 0; mod < 5; ++mod) {
+    if( other.GetT(mod) )
+      SetT(mod, *other.GetT(mod));
+    else
+      delete fT.RemoveAt(mod);
+  }
+  fIncidentVector = other.fIncidentVector;
+  fParA = other.fParA;
+  fParB = other.fParB;
+
+  return *this;
+}
 
 
 SampleParameters::~SampleParameters()
@@ -133,21 +157,60 @@ TCanvas* SampleParameters::DrawBadChannelMap()
  return canv; 
 }
 
-bool SampleParameters::Equal ( const SampleParameters& other)
+Bool_t SampleParameters::SameGeometry ( const SampleParameters& other ) const
 {
-  if( fNGood != other.fNGood )
-    return false;
-  for(unsigned int idx=0; idx<fNGood; ++fNGood)
+  if( fNGood != other.fNGood || fCS != other.fCS )
+    return kFALSE;
+  for(unsigned int idx=0; idx<fNGood; ++idx)
   {
     if(fIDArray[idx] != other.fIDArray[idx] )
-      return false;
-    if(fCCArray[idx] != other.fCCArray[idx]) // should be machine exact equal
-      return false;
-    //TODO: complare local array
+      return kFALSE;
+    const TVector3* pos = GetLocalPos(idx);
+    const TVector3* otherPos = other.GetLocalPos(idx);
+    if( (pos == NULL) != (otherPos == NULL) )
+      return kFALSE;
+    if( pos && (pos->X() != otherPos->X() || pos->Y() != otherPos->Y() || pos->Z() != otherPos->Z()) )
+      return kFALSE;
   }
-  //TODO; finish SampleParameters::Equal
- 
-  return true;
+
+  for(unsigned int mod = 0; mod < 5; ++mod) {
+    const TGeoHMatrix* T = GetT(mod);
+    const TGeoHMatrix* otherT = other.GetT(mod);
+    if( (T == NULL) != (otherT == NULL) )
+      return kFALSE;
+    if( ! T )
+      continue;
+    for(int idx = 0; idx < 9; ++idx)
+      if( T->GetRotationMatrix()[idx] != otherT->GetRotationMatrix()[idx] )
+	return kFALSE;
+    for(int idx = 0; idx < 3; ++idx)
+      if( T->GetTranslation()[idx] != otherT->GetTranslation()[idx] )
+	return kFALSE;
+  }
+  return kTRUE;
+}
+
+
+Bool_t SampleParameters::Equal ( const SampleParameters& other ) const
+{
+  if( ! SameGeometry(other) )
+    return kFALSE;
+  for(unsigned int idx=0; idx<fNGood; ++idx)
+    if(fCCArray[idx] != other.fCCArray[idx]) // should be machine exact equal
+      return kFALSE;
+
+  if( fLogWeight != other.fLogWeight || fParA != other.fParA || fParB != other.fParB )
+    return kFALSE;
+  if( fIncidentVector.X() != other.fIncidentVector.X() || fIncidentVector.Y() != other.fIncidentVector.Y()
+      || fIncidentVector.Z() != other.fIncidentVector.Z() )
+    return kFALSE;
+  if( fNonLinearCorrectionVersion != other.fNonLinearCorrectionVersion
+      || fNonLinearParams.GetSize() != other.fNonLinearParams.GetSize() )
+    return kFALSE;
+  for(int idx = 0; idx < fNonLinearParams.GetSize(); ++idx)
+    if( fNonLinearParams[idx] != other.fNonLinearParams[idx] )
+      return kFALSE;
+  return kTRUE;
 }
 
 
@@ -221,7 +284,7 @@ void SampleParameters::SetID ( UInt_t index, Int_t phosID )
 }
 
 
-void SampleParameters::SetCC ( UInt_t index, Int_t cc )
+void SampleParameters::SetCC ( UInt_t index, Float_t cc )
 {
   if( index < fNGood )
     fCCArray[index] = cc;
@@ -240,6 +303,16 @@ void SampleParameters::SetLocalPos ( UInt_t index, const TVector3& localPos )
   fLocalPosArray.SetOwner(); // for peace of mind
 }
 
+
+void SampleParameters::RemoveLocalPos ( UInt_t index )
+{
+  if( fNGood <= index ) {
+    Error("RemoveLocalPos", "index out of bounds");
+    return;
+  }
+  delete fLocalPosArray.RemoveAt(index);
+}
+
 void SampleParameters::SetT ( UInt_t module, const TGeoHMatrix& T )
 {
   if( 5 <= module )
@@ -251,3 +324,67 @@ void SampleParameters::SetT ( UInt_t module, const TGeoHMatrix& T )
 }
 
 
+CoreGlobals SampleParameters::GetCoreGlobals() const
+{
+  CoreGlobals globals;
+  globals.fLogWeight = fLogWeight;
+  globals.fParA = fParA;
+  globals.fParB = fParB;
+  globals.fCS = fCS;
+  fIncidentVector.GetXYZ(globals.fIncident);
+  globals.fNNonLinearParams = TMath::Min(fNonLinearParams.GetSize(), CoreGlobals::kMaxNonLinearParams);
+  for(Int_t idx = 0; idx < CoreGlobals::kMaxNonLinearParams; ++idx)
+    globals.fNonLinearParams[idx] = idx < globals.fNNonLinearParams ? fNonLinearParams[idx] : 0;
+  globals.fNonLinearity = NonLinearity::GetVersion(fNonLinearCorrectionVersion.Data(), fNonLinearParams.GetSize());
+  return globals;
+}
+
+
+void SampleParameters::GetCore ( CoreParameters& core ) const
+{
+  core.fGlobals = GetCoreGlobals();
+
+  core.fChannels.resize(fNGood);
+  for(UInt_t idx = 0; idx < fNGood; ++idx) {
+    CoreChannel& channel = core.fChannels[idx];
+    channel.fAbsId = fIDArray[idx];
+    channel.fCC = fCCArray[idx];
+    const TVector3* localPos = GetLocalPos(idx);
+    if( ! localPos )
+      Error("GetCore", "local position of index %d not set", idx);
+    channel.fLocalX = localPos ? localPos->X() : 0;
+    channel.fLocalZ = localPos ? localPos->Z() : 0;
+  }
+
+  for(Int_t mod = 0; mod < CoreParameters::kNMod; ++mod) {
+    Float_t* t = core.fT[mod];
+    const TGeoHMatrix* matrix = GetT(mod);
+    if( ! matrix ) { // identity
+      for(int idx = 0; idx < 12; ++idx)
+	t[idx] = (idx % 5 == 0) ? 1 : 0;
+      continue;
+    }
+    const Double_t* rot = matrix->GetRotationMatrix();
+    const Double_t* tra = matrix->GetTranslation();
+    for(int row = 0; row < 3; ++row) {
+      t[4*row + 0] = rot[3*row + 0];
+      t[4*row + 1] = rot[3*row + 1];
+      t[4*row + 2] = rot[3*row + 2];
+      t[4*row + 3] = tra[row];
+    }
+  }
+}
+
+
+void SampleParameters::SetCore ( const CoreParameters& core )
+{
+  if( core.GetNGood() != (Int_t) fNGood ) {
+    Error("SetCore", "%d good channels, not %d", core.GetNGood(), fNGood);
+    return;
+  }
+  for(UInt_t idx = 0; idx < fNGood; ++idx)
+    fCCArray[idx] = core.fChannels[idx].fCC;
+  fLogWeight = core.fGlobals.fLogWeight;
+  fParA = core.fGlobals.fParA;
+  fParB = core.fGlobals.fParB;
+}
@@ -31,13 +31,14 @@
 #include <TVector3.h>
 #include <TGeoMatrix.h>
 #include <TMap.h>
+#include "CoreParameters.h"
 
 class SampleParameters : public TObject
 {
 public:
   SampleParameters(UInt_t nGood = 0);
-//   SampleParameters(const SampleParameters& other );
-//   SampleParameters& operator= (const SampleParameters& other );
+  SampleParameters(const SampleParameters& other );
+  SampleParameters& operator= (const SampleParameters& other );
   ~SampleParameters();
   
   TCanvas* DrawBadChannelMap();
@@ -67,9 +68,10 @@ public:
   void SetNGood(UInt_t nGood);
   void SetID(UInt_t index, Int_t phosID);
 
-  void SetCC(UInt_t index, Int_t cc);
-  void SetCS(Int_t cs) { fCS = cs; }
+  void SetCC(UInt_t index, Float_t cc);
+  void SetCS(Float_t cs) { fCS = cs; }
   void SetLocalPos(UInt_t index, const TVector3& localPos);
+  void RemoveLocalPos(UInt_t index);
   void SetLogWeight(Float_t logWeight) { fLogWeight = logWeight; }
   void SetNonLinearParams(const TArrayF& paramArray) {fNonLinearParams = paramArray; }
   void SetNonLinearCorrectionVersion(const TString& name) { fNonLinearCorrectionVersion = name; }
@@ -79,8 +81,25 @@ public:
   void SetParB(Float_t parb) { fParB = parb; }
 
 
+  // *** Plain values, of the calibration core (libCalibCore) ***
+  // the globals, the nonlinearity version resolved
+  CoreGlobals GetCoreGlobals() const;
+  void GetCore(CoreParameters& core) const;
+  // the cc's and the fitted globals (log weight, para, parb) of core, which
+  // has the good channels of these parameters
+  void SetCore(const CoreParameters& core);
+
+
+  // the good channels (ids and positions), the module matrixes and the
+  // crystal shift are identical, bit for bit; the cc's and the
+  // reconstruction settings may differ
+  Bool_t SameGeometry(const SampleParameters& other) const;
+  // the good channels (ids, cc's and positions), the module matrixes and
+  // the reconstruction settings are identical, bit for bit
+  Bool_t Equal(const SampleParameters& other) const;
+
+
 private:
-  bool Equal(const SampleParameters& other); // not finnished
   
   UInt_t fNGood;
   TArrayI fIDArray; // [fNGood] PHOS ID of Good Channels
@@ -0,0 +1,373 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SampleParametersCodec.h"
+#include "SampleParameters.h"
+#include <TError.h>
+#include <TMath.h>
+#include <cstring>
+
+const UInt_t SampleParametersCodec::kVersion;
+
+namespace {
+  const char kMagic[4] = {'S', 'P', 'A', 'R'};
+  // magic, version, kind, payload size, checksum
+  const ULong64_t kHeaderSize = 4 + sizeof(UInt_t) + sizeof(Int_t) + sizeof(ULong64_t) + sizeof(UInt_t);
+  const UInt_t kNModules = 5;
+
+  class Writer
+  {
+  public:
+    explicit Writer(std::vector<char>& buffer) : fBuffer(buffer) {}
+    template<class T> void Put(const T& value) { Put(&value, 1); }
+    template<class T> void Put(const T* values, ULong64_t n)
+    {
+      const char* bytes = reinterpret_cast<const char*>(values);
+      if( n )
+	fBuffer.insert(fBuffer.end(), bytes, bytes + n*sizeof(T));
+    }
+  private:
+    Writer(const Writer&); // Not Implemented
+    Writer& operator= (const Writer&); // Not Implemented
+    std::vector<char>& fBuffer;
+  };
+
+  class Reader
+  {
+  public:
+    Reader(const char* data, ULong64_t size) : fData(data), fEnd(data + size), fOK(kTRUE) {}
+    template<class T> T Get() { T value = T(); Get(&value, 1); return value; }
+    template<class T> void Get(T* values, ULong64_t n)
+    {
+      if( ! fOK || ULong64_t(fEnd - fData) < n*sizeof(T) ) {
+	fOK = kFALSE;
+	return;
+      }
+      if( n )
+	memcpy(values, fData, n*sizeof(T));
+      fData += n*sizeof(T);
+    }
+    Bool_t IsOK() const { return fOK; }
+    Bool_t AtEnd() const { return fData == fEnd; }
+  private:
+    Reader(const Reader&); // Not Implemented
+    Reader& operator= (const Reader&); // Not Implemented
+    const char* fData;
+    const char* fEnd;
+    Bool_t fOK;
+  };
+
+  // CRC-32 (IEEE 802.3) of each byte value
+  class CRCTable
+  {
+  public:
+    CRCTable()
+    {
+      for(UInt_t n = 0; n < 256; ++n) {
+	UInt_t c = n;
+	for(Int_t k = 0; k < 8; ++k)
+	  c = c & 1 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+	fEntries[n] = c;
+      }
+    }
+    UInt_t operator[] (UInt_t n) const { return fEntries[n]; }
+  private:
+    UInt_t fEntries[256];
+  };
+
+  UInt_t CCChecksum(const SampleParameters& params)
+  {
+    return SampleParametersCodec::CRC32(params.GetCCArray().GetArray(), params.GetNGood()*sizeof(Float_t));
+  }
+}
+
+
+void SampleParametersCodec::Encode ( const SampleParameters& params, std::vector<char>& buffer )
+{
+  WriteHeader(buffer, kFull);
+  Writer writer(buffer);
+  const UInt_t nGood = params.GetNGood();
+  writer.Put(nGood);
+  writer.Put(params.GetIDArray().GetArray(), nGood);
+  writer.Put(params.GetCCArray().GetArray(), nGood);
+  writer.Put(params.GetCS());
+
+  // local positions, with a flag per cell for those set
+  std::vector<UChar_t> hasPos(nGood);
+  std::vector<Double_t> pos(3*nGood, 0.);
+  for(UInt_t idx = 0; idx < nGood; ++idx) {
+    const TVector3* localPos = params.GetLocalPos(idx);
+    hasPos[idx] = localPos != NULL;
+    if( localPos )
+      localPos->GetXYZ(&pos[3*idx]);
+  }
+  writer.Put(hasPos.data(), nGood);
+  writer.Put(pos.data(), 3*nGood);
+
+  writer.Put(params.GetLogWeight());
+  const UInt_t nNonLinear = params.GetNonLinearParams().GetSize();
+  writer.Put(nNonLinear);
+  writer.Put(params.GetNonLinearParams().GetArray(), nNonLinear);
+  const UInt_t versionLength = params.GetNonLinearCorrectionVersion().Length();
+  writer.Put(versionLength);
+  writer.Put(params.GetNonLinearCorrectionVersion().Data(), versionLength);
+
+  // module transformations, rotation and translation
+  for(UInt_t mod = 0; mod < kNModules; ++mod) {
+    const TGeoHMatrix* T = params.GetT(mod);
+    writer.Put(UChar_t(T != NULL));
+    if( ! T )
+      continue;
+    writer.Put(T->GetRotationMatrix(), 9);
+    writer.Put(T->GetTranslation(), 3);
+  }
+
+  Double_t incident[3];
+  params.GetIncidentVector().GetXYZ(incident);
+  writer.Put(incident, 3);
+  writer.Put(params.GetPara());
+  writer.Put(params.GetParb());
+
+  // payload size and checksum
+  const ULong64_t payloadSize = buffer.size() - kHeaderSize;
+  const UInt_t crc = CRC32(&buffer[kHeaderSize], payloadSize);
+  memcpy(&buffer[kHeaderSize - sizeof(UInt_t) - sizeof(ULong64_t)], &payloadSize, sizeof(payloadSize));
+  memcpy(&buffer[kHeaderSize - sizeof(UInt_t)], &crc, sizeof(crc));
+}
+
+
+Bool_t SampleParametersCodec::Decode ( const char* data, ULong64_t size, SampleParameters& params )
+{
+  ULong64_t payloadSize = 0;
+  const char* payload = CheckHeader(data, size, kFull, payloadSize);
+  if( ! payload )
+    return kFALSE;
+  Reader reader(payload, payloadSize);
+
+  const UInt_t nGood = reader.Get<UInt_t>();
+  if( ! reader.IsOK() || nGood > payloadSize ) {
+    Error("Decode", "corrupt number of good channels");
+    return kFALSE;
+  }
+  // the whole payload into temporaries, params is only assigned if valid
+  std::vector<Int_t> ids(nGood);
+  std::vector<Float_t> cc(nGood);
+  std::vector<UChar_t> hasPos(nGood);
+  std::vector<Double_t> pos(3*nGood);
+  reader.Get(ids.data(), nGood);
+  reader.Get(cc.data(), nGood);
+  const Float_t cs = reader.Get<Float_t>();
+  reader.Get(hasPos.data(), nGood);
+  reader.Get(pos.data(), 3*nGood);
+  const Float_t logWeight = reader.Get<Float_t>();
+  const UInt_t nNonLinear = reader.Get<UInt_t>();
+  TArrayF nonLinear(nNonLinear <= payloadSize ? nNonLinear : 0);
+  reader.Get(nonLinear.GetArray(), nNonLinear);
+  const UInt_t versionLength = reader.Get<UInt_t>();
+  std::vector<char> version(versionLength <= payloadSize ? versionLength + 1 : 1, '\0');
+  reader.Get(&version[0], versionLength);
+  UChar_t hasT[kNModules];
+  Double_t rotation[kNModules][9], translation[kNModules][3];
+  for(UInt_t mod = 0; mod < kNModules; ++mod) {
+    hasT[mod] = reader.Get<UChar_t>();
+    if( ! hasT[mod] )
+      continue;
+    reader.Get(rotation[mod], 9);
+    reader.Get(translation[mod], 3);
+  }
+  Double_t incident[3];
+  reader.Get(incident, 3);
+  const Float_t parA = reader.Get<Float_t>();
+  const Float_t parB = reader.Get<Float_t>();
+  if( ! reader.IsOK() || ! reader.AtEnd() ) {
+    Error("Decode", "payload of unexpected size");
+    return kFALSE;
+  }
+
+  // members the encoding lacks, local positions and transformations, are
+  // cleared by the assignment
+  SampleParameters decoded(nGood);
+  for(UInt_t idx = 0; idx < nGood; ++idx) {
+    decoded.SetID(idx, ids[idx]);
+    decoded.SetCC(idx, cc[idx]);
+    if( hasPos[idx] )
+      decoded.SetLocalPos(idx, TVector3(&pos[3*idx]));
+  }
+  decoded.SetCS(cs);
+  decoded.SetLogWeight(logWeight);
+  decoded.SetNonLinearParams(nonLinear);
+  decoded.SetNonLinearCorrectionVersion(&version[0]);
+  for(UInt_t mod = 0; mod < kNModules; ++mod) {
+    if( ! hasT[mod] )
+      continue;
+    TGeoHMatrix T;
+    T.SetRotation(rotation[mod]);
+    T.SetTranslation(translation[mod]);
+    decoded.SetT(mod, T);
+  }
+  decoded.SetIncidentVector(TVector3(incident));
+  decoded.SetParA(parA);
+  decoded.SetParB(parB);
+  params = decoded;
+  return kTRUE;
+}
+
+
+void SampleParametersCodec::EncodeDelta ( const SampleParameters& params, const SampleParameters& reference, std::vector<char>& buffer )
+{
+  const UInt_t nGood = params.GetNGood();
+  if( UInt_t(reference.GetNGood()) != nGood )
+    Error("EncodeDelta", "reference of %d good channels, not %d", reference.GetNGood(), nGood);
+
+  WriteHeader(buffer, kDelta);
+  Writer writer(buffer);
+  writer.Put(nGood);
+  writer.Put(CCChecksum(reference));
+
+  // changed entries, as (index, cc)
+  const Float_t* cc = params.GetCCArray().GetArray();
+  const Float_t* referenceCC = reference.GetCCArray().GetArray();
+  const UInt_t nCompared = TMath::Min(nGood, UInt_t(reference.GetNGood()));
+  const ULong64_t nChangedPos = buffer.size();
+  UInt_t nChanged = 0;
+  writer.Put(nChanged);
+  for(UInt_t idx = 0; idx < nGood; ++idx) {
+    if( idx < nCompared && cc[idx] == referenceCC[idx] )
+      continue;
+    writer.Put(idx);
+    writer.Put(cc[idx]);
+    ++nChanged;
+  }
+  memcpy(&buffer[nChangedPos], &nChanged, sizeof(nChanged));
+
+  const ULong64_t payloadSize = buffer.size() - kHeaderSize;
+  const UInt_t crc = CRC32(&buffer[kHeaderSize], payloadSize);
+  memcpy(&buffer[kHeaderSize - sizeof(UInt_t) - sizeof(ULong64_t)], &payloadSize, sizeof(payloadSize));
+  memcpy(&buffer[kHeaderSize - sizeof(UInt_t)], &crc, sizeof(crc));
+}
+
+
+Bool_t SampleParametersCodec::ApplyDelta ( const char* data, ULong64_t size, SampleParameters& params, Bool_t verifyBase )
+{
+  ULong64_t payloadSize = 0;
+  const char* payload = CheckHeader(data, size, kDelta, payloadSize);
+  if( ! payload )
+    return kFALSE;
+  Reader reader(payload, payloadSize);
+
+  const UInt_t nGood = reader.Get<UInt_t>();
+  const UInt_t baseChecksum = reader.Get<UInt_t>();
+  const UInt_t nChanged = reader.Get<UInt_t>();
+  if( ! reader.IsOK() || nGood != UInt_t(params.GetNGood()) ) {
+    Error("ApplyDelta", "delta of %d good channels, parameters of %d", nGood, params.GetNGood());
+    return kFALSE;
+  }
+  if( verifyBase && baseChecksum != CCChecksum(params) ) {
+    Error("ApplyDelta", "parameters are not the reference of the delta");
+    return kFALSE;
+  }
+  if( payloadSize != 3*sizeof(UInt_t) + ULong64_t(nChanged)*(sizeof(UInt_t) + sizeof(Float_t)) ) {
+    Error("ApplyDelta", "payload of unexpected size");
+    return kFALSE;
+  }
+
+  for(UInt_t change = 0; change < nChanged; ++change) {
+    const UInt_t idx = reader.Get<UInt_t>();
+    const Float_t cc = reader.Get<Float_t>();
+    if( idx >= nGood ) {
+      Error("ApplyDelta", "index %d out of range", idx);
+      return kFALSE;
+    }
+    params.SetCC(idx, cc);
+  }
+  return kTRUE;
+}
+
+
+Int_t SampleParametersCodec::GetKind ( const char* data, ULong64_t size )
+{
+  if( size < kHeaderSize || memcmp(data, kMagic, 4) )
+    return -1;
+  Int_t kind;
+  memcpy(&kind, data + 4 + sizeof(UInt_t), sizeof(kind));
+  return kind;
+}
+
+
+UInt_t SampleParametersCodec::CRC32 ( const void* data, ULong64_t size, UInt_t crc )
+{
+  // CRC-32 (IEEE 802.3), table driven; the table is built once, on the
+  // first call of any thread
+  static const CRCTable table;
+
+  const UChar_t* bytes = static_cast<const UChar_t*>(data);
+  crc = ~crc;
+  for(ULong64_t idx = 0; idx < size; ++idx)
+    crc = table[(crc ^ bytes[idx]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+
+const char* SampleParametersCodec::CheckHeader ( const char* data, ULong64_t size, Int_t kind, ULong64_t& payloadSize )
+{
+  if( size < kHeaderSize || memcmp(data, kMagic, 4) ) {
+    Error("CheckHeader", "not a SampleParameters encoding");
+    return NULL;
+  }
+  UInt_t version;
+  Int_t dataKind;
+  UInt_t crc;
+  memcpy(&version, data + 4, sizeof(version));
+  memcpy(&dataKind, data + 4 + sizeof(UInt_t), sizeof(dataKind));
+  memcpy(&payloadSize, data + 4 + sizeof(UInt_t) + sizeof(Int_t), sizeof(payloadSize));
+  memcpy(&crc, data + kHeaderSize - sizeof(UInt_t), sizeof(crc));
+  if( version != kVersion ) {
+    Error("CheckHeader", "encoding version %d, this is version %d", version, kVersion);
+    return NULL;
+  }
+  if( dataKind != kind ) {
+    Error("CheckHeader", "encoding of kind %d, expected %d", dataKind, kind);
+    return NULL;
+  }
+  if( payloadSize != size - kHeaderSize ) {
+    Error("CheckHeader", "payload of %lld bytes, %lld given", (Long64_t) payloadSize, (Long64_t) (size - kHeaderSize));
+    return NULL;
+  }
+  if( CRC32(data + kHeaderSize, payloadSize) != crc ) {
+    Error("CheckHeader", "checksum mismatch");
+    return NULL;
+  }
+  return data + kHeaderSize;
+}
+
+
+void SampleParametersCodec::WriteHeader ( std::vector<char>& buffer, Int_t kind )
+{
+  // payload size and checksum are filled in when the payload is written
+  buffer.clear();
+  Writer writer(buffer);
+  writer.Put(kMagic, 4);
+  writer.Put(kVersion);
+  writer.Put(kind);
+  writer.Put(ULong64_t(0));
+  writer.Put(UInt_t(0));
+}
@@ -0,0 +1,67 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SAMPLEPARAMETERSCODEC_H
+#define SAMPLEPARAMETERSCODEC_H
+
+#include <Rtypes.h>
+#include <vector>
+
+class SampleParameters;
+
+
+// Flat, versioned binary encoding of SampleParameters, for fast loading and
+// for shipping the parameters to the workers of a calibration, in place of
+// the ROOT streamer and its per object overhead.
+//
+// An encoding is a header, magic "SPAR", format version, kind (full or
+// delta), payload size and the CRC-32 of the payload, followed by the
+// payload. A full payload holds every member; a delta payload only the
+// fCCArray entries which differ from a reference, together with the CRC-32
+// of the reference cc's, against which ApplyDelta checks its base. Numbers
+// are in the byte order of the machine.
+class SampleParametersCodec
+{
+public:
+  enum Kind { kFull = 0, kDelta = 1 };
+  const static UInt_t kVersion = 1;
+
+  static void Encode(const SampleParameters& params, std::vector<char>& buffer);
+  static Bool_t Decode(const char* data, ULong64_t size, SampleParameters& params);
+
+  // the cc's of params which differ from those of reference
+  static void EncodeDelta(const SampleParameters& params, const SampleParameters& reference, std::vector<char>& buffer);
+  // applies a delta to params, which must be the reference of the delta
+  // (by its cc checksum, if verifyBase)
+  static Bool_t ApplyDelta(const char* data, ULong64_t size, SampleParameters& params, Bool_t verifyBase = kTRUE);
+
+  // kind of an encoding, -1 if not valid
+  static Int_t GetKind(const char* data, ULong64_t size);
+  static UInt_t CRC32(const void* data, ULong64_t size, UInt_t crc = 0);
+
+private:
+  // checks the header, returns the payload
+  static const char* CheckHeader(const char* data, ULong64_t size, Int_t kind, ULong64_t& payloadSize);
+  static void WriteHeader(std::vector<char>& buffer, Int_t kind);
+};
+
+#endif // SAMPLEPARAMETERSCODEC_H
@@ -21,21 +21,220 @@
 */
 
 #include "SampleReader.h"
+#include "Sample.h"
+#include "SampleEvent.h"
+#include "SampleBatch.h"
+#include "SampleFilter.h"
+#include "SampleParameters.h"
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TKey.h>
+#include <TList.h>
+#include <TObjArray.h>
+#include <TString.h>
+#include <TError.h>
 
-SampleReader::SampleReader(TString filename) {
-  //TODO
+
+SampleReader::SampleReader ( const char* filename, const char* treeName )
+: fFile(NULL),
+  fTree(NULL),
+  fParameters(NULL),
+  fEvent(NULL),
+  fSample(NULL),
+  fFilter(NULL),
+  fPushdown(kTRUE),
+  fScalarBranches(),
+  fCellBranches(),
+  fEntry(-1),
+  fPair(0),
+  fCellsLoaded(kFALSE),
+  fNPassed(0),
+  fNRejected(0),
+  fNDecoded(0),
+  fNSkipped(0)
+{
+  fFile = TFile::Open(filename);
+  if( ! fFile || fFile->IsZombie() ) {
+    Error("SampleReader", "could not open %s", filename);
+    return;
+  }
+
+  // the parameters, and the tree if not named
+  TIter next(fFile->GetListOfKeys());
+  while( TKey* key = static_cast<TKey*>(next()) ) {
+    const TString className = key->GetClassName();
+    if( ! fParameters && className == "SampleParameters" )
+      fParameters = dynamic_cast<SampleParameters*>(key->ReadObj());
+    if( ! fTree && ! treeName && className == "TTree" )
+      fTree = dynamic_cast<TTree*>(key->ReadObj());
+  }
+  if( treeName )
+    fTree = dynamic_cast<TTree*>(fFile->Get(treeName));
+  if( ! fParameters )
+    Warning("SampleReader", "no SampleParameters in %s", filename);
+  if( ! fTree ) {
+    Error("SampleReader", "no sample tree in %s", filename);
+    return;
+  }
+
+  TBranch* branch = fTree->GetBranch("events");
+  if( branch ) {
+    fEvent = new SampleEvent();
+    fTree->SetBranchAddress("events", &fEvent);
+  }
+  else if( (branch = fTree->GetBranch("samples")) ) {
+    fSample = new Sample();
+    fTree->SetBranchAddress("samples", &fSample);
+  }
+  else {
+    Error("SampleReader", "tree %s has neither branch \"events\" nor \"samples\"", fTree->GetName());
+    fTree = NULL;
+    return;
+  }
+
+  // the cells (and the dense amplitudes) are the bulk of an entry; if the
+  // branch is not split there is nothing to push down to
+  std::vector<TBranch*> leaves;
+  GetLeafBranches(branch, leaves);
+  for(UInt_t idx = 0; idx < leaves.size(); ++idx) {
+    const TString name = leaves[idx]->GetName();
+    if( name.Contains("fCell") || name.Contains("fAmplitudes") )
+      fCellBranches.push_back(leaves[idx]);
+    else
+      fScalarBranches.push_back(leaves[idx]);
+  }
+}
+
+
+SampleReader::~SampleReader()
+{
+  delete fEvent;
+  delete fSample;
+  delete fParameters;
+  if( fFile )
+    fFile->Close();
+  delete fFile;
 }
 
-SampleReader::SampleReader ( const TObject& object ) {
-//TODO
+
+Long64_t SampleReader::GetNEntries() const
+{
+  return fTree ? fTree->GetEntries() : 0;
 }
 
-SampleReader::~SampleReader() {
-//TODO
+
+void SampleReader::Rewind()
+{
+  fEntry = -1;
+  fPair = 0;
+  fCellsLoaded = kFALSE;
+  fNPassed = fNRejected = fNDecoded = fNSkipped = 0;
 }
 
-SampleReader& SampleReader::operator= ( const SampleReader& other ) {
-//TODO
-  return *this;
+
+Bool_t SampleReader::AtEnd() const
+{
+  return ! fTree || (fEntry + 1 >= GetNEntries() && (fEntry < 0 || fPair >= GetNPairs()));
 }
 
+
+UInt_t SampleReader::Read ( SampleBatch& batch )
+{
+  UInt_t nAdded = 0;
+  while( ! batch.IsFull() ) {
+    if( fEntry < 0 || fPair >= GetNPairs() )
+      if( ! NextEntry() )
+	break;
+
+    if( ! PassScalars(fPair) ) {
+      ++fNRejected;
+      ++fPair;
+      continue;
+    }
+    if( ! fCellsLoaded ) {
+      for(UInt_t idx = 0; idx < fCellBranches.size(); ++idx)
+	fCellBranches[idx]->GetEntry(fEntry);
+      fCellsLoaded = kTRUE;
+      ++fNDecoded;
+    }
+
+    const Int_t sample = fEvent ? batch.Add(*fEvent, fPair) : batch.Add(*fSample);
+    if( sample < 0 ) {
+      if( batch.GetNSamples() ) // out of cell capacity, resumes here
+	break;
+      Error("Read", "sample of entry %lld does not fit in an empty batch", fEntry);
+      ++fPair;
+      continue;
+    }
+    ++fPair;
+    if( fFilter && fFilter->HasCellCuts()
+	&& ! fFilter->PassCells(batch.GetCellIndex(sample, 0), batch.GetNCells(sample, 0),
+				batch.GetCellIndex(sample, 1), batch.GetNCells(sample, 1)) ) {
+      batch.PopBack();
+      ++fNRejected;
+      continue;
+    }
+    ++fNPassed;
+    ++nAdded;
+  }
+  return nAdded;
+}
+
+
+void SampleReader::GetLeafBranches ( TBranch* branch, std::vector<TBranch*>& leaves )
+{
+  TObjArray* branches = branch->GetListOfBranches();
+  if( ! branches || ! branches->GetEntriesFast() ) {
+    leaves.push_back(branch);
+    return;
+  }
+  for(Int_t idx = 0; idx < branches->GetEntriesFast(); ++idx)
+    GetLeafBranches(static_cast<TBranch*>(branches->At(idx)), leaves);
+}
+
+
+Bool_t SampleReader::NextEntry()
+{
+  // the scalars of entries, until one with a sample passing them
+  while( fTree && fEntry + 1 < GetNEntries() ) {
+    ++fEntry;
+    fPair = 0;
+    fCellsLoaded = fCellBranches.empty() || ! fPushdown;
+    for(UInt_t idx = 0; idx < fScalarBranches.size(); ++idx)
+      fScalarBranches[idx]->GetEntry(fEntry);
+    for(UInt_t idx = 0; ! fPushdown && idx < fCellBranches.size(); ++idx)
+      fCellBranches[idx]->GetEntry(fEntry);
+    if( fCellsLoaded )
+      ++fNDecoded;
+
+    const Int_t nPairs = GetNPairs();
+    Bool_t passing = kFALSE;
+    for(Int_t pair = 0; pair < nPairs && ! passing; ++pair)
+      passing = PassScalars(pair);
+    if( passing )
+      return kTRUE;
+    fNRejected += nPairs;
+    if( ! fCellsLoaded )
+      ++fNSkipped;
+  }
+  fPair = GetNPairs();
+  return kFALSE;
+}
+
+
+Int_t SampleReader::GetNPairs() const
+{
+  return fEvent ? fEvent->GetNPairs() : 1;
+}
+
+
+Bool_t SampleReader::PassScalars ( Int_t pair ) const
+{
+  if( ! fFilter )
+    return kTRUE;
+  if( fEvent )
+    return fFilter->PassScalars(fEvent->GetMass(pair), fEvent->GetEnergy(fEvent->GetCluster1(pair)),
+				fEvent->GetEnergy(fEvent->GetCluster2(pair)), fEvent->GetVertex().Z());
+  return fFilter->PassScalars(fSample->GetMass(), fSample->GetEnergy1(), fSample->GetEnergy2(), fSample->GetVertex().Z());
+}
@@ -23,29 +23,85 @@
 #ifndef SAMPLEREADER_H
 #define SAMPLEREADER_H
 
-#include <TObject.h>
-#include "Sample.h"
-#include "SampleParameters.h"
+#include <Rtypes.h>
+#include <vector>
 
+class TFile;
+class TTree;
+class TBranch;
+class Sample;
+class SampleEvent;
+class SampleBatch;
+class SampleFilter;
+class SampleParameters;
 
-class SampleReader : public TObject
+
+// Reads the samples of an ExtractorTask output file, from a tree of either
+// the branch "events" (SampleEvent) or "samples" (Sample), into batches.
+//
+// The filter is applied as the samples are read. With a split branch the
+// cut is pushed down: for every entry only the scalar sub-branches (mass,
+// energies, vertex, cluster ranges) are read, and the cell branches only
+// if a sample of the entry passes PassScalars, so rejected entries are
+// never decoded.
+class SampleReader
 {
 public:
-  SampleReader(TString filename = TString(""));
-  
-  SampleReader ( const TObject& object );
+  // the tree of name treeName, or the first tree of the file
+  SampleReader(const char* filename, const char* treeName = NULL);
   virtual ~SampleReader();
-  virtual SampleReader& operator= ( const SampleReader& other );
 
+  Bool_t IsOpen() const { return fTree != NULL; }
+  const SampleParameters* GetParameters() const { return fParameters; }
+  Long64_t GetNEntries() const;
+
+  // applied as the samples are read, not owned
+  void SetFilter(const SampleFilter* filter) { fFilter = filter; }
+  // kFALSE: every branch of every entry is read, as without a split branch
+  void SetPushdown(Bool_t pushdown) { fPushdown = pushdown; }
+  void Rewind();
+  Bool_t AtEnd() const;
 
-  const SampleParameters & GetParameters();
+  // adds the next samples which pass the filter to batch, until it is full
+  // or the tree ends. The number of samples added.
+  UInt_t Read(SampleBatch& batch);
 
-  UInt_t GetNSamples();
-  const Sample & GetSample(int index);
-  
+  // *** Counters ***
+  Long64_t GetNPassed() const { return fNPassed; }
+  Long64_t GetNRejected() const { return fNRejected; }
+  // entries of which the cells were read
+  Long64_t GetNDecoded() const { return fNDecoded; }
+  // entries rejected on the scalar branches only
+  Long64_t GetNSkipped() const { return fNSkipped; }
 
 private:
-  //TODO
+  SampleReader(const SampleReader&); // Not Implemented
+  SampleReader& operator= (const SampleReader&); // Not Implemented
+
+  static void GetLeafBranches(TBranch* branch, std::vector<TBranch*>& leaves);
+  Bool_t NextEntry();
+  Int_t GetNPairs() const;
+  Bool_t PassScalars(Int_t pair) const;
+
+  TFile* fFile;
+  TTree* fTree; // owned by fFile
+  SampleParameters* fParameters;
+  SampleEvent* fEvent; // entry of branch "events", or
+  Sample* fSample; // entry of branch "samples"
+  const SampleFilter* fFilter;
+  Bool_t fPushdown;
+
+  std::vector<TBranch*> fScalarBranches; // read for every entry
+  std::vector<TBranch*> fCellBranches; // read for entries with a passing sample
+
+  Long64_t fEntry; // current entry
+  Int_t fPair; // next pair of the current entry
+  Bool_t fCellsLoaded;
+
+  Long64_t fNPassed;
+  Long64_t fNRejected;
+  Long64_t fNDecoded;
+  Long64_t fNSkipped;
 };
 
 #endif // SAMPLEREADER_H
@@ -0,0 +1,175 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SYNTHETICSAMPLES_H
+#define SYNTHETICSAMPLES_H
+
+// Synthetic PHOS like samples for the calibration benchmarks.
+//
+// A nRowX x nColZ patch of module 0 (2.2 cm cells) at 460 cm from the
+// vertex. Clusters are 3x3 cells around a random center. The cell energies
+// are made consistent with the true cc's, and each sample is scaled such
+// that its mass, with the true cc's, is the pi0 mass with gaussian noise
+// (or a uniform outlier mass).
+
+#include <Sample.h>
+#include <SampleEvent.h>
+#include <SampleParameters.h>
+#include <Calibrator.h>
+#include <TRandom3.h>
+#include <TGeoMatrix.h>
+#include <cmath>
+#include <vector>
+
+namespace SyntheticSamples {
+
+  const Double_t kCellSize = 2.2;
+
+  inline void MakeParameters(SampleParameters& params, UInt_t nRowX, UInt_t nColZ)
+  {
+    params.SetNGood(nRowX*nColZ);
+    for(UInt_t x = 0; x < nRowX; ++x) {
+      for(UInt_t z = 0; z < nColZ; ++z) {
+        const UInt_t index = x*nColZ + z;
+        params.SetID(index, 1 + x*56 + z);
+        params.SetCC(index, 1.);
+        params.SetLocalPos(index, TVector3((x + 0.5 - nRowX/2.)*kCellSize, 0, (z + 0.5 - nColZ/2.)*kCellSize));
+      }
+    }
+    TGeoHMatrix T;
+    const Double_t rotation[9] = {1, 0, 0,  0, 1, 0,  0, 0, 1};
+    const Double_t translation[3] = {0, 460, 0};
+    T.SetRotation(rotation);
+    T.SetTranslation(translation);
+    params.SetT(0, T);
+  }
+
+  // those of MakeParameters, with the true cc's 1 + Gaus(0, spread) of seed
+  inline void MakeTrueParameters(SampleParameters& params, UInt_t nRowX, UInt_t nColZ, UInt_t seed = 2, Double_t spread = 0.05)
+  {
+    MakeParameters(params, nRowX, nColZ);
+    TRandom3 random(seed);
+    for(Int_t idx = 0; idx < params.GetNGood(); ++idx)
+      params.SetCC(idx, 1 + random.Gaus(0, spread));
+  }
+
+  // samples must be sized, trueParams holds the true cc's; a maxSeparation
+  // other than 0 bounds the cell distance of the two cluster centers
+  inline void MakeSamples(std::vector<Sample>& samples, const SampleParameters& trueParams, UInt_t nRowX, UInt_t nColZ,
+                          Double_t sigma = 0.002, Double_t outlierFraction = 0.05, UInt_t seed = 1, UInt_t maxSeparation = 0)
+  {
+    TRandom3 random(seed);
+    const UInt_t nGood = trueParams.GetNGood();
+    const Double_t pi0Mass = 0.1349766;
+    for(UInt_t idx = 0; idx < samples.size(); ++idx) {
+      Sample& sample = samples[idx];
+      sample.Amplitude1().Set(nGood);
+      sample.Amplitude2().Set(nGood);
+      sample.Amplitude1().Reset();
+      sample.Amplitude2().Reset();
+      sample.SetVertex(TVector3(random.Gaus(0, 0.1), random.Gaus(0, 0.1), random.Gaus(0, 5)));
+
+      // cluster centers, non overlapping
+      UInt_t x[2], z[2];
+      do {
+        for(int c = 0; c < 2; ++c) {
+          x[c] = 1 + random.Integer(nRowX - 2);
+          z[c] = 1 + random.Integer(nColZ - 2);
+        }
+      } while( (std::abs(Int_t(x[0]) - Int_t(x[1])) < 3 && std::abs(Int_t(z[0]) - Int_t(z[1])) < 3)
+               || (maxSeparation && (std::abs(Int_t(x[0]) - Int_t(x[1])) > Int_t(maxSeparation)
+                                     || std::abs(Int_t(z[0]) - Int_t(z[1])) > Int_t(maxSeparation))) );
+
+      for(int c = 0; c < 2; ++c) {
+        TArrayF& amplitudes = c ? sample.Amplitude2() : sample.Amplitude1();
+        const Double_t energy = random.Uniform(0.5, 3.);
+        const Double_t dx = random.Uniform(-0.5, 0.5);
+        const Double_t dz = random.Uniform(-0.5, 0.5);
+        Double_t norm = 0;
+        for(int ix = -1; ix <= 1; ++ix)
+          for(int iz = -1; iz <= 1; ++iz)
+            norm += std::exp(-2*((ix - dx)*(ix - dx) + (iz - dz)*(iz - dz)));
+        for(int ix = -1; ix <= 1; ++ix) {
+          for(int iz = -1; iz <= 1; ++iz) {
+            const UInt_t index = (x[c] + ix)*nColZ + z[c] + iz;
+            const Double_t e = energy * std::exp(-2*((ix - dx)*(ix - dx) + (iz - dz)*(iz - dz))) / norm;
+            amplitudes[index] = e / trueParams.GetCCArray()[index];
+          }
+        }
+      }
+
+      // scale to the target mass, the cluster positions are invariant
+      const Double_t mass = Calibrator::M(sample, trueParams);
+      const Double_t target = random.Rndm() < outlierFraction
+        ? random.Uniform(0.05, 0.3)
+        : pi0Mass * (1 + random.Gaus(0, sigma/pi0Mass));
+      const Float_t scale = target / mass;
+      for(UInt_t index = 0; index < nGood; ++index) {
+        sample.Amplitude1()[index] *= scale;
+        sample.Amplitude2()[index] *= scale;
+      }
+    }
+  }
+
+  // events must be sized; nClusters random clusters per event, all paired,
+  // as ExtractCandidates does. The masses are combinatorial.
+  inline void MakeEvents(std::vector<SampleEvent>& events, const SampleParameters& trueParams, UInt_t nRowX, UInt_t nColZ,
+                         UInt_t nClusters, UInt_t seed = 1)
+  {
+    TRandom3 random(seed);
+    std::vector<Int_t> index(9);
+    std::vector<Float_t> amp(9);
+    for(UInt_t idx = 0; idx < events.size(); ++idx) {
+      SampleEvent& event = events[idx];
+      event.Reset();
+      event.SetVertex(TVector3(random.Gaus(0, 0.1), random.Gaus(0, 0.1), random.Gaus(0, 5)));
+      for(UInt_t c = 0; c < nClusters; ++c) {
+        const UInt_t x = 1 + random.Integer(nRowX - 2);
+        const UInt_t z = 1 + random.Integer(nColZ - 2);
+        const Double_t energy = random.Uniform(0.5, 3.);
+        for(int cell = 0; cell < 9; ++cell) {
+          const int ix = cell/3 - 1, iz = cell%3 - 1;
+          index[cell] = (x + ix)*nColZ + z + iz;
+          amp[cell] = energy * std::exp(-2.*(ix*ix + iz*iz)) / 2.1 / trueParams.GetCCArray()[index[cell]];
+        }
+        event.AddCluster(&index[0], &amp[0], 9, energy, TVector3());
+      }
+      for(UInt_t c1 = 0; c1 < nClusters; ++c1)
+        for(UInt_t c2 = c1 + 1; c2 < nClusters; ++c2)
+          event.AddPair(c1, c2, 0);
+    }
+  }
+
+  // relative rms of params cc's wrt the true cc's
+  inline Double_t RelativeRMS(const SampleParameters& params, const SampleParameters& trueParams)
+  {
+    Double_t sum = 0;
+    const Int_t nGood = params.GetNGood();
+    for(Int_t index = 0; index < nGood; ++index) {
+      const Double_t rel = params.GetCCArray()[index] / trueParams.GetCCArray()[index] - 1;
+      sum += rel*rel;
+    }
+    return nGood ? std::sqrt(sum/nGood) : 0;
+  }
+}
+
+#endif // SYNTHETICSAMPLES_H
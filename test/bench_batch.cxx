@@ -0,0 +1,144 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of sample batches: the pairs of synthetic events read in
+// rounds, as a reader would, into a heap allocated Sample per pair (the
+// dense amplitude arrays of nGood channels) versus into a recycled
+// SampleBatch, and added to a ClusterTable. Reports the time per round.
+// Fails unless both give the same table, each sample of the batch is the
+// Sample of its pair (its fields, and its cells as FillSample writes them
+// back), the model masses of the two tables are the same, and PopBack
+// empties a batch and then leaves it empty.
+//
+// usage: bench_batch [nEvents] [nClustersPerEvent] [nRounds] [nRowX] [nColZ]
+
+#include <iostream>
+#include <cstdlib>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "SampleBatch.h"
+#include "ClusterTable.h"
+#include "CoreSampleSet.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nEvents = argc > 1 ? atoi(argv[1]) : 1000;
+  const UInt_t nClusters = argc > 2 ? atoi(argv[2]) : 6;
+  const UInt_t nRounds = argc > 3 ? atoi(argv[3]) : 10;
+  const UInt_t nRowX = argc > 4 ? atoi(argv[4]) : 64;
+  const UInt_t nColZ = argc > 5 ? atoi(argv[5]) : 56;
+
+  SampleParameters params;
+  SyntheticSamples::MakeParameters(params, nRowX, nColZ);
+  std::vector<SampleEvent> events(nEvents);
+  SyntheticSamples::MakeEvents(events, params, nRowX, nColZ, nClusters);
+  UInt_t nPairs = 0, nCells = 0;
+  for(UInt_t idx = 0; idx < nEvents; ++idx) {
+    nPairs += events[idx].GetNPairs();
+    for(Int_t pair = 0; pair < events[idx].GetNPairs(); ++pair)
+      nCells += events[idx].GetNCells(events[idx].GetCluster1(pair)) + events[idx].GetNCells(events[idx].GetCluster2(pair));
+  }
+
+  ClusterTable samplesTable;
+  TStopwatch samplesWatch;
+  for(UInt_t round = 0; round < nRounds; ++round) {
+    samplesTable.Clear();
+    std::vector<Sample*> samples;
+    for(UInt_t idx = 0; idx < nEvents; ++idx)
+      for(Int_t pair = 0; pair < events[idx].GetNPairs(); ++pair) {
+        Sample* sample = new Sample(params.GetNGood());
+        events[idx].FillSample(pair, *sample);
+        samples.push_back(sample);
+      }
+    for(UInt_t idx = 0; idx < samples.size(); ++idx) {
+      samplesTable.AddSample(*samples[idx]);
+      delete samples[idx];
+    }
+  }
+  samplesWatch.Stop();
+
+  ClusterTable batchTable;
+  SampleBatch batch(nPairs, nCells);
+  TStopwatch batchWatch;
+  for(UInt_t round = 0; round < nRounds; ++round) {
+    batchTable.Clear();
+    batch.Reset();
+    for(UInt_t idx = 0; idx < nEvents; ++idx)
+      for(Int_t pair = 0; pair < events[idx].GetNPairs(); ++pair)
+        batch.Add(events[idx], pair);
+    batchTable.AddBatch(batch);
+  }
+  batchWatch.Stop();
+
+  // popping every sample, and once more
+  SampleBatch popped(2, nCells);
+  popped.Add(events[0], 0);
+  popped.Add(events[0], 1);
+  for(Int_t idx = 0; idx < 3; ++idx)
+    popped.PopBack();
+  const Bool_t poppedEmpty = popped.GetNSamples() == 0 && popped.GetNCellEntries() == 0
+    && popped.Add(events[0], 0) == 0;
+
+  // a batch handed on is moved, its arena with it
+  SampleBatch handed(std::move(batch));
+  const Bool_t same = samplesTable.GetNSamples() == batchTable.GetNSamples()
+    && samplesTable.GetNClusters() == batchTable.GetNClusters()
+    && samplesTable.GetCellIndexArray() == batchTable.GetCellIndexArray()
+    && handed.GetNSamples() == nPairs && batch.GetCapacity() == 0;
+
+  // per pair, the batch sample against the Sample of the pair
+  Sample sample(params.GetNGood());
+  Sample back(params.GetNGood());
+  bool samePairs = handed.GetNSamples() == nPairs;
+  for(UInt_t idx = 0, entry = 0; samePairs && idx < nEvents; ++idx)
+    for(Int_t pair = 0; samePairs && pair < events[idx].GetNPairs(); ++pair, ++entry) {
+      events[idx].FillSample(pair, sample);
+      handed.FillSample(entry, back);
+      Double_t vertex[3];
+      handed.GetVertex(entry, vertex);
+      samePairs = handed.GetMass(entry) == sample.GetMass()
+        && handed.GetEnergy(entry, 0) == sample.GetEnergy1() && handed.GetEnergy(entry, 1) == sample.GetEnergy2()
+        && handed.GetPosition(entry, 0).X() == sample.GetPostion1().X() && handed.GetPosition(entry, 1).Z() == sample.GetPostion2().Z()
+        && vertex[0] == sample.GetVertex().X() && vertex[1] == sample.GetVertex().Y() && vertex[2] == sample.GetVertex().Z();
+      for(Int_t channel = 0; samePairs && channel < sample.Amplitudes1().GetSize(); ++channel)
+        samePairs = back.Amplitudes1()[channel] == sample.Amplitudes1()[channel]
+          && back.Amplitudes2()[channel] == sample.Amplitudes2()[channel];
+    }
+
+  // the masses of the model, of either table
+  CoreParameters core;
+  params.GetCore(core);
+  CoreSampleSet samplesSet, batchSet;
+  samplesTable.GetCore(samplesSet);
+  batchTable.GetCore(batchSet);
+  std::vector<Double_t> samplesMasses, batchMasses;
+  samplesSet.EvalMasses(core, samplesMasses);
+  batchSet.EvalMasses(core, batchMasses);
+  const bool sameMasses = samplesMasses.size() == nPairs && samplesMasses == batchMasses;
+
+  std::cout << "pairs " << nPairs << ", cells " << nCells << ", channels " << params.GetNGood() << std::endl
+            << "Sample per pair: " << samplesWatch.RealTime() / nRounds * 1e3 << " ms per round" << std::endl
+            << "SampleBatch:     " << batchWatch.RealTime() / nRounds * 1e3 << " ms per round, "
+            << handed.GetNCellEntries() * (sizeof(Int_t) + sizeof(Float_t)) / 1024 << " kB of cells" << std::endl
+            << "tables " << (same ? "identical" : "DIFFER") << ", samples " << (samePairs ? "those of the pairs" : "DIFFER")
+            << ", masses " << (sameMasses ? "identical" : "DIFFER") << ", PopBack " << (poppedEmpty ? "ok" : "FAILED") << std::endl;
+  return same && samePairs && sameMasses && poppedEmpty ? 0 : 1;
+}
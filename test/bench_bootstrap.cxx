@@ -0,0 +1,118 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the bootstrap uncertainties: the bootstrap spread of the
+// cc's of one synthetic sample set versus the actual scatter of the cc's
+// fitted to independent sample sets of the same truth, and the wall time
+// of the replicates with one and with all threads. Fails unless the
+// replicates agree across thread counts, the mean spread is within a factor
+// 2 of the scatter, and a memory budget is divided among the threads.
+//
+// usage: bench_bootstrap [nSamples] [nReplicates] [nIndependent] [nRowX] [nColZ]
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <TMath.h>
+#include "SyntheticSamples.h"
+#include "BootstrapCalibrator.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 10000;
+  const Int_t nReplicates = argc > 2 ? atoi(argv[2]) : 32;
+  const Int_t nIndependent = argc > 3 ? atoi(argv[3]) : 16;
+  const UInt_t nRowX = argc > 4 ? atoi(argv[4]) : 16;
+  const UInt_t nColZ = argc > 5 ? atoi(argv[5]) : 16;
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ);
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+  const UInt_t nGood = initial.GetNGood();
+
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ);
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < nSamples; ++idx)
+    table.AddSample(samples[idx]);
+
+  // bootstrap, with one thread and with all
+  BootstrapCalibrator bootstrap;
+  std::vector<Double_t> single;
+  Bool_t sameReplicates = kTRUE;
+  for(Int_t pass = 0; pass < 2; ++pass) {
+    bootstrap.SetNReplicates(nReplicates);
+    bootstrap.SetNThreads(pass ? 0 : 1);
+    bootstrap.Calibrate(table, initial);
+    std::cout << bootstrap.GetNThreadsUsed() << " threads: ";
+    bootstrap.PrintReport();
+    for(Int_t replicate = 0; replicate < nReplicates; ++replicate)
+      for(UInt_t cell = 0; cell < nGood; ++cell) {
+        if( ! pass )
+          single.push_back(bootstrap.GetReplicateCC(replicate, cell));
+        else
+          sameReplicates = sameReplicates && single[replicate*nGood + cell] == bootstrap.GetReplicateCC(replicate, cell);
+      }
+  }
+
+  // a budget, shared by 4 threads
+  BootstrapCalibrator budgeted;
+  const Long64_t budget = 1 << 20;
+  budgeted.SetNReplicates(4);
+  budgeted.SetNThreads(4);
+  budgeted.SetMemoryBudget(budget);
+  budgeted.Calibrate(table, initial);
+  const Bool_t budgetShared = budgeted.GetNThreadsUsed() == 4 && budgeted.GetReplicateBudget() == budget / 4;
+
+  // scatter of the fits of independent sample sets
+  std::vector<Double_t> sum(nGood, 0.), sum2(nGood, 0.);
+  for(Int_t set = 0; set < nIndependent; ++set) {
+    SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ, 0.002, 0.05, 100 + set);
+    NLLSCalibrator calibrator;
+    const SampleParameters result = calibrator.Calibrate(samples, initial);
+    for(UInt_t cell = 0; cell < nGood; ++cell) {
+      const Double_t cc = result.GetCCArray()[cell];
+      sum[cell] += cc;
+      sum2[cell] += cc*cc;
+    }
+  }
+
+  // ratio of bootstrap spread to actual scatter, over the channels
+  Double_t ratioSum = 0, coverage = 0;
+  UInt_t nCells = 0;
+  for(UInt_t cell = 0; cell < nGood; ++cell) {
+    const Double_t mean = sum[cell] / nIndependent;
+    const Double_t scatter = std::sqrt(TMath::Max(0., (sum2[cell] - nIndependent*mean*mean) / (nIndependent - 1)));
+    if( scatter <= 0 )
+      continue;
+    ratioSum += bootstrap.GetSpread(cell) / scatter;
+    const Double_t truth = trueParams.GetCCArray()[cell];
+    coverage += bootstrap.GetQuantile(cell, 0.16) <= truth && truth <= bootstrap.GetQuantile(cell, 0.84);
+    ++nCells;
+  }
+  std::cout << "channels " << nCells << ", mean bootstrap spread / independent scatter " << ratioSum / nCells
+            << ", truth within the 16-84% quantiles " << coverage / nCells << std::endl
+            << "replicates " << (sameReplicates ? "identical" : "DIFFER") << " across threads, budget per replicate "
+            << budgeted.GetReplicateBudget() << " bytes of " << budget << std::endl;
+  const Double_t ratio = ratioSum / nCells;
+  return sameReplicates && budgetShared && ratio > 0.5 && ratio < 2 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the shared cluster table: events with all clusters paired,
+// as ExtractCandidates does, calibrated from a table with each cluster
+// stored once (ClusterTable::AddEvent, or deduplicated by AddSample) versus
+// one with a copy of the clusters per pair. Reports the stored cells and
+// the time per residual and jacobian pass. Fails unless the shared tables
+// store fewer cells and fit the cc's of the per pair one (1e-9 rms), unless
+// a sample with an empty cluster adds nothing, and unless the samples, the
+// table and the parameters convert to the plain values of libCalibCore and
+// back unchanged.
+//
+// usage: bench_clustertable [nEvents] [nClustersPerEvent] [nRowX] [nColZ]
+
+#include <iostream>
+#include <cstdlib>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+#include "ClusterTable.h"
+#include "CoreSampleSet.h"
+
+namespace {
+  SampleParameters Report(const char* name, const ClusterTable& table, SampleParameters& initial)
+  {
+    NLLSCalibrator calibrator;
+    calibrator.SetMaxIterations(2);
+    calibrator.SetSigma(0.01);
+    const SampleParameters result = calibrator.Calibrate(table, initial);
+    const CalibStats& stats = calibrator.GetStats();
+    std::cout << name << ": samples " << table.GetNSamples() << ", clusters " << table.GetNClusters()
+              << ", cells stored " << table.GetNCellEntries()
+              << ", residual pass " << stats.GetRealTime(CalibStats::kResidual) / stats.GetNCalls(CalibStats::kResidual) << " s"
+              << ", jacobian pass " << stats.GetRealTime(CalibStats::kJacobian) / stats.GetNCalls(CalibStats::kJacobian) << " s"
+              << std::endl;
+    return result;
+  }
+}
+
+int main(int argc, char **argv) {
+  const UInt_t nEvents = argc > 1 ? atoi(argv[1]) : 2000;
+  const UInt_t nClusters = argc > 2 ? atoi(argv[2]) : 8;
+  const UInt_t nRowX = argc > 3 ? atoi(argv[3]) : 24;
+  const UInt_t nColZ = argc > 4 ? atoi(argv[4]) : 24;
+
+  SampleParameters params;
+  SyntheticSamples::MakeParameters(params, nRowX, nColZ);
+  std::vector<SampleEvent> events(nEvents);
+  SyntheticSamples::MakeEvents(events, params, nRowX, nColZ, nClusters);
+
+  // per pair copies, as the clusters of samples were
+  ClusterTable copies;
+  for(UInt_t idx = 0; idx < nEvents; ++idx) {
+    const SampleEvent& event = events[idx];
+    const Double_t vertex[3] = {event.GetVertex().X(), event.GetVertex().Y(), event.GetVertex().Z()};
+    for(Int_t pair = 0; pair < event.GetNPairs(); ++pair) {
+      const Int_t c1 = event.GetCluster1(pair), c2 = event.GetCluster2(pair);
+      const Int_t id1 = copies.AddCluster(event.GetCellIndex(c1), event.GetCellAmp(c1), event.GetNCells(c1), kFALSE);
+      const Int_t id2 = copies.AddCluster(event.GetCellIndex(c2), event.GetCellAmp(c2), event.GetNCells(c2), kFALSE);
+      copies.AddPair(id1, id2, vertex);
+    }
+  }
+  const SampleParameters perPair = Report("per pair", copies, params);
+
+  // shared, from the events
+  ClusterTable shared;
+  for(UInt_t idx = 0; idx < nEvents; ++idx)
+    shared.AddEvent(events[idx]);
+  const SampleParameters sharedResult = Report("shared", shared, params);
+
+  // shared, deduplicated from samples
+  ClusterTable deduplicated;
+  Sample sample(params.GetNGood());
+  for(UInt_t idx = 0; idx < nEvents; ++idx)
+    for(Int_t pair = 0; pair < events[idx].GetNPairs(); ++pair) {
+      events[idx].FillSample(pair, sample);
+      deduplicated.AddSample(sample);
+    }
+  const SampleParameters deduplicatedResult = Report("deduplicated samples", deduplicated, params);
+
+  // a sample with an empty second cluster
+  events[0].FillSample(0, sample);
+  for(Int_t idx = 0; idx < sample.Amplitude2().GetSize(); ++idx)
+    sample.Amplitude2()[idx] = 0;
+  const Int_t nClustersBefore = deduplicated.GetNClusters();
+  const Bool_t added = deduplicated.AddSample(sample);
+  const bool emptySkipped = ! added && deduplicated.GetNClusters() == nClustersBefore;
+
+  // as plain values and back, into a sample sized by its amplitudes
+  CoreSampleSet fromSamples;
+  Sample back;
+  back.Amplitude1().Set(params.GetNGood());
+  back.Amplitude2().Set(params.GetNGood());
+  bool coreKept = true;
+  for(Int_t pair = 0; pair < events[1].GetNPairs(); ++pair) {
+    events[1].FillSample(pair, sample);
+    sample.GetCore(fromSamples);
+    back.SetCore(fromSamples, fromSamples.GetNSamples() - 1);
+    for(Int_t idx = 0; idx < sample.Amplitudes1().GetSize(); ++idx)
+      coreKept = coreKept && back.Amplitudes1()[idx] == sample.Amplitudes1()[idx] && back.Amplitudes2()[idx] == sample.Amplitudes2()[idx];
+    coreKept = coreKept && back.GetVertex().Z() == sample.GetVertex().Z();
+  }
+  CoreSampleSet fromTable;
+  deduplicated.GetCore(fromTable);
+  coreKept = coreKept && fromTable.GetNSamples() == deduplicated.GetNSamples() && fromTable.GetNClusters() == deduplicated.GetNClusters();
+  for(UInt_t cluster = 0; coreKept && cluster < deduplicated.GetNClusters(); ++cluster) {
+    coreKept = fromTable.GetNCells(cluster) == deduplicated.GetNCells(cluster);
+    for(Int_t cell = 0; coreKept && cell < deduplicated.GetNCells(cluster); ++cell)
+      coreKept = fromTable.GetCells(cluster)[cell].fIndex == deduplicated.GetCellIndex(cluster)[cell]
+        && fromTable.GetCells(cluster)[cell].fAmp == deduplicated.GetCellAmp(cluster)[cell];
+  }
+  for(UInt_t idx = 0; coreKept && idx < deduplicated.GetNSamples(); ++idx)
+    coreKept = fromTable.GetSample(idx).fCluster[0] == deduplicated.GetCluster1(idx)
+      && fromTable.GetSample(idx).fCluster[1] == deduplicated.GetCluster2(idx);
+  CoreParameters core;
+  params.GetCore(core);
+  for(UInt_t idx = 0; idx < core.fChannels.size(); ++idx)
+    core.fChannels[idx].fCC = 1 + 0.001*idx;
+  SampleParameters fromCore(params);
+  fromCore.SetCore(core);
+  for(Int_t idx = 0; coreKept && idx < params.GetNGood(); ++idx)
+    coreKept = fromCore.GetCCArray()[idx] == core.fChannels[idx].fCC;
+
+  const Double_t sharedRMS = SyntheticSamples::RelativeRMS(sharedResult, perPair);
+  const Double_t deduplicatedRMS = SyntheticSamples::RelativeRMS(deduplicatedResult, perPair);
+  std::cout << "rms(cc/per pair - 1): shared " << sharedRMS << ", deduplicated " << deduplicatedRMS
+            << "; empty cluster " << (emptySkipped ? "skipped" : "ADDED")
+            << "; plain values " << (coreKept ? "round trip" : "CHANGED") << std::endl;
+  return shared.GetNCellEntries() < copies.GetNCellEntries() && deduplicated.GetNCellEntries() < copies.GetNCellEntries()
+    && sharedRMS < 1e-9 && deduplicatedRMS < 1e-9 && emptySkipped && coreKept ? 0 : 1;
+}
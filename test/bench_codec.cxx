@@ -0,0 +1,135 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the binary encoding of SampleParameters: time to encode and
+// decode the parameters of a full PHOS sized set of channels, the encoded
+// sizes, and the size and time of a delta encoding of an update of a
+// fraction of the cc's. Checks the round trip by encoding the decoded
+// parameters again, that decoding replaces all of the previous parameters,
+// and that a corrupt encoding leaves them unchanged.
+//
+// usage: bench_codec [nRowX] [nColZ] [changedFraction] [nRepeat]
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <TStopwatch.h>
+#include <TRandom3.h>
+#include "SyntheticSamples.h"
+#include "SampleParametersCodec.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nRowX = argc > 1 ? atoi(argv[1]) : 64*5;
+  const UInt_t nColZ = argc > 2 ? atoi(argv[2]) : 56;
+  const Double_t changedFraction = argc > 3 ? atof(argv[3]) : 0.01;
+  const UInt_t nRepeat = argc > 4 ? atoi(argv[4]) : 20;
+
+  SampleParameters params;
+  SyntheticSamples::MakeParameters(params, nRowX, nColZ);
+  std::vector<char> buffer;
+
+  TStopwatch encodeWatch;
+  for(UInt_t repeat = 0; repeat < nRepeat; ++repeat)
+    SampleParametersCodec::Encode(params, buffer);
+  encodeWatch.Stop();
+
+  SampleParameters decoded;
+  TStopwatch decodeWatch;
+  for(UInt_t repeat = 0; repeat < nRepeat; ++repeat)
+    if( ! SampleParametersCodec::Decode(&buffer[0], buffer.size(), decoded) )
+      return 1;
+  decodeWatch.Stop();
+
+  std::vector<char> again;
+  SampleParametersCodec::Encode(decoded, again);
+  const Bool_t roundTrip = again == buffer;
+  std::cout << "channels " << params.GetNGood() << ", encoded " << buffer.size() << " bytes"
+            << ", encode " << encodeWatch.RealTime() / nRepeat * 1e3 << " ms"
+            << ", decode " << decodeWatch.RealTime() / nRepeat * 1e3 << " ms"
+            << ", round trip " << (roundTrip ? "identical" : "DIFFERS") << std::endl;
+
+  // an update of a fraction of the cc's
+  SampleParameters updated;
+  SampleParametersCodec::Decode(&buffer[0], buffer.size(), updated);
+  TRandom3 random(1);
+  for(Int_t idx = 0; idx < updated.GetNGood(); ++idx)
+    if( random.Uniform() < changedFraction )
+      updated.SetCC(idx, random.Gaus(1, 0.1));
+
+  std::vector<char> delta;
+  TStopwatch deltaWatch;
+  for(UInt_t repeat = 0; repeat < nRepeat; ++repeat)
+    SampleParametersCodec::EncodeDelta(updated, params, delta);
+  deltaWatch.Stop();
+
+  TStopwatch applyWatch;
+  for(UInt_t repeat = 0; repeat < nRepeat; ++repeat) {
+    if( ! SampleParametersCodec::ApplyDelta(&delta[0], delta.size(), decoded, kFALSE) )
+      return 1;
+  }
+  applyWatch.Stop();
+
+  std::vector<char> updatedBuffer;
+  SampleParametersCodec::Encode(updated, updatedBuffer);
+  SampleParametersCodec::Encode(decoded, again);
+  const Bool_t deltaOK = again == updatedBuffer;
+  // decoded is no longer the base of the delta
+  const Bool_t baseChecked = ! SampleParametersCodec::ApplyDelta(&delta[0], delta.size(), decoded);
+  std::cout << "delta of " << changedFraction * 100 << "% of cc's: " << delta.size() << " bytes"
+            << ", encode " << deltaWatch.RealTime() / nRepeat * 1e6 << " us"
+            << ", apply " << applyWatch.RealTime() / nRepeat * 1e6 << " us"
+            << ", result " << (deltaOK ? "identical" : "DIFFERS")
+            << ", base check " << (baseChecked ? "ok" : "FAILED") << std::endl;
+
+  // decoded over parameters with local positions and transformations,
+  // parameters without have none left
+  SampleParameters bare(4);
+  for(UInt_t idx = 0; idx < 4; ++idx) {
+    bare.SetID(idx, idx + 1);
+    bare.SetCC(idx, 1);
+  }
+  std::vector<char> bareBuffer;
+  SampleParametersCodec::Encode(bare, bareBuffer);
+  SampleParameters replaced(params);
+  SampleParametersCodec::Decode(&bareBuffer[0], bareBuffer.size(), replaced);
+  SampleParametersCodec::Encode(replaced, again);
+  const Bool_t replacedOK = again == bareBuffer && ! replaced.GetLocalPos(0) && ! replaced.GetT(0);
+  std::cout << "decoded over other parameters: " << (replacedOK ? "replaced" : "STALE MEMBERS") << std::endl;
+
+  // corruption is detected, and the parameters left as they were: a
+  // flipped bit by the checksum, a payload with a byte too many, under a
+  // valid checksum, once all of it is read
+  std::vector<char> longer(buffer);
+  longer.push_back(0);
+  const ULong64_t headerSize = 24, payloadSize = longer.size() - headerSize;
+  memcpy(&longer[headerSize - sizeof(UInt_t) - sizeof(ULong64_t)], &payloadSize, sizeof(payloadSize));
+  const UInt_t crc = SampleParametersCodec::CRC32(&longer[headerSize], payloadSize);
+  memcpy(&longer[headerSize - sizeof(UInt_t)], &crc, sizeof(crc));
+  buffer[buffer.size() / 2] ^= 1;
+  const Bool_t corruptionDetected = ! SampleParametersCodec::Decode(&buffer[0], buffer.size(), replaced)
+    && ! SampleParametersCodec::Decode(&longer[0], longer.size(), replaced);
+  SampleParametersCodec::Encode(replaced, again);
+  const Bool_t unchanged = again == bareBuffer;
+  std::cout << "corruption " << (corruptionDetected ? "detected" : "NOT DETECTED")
+            << ", parameters " << (unchanged ? "unchanged" : "CHANGED") << std::endl;
+  return roundTrip && deltaOK && baseChecked && replacedOK && corruptionDetected && unchanged ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the calibration core without ROOT: links libCalibCore only.
+// Builds a nRowX x nColZ patch of module 0 and random 3x3 cluster pairs as
+// plain values, and times the mass pass of CoreSampleSet::EvalMasses. Fails
+// unless the masses scale with a common factor of the cc's to within 1e-6.
+//
+// usage: bench_core [nSamples] [nRowX] [nColZ]
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include "CoreParameters.h"
+#include "CoreSampleSet.h"
+
+namespace {
+  const Double_t kCellSize = 2.2;
+
+  void MakeParameters(CoreParameters& params, Int_t nRowX, Int_t nColZ)
+  {
+    params.fGlobals.fLogWeight = 4.5;
+    params.fGlobals.fParA = 0.925;
+    params.fGlobals.fParB = 6.25;
+    params.fGlobals.fCS = 0;
+    params.fGlobals.fIncident[0] = params.fGlobals.fIncident[1] = params.fGlobals.fIncident[2] = 0;
+    params.fGlobals.fNonLinearity = 0;
+    params.fGlobals.fNNonLinearParams = 0;
+    params.fChannels.resize(nRowX*nColZ);
+    for(Int_t x = 0; x < nRowX; ++x) {
+      for(Int_t z = 0; z < nColZ; ++z) {
+        CoreChannel& channel = params.fChannels[x*nColZ + z];
+        channel.fAbsId = 1 + x*56 + z;
+        channel.fCC = 1;
+        channel.fLocalX = (x + 0.5 - nRowX/2.)*kCellSize;
+        channel.fLocalZ = (z + 0.5 - nColZ/2.)*kCellSize;
+      }
+    }
+    params.fT[0][7] = 460; // translation y
+  }
+
+  void MakeSamples(CoreSampleSet& set, UInt_t nSamples, Int_t nRowX, Int_t nColZ)
+  {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<Int_t> centerX(1, nRowX - 2), centerZ(1, nColZ - 2);
+    std::uniform_real_distribution<Double_t> energy(0.5, 3.);
+    std::normal_distribution<Double_t> vertexZ(0, 5);
+    CoreCell cells[9];
+    for(UInt_t sample = 0; sample < nSamples; ++sample) {
+      // cluster centers, non overlapping
+      Int_t x[2], z[2];
+      do {
+        for(Int_t c = 0; c < 2; ++c) {
+          x[c] = centerX(random);
+          z[c] = centerZ(random);
+        }
+      } while( std::abs(x[0] - x[1]) < 3 && std::abs(z[0] - z[1]) < 3 );
+
+      Int_t clusters[2];
+      for(Int_t c = 0; c < 2; ++c) {
+        const Double_t e = energy(random);
+        Int_t nCells = 0;
+        for(Int_t ix = -1; ix <= 1; ++ix)
+          for(Int_t iz = -1; iz <= 1; ++iz) {
+            cells[nCells].fIndex = (x[c] + ix)*nColZ + z[c] + iz;
+            cells[nCells].fAmp = e * std::exp(-2.*(ix*ix + iz*iz)) / 2.;
+            ++nCells;
+          }
+        clusters[c] = set.AddCluster(cells, nCells);
+      }
+      const Double_t vertex[3] = {0, 0, vertexZ(random)};
+      set.AddSample(clusters[0], clusters[1], vertex);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 200000;
+  const Int_t nRowX = argc > 2 ? atoi(argv[2]) : 64;
+  const Int_t nColZ = argc > 3 ? atoi(argv[3]) : 56;
+
+  CoreParameters params;
+  MakeParameters(params, nRowX, nColZ);
+  CoreSampleSet set;
+  MakeSamples(set, nSamples, nRowX, nColZ);
+
+  std::vector<Double_t> masses;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  set.EvalMasses(params, masses);
+  const Double_t time = std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - start).count();
+
+  // a common factor of the cc's scales the energies, not the positions
+  CoreParameters scaled(params);
+  for(UInt_t idx = 0; idx < scaled.fChannels.size(); ++idx)
+    scaled.fChannels[idx].fCC = 1.1;
+  std::vector<Double_t> scaledMasses;
+  set.EvalMasses(scaled, scaledMasses);
+  Double_t maxDeviation = 0;
+  Double_t meanMass = 0;
+  for(UInt_t sample = 0; sample < nSamples; ++sample) {
+    meanMass += masses[sample] / nSamples;
+    if( masses[sample] > 0 )
+      maxDeviation = std::max(maxDeviation, std::fabs(scaledMasses[sample] / masses[sample] / 1.1 - 1));
+  }
+
+  std::cout << nSamples << " samples, " << params.GetNGood() << " channels: mass pass " << time << " s ("
+            << 1e9 * time / nSamples << " ns per sample), mean mass " << meanMass << " GeV" << std::endl
+            << "masses at 1.1 x cc, max relative deviation from 1.1 x mass: " << maxDeviation << std::endl;
+  return maxDeviation < 1e-6 ? 0 : 1;
+}
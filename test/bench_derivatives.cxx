@@ -0,0 +1,132 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the mass derivatives, analytic (MassKernel::MassGradient)
+// versus forward mode automatic differentiation (AutoDiff.h), on synthetic
+// samples. Reports the largest difference of the cc derivatives, the
+// global derivatives against finite differences, and the throughput of the
+// NLLSCalibrator jacobian pass with either. Fails unless the cc
+// derivatives agree to 1e-10, the global ones match the finite differences
+// to 1e-3, both fits give the same cc's and a sample with an empty cluster
+// has a mass and gradient of 0. The throughputs are reported.
+//
+// usage: bench_derivatives [nSamples] [nRowX] [nColZ]
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+#include "GeometryCache.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 20000;
+  const UInt_t nRowX = argc > 2 ? atoi(argv[2]) : 24;
+  const UInt_t nColZ = argc > 3 ? atoi(argv[3]) : 24;
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ);
+
+  // oblique incidence and depth correction, so that all globals matter
+  SampleParameters params(trueParams);
+  params.SetIncidentVector(TVector3(0.1, 1., 0.2));
+  params.SetParA(0.5);
+  params.SetParB(1.);
+  CoreParameters core;
+  params.GetCore(core);
+  const GeometryCache geometry(core);
+
+  // cc derivatives
+  const UInt_t nCheck = nSamples < 2000 ? nSamples : 2000;
+  Double_t maxDiff = 0;
+  TStopwatch analyticWatch, automaticWatch;
+  analyticWatch.Stop();
+  automaticWatch.Stop();
+  for(UInt_t idx = 0; idx < nCheck; ++idx) {
+    analyticWatch.Start(kFALSE);
+    const std::vector<Double_t> analytic = Calibrator::M_p(samples[idx], params, geometry);
+    analyticWatch.Stop();
+    automaticWatch.Start(kFALSE);
+    const std::vector<Double_t> automatic = Calibrator::M_pAD(samples[idx], params, geometry);
+    automaticWatch.Stop();
+    for(UInt_t cell = 0; cell < analytic.size(); ++cell)
+      maxDiff = std::max(maxDiff, std::fabs(analytic[cell] - automatic[cell]));
+  }
+  Bool_t good = maxDiff < 1e-10;
+  std::cout << "max |dM/dcc analytic - automatic| = " << maxDiff << " over " << nCheck << " samples" << std::endl;
+  std::cout << "M_p: " << nCheck / analyticWatch.RealTime() << " samples/s, M_pAD: "
+            << nCheck / automaticWatch.RealTime() << " samples/s" << std::endl;
+
+  // global derivatives, central differences
+  Double_t dMdGlobal[3];
+  Calibrator::M_pAD(samples[0], params, geometry, dMdGlobal);
+  const char* names[3] = {"LogWeight", "ParA", "ParB"};
+  const Float_t h = 1e-2;
+  for(int global = 0; global < 3; ++global) {
+    SampleParameters up(params), down(params);
+    if( global == 0 ) { up.SetLogWeight(params.GetLogWeight() + h); down.SetLogWeight(params.GetLogWeight() - h); }
+    if( global == 1 ) { up.SetParA(params.GetPara() + h); down.SetParA(params.GetPara() - h); }
+    if( global == 2 ) { up.SetParB(params.GetParb() + h); down.SetParB(params.GetParb() - h); }
+    const Double_t difference = (Calibrator::M(samples[0], up, geometry) - Calibrator::M(samples[0], down, geometry)) / (2*h);
+    std::cout << "dM/d" << names[global] << ": automatic " << dMdGlobal[global]
+              << ", finite difference " << difference << std::endl;
+    good = good && std::fabs(dMdGlobal[global] - difference) <= 1e-3 * std::fabs(difference) + 1e-12;
+  }
+
+  // jacobian pass of the calibration
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+  const NLLSCalibrator::Derivatives modes[2] = {NLLSCalibrator::kAnalytic, NLLSCalibrator::kAutomatic};
+  const char* modeNames[2] = {"analytic", "automatic"};
+  SampleParameters* results[2] = {0};
+  for(int mode = 0; mode < 2; ++mode) {
+    NLLSCalibrator calibrator;
+    calibrator.SetDerivatives(modes[mode]);
+    results[mode] = new SampleParameters(calibrator.Calibrate(samples, initial));
+
+    const CalibStats& stats = calibrator.GetStats();
+    const Double_t nEval = stats.GetNCalls(CalibStats::kJacobian) * Double_t(nSamples);
+    std::cout << modeNames[mode] << ", jacobian: " << nEval / stats.GetRealTime(CalibStats::kJacobian) << " samples/s"
+              << ", iterations: " << calibrator.GetNIterations()
+              << ", rms(cc/true - 1) = " << SyntheticSamples::RelativeRMS(*results[mode], trueParams) << std::endl;
+  }
+  const Double_t modeRMS = SyntheticSamples::RelativeRMS(*results[1], *results[0]);
+  std::cout << "rms(automatic/analytic - 1) = " << modeRMS << std::endl;
+  good = good && modeRMS < 1e-9;
+
+  // a sample with an empty second cluster, the first made so
+  Sample& empty = samples[0];
+  for(Int_t idx = 0; idx < empty.Amplitude2().GetSize(); ++idx)
+    empty.Amplitude2()[idx] = 0;
+  const std::vector<Double_t> emptyGradient = Calibrator::M_p(empty, params, geometry);
+  Bool_t emptyOk = Calibrator::M(empty, params, geometry) == 0;
+  for(UInt_t cell = 0; cell < emptyGradient.size(); ++cell)
+    emptyOk = emptyOk && emptyGradient[cell] == 0;
+  std::cout << "empty cluster: " << (emptyOk ? "mass and gradient 0" : "FAILED") << std::endl;
+
+  delete results[0];
+  delete results[1];
+  return good && emptyOk ? 0 : 1;
+}
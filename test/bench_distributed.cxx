@@ -0,0 +1,123 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the DistributedCalibrator: the synthetic samples are
+// partitioned over nRanks processes, connected by a SocketTransport, and
+// the result is compared with the NLLSCalibrator on all samples. Without a
+// rank, the workers are forked on this machine (unix socket by default);
+// with a rank, only that rank is run, e.g. one per node with a tcp address
+// (rank -1 forks). Fails unless the distributed cc's are the single
+// process ones, within 1e-6 rms, or unless the ranks used different
+// solvers (with a memory budget).
+//
+// usage: bench_distributed [nRanks] [nSamples] [address, - the default] [rank] [solver cg|cgls|ldlt] [budget kB, 0 none]
+
+#include <iostream>
+#include <cstdlib>
+#include <sstream>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "DistributedCalibrator.h"
+
+int main(int argc, char **argv) {
+  const Int_t nRanks = argc > 1 ? atoi(argv[1]) : 4;
+  const UInt_t nSamples = argc > 2 ? atoi(argv[2]) : 20000;
+  std::ostringstream defaultAddress;
+  defaultAddress << "unix:/tmp/bench_distributed_" << getpid() << ".sock";
+  const std::string address = argc > 3 && std::string(argv[3]) != "-" ? argv[3] : defaultAddress.str();
+  Int_t rank = argc > 4 ? atoi(argv[4]) : -1;
+  const std::string solverName = argc > 5 ? argv[5] : "cg";
+  const NLLSCalibrator::Solver solver = solverName == "cgls" ? NLLSCalibrator::kCGLS
+    : solverName == "ldlt" ? NLLSCalibrator::kLDLT : NLLSCalibrator::kCG;
+  const Long64_t budget = argc > 6 ? atoi(argv[6]) * 1024LL : 0;
+  const UInt_t nRowX = 24;
+  const UInt_t nColZ = 24;
+
+  // the same samples on all ranks
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ);
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+
+  // fork the workers
+  std::vector<pid_t> workers;
+  if( rank < 0 ) {
+    rank = 0;
+    for(Int_t worker = 1; worker < nRanks; ++worker) {
+      const pid_t pid = fork();
+      if( pid == 0 ) {
+        rank = worker;
+        workers.clear();
+        break;
+      }
+      workers.push_back(pid);
+    }
+  }
+
+  // the partition of this rank
+  ClusterTable partition;
+  for(UInt_t idx = rank; idx < nSamples; idx += nRanks)
+    partition.AddSample(samples[idx]);
+
+  SocketTransport transport(address.c_str(), rank, nRanks);
+  if( ! transport.IsConnected() )
+    return 1;
+  DistributedCalibrator distributed(transport);
+  distributed.SetSolver(solver);
+  distributed.SetMemoryBudget(budget, "/tmp");
+  TStopwatch watch;
+  const SampleParameters result = distributed.Calibrate(partition, initial);
+  watch.Stop();
+  if( rank != 0 )
+    return distributed.GetUsedSolver();
+
+  bool agree = true;
+  for(UInt_t idx = 0; idx < workers.size(); ++idx) {
+    int status = 0;
+    waitpid(workers[idx], &status, 0);
+    agree = agree && WIFEXITED(status) && WEXITSTATUS(status) == distributed.GetUsedSolver();
+  }
+  distributed.PrintReport();
+
+  NLLSCalibrator single;
+  single.SetSolver(solver);
+  single.SetMemoryBudget(budget, "/tmp");
+  TStopwatch singleWatch;
+  const SampleParameters reference = single.Calibrate(samples, initial);
+  singleWatch.Stop();
+
+  std::cout << "distributed, " << nRanks << " ranks: " << watch.RealTime() << " s, communication "
+            << distributed.GetStats().GetRealTime(CalibStats::kCommunication) << " s, iterations "
+            << distributed.GetNIterations() << std::endl;
+  std::cout << "single process: " << singleWatch.RealTime() << " s, iterations " << single.GetNIterations() << std::endl;
+  const Double_t rms = SyntheticSamples::RelativeRMS(result, reference);
+  std::cout << "rms(distributed/single - 1) = " << rms
+            << ", rms(cc/true - 1) = " << SyntheticSamples::RelativeRMS(result, trueParams) << std::endl;
+  if( budget > 0 )
+    std::cout << "memory budget " << budget / 1024 << " kB, solver distributed " << distributed.GetUsedSolver()
+              << ", single process " << single.GetUsedSolver() << std::endl;
+  return rms < 1e-6 && agree ? 0 : 1;
+}
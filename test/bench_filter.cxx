@@ -0,0 +1,144 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of filtered reading: synthetic events are written to a tree,
+// as ExtractorTask does with SetClusterTable, and read back into batches
+// by SampleReader, without a filter and with a mass window and vertex cut.
+// Reports the read time, the entries whose cells were decoded, and checks
+// the number of samples passing against the filter applied as written,
+// and against the filter without pushdown, reading every branch of every
+// entry, and the module cut on pairs of clusters within and across modules.
+// Fails unless all of these agree.
+//
+// usage: bench_filter [nEvents] [nClustersPerEvent] [file]
+
+#include <iostream>
+#include <cstdlib>
+#include <TFile.h>
+#include <TTree.h>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "SampleBatch.h"
+#include "SampleFilter.h"
+#include "SampleReader.h"
+
+namespace {
+  Long64_t ReadAll(SampleReader& reader, const SampleFilter* filter, Double_t& time)
+  {
+    reader.SetFilter(filter);
+    reader.Rewind();
+    SampleBatch batch(4096, 4096*2*16);
+    Long64_t nRead = 0;
+    TStopwatch watch;
+    while( ! reader.AtEnd() ) {
+      batch.Reset();
+      nRead += reader.Read(batch);
+    }
+    time = watch.RealTime();
+    return nRead;
+  }
+}
+
+namespace {
+  // the module cut is of the sample: both clusters in one module given
+  bool CheckModuleCut()
+  {
+    SampleParameters params(4);
+    const Int_t ids[4] = {1, 2, 3584 + 1, 3584 + 2}; // modules 0, 0, 1, 1
+    for(Int_t idx = 0; idx < 4; ++idx)
+      params.SetID(idx, ids[idx]);
+    const Int_t cells[4] = {0, 1, 2, 3};
+    SampleFilter module0(&params);
+    module0.Module(0);
+    SampleFilter modules01(module0);
+    modules01.Module(1);
+    const bool good = module0.PassCells(&cells[0], 1, &cells[1], 1) && ! module0.PassCells(&cells[0], 1, &cells[2], 1)
+      && ! module0.PassCells(&cells[2], 1, &cells[3], 1) && modules01.PassCells(&cells[2], 1, &cells[3], 1)
+      && ! modules01.PassCells(&cells[1], 1, &cells[2], 1) && ! modules01.PassCells(&cells[1], 2, &cells[3], 1);
+    std::cout << "module cut per sample: " << (good ? "ok" : "FAILED") << std::endl;
+    return good;
+  }
+}
+
+int main(int argc, char **argv) {
+  const bool moduleCutOk = CheckModuleCut();
+  const UInt_t nEvents = argc > 1 ? atoi(argv[1]) : 20000;
+  const UInt_t nClusters = argc > 2 ? atoi(argv[2]) : 3;
+  const char* filename = argc > 3 ? argv[3] : "bench_filter.root";
+  const UInt_t nRowX = 64, nColZ = 56;
+
+  SampleParameters params;
+  SyntheticSamples::MakeParameters(params, nRowX, nColZ);
+  std::vector<SampleEvent> events(nEvents);
+  SyntheticSamples::MakeEvents(events, params, nRowX, nColZ, nClusters);
+
+  // a narrow window, as when re-running with tighter cuts
+  SampleFilter filter(&params);
+  filter.MassWindow(0.130, 0.140).VertexZ(-2, 2);
+  Long64_t nPassing = 0;
+
+  // the synthetic pairs have no mass, one of a pi0 peak on a background
+  {
+    TRandom3 random(2);
+    TFile file(filename, "RECREATE");
+    params.Write("parameters");
+    TTree tree("fSampleTree", "Sample Tree");
+    SampleEvent* event = new SampleEvent();
+    tree.Branch("events", "SampleEvent", &event);
+    for(UInt_t idx = 0; idx < nEvents; ++idx) {
+      event->Reset();
+      event->SetVertex(events[idx].GetVertex());
+      for(Int_t cluster = 0; cluster < events[idx].GetNClusters(); ++cluster)
+        event->AddCluster(events[idx].GetCellIndex(cluster), events[idx].GetCellAmp(cluster), events[idx].GetNCells(cluster),
+                          events[idx].GetEnergy(cluster), events[idx].GetPosition(cluster));
+      for(Int_t pair = 0; pair < events[idx].GetNPairs(); ++pair) {
+        const Double_t mass = random.Uniform() < 0.3 ? random.Gaus(0.135, 0.006) : random.Uniform(0, 0.5);
+        nPassing += filter.Pass(*event, event->AddPair(events[idx].GetCluster1(pair), events[idx].GetCluster2(pair), mass));
+      }
+      tree.Fill();
+    }
+    tree.Write();
+    delete event;
+  }
+
+  SampleReader reader(filename);
+  if( ! reader.IsOpen() )
+    return 1;
+  Double_t allTime = 0, filteredTime = 0;
+  const Long64_t nAll = ReadAll(reader, NULL, allTime);
+  const Long64_t nAllDecoded = reader.GetNDecoded();
+  const Long64_t nFiltered = ReadAll(reader, &filter, filteredTime);
+  const Long64_t nDecoded = reader.GetNDecoded(), nSkipped = reader.GetNSkipped();
+  // the filter applied to fully read entries
+  Double_t unpushedTime = 0;
+  reader.SetPushdown(kFALSE);
+  const Long64_t nUnpushed = ReadAll(reader, &filter, unpushedTime);
+  const bool samePushdown = nUnpushed == nFiltered && reader.GetNDecoded() == reader.GetNEntries() && reader.GetNSkipped() == 0;
+
+  std::cout << "entries " << reader.GetNEntries() << std::endl
+            << "no filter: " << nAll << " samples, " << nAllDecoded << " entries decoded, " << allTime << " s" << std::endl
+            << "filtered:  " << nFiltered << " samples (" << nPassing << " in memory), "
+            << nDecoded << " entries decoded, " << nSkipped << " skipped, " << filteredTime << " s" << std::endl
+            << "no pushdown: " << nUnpushed << " samples, " << reader.GetNDecoded() << " entries decoded, "
+            << unpushedTime << " s, " << (samePushdown ? "the samples of the pushdown" : "NOT the samples of the pushdown") << std::endl;
+  return nFiltered == nPassing && samePushdown && moduleCutOk ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the sparse LDL^T solver: the analysis (ordering and pattern
+// of the factor) versus the numeric factorisation and solve, cold and from
+// the memory and disk caches, on the normal matrix pattern of synthetic
+// samples; and the calibration with kLDLT versus kCG. Fails unless every
+// factorisation is positive and solves to 1e-10, the caches are hit, no
+// temporary file is left in the cache directory, and the kLDLT cc's are the
+// kCG ones within 1e-6 rms.
+//
+// usage: bench_ldlt [nSamples] [nRowX] [nColZ] [cacheDirectory, a new one by default]
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <dirent.h>
+#include <unistd.h>
+#include <TRandom3.h>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+#include "SparseLDLT.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 20000;
+  const UInt_t nRowX = argc > 2 ? atoi(argv[2]) : 24;
+  const UInt_t nColZ = argc > 3 ? atoi(argv[3]) : 24;
+  // by default a new directory, removed at the end, so the cold pass is cold
+  char freshDirectory[] = "/tmp/bench_ldlt_XXXXXX";
+  const bool fresh = argc <= 4;
+  const char* cacheDirectory = fresh ? mkdtemp(freshDirectory) : argv[4];
+  if( ! cacheDirectory )
+    return 1;
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ);
+  TRandom3 random(12);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ);
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < nSamples; ++idx)
+    table.AddSample(samples[idx]);
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+  const UInt_t n = initial.GetNGood();
+
+  // the normal matrix of the samples, random positive rows
+  std::vector< std::vector<Int_t> > cliques(table.GetNSamples());
+  for(UInt_t sample = 0; sample < table.GetNSamples(); ++sample) {
+    const Int_t clusters[2] = {table.GetCluster1(sample), table.GetCluster2(sample)};
+    for(Int_t idx = 0; idx < 2; ++idx)
+      cliques[sample].insert(cliques[sample].end(), table.GetCellIndex(clusters[idx]), table.GetCellIndex(clusters[idx]) + table.GetNCells(clusters[idx]));
+    std::sort(cliques[sample].begin(), cliques[sample].end());
+    cliques[sample].erase(std::unique(cliques[sample].begin(), cliques[sample].end()), cliques[sample].end());
+  }
+  SparseMatrix a;
+  a.SetPattern(n, cliques);
+  std::vector<Double_t> g;
+  for(UInt_t sample = 0; sample < cliques.size(); ++sample) {
+    g.resize(cliques[sample].size());
+    for(UInt_t idx = 0; idx < g.size(); ++idx)
+      g[idx] = random.Uniform(0.1, 1);
+    a.AddOuter(&cliques[sample][0], &g[0], g.size(), 1);
+  }
+  const std::vector<Double_t> shift(n, 1e-3);
+  std::vector<Double_t> b(n), x(n), ax(n);
+  for(UInt_t idx = 0; idx < n; ++idx)
+    b[idx] = random.Gaus();
+
+  // cold, from memory, from disk
+  SparseLDLT::ClearCache();
+  SparseLDLT::SetCacheDirectory(cacheDirectory);
+  const char* names[3] = {"cold", "memory cache", "disk cache"};
+  bool good = true;
+  for(Int_t pass = 0; pass < 3; ++pass) {
+    if( pass == 2 )
+      SparseLDLT::ClearCache();
+    SparseLDLT ldlt;
+    TStopwatch watch;
+    ldlt.Analyse(a);
+    const Double_t analysis = watch.RealTime();
+    watch.Start();
+    const Int_t nFactorisations = 10;
+    Bool_t ok = kTRUE;
+    for(Int_t idx = 0; idx < nFactorisations; ++idx)
+      ok = ldlt.Factorise(a, shift) && ok;
+    const Double_t factorisation = watch.RealTime() / nFactorisations;
+    watch.Start();
+    ldlt.Solve(&b[0], &x[0]);
+    const Double_t solve = watch.RealTime();
+
+    // relative residual of the solution
+    a.Multiply(&x[0], &ax[0]);
+    Double_t residual = 0, norm = 0;
+    for(UInt_t idx = 0; idx < n; ++idx) {
+      const Double_t r = ax[idx] + shift[idx]*x[idx] - b[idx];
+      residual += r*r;
+      norm += b[idx]*b[idx];
+    }
+    std::cout << names[pass] << ": unknowns " << n << ", A non zero " << a.GetNNonZero() << ", L non zero " << ldlt.GetNNonZero()
+              << ", cached " << (ldlt.IsCached() ? "yes" : "no") << ", analysis " << analysis << " s, factorisation "
+              << factorisation << " s, solve " << solve << " s, positive " << (ok ? "yes" : "no")
+              << ", |Ax - b|/|b| " << std::sqrt(residual / norm) << std::endl;
+    good = good && ok && std::sqrt(residual / norm) < 1e-10 && (pass > 0 ? ldlt.IsCached() : ! fresh || ! ldlt.IsCached());
+  }
+  SparseLDLT::SetCacheDirectory(NULL);
+
+  // the analyses are renamed into place, ldlt_<hash>.bin
+  Int_t nTemporary = 0;
+  if( DIR* directory = opendir(cacheDirectory) ) {
+    while( const dirent* entry = readdir(directory) ) {
+      nTemporary += std::strncmp(entry->d_name, "ldlt_", 5) == 0 && std::strstr(entry->d_name, ".bin.") != NULL;
+      if( fresh && entry->d_name[0] != '.' )
+        unlink((std::string(cacheDirectory) + "/" + entry->d_name).c_str());
+    }
+    closedir(directory);
+  }
+  if( fresh )
+    rmdir(cacheDirectory);
+  std::cout << "temporary files left in " << cacheDirectory << ": " << nTemporary << std::endl;
+  good = good && nTemporary == 0;
+
+  // the calibration, cg versus ldlt, the second ldlt fit with the analysis cached
+  SparseLDLT::ClearCache();
+  const NLLSCalibrator::Solver solvers[3] = {NLLSCalibrator::kCG, NLLSCalibrator::kLDLT, NLLSCalibrator::kLDLT};
+  const char* solverNames[3] = {"cg", "ldlt", "ldlt, cached"};
+  SampleParameters* reference = 0;
+  for(Int_t mode = 0; mode < 3; ++mode) {
+    NLLSCalibrator calibrator;
+    calibrator.SetSolver(solvers[mode]);
+    const SampleParameters result = calibrator.Calibrate(table, initial);
+    if( ! reference )
+      reference = new SampleParameters(result);
+    std::cout << solverNames[mode] << ": iterations " << calibrator.GetNIterations()
+              << ", solve time " << calibrator.GetStats().GetRealTime(CalibStats::kSolve) << " s"
+              << ", rms(cc/true - 1) = " << SyntheticSamples::RelativeRMS(result, trueParams)
+              << ", rms(cc/cg - 1) = " << SyntheticSamples::RelativeRMS(result, *reference) << std::endl;
+    good = good && SyntheticSamples::RelativeRMS(result, *reference) < 1e-6;
+  }
+  delete reference;
+  return good ? 0 : 1;
+}
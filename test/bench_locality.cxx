@@ -0,0 +1,189 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the locality preserving order of cells and samples
+// (CellOrdering): the cache misses of the reads of a residual pass (the
+// cells of the clusters, and the cc and geometry of each cell) in a
+// simulated set associative LRU cache, and the time per residual and
+// jacobian pass, in event order, with the cells renumbered only, and with
+// the cells renumbered and the samples sorted. The cc's of the ordered fit,
+// restored to the original channels, are compared with the direct fit.
+// Fails unless the restored cc's match the direct fit (1e-4 rms), sorting
+// the samples misses less than event order, and a cluster without cells or
+// a channel without a position is carried through Apply.
+//
+// usage: bench_locality [nSamples] [maxSeparation] [cacheKiB]
+
+#include <iostream>
+#include <cstdlib>
+#include <list>
+#include <stdint.h>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+#include "CellOrdering.h"
+#include "GeometryCache.h"
+
+namespace {
+  // set associative, least recently used, 64 byte lines
+  class Cache {
+  public:
+    Cache(UInt_t bytes, UInt_t ways) : fWays(ways), fSets(bytes / 64 / ways), fMisses(0), fReads(0) {}
+    void Read(const void* address) {
+      const uintptr_t line = uintptr_t(address) / 64;
+      std::list<uintptr_t>& set = fSets[line % fSets.size()];
+      ++fReads;
+      for(std::list<uintptr_t>::iterator it = set.begin(); it != set.end(); ++it)
+        if( *it == line ) {
+          set.splice(set.begin(), set, it);
+          return;
+        }
+      ++fMisses;
+      set.push_front(line);
+      if( set.size() > fWays )
+        set.pop_back();
+    }
+    ULong64_t GetMisses() const { return fMisses; }
+    ULong64_t GetReads() const { return fReads; }
+  private:
+    UInt_t fWays;
+    std::vector< std::list<uintptr_t> > fSets;
+    ULong64_t fMisses;
+    ULong64_t fReads;
+  };
+
+  // the fraction of reads missed
+  Double_t Report(const char* name, const ClusterTable& table, SampleParameters& params, UInt_t cacheBytes, SampleParameters& result)
+  {
+    CoreParameters core;
+    params.GetCore(core);
+    const GeometryCache geometry(core);
+    const Float_t* cc = params.GetCCArray().GetArray();
+    Cache cache(cacheBytes, 8);
+    for(UInt_t sample = 0; sample < table.GetNSamples(); ++sample) {
+      const Int_t clusters[2] = {table.GetCluster1(sample), table.GetCluster2(sample)};
+      for(Int_t idx = 0; idx < 2; ++idx) {
+        const Int_t* index = table.GetCellIndex(clusters[idx]);
+        const Float_t* amp = table.GetCellAmp(clusters[idx]);
+        for(Int_t cell = 0; cell < table.GetNCells(clusters[idx]); ++cell) {
+          cache.Read(index + cell);
+          cache.Read(amp + cell);
+          cache.Read(cc + index[cell]);
+          cache.Read(geometry.GetModuleArray() + index[cell]);
+          cache.Read(geometry.GetLocalXArray() + index[cell]);
+          cache.Read(geometry.GetLocalZArray() + index[cell]);
+        }
+      }
+    }
+
+    NLLSCalibrator calibrator;
+    result = calibrator.Calibrate(table, params);
+    const CalibStats& stats = calibrator.GetStats();
+    std::cout << name << ": reads " << cache.GetReads() << ", misses " << cache.GetMisses()
+              << " (" << 100. * cache.GetMisses() / cache.GetReads() << "%), per sample "
+              << Double_t(cache.GetMisses()) / table.GetNSamples()
+              << ", residual pass " << stats.GetRealTime(CalibStats::kResidual) / stats.GetNCalls(CalibStats::kResidual) << " s"
+              << ", jacobian pass " << stats.GetRealTime(CalibStats::kJacobian) / stats.GetNCalls(CalibStats::kJacobian) << " s"
+              << std::endl;
+    return Double_t(cache.GetMisses()) / cache.GetReads();
+  }
+}
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 50000;
+  const UInt_t maxSeparation = argc > 2 ? atoi(argv[2]) : 8;
+  const UInt_t cacheBytes = (argc > 3 ? atoi(argv[3]) : 32) * 1024;
+  // a full module
+  const UInt_t nRowX = GeometryCache::kNRowX;
+  const UInt_t nColZ = GeometryCache::kNColZ;
+
+  // the curve visits each cell of the square once, in steps to neighbours
+  const UInt_t order = 6, side = 1U << order;
+  std::vector<Int_t> visited(side*side, -1);
+  Bool_t curveOk = kTRUE;
+  for(UInt_t x = 0; x < side; ++x)
+    for(UInt_t z = 0; z < side; ++z) {
+      const UInt_t d = CellOrdering::HilbertIndex(order, x, z);
+      curveOk = curveOk && d < side*side && visited[d] < 0;
+      if( d < side*side )
+        visited[d] = x*side + z;
+    }
+  for(UInt_t d = 1; curveOk && d < side*side; ++d)
+    curveOk = std::abs(visited[d]/Int_t(side) - visited[d-1]/Int_t(side)) + std::abs(visited[d]%Int_t(side) - visited[d-1]%Int_t(side)) == 1;
+  std::cout << "hilbert curve of " << side << "x" << side << ": " << (curveOk ? "ok" : "FAILED") << std::endl;
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ, 0.002, 0.05, 1, maxSeparation);
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < nSamples; ++idx)
+    table.AddSample(samples[idx]);
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+
+  SampleParameters direct;
+  const Double_t directMisses = Report("event order", table, initial, cacheBytes, direct);
+
+  CellOrdering ordering;
+  ordering.Compute(initial);
+  SampleParameters orderedParams;
+  ordering.Apply(initial, orderedParams);
+  Bool_t good = curveOk;
+  Double_t sortedMisses = 1;
+  const char* names[2] = {"cells renumbered", "cells renumbered, samples sorted"};
+  for(Int_t mode = 0; mode < 2; ++mode) {
+    // a block of all cells keeps the samples in event order
+    ordering.SetBlockSize(mode ? 64 : initial.GetNGood());
+    ClusterTable ordered;
+    ordering.Apply(table, ordered);
+    SampleParameters orderedResult;
+    sortedMisses = Report(names[mode], ordered, orderedParams, cacheBytes, orderedResult);
+    SampleParameters restored(initial);
+    const Bool_t ok = ordering.Restore(orderedResult, restored);
+    std::cout << "   restored " << (ok ? "ok" : "FAILED") << ", rms(cc/direct - 1) = " << SyntheticSamples::RelativeRMS(restored, direct)
+              << ", rms(cc/true - 1) = " << SyntheticSamples::RelativeRMS(restored, trueParams) << std::endl;
+    good = good && ok && SyntheticSamples::RelativeRMS(restored, direct) < 1e-4;
+  }
+  good = good && sortedMisses < directMisses;
+
+  // a sample with a cluster without cells sorts last, and a channel
+  // without a position has none once renumbered
+  ClusterTable withEmpty;
+  const Double_t vertex[3] = {0, 0, 0};
+  const Int_t cells[2] = {0, 1};
+  const Float_t amps[2] = {1, 2};
+  const Int_t empty = withEmpty.AddCluster(NULL, NULL, 0, kFALSE);
+  const Int_t full = withEmpty.AddCluster(cells, amps, 2, kFALSE);
+  withEmpty.AddPair(empty, full, vertex);
+  withEmpty.AddPair(full, full, vertex);
+  ClusterTable emptyOrdered;
+  ordering.Apply(withEmpty, emptyOrdered);
+  const Bool_t emptyOk = emptyOrdered.GetNSamples() == 2 && ordering.GetOldSample(1) == 0
+    && emptyOrdered.GetNCells(emptyOrdered.GetCluster1(1)) == 0;
+  SampleParameters noPosition(initial);
+  noPosition.RemoveLocalPos(ordering.GetOldIndex(0));
+  ordering.Apply(noPosition, orderedParams);
+  const Bool_t positionOk = ! orderedParams.GetLocalPos(0) && orderedParams.GetLocalPos(1);
+  std::cout << "cluster without cells " << (emptyOk ? "ok" : "FAILED")
+            << ", channel without position " << (positionOk ? "ok" : "FAILED") << std::endl;
+  return good && emptyOk && positionOk ? 0 : 1;
+}
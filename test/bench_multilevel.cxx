@@ -0,0 +1,103 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the coarse to fine calibration (MultilevelCalibrator) from
+// nominal cc's: true cc's with a module offset and 8x8 and 2x2 tile
+// variations on top of the cell to cell spread, fitted per cell from the
+// start versus by modules, 8x8 and 2x2 tiles and then cells, all with sigma
+// estimated as the fit goes. Reports the unknowns, iterations and wall time
+// per level, and the accuracy. Fails unless the cost falls from level to
+// level, the fine level takes fewer iterations than the per cell fit and
+// ends at its cost (within 1e-3) and accuracy (rms within 5%). The coarse
+// levels each pass over all samples per iteration, so the multilevel wall
+// time is reported, not required to be lower.
+//
+// usage: bench_multilevel [nSamples] [moduleOffset] [tileSpread] [cellSpread]
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <TRandom3.h>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+#include "MultilevelCalibrator.h"
+#include "GeometryCache.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 100000;
+  const Double_t moduleOffset = argc > 2 ? atof(argv[2]) : 0.3;
+  const Double_t tileSpread = argc > 3 ? atof(argv[3]) : 0.1;
+  const Double_t cellSpread = argc > 4 ? atof(argv[4]) : 0.05;
+  // a full module
+  const UInt_t nRowX = GeometryCache::kNRowX;
+  const UInt_t nColZ = GeometryCache::kNColZ;
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeParameters(trueParams, nRowX, nColZ);
+  TRandom3 random(2);
+  std::vector<Double_t> tile8(64), tile2(32*28);
+  for(UInt_t idx = 0; idx < tile8.size(); ++idx)
+    tile8[idx] = 1 + random.Gaus(0, tileSpread);
+  for(UInt_t idx = 0; idx < tile2.size(); ++idx)
+    tile2[idx] = 1 + random.Gaus(0, tileSpread);
+  for(UInt_t x = 0; x < nRowX; ++x)
+    for(UInt_t z = 0; z < nColZ; ++z)
+      trueParams.SetCC(x*nColZ + z, (1 + moduleOffset) * tile8[(x/8)*7 + z/8] * tile2[(x/2)*28 + z/2] * (1 + random.Gaus(0, cellSpread)));
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ, 0.002, 0.05, 1, 8);
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < nSamples; ++idx)
+    table.AddSample(samples[idx]);
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+  std::cout << "start: rms(cc/true - 1) = " << SyntheticSamples::RelativeRMS(initial, trueParams) << std::endl;
+
+  TStopwatch watch;
+  NLLSCalibrator direct;
+  direct.SetMaxIterations(50);
+  const SampleParameters directResult = direct.Calibrate(table, initial);
+  const Double_t directTime = watch.RealTime();
+  const Double_t directRMS = SyntheticSamples::RelativeRMS(directResult, trueParams);
+  std::cout << "per cell: unknowns " << direct.GetNParams() << ", iterations " << direct.GetNIterations()
+            << ", cost " << direct.GetCost() << ", " << directTime << " s"
+            << ", rms(cc/true - 1) = " << directRMS << std::endl;
+
+  watch.Start();
+  MultilevelCalibrator multilevel;
+  multilevel.GetFitter().SetMaxIterations(50);
+  const SampleParameters result = multilevel.Calibrate(table, initial);
+  const Double_t time = watch.RealTime();
+  const Double_t rms = SyntheticSamples::RelativeRMS(result, trueParams);
+  const Int_t fine = multilevel.GetNLevels() - 1;
+  bool good = fine > 0 && multilevel.GetLevelNIterations(fine) < direct.GetNIterations()
+    && std::fabs(multilevel.GetLevelCost(fine) / direct.GetCost() - 1) < 1e-3 && rms < 1.05 * directRMS;
+  for(Int_t level = 0; level < multilevel.GetNLevels(); ++level) {
+    good = good && (level == 0 || multilevel.GetLevelCost(level) < multilevel.GetLevelCost(level - 1));
+    std::cout << "   level " << level << ": unknowns " << multilevel.GetLevelNParams(level)
+              << ", iterations " << multilevel.GetLevelNIterations(level) << ", cost " << multilevel.GetLevelCost(level)
+              << ", " << multilevel.GetLevelTime(level) << " s" << std::endl;
+  }
+  std::cout << "multilevel: " << time << " s, rms(cc/true - 1) = " << rms
+            << ", rms(cc/per cell - 1) = " << SyntheticSamples::RelativeRMS(result, directResult) << std::endl;
+  return good ? 0 : 1;
+}
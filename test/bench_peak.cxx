@@ -0,0 +1,94 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the single pass peak estimate of the cc's (PeakCalibrator)
+// as the start of the nonlinear fit: its time and accuracy, and the
+// iterations and time of NLLSCalibrator from the nominal cc's versus from
+// the estimate. Fails unless the estimate is closer to the true cc's than
+// the nominal ones and does not depend on the number of threads, and the
+// fit from the estimate needs fewer iterations than the fit from the
+// nominal cc's and ends at its cost (within 1e-3). The times are reported.
+//
+// usage: bench_peak [nSamples] [nRowX] [nColZ] [ccSpread] [nThreads]
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+#include "PeakCalibrator.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 50000;
+  const UInt_t nRowX = argc > 2 ? atoi(argv[2]) : 24;
+  const UInt_t nColZ = argc > 3 ? atoi(argv[3]) : 32;
+  const Double_t spread = argc > 4 ? atof(argv[4]) : 0.15;
+  const Int_t nThreads = argc > 5 ? atoi(argv[5]) : std::thread::hardware_concurrency();
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ, 2, spread);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ, 0.002, 0.05, 1, 8);
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < nSamples; ++idx)
+    table.AddSample(samples[idx]);
+  SampleParameters nominal;
+  SyntheticSamples::MakeParameters(nominal, nRowX, nColZ);
+  std::cout << "nominal: rms(cc/true - 1) = " << SyntheticSamples::RelativeRMS(nominal, trueParams) << std::endl;
+
+  TStopwatch watch;
+  PeakCalibrator peak;
+  peak.SetNThreads(nThreads);
+  SampleParameters estimate = peak.Calibrate(table, nominal);
+  const Double_t peakTime = watch.RealTime();
+  const Double_t peakRMS = SyntheticSamples::RelativeRMS(estimate, trueParams);
+  std::cout << "peak estimate: " << peakTime << " s, threads " << peak.GetNThreadsUsed()
+            << ", corrected " << peak.GetNCorrected() << " of " << nominal.GetNGood()
+            << ", rms(cc/true - 1) = " << peakRMS << std::endl;
+
+  PeakCalibrator serial;
+  serial.SetNThreads(1);
+  const Double_t threadRMS = SyntheticSamples::RelativeRMS(serial.Calibrate(table, nominal), estimate);
+  std::cout << "rms(cc 1 thread/cc - 1) = " << threadRMS << std::endl;
+  bool good = peakRMS < SyntheticSamples::RelativeRMS(nominal, trueParams) && threadRMS < 1e-12;
+
+  const char* names[2] = {"nlls from nominal", "nlls from estimate"};
+  SampleParameters* starts[2] = {&nominal, &estimate};
+  Int_t iterations[2];
+  Double_t cost[2], time[2], rms[2];
+  for(Int_t mode = 0; mode < 2; ++mode) {
+    watch.Start();
+    NLLSCalibrator calibrator;
+    calibrator.SetMaxIterations(50);
+    const SampleParameters result = calibrator.Calibrate(table, *starts[mode]);
+    iterations[mode] = calibrator.GetNIterations();
+    cost[mode] = calibrator.GetCost();
+    time[mode] = watch.RealTime();
+    rms[mode] = SyntheticSamples::RelativeRMS(result, trueParams);
+    std::cout << names[mode] << ": iterations " << iterations[mode] << ", cost " << cost[mode]
+              << ", " << time[mode] << " s, rms(cc/true - 1) = " << rms[mode] << std::endl;
+  }
+  good = good && iterations[1] < iterations[0] && std::fabs(cost[1] / cost[0] - 1) < 1e-3;
+  return good ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the joint calibration of run periods: synthetic periods whose
+// true cc's drift as a random walk, each with few samples, fitted as
+// independent calibrations and jointly with the smooth and reference
+// couplings; and the wall time of the joint fit against the number of
+// periods, which should grow linearly, reported. Fails unless the couplings
+// halve the error of the separate calibrations, the uncoupled joint fit is
+// within 10% of them and cgls fits the cc's of cg to 1e-6.
+//
+// usage: bench_periods [nSamples per period] [nPeriods] [drift] [nRowX] [nColZ]
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <TRandom3.h>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "PeriodCalibrator.h"
+
+namespace {
+
+  // the true cc's of the periods, a random walk of relative step drift
+  void MakePeriods(std::vector<SampleParameters>& trueParams, UInt_t nRowX, UInt_t nColZ, Double_t drift)
+  {
+    TRandom3 random(2);
+    for(UInt_t p = 0; p < trueParams.size(); ++p) {
+      SyntheticSamples::MakeParameters(trueParams[p], nRowX, nColZ);
+      for(Int_t cell = 0; cell < trueParams[p].GetNGood(); ++cell) {
+        const Double_t cc = p ? trueParams[p-1].GetCCArray()[cell] * (1 + random.Gaus(0, drift)) : 1 + random.Gaus(0, 0.05);
+        trueParams[p].SetCC(cell, cc);
+      }
+    }
+  }
+
+  void MakeTables(std::vector<ClusterTable>& tables, const std::vector<SampleParameters>& trueParams, UInt_t nSamples,
+                  UInt_t nRowX, UInt_t nColZ)
+  {
+    std::vector<Sample> samples(nSamples);
+    for(UInt_t p = 0; p < tables.size(); ++p) {
+      SyntheticSamples::MakeSamples(samples, trueParams[p], nRowX, nColZ, 0.002, 0.05, 100 + p);
+      tables[p].Clear();
+      for(UInt_t idx = 0; idx < nSamples; ++idx)
+        tables[p].AddSample(samples[idx]);
+    }
+  }
+
+  Double_t RelativeRMS(const std::vector<SampleParameters>& params, const std::vector<SampleParameters>& trueParams)
+  {
+    Double_t sum = 0;
+    for(UInt_t p = 0; p < params.size(); ++p) {
+      const Double_t rms = SyntheticSamples::RelativeRMS(params[p], trueParams[p]);
+      sum += rms*rms;
+    }
+    return std::sqrt(sum / params.size());
+  }
+}
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 2000;
+  const UInt_t nPeriods = argc > 2 ? atoi(argv[2]) : 8;
+  const Double_t drift = argc > 3 ? atof(argv[3]) : 0.002;
+  const UInt_t nRowX = argc > 4 ? atoi(argv[4]) : 16;
+  const UInt_t nColZ = argc > 5 ? atoi(argv[5]) : 16;
+
+  std::vector<SampleParameters> trueParams(nPeriods);
+  MakePeriods(trueParams, nRowX, nColZ, drift);
+  std::vector<SampleParameters> initial(nPeriods);
+  for(UInt_t p = 0; p < nPeriods; ++p)
+    SyntheticSamples::MakeParameters(initial[p], nRowX, nColZ);
+  std::vector<ClusterTable> tables(nPeriods);
+  MakeTables(tables, trueParams, nSamples, nRowX, nColZ);
+  std::vector<const ClusterTable*> tablePointers;
+  for(UInt_t p = 0; p < nPeriods; ++p)
+    tablePointers.push_back(&tables[p]);
+
+  // independent calibrations, one per period
+  std::vector<SampleParameters> separate(initial);
+  for(UInt_t p = 0; p < nPeriods; ++p) {
+    NLLSCalibrator calibrator;
+    separate[p] = calibrator.Calibrate(tables[p], initial[p]);
+  }
+  const Double_t separateRMS = RelativeRMS(separate, trueParams);
+  std::cout << "separate calibrations: relative rms " << separateRMS << std::endl;
+
+  // joint, the expected cc step of the couplings the drift
+  const PeriodCalibrator::Coupling couplings[4] = {PeriodCalibrator::kIndependent, PeriodCalibrator::kSmooth,
+                                                   PeriodCalibrator::kSmooth, PeriodCalibrator::kReference};
+  const char* names[4] = {"independent", "smooth", "smooth, cgls", "reference"};
+  Double_t jointRMS[4];
+  std::vector<SampleParameters> smooth;
+  Double_t cglsRMS = 0;
+  for(Int_t idx = 0; idx < 4; ++idx) {
+    PeriodCalibrator calibrator;
+    if( idx == 2 )
+      calibrator.SetSolver(NLLSCalibrator::kCGLS);
+    calibrator.SetCoupling(couplings[idx], couplings[idx] == PeriodCalibrator::kReference ? drift*std::sqrt(nPeriods/2.) : drift);
+    TStopwatch watch;
+    const std::vector<SampleParameters> joint = calibrator.Calibrate(tablePointers, initial);
+    jointRMS[idx] = RelativeRMS(joint, trueParams);
+    if( idx == 1 )
+      smooth = joint;
+    if( idx == 2 )
+      cglsRMS = RelativeRMS(joint, smooth);
+    std::cout << "joint " << names[idx] << ": relative rms " << jointRMS[idx]
+              << ", unknowns " << calibrator.GetNParams() << ", iterations " << calibrator.GetNIterations()
+              << ", cg iterations " << calibrator.GetNCGIterations() << ", " << watch.RealTime() << " s" << std::endl;
+  }
+
+  // scaling with the number of periods, smooth coupling
+  std::cout << "periods, wall time [s], per period [s], cg iterations, per iteration [s]" << std::endl;
+  for(UInt_t n = 1; n <= nPeriods; n *= 2) {
+    const std::vector<const ClusterTable*> some(tablePointers.begin(), tablePointers.begin() + n);
+    const std::vector<SampleParameters> someInitial(initial.begin(), initial.begin() + n);
+    PeriodCalibrator calibrator;
+    calibrator.SetCoupling(PeriodCalibrator::kSmooth, drift);
+    TStopwatch watch;
+    calibrator.Calibrate(some, someInitial);
+    const Double_t time = watch.RealTime();
+    const Double_t solve = calibrator.GetStats().GetRealTime(CalibStats::kSolve);
+    std::cout << n << ", " << time << ", " << time / n << ", " << calibrator.GetNCGIterations()
+              << ", " << (calibrator.GetNCGIterations() ? solve / calibrator.GetNCGIterations() : 0.) << std::endl;
+  }
+  std::cout << "rms(cc cgls/cg - 1) = " << cglsRMS << std::endl;
+  return jointRMS[1] < 0.5 * separateRMS && jointRMS[3] < 0.5 * separateRMS
+    && std::fabs(jointRMS[0] - separateRMS) < 0.1 * separateRMS && cglsRMS < 1e-6 ? 0 : 1;
+}
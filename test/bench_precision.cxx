@@ -0,0 +1,99 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the NLLSCalibrator precision modes, double versus mixed
+// (float evaluation with double accumulation and refinement), on synthetic
+// samples. Reports the evaluation throughput, the wall times and the final
+// accuracy, against a double fit converged far beyond the default stop.
+// The modes fit with the sigma the converged fit estimated last, so that
+// their costs compare. Fails unless the mixed fit is as close to it as the
+// double fit (within a factor 1.5) and its cost at most the double one
+// (within the relative stop tolerance, 1e-6), or unless a fit overwrote the
+// sigma setting.
+//
+// usage: bench_precision [nSamples] [nRowX] [nColZ]
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 20000;
+  const UInt_t nRowX = argc > 2 ? atoi(argv[2]) : 24;
+  const UInt_t nColZ = argc > 3 ? atoi(argv[3]) : 24;
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ);
+
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+
+  NLLSCalibrator converged;
+  converged.SetTolerance(1e-14);
+  converged.SetMaxIterations(200);
+  const SampleParameters reference = converged.Calibrate(samples, initial);
+  const Double_t sigma = converged.GetFitSigma();
+  bool sigmaKept = converged.GetSigma() <= 0 && sigma > 0;
+
+  const NLLSCalibrator::Precision precisions[2] = {NLLSCalibrator::kDouble, NLLSCalibrator::kMixed};
+  const char* names[2] = {"double", "mixed"};
+  SampleParameters* results[2] = {0};
+  Double_t costs[2] = {0};
+  Double_t distances[2] = {0};
+  for(int mode = 0; mode < 2; ++mode) {
+    NLLSCalibrator calibrator;
+    calibrator.SetPrecision(precisions[mode]);
+    calibrator.SetSigma(sigma);
+    TStopwatch watch;
+    results[mode] = new SampleParameters(calibrator.Calibrate(samples, initial));
+    watch.Stop();
+    calibrator.PrintReport();
+    costs[mode] = calibrator.GetCost();
+    sigmaKept = sigmaKept && calibrator.GetSigma() == sigma && calibrator.GetFitSigma() == sigma;
+    distances[mode] = SyntheticSamples::RelativeRMS(*results[mode], reference);
+
+    const CalibStats& stats = calibrator.GetStats();
+    const CalibStats::Stage stages[2] = {CalibStats::kResidual, CalibStats::kJacobian};
+    for(int idx = 0; idx < 2; ++idx) {
+      const Double_t nEval = stats.GetNCalls(stages[idx]) * Double_t(nSamples);
+      std::cout << names[mode] << ", " << CalibStats::GetStageName(stages[idx]) << ": "
+                << nEval / stats.GetRealTime(stages[idx]) << " samples/s" << std::endl;
+    }
+    std::cout << names[mode] << ": rms(cc/true - 1) = " << SyntheticSamples::RelativeRMS(*results[mode], trueParams)
+              << ", cost = " << calibrator.GetCost() << ", total evaluation time = "
+              << stats.GetRealTime(CalibStats::kResidual) + stats.GetRealTime(CalibStats::kJacobian) << " s, wall time = "
+              << watch.RealTime() << " s" << std::endl
+              << names[mode] << ": rms(cc/converged - 1) = " << distances[mode] << std::endl;
+  }
+  std::cout << std::setprecision(12) << "converged: iterations " << converged.GetNIterations() << ", cost " << converged.GetCost()
+            << "; double cost " << costs[0] << ", mixed cost " << costs[1] << std::endl << std::setprecision(6)
+            << "rms(mixed/double - 1) = " << SyntheticSamples::RelativeRMS(*results[1], *results[0]) << std::endl;
+
+  delete results[0];
+  delete results[1];
+  return sigmaKept && distances[1] <= 1.5 * distances[0] + 1e-6 && costs[1] <= costs[0] * (1 + 1e-6) ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the residual histograms: the wall time of a fit without and
+// with the per cell and module pull histograms, and the noisy channels
+// found by them. A few channels are made noisy by smearing their
+// amplitudes per sample, which no cc can correct.
+//
+// usage: bench_residuals [nSamples] [nRowX] [nColZ] [nNoisy]
+
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <TStopwatch.h>
+#include <TRandom3.h>
+#include <TMath.h>
+#include <TH1F.h>
+#include <TH2F.h>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+#include "ResidualHistograms.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 50000;
+  const UInt_t nRowX = argc > 2 ? atoi(argv[2]) : 24;
+  const UInt_t nColZ = argc > 3 ? atoi(argv[3]) : 24;
+  const Int_t nNoisy = argc > 4 ? atoi(argv[4]) : 5;
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ, 3);
+  TRandom3 random(13);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ);
+
+  // noisy channels, away from the patch edges
+  std::vector<Int_t> noisy;
+  for(Int_t idx = 0; idx < nNoisy; ++idx)
+    noisy.push_back((2 + random.Integer(nRowX - 4)) * nColZ + 2 + random.Integer(nColZ - 4));
+  std::sort(noisy.begin(), noisy.end());
+  noisy.erase(std::unique(noisy.begin(), noisy.end()), noisy.end());
+  for(UInt_t sample = 0; sample < nSamples; ++sample)
+    for(UInt_t idx = 0; idx < noisy.size(); ++idx) {
+      const Float_t smear = TMath::Max(0.2, 1 + random.Gaus(0, 0.3));
+      samples[sample].Amplitude1()[noisy[idx]] *= smear;
+      samples[sample].Amplitude2()[noisy[idx]] *= smear;
+    }
+
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < nSamples; ++idx)
+    table.AddSample(samples[idx]);
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+
+  NLLSCalibrator plain;
+  TStopwatch plainWatch;
+  plain.Calibrate(table, initial);
+  const Double_t plainTime = plainWatch.RealTime();
+
+  ResidualHistograms histograms;
+  NLLSCalibrator calibrator;
+  calibrator.SetResidualHistograms(&histograms);
+  TStopwatch watch;
+  calibrator.Calibrate(table, initial);
+  const Double_t time = watch.RealTime();
+
+  // the same fit again, into the same histograms, starts from empty ones;
+  // into others, merges to twice the entries
+  const Double_t nEntries = histograms.GetModuleStatistic(0, ResidualHistograms::kEntries);
+  calibrator.Calibrate(table, initial);
+  const Bool_t resetOk = histograms.GetModuleStatistic(0, ResidualHistograms::kEntries) == nEntries;
+  ResidualHistograms again;
+  calibrator.SetResidualHistograms(&again);
+  calibrator.Calibrate(table, initial);
+  ResidualHistograms merged(histograms);
+  merged.Add(again);
+
+  std::vector<Int_t> outliers;
+  histograms.FindOutliers(outliers, 0.5, 0.9, 50);
+  std::cout << "fit without histograms " << plainTime << " s, with " << time << " s" << std::endl
+            << "module 0: " << histograms.GetModuleStatistic(0, ResidualHistograms::kEntries) << " entries, mean pull "
+            << histograms.GetModuleStatistic(0, ResidualHistograms::kMean) << ", rms "
+            << histograms.GetModuleStatistic(0, ResidualHistograms::kRMS) << std::endl;
+  Int_t nFound = 0;
+  for(UInt_t idx = 0; idx < noisy.size(); ++idx) {
+    const Bool_t found = std::find(outliers.begin(), outliers.end(), noisy[idx]) != outliers.end();
+    nFound += found;
+    std::cout << "  noisy channel " << noisy[idx] << ": " << histograms.GetCellStatistic(noisy[idx], ResidualHistograms::kEntries)
+              << " entries, pull rms " << histograms.GetCellStatistic(noisy[idx], ResidualHistograms::kRMS)
+              << (found ? ", found" : ", missed") << std::endl;
+  }
+  std::cout << "outliers: " << outliers.size() << ", of them noisy: " << nFound << " of " << noisy.size() << std::endl
+            << "merged entries of module 0: " << merged.GetModuleStatistic(0, ResidualHistograms::kEntries) << std::endl;
+
+  delete histograms.CreateCellPulls();
+  delete histograms.CreateModulePulls(0);
+  delete histograms.CreateModuleMap(0, ResidualHistograms::kRMS);
+
+  const Bool_t mergedOk = merged.GetModuleStatistic(0, ResidualHistograms::kEntries)
+    == 2 * histograms.GetModuleStatistic(0, ResidualHistograms::kEntries);
+  return nFound == Int_t(noisy.size()) && mergedOk && resetOk ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the NLLSCalibrator linear solvers, the assembled normal
+// matrix with conjugate gradient versus the matrix free CGLS, with and
+// without warm starts, and of the conjugate gradient preconditioners, on
+// synthetic samples. Reports the inner iterations, the solve time and the
+// final accuracy. Fails unless every solver and preconditioner fits the
+// cc's of plain cg to 1e-6, and the block and incomplete cholesky
+// preconditioners need fewer cg iterations than jacobi.
+//
+// usage: bench_solvers [nSamples] [nRowX] [nColZ]
+
+#include <iostream>
+#include <cstdlib>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 20000;
+  const UInt_t nRowX = argc > 2 ? atoi(argv[2]) : 24;
+  const UInt_t nColZ = argc > 3 ? atoi(argv[3]) : 24;
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ);
+
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+
+  const NLLSCalibrator::Solver solvers[4] = {NLLSCalibrator::kCG, NLLSCalibrator::kCG, NLLSCalibrator::kCGLS, NLLSCalibrator::kCGLS};
+  const Bool_t warmStarts[4] = {kFALSE, kTRUE, kFALSE, kTRUE};
+  const char* names[4] = {"cg", "cg, warm start", "cgls", "cgls, warm start"};
+  SampleParameters* reference = 0;
+  Bool_t good = kTRUE;
+  for(int mode = 0; mode < 4; ++mode) {
+    NLLSCalibrator calibrator;
+    calibrator.SetSolver(solvers[mode]);
+    calibrator.SetWarmStart(warmStarts[mode]);
+    const SampleParameters result = calibrator.Calibrate(samples, initial);
+    if( ! reference )
+      reference = new SampleParameters(result);
+
+    const CalibStats& stats = calibrator.GetStats();
+    std::cout << names[mode] << ": iterations " << calibrator.GetNIterations()
+              << ", inner iterations " << calibrator.GetNCGIterations()
+              << ", solve time " << stats.GetRealTime(CalibStats::kSolve) << " s"
+              << ", rms(cc/true - 1) = " << SyntheticSamples::RelativeRMS(result, trueParams)
+              << ", rms(cc/cg - 1) = " << SyntheticSamples::RelativeRMS(result, *reference) << std::endl;
+    good = good && SyntheticSamples::RelativeRMS(result, *reference) < 1e-6;
+  }
+
+  // preconditioners, kCG
+  const Preconditioner::Type types[5] = {Preconditioner::kJacobi, Preconditioner::kBlockJacobi, Preconditioner::kBlockJacobi,
+                                         Preconditioner::kBlockJacobi, Preconditioner::kIncompleteCholesky};
+  const Int_t tileSizes[5] = {0, 2, 4, 0, 0};
+  const char* typeNames[5] = {"jacobi", "block jacobi 2x2 tiles", "block jacobi 4x4 tiles", "block jacobi modules", "incomplete cholesky"};
+  Int_t jacobiIterations = 0;
+  for(int mode = 0; mode < 5; ++mode) {
+    NLLSCalibrator calibrator;
+    calibrator.SetPreconditioner(types[mode], tileSizes[mode]);
+    const SampleParameters result = calibrator.Calibrate(samples, initial);
+
+    const CalibStats& stats = calibrator.GetStats();
+    std::cout << typeNames[mode] << ": iterations " << calibrator.GetNIterations()
+              << ", cg iterations " << calibrator.GetNCGIterations()
+              << ", solve time " << stats.GetRealTime(CalibStats::kSolve) << " s"
+              << ", rms(cc/jacobi - 1) = " << SyntheticSamples::RelativeRMS(result, *reference) << std::endl;
+    if( ! mode )
+      jacobiIterations = calibrator.GetNCGIterations();
+    good = good && SyntheticSamples::RelativeRMS(result, *reference) < 1e-6
+      && (! mode || calibrator.GetNCGIterations() < jacobiIterations);
+  }
+
+  delete reference;
+  return good ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the bounded memory calibration: the matrix free fit with
+// its jacobian rows in memory versus spilled to a scratch file under
+// memory budgets, and a budget below the normal matrix of kCG. Reports the
+// bytes spilled, the io time and the slowdown. Fails unless the cc's are
+// unchanged (1e-12), each budget spills, in more chunks the smaller it is,
+// and keeps the rows in memory within it (and a row), and kCG over budget
+// falls back to cgls.
+//
+// usage: bench_spill [nSamples] [nRowX] [nColZ] [scratchDirectory]
+
+#include <iostream>
+#include <cstdlib>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 100000;
+  const UInt_t nRowX = argc > 2 ? atoi(argv[2]) : 32;
+  const UInt_t nColZ = argc > 3 ? atoi(argv[3]) : 32;
+  const char* scratchDirectory = argc > 4 ? argv[4] : "/tmp";
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ);
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < nSamples; ++idx)
+    table.AddSample(samples[idx]);
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+
+  // cgls, unlimited and with budgets of a fraction of the rows
+  const Long64_t maxRowBytes = 18 * 12 + 4;
+  const Long64_t rowBytes = Long64_t(nSamples) * maxRowBytes;
+  const Double_t fractions[4] = {0, 0.5, 0.1, 0.01};
+  Double_t reference = 0;
+  SampleParameters* referenceParams = 0;
+  Bool_t good = kTRUE;
+  Int_t previousChunks = 0;
+  for(Int_t mode = 0; mode < 4; ++mode) {
+    NLLSCalibrator calibrator;
+    calibrator.SetSolver(NLLSCalibrator::kCGLS);
+    calibrator.SetMemoryBudget(Long64_t(fractions[mode] * rowBytes), scratchDirectory);
+    TStopwatch watch;
+    const SampleParameters result = calibrator.Calibrate(table, initial);
+    const Double_t time = watch.RealTime();
+    if( ! referenceParams ) {
+      referenceParams = new SampleParameters(result);
+      reference = time;
+    }
+    const RowStore& rows = calibrator.GetRows();
+    std::cout << "budget " << fractions[mode] << " of the rows: wall time " << time << " s, slowdown " << time / reference
+              << ", io " << calibrator.GetStats().GetRealTime(CalibStats::kIO) << " s, chunks " << rows.GetNChunks()
+              << ", in memory " << rows.GetPeakBytes() << " bytes"
+              << ", rms(cc/in memory - 1) = " << SyntheticSamples::RelativeRMS(result, *referenceParams) << std::endl;
+    calibrator.PrintReport();
+    const Bool_t spilled = calibrator.GetStats().GetNCalls(CalibStats::kIO) > 0;
+    good = good && SyntheticSamples::RelativeRMS(result, *referenceParams) < 1e-12
+      && (mode ? spilled && rows.GetNChunks() > previousChunks && rows.GetPeakBytes() <= ULong64_t(calibrator.GetMemoryBudget() + maxRowBytes)
+          : ! spilled && rows.GetNChunks() == 0);
+    previousChunks = rows.GetNChunks();
+  }
+
+  // kCG with a budget below its normal matrix falls back to matrix free
+  NLLSCalibrator calibrator;
+  calibrator.SetMemoryBudget(1 << 20, scratchDirectory);
+  const SampleParameters result = calibrator.Calibrate(table, initial);
+  std::cout << "cg, 1 MB budget: solver " << (calibrator.GetUsedSolver() == NLLSCalibrator::kCGLS ? "cgls" : "cg")
+            << ", rms(cc/in memory - 1) = " << SyntheticSamples::RelativeRMS(result, *referenceParams) << std::endl;
+  good = good && calibrator.GetUsedSolver() == NLLSCalibrator::kCGLS
+    && SyntheticSamples::RelativeRMS(result, *referenceParams) < 1e-12;
+  delete referenceParams;
+  return good ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the sweep of reconstruction settings (SweepCalibrator): a
+// grid of log weights calibrated from samples made with the default
+// settings, with the samples decoded once and the fits concurrent, versus
+// a job per variant decoding the samples itself. Reports the cost and peak
+// width per variant; the narrowest peak should be that of the settings of
+// the samples. (The synthetic samples have no incident vector, so the
+// depth correction does not change their masses and is not swept.)
+// Fails unless the narrowest peak is at the settings of the samples, the
+// calibration and cost of each variant are those of its job at the sigma
+// of the sweep, and the telemetry and the residual histograms reach the
+// caller.
+//
+// usage: bench_sweep [nSamples] [nRowX] [nColZ] [nThreads]
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+#include "SweepCalibrator.h"
+#include "Telemetry.h"
+#include "ResidualHistograms.h"
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 20000;
+  const UInt_t nRowX = argc > 2 ? atoi(argv[2]) : 24;
+  const UInt_t nColZ = argc > 3 ? atoi(argv[3]) : 32;
+  const Int_t nThreads = argc > 4 ? atoi(argv[4]) : std::thread::hardware_concurrency();
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ, 0.002, 0.05, 1, 8);
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+
+  std::vector<Float_t> logWeights, paraValues, parbValues;
+  for(Int_t idx = -2; idx <= 2; ++idx)
+    logWeights.push_back(initial.GetLogWeight() + 0.5*idx);
+  paraValues.push_back(initial.GetPara());
+  parbValues.push_back(initial.GetParb());
+
+  // the sweep, the samples decoded once
+  TStopwatch watch;
+  SweepCalibrator sweep;
+  sweep.SetNThreads(nThreads);
+  sweep.AddGrid(initial, logWeights, paraValues, parbValues);
+  Telemetry telemetry;
+  telemetry.SetKeepRecords();
+  sweep.SetTelemetry(&telemetry);
+  ResidualHistograms histograms;
+  sweep.SetResidualHistograms(&histograms);
+  const SampleParameters best = sweep.Calibrate(samples, initial);
+  const Double_t swept = watch.RealTime();
+
+  // a job per variant, each decoding the samples, at the sigma of the
+  // sweep; the histograms of that of the narrowest peak
+  ResidualHistograms jobHistograms;
+  Double_t maxRMS = 0, maxCost = 0;
+  watch.Start();
+  for(Int_t variant = 0; variant < sweep.GetNVariants(); ++variant) {
+    ClusterTable table;
+    for(UInt_t idx = 0; idx < nSamples; ++idx)
+      table.AddSample(samples[idx]);
+    NLLSCalibrator calibrator;
+    calibrator.SetSigma(sweep.GetFitSigma());
+    if( variant == sweep.GetBest() )
+      calibrator.SetResidualHistograms(&jobHistograms);
+    SampleParameters params(sweep.GetVariant(variant));
+    const SampleParameters result = calibrator.Calibrate(table, params);
+    maxRMS = std::max(maxRMS, SyntheticSamples::RelativeRMS(sweep.GetResult(variant), result));
+    maxCost = std::max(maxCost, std::fabs(sweep.GetCost(variant) / calibrator.GetCost() - 1));
+  }
+  const Double_t separate = watch.RealTime();
+
+  Double_t histogramEntries = 0;
+  Bool_t sameHistograms = histograms.GetNCells() == jobHistograms.GetNCells();
+  for(Int_t cell = 0; sameHistograms && cell < histograms.GetNCells(); ++cell) {
+    histogramEntries += histograms.GetCellStatistic(cell, ResidualHistograms::kEntries);
+    sameHistograms = std::fabs(histograms.GetCellStatistic(cell, ResidualHistograms::kMean)
+                               - jobHistograms.GetCellStatistic(cell, ResidualHistograms::kMean)) < 1e-9;
+  }
+
+  for(Int_t variant = 0; variant < sweep.GetNVariants(); ++variant)
+    std::cout << (variant == sweep.GetBest() ? "* " : "  ") << sweep.GetVariantName(variant)
+              << ": cost " << sweep.GetCost(variant) << ", peak width " << sweep.GetPeakWidth(variant)
+              << ", iterations " << sweep.GetNIterations(variant) << std::endl;
+  const SampleParameters& bestVariant = sweep.GetVariant(sweep.GetBest());
+  const Bool_t found = bestVariant.GetLogWeight() == trueParams.GetLogWeight();
+  std::cout << "variants " << sweep.GetNVariants() << ", threads " << sweep.GetNThreadsUsed()
+            << ": a job per variant " << separate << " s, sweep " << swept << " s"
+            << ", narrowest peak at the settings of the samples: " << (found ? "yes" : "no")
+            << ", rms(cc/true - 1) = " << SyntheticSamples::RelativeRMS(best, trueParams) << std::endl
+            << "sigma " << sweep.GetFitSigma() << ", against a job per variant: max rms(cc/job - 1) = " << maxRMS
+            << ", max |cost/job - 1| = " << maxCost
+            << ", telemetry fits " << telemetry.GetNFits() << ", histogram entries " << histogramEntries
+            << (sameHistograms ? ", those of its job" : ", NOT those of its job") << std::endl;
+  return found && maxRMS < 1e-9 && maxCost < 1e-9 && telemetry.GetNFits() == sweep.GetNVariants()
+    && histogramEntries > 0 && sameHistograms ? 0 : 1;
+}
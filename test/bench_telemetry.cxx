@@ -0,0 +1,144 @@
+/*
+    Library for the Outlier Robust Lest Squares based estimation/calibration
+    of PHOS calibration coefficiants for the ALICE Experiment.
+
+    Copyright (C) 2011  Henrik Qvigstad <henrik.qvigstad@cern.com>,
+		       Joseph Young <>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Benchmark of the convergence telemetry: the wall time of a fit without
+// telemetry, streaming CSV and streaming binary records, the records read
+// back, and a fit stopped early by the callback. Fails unless each stream
+// holds a record per iteration, the records read back are those kept in
+// memory (the binary ones exactly, the CSV ones in their integer fields and
+// the costs, which it writes in full), and the callback stops the fit after
+// exactly two iterations. The times are reported.
+//
+// usage: bench_telemetry [nSamples] [nRowX] [nColZ] [prefix]
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <TStopwatch.h>
+#include "SyntheticSamples.h"
+#include "NLLSCalibrator.h"
+#include "Telemetry.h"
+
+namespace {
+  Double_t Fit(ClusterTable& table, SampleParameters& initial, Telemetry* telemetry, NLLSCalibrator& calibrator)
+  {
+    calibrator.SetTelemetry(telemetry);
+    TStopwatch watch;
+    calibrator.Calibrate(table, initial);
+    return watch.RealTime();
+  }
+
+  Bool_t StopAfterTwo(const TelemetryRecord& record)
+  {
+    return record.fIteration < 1;
+  }
+
+  bool SameRecord(const TelemetryRecord& a, const TelemetryRecord& b)
+  {
+    return a.fFit == b.fFit && a.fIteration == b.fIteration && a.fPhase == b.fPhase && a.fNTrials == b.fNTrials
+      && a.fNInnerIterations == b.fNInnerIterations && a.fNDownWeighted == b.fNDownWeighted
+      && a.fCost == b.fCost && a.fRobustCost == b.fRobustCost && a.fGradientNorm == b.fGradientNorm
+      && a.fStepNorm == b.fStepNorm && a.fLambda == b.fLambda && a.fResidualTime == b.fResidualTime
+      && a.fJacobianTime == b.fJacobianTime && a.fSolveTime == b.fSolveTime;
+  }
+
+  // the fields of a CSV line the stream writes in full
+  bool SameLine(const std::string& line, const TelemetryRecord& record)
+  {
+    Int_t ints[TelemetryRecord::kNInts];
+    Double_t cost = 0, robustCost = 0;
+    if( sscanf(line.c_str(), "%d,%d,%d,%d,%d,%d,%lg,%lg", &ints[0], &ints[1], &ints[2], &ints[3], &ints[4], &ints[5],
+               &cost, &robustCost) != TelemetryRecord::kNInts + 2 )
+      return false;
+    return ints[0] == record.fFit && ints[1] == record.fIteration && ints[2] == record.fPhase && ints[3] == record.fNTrials
+      && ints[4] == record.fNInnerIterations && ints[5] == record.fNDownWeighted
+      && cost == record.fCost && robustCost == record.fRobustCost;
+  }
+}
+
+int main(int argc, char **argv) {
+  const UInt_t nSamples = argc > 1 ? atoi(argv[1]) : 20000;
+  const UInt_t nRowX = argc > 2 ? atoi(argv[2]) : 24;
+  const UInt_t nColZ = argc > 3 ? atoi(argv[3]) : 24;
+  const std::string prefix = argc > 4 ? argv[4] : "bench_telemetry";
+
+  SampleParameters trueParams;
+  SyntheticSamples::MakeTrueParameters(trueParams, nRowX, nColZ);
+  std::vector<Sample> samples(nSamples);
+  SyntheticSamples::MakeSamples(samples, trueParams, nRowX, nColZ);
+  ClusterTable table;
+  for(UInt_t idx = 0; idx < nSamples; ++idx)
+    table.AddSample(samples[idx]);
+  SampleParameters initial;
+  SyntheticSamples::MakeParameters(initial, nRowX, nColZ);
+
+  NLLSCalibrator plain;
+  const Double_t plainTime = Fit(table, initial, NULL, plain);
+
+  Telemetry csv;
+  csv.Open((prefix + ".csv").c_str(), Telemetry::kCSV);
+  csv.SetKeepRecords();
+  NLLSCalibrator csvCalibrator;
+  const Double_t csvTime = Fit(table, initial, &csv, csvCalibrator);
+  csv.Close();
+
+  Telemetry binary;
+  binary.Open((prefix + ".bin").c_str(), Telemetry::kBinary);
+  binary.SetKeepRecords();
+  NLLSCalibrator binaryCalibrator;
+  const Double_t binaryTime = Fit(table, initial, &binary, binaryCalibrator);
+  binary.Close();
+
+  std::vector<TelemetryRecord> records;
+  Telemetry::ReadBinary((prefix + ".bin").c_str(), records);
+  // a header, then a line per record
+  std::ifstream csvFile((prefix + ".csv").c_str());
+  Int_t nLines = 0;
+  bool sameContent = records.size() == binary.GetRecords().size() && csv.GetRecords().size() > 0;
+  for(std::string line; std::getline(csvFile, line); ++nLines)
+    if( nLines > 0 )
+      sameContent = sameContent && UInt_t(nLines) <= csv.GetRecords().size() && SameLine(line, csv.GetRecords()[nLines - 1]);
+  for(UInt_t idx = 0; sameContent && idx < records.size(); ++idx)
+    sameContent = SameRecord(records[idx], binary.GetRecords()[idx]);
+  std::cout << "fit without telemetry " << plainTime << " s, with csv " << csvTime << " s, with binary " << binaryTime << " s" << std::endl
+            << "records read back: " << records.size() << " of " << binaryCalibrator.GetNIterations() << " iterations"
+            << ", csv lines " << nLines << ", content " << (sameContent ? "that of the records kept" : "DIFFERENT") << std::endl;
+  for(UInt_t idx = 0; idx < records.size(); ++idx) {
+    const TelemetryRecord& record = records[idx];
+    std::cout << "  iteration " << record.fIteration << ": cost " << record.fCost << ", robust " << record.fRobustCost
+              << ", |g| " << record.fGradientNorm << ", |step| " << record.fStepNorm << ", lambda " << record.fLambda
+              << ", down weighted " << record.fNDownWeighted << ", trials " << record.fNTrials
+              << ", cg " << record.fNInnerIterations << ", jacobian " << record.fJacobianTime << " s"
+              << ", solve " << record.fSolveTime << " s" << std::endl;
+  }
+
+  Telemetry stopping;
+  stopping.SetCallback(StopAfterTwo);
+  NLLSCalibrator stopped;
+  Fit(table, initial, &stopping, stopped);
+  std::cout << "callback stop after two iterations: " << stopped.GetNIterations() << " iterations, stopped "
+            << (stopped.IsStopped() ? "yes" : "no") << std::endl;
+  return records.size() == UInt_t(binaryCalibrator.GetNIterations()) && nLines == csvCalibrator.GetNIterations() + 1
+    && sameContent && stopped.IsStopped() && stopped.GetNIterations() == 2 ? 0 : 1;
+}